@@ -27,7 +27,9 @@ struct Channel {
 		PAST_END
 	};
 
-	Retval<Keyframe, Status> sample(std::chrono::milliseconds time);
+	Retval<Keyframe, Status> sample(std::chrono::milliseconds time) const;
+	// Cursor is the keyframe interval found by the previous sample of the same playback, start it at 0
+	Retval<Keyframe, Status> sample(std::chrono::milliseconds time, size_t& cursor) const;
 
 	std::vector<std::chrono::milliseconds> time_points;
 	std::vector<Keyframe> keyframes;
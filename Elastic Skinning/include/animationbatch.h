@@ -0,0 +1,134 @@
+#pragma once
+
+#include "util.h"
+#include "simd.h"
+#include "skeleton.h"
+#include "jobsystem.h"
+
+#include <vector>
+#include <span>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <cstdint>
+
+/*
+* Batched CPU pose evaluation for large numbers of characters
+*
+* Instances of the same skeleton are packed four to a block, one per SIMD lane, and every bone
+* of a block is stored as lanes of its rotation and position components. Finding keyframe
+* intervals and gathering the keys is scalar, interpolation and pose propagation run on all
+* lanes at once. Clips are converted once per skeleton and animation into flat per track
+* arrays of key times and components.
+*
+* Rotations are interpolated with nlerp along the shorter arc, Skeleton::sample_animation_frame
+* lerps them without renormalizing, so poses of the two differ slightly between keys.
+*/
+class AnimationBatch {
+
+public:
+
+	enum class Error {
+		OK,
+		SKELETON_NOT_FINALIZED,
+		ANIMATION_NOT_FOUND,
+		INSTANCE_NOT_FOUND,
+		OUTPUT_TOO_SMALL
+	};
+
+	using InstanceId = uint32_t;
+
+	AnimationBatch() = default;
+
+	// Skeleton must be finalized and outlive the batch
+	Retval<InstanceId, Error> add_instance(const Skeleton& Skeleton);
+	void clear();
+
+	size_t instance_count() { return instances.size(); }
+
+	// Restarts the playback of the instance
+	Error play_animation(InstanceId Instance, StringHash Name, bool Loop);
+	void clear_animation(InstanceId Instance);
+
+	Error set_time(InstanceId Instance, std::chrono::milliseconds Time);
+	// Moves the playback of every instance forward
+	void advance(std::chrono::milliseconds Delta);
+
+	// Samples and propagates every instance, blocks are spread over Jobs when given
+	void evaluate(JobSystem* Jobs = nullptr);
+
+	// Writes the last evaluated pose of the instance, one bone per skeleton bone at the front of Out, which is only
+	// ever written to, so it may be mapped bone buffer memory
+	Error get_pose(InstanceId Instance, std::span<Bone> Out);
+
+private:
+
+	static constexpr uint32_t NO_TRACK = UINT32_MAX;
+
+	/*
+	* Flat copy of one animation of one skeleton
+	*/
+	struct Clip {
+		std::chrono::milliseconds duration{ 0 };
+
+		// bone_tracks[Bone Index], NO_TRACK for bones the clip does not animate
+		std::vector<uint32_t> bone_tracks;
+
+		struct Track {
+			uint32_t first_key{ 0 };
+			uint32_t key_count{ 0 };
+		};
+
+		std::vector<Track> tracks;
+
+		// Key arrays of all tracks back to back
+		std::vector<int64_t> times;
+		std::vector<float> rotation_x, rotation_y, rotation_z, rotation_w;
+		std::vector<float> position_x, position_y, position_z;
+	};
+
+	struct Instance {
+		uint32_t group{ 0 };
+		uint32_t lane{ 0 };
+
+		const Clip* clip{ nullptr };
+		bool is_looped{ false };
+		std::chrono::milliseconds time{ 0 };
+
+		// cursors[Track Index], keyframe intervals of the previous evaluation
+		std::vector<size_t> cursors;
+	};
+
+	// One block of the pose of four instances
+	struct BoneLanes {
+		Quatx4 rotation;
+		Vec3x4 position;
+	};
+
+	struct SkeletonGroup {
+		const Skeleton* skeleton{ nullptr };
+
+		// Lane order, block b holds lanes 4b to 4b + 3
+		std::vector<InstanceId> instances;
+
+		// poses[Block * Bone Count + Bone Index]
+		std::vector<BoneLanes> poses;
+	};
+
+	struct BlockRef {
+		uint32_t group;
+		uint32_t block;
+	};
+
+	const Clip* get_clip(const Skeleton& Skeleton, size_t AnimationIdx);
+
+	void evaluate_block(SkeletonGroup& Group, size_t Block);
+
+	std::vector<Instance> instances;
+	std::vector<SkeletonGroup> groups;
+	std::vector<BlockRef> blocks;
+
+	// clips[{ Skeleton, Animation Index }]
+	std::map<std::pair<const Skeleton*, size_t>, std::unique_ptr<Clip>> clips;
+
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "util.h"
+#include "skeleton.h"
+#include "jobsystem.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <span>
+#include <chrono>
+#include <unordered_map>
+#include <cstdint>
+
+struct AnimationScheduleSettings {
+	// Updates per second at or above near_screen_size and at or below far_screen_size, interpolated in between
+	float near_rate{ 30.0f };
+	float far_rate{ 10.0f };
+
+	// Fraction of the screen height covered by the bounds of a skeletal mesh
+	float near_screen_size{ 0.25f };
+	float far_screen_size{ 0.05f };
+};
+
+/*
+* Fixed rate skeleton posing
+*
+* Every skeleton is posed at its own rate, chosen by how large it appears on screen, instead of on
+* every frame. An update samples the pose at the time of the following update, so frames in between
+* blend the last two poses without trailing the animation. Updates start at staggered phases, so
+* skeletons sharing a rate fall on different frames rather than all on the same one.
+*/
+class AnimationScheduler {
+
+public:
+
+	enum class Error {
+		OK,
+		ENTRY_NOT_FOUND,
+		OUTPUT_TOO_SMALL
+	};
+
+	using EntryId = uint32_t;
+
+	static constexpr uint32_t NO_GENERATION = UINT32_MAX;
+
+	AnimationScheduler() = default;
+
+	void set_settings(const AnimationScheduleSettings& Settings) { settings = Settings; }
+
+	// Skeleton must outlive the scheduler, adding a skeleton twice returns its existing entry
+	EntryId add_skeleton(Skeleton& Skeleton);
+	void clear();
+
+	size_t entry_count() { return entries.size(); }
+
+	// Entries default to the near rate until given a size
+	void set_screen_size(EntryId Entry, float ScreenSize);
+
+	// Poses every entry that is due at Now, spread over Jobs when given, and returns how many were
+	size_t update(std::chrono::steady_clock::time_point Now, JobSystem* Jobs = nullptr);
+
+	// Blend of the last two poses of the entry at Now, one bone per skeleton bone at the front of Out
+	Error get_pose(EntryId Entry, std::chrono::steady_clock::time_point Now, std::span<Bone> Out);
+
+	// Changes whenever the entry is posed, NO_GENERATION before its first update. Entries without an
+	// animation are posed once and then left alone until one starts playing
+	uint32_t get_generation(EntryId Entry);
+
+	// Fraction of the screen height covered by a model space bounding sphere, xyz center and w radius
+	static float get_screen_size(const glm::vec4& Sphere, const glm::mat4& Model, const glm::mat4& View, const glm::mat4& Projection);
+
+private:
+
+	struct Entry {
+		Skeleton* skeleton{ nullptr };
+		float screen_size{ 1.0f };
+
+		// Fraction of a period the first update is moved ahead by, in (0, 1]
+		float phase{ 1.0f };
+
+		// Poses sampled at previous_time and next_time, the next update is due at next_time
+		std::vector<Bone> previous_pose;
+		std::vector<Bone> next_pose;
+		std::chrono::steady_clock::time_point previous_time;
+		std::chrono::steady_clock::time_point next_time;
+		// next_pose is the last of a loop, the update after it starts over without blending
+		bool ends_loop{ false };
+
+		uint32_t generation{ NO_GENERATION };
+
+		// Playback the poses were sampled from, restarting it poses the entry again immediately
+		const Animation* animation{ nullptr };
+		std::chrono::steady_clock::time_point animation_start;
+	};
+
+	std::chrono::steady_clock::duration get_period(float ScreenSize);
+
+	bool is_due(const Entry& Entry, std::chrono::steady_clock::time_point Now);
+	void pose(Entry& Entry, std::chrono::steady_clock::time_point Now);
+
+	AnimationScheduleSettings settings;
+
+	std::vector<Entry> entries;
+	std::unordered_map<const Skeleton*, EntryId> entry_ids;
+
+	// Reused every update
+	std::vector<EntryId> due_entries;
+
+};
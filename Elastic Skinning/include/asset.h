@@ -14,14 +14,17 @@ enum class AssetError {
 	NOT_FOUND,
 	INCORRECT_FILE_FORMAT,
 	READ_ERROR,
+	WRITE_ERROR,
 	INVALID_DATA
 };
 
 Retval<BinaryBlob, AssetError> load_binary_asset(std::filesystem::path path);
+AssetError save_binary_asset(std::filesystem::path path, const BinaryBlob& data);
 
 Retval<std::string, AssetError> load_text_asset(std::filesystem::path path);
 
 Retval<Image, AssetError> load_image(std::filesystem::path path);
 Retval<Image, AssetError> load_image(const BinaryBlob& data);
+AssetError save_image_png(std::filesystem::path path, const Image& image);
 
 Retval<Model, AssetError> load_model(std::filesystem::path path);
\ No newline at end of file
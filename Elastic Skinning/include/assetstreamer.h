@@ -0,0 +1,99 @@
+#pragma once
+
+#include "util.h"
+#include "gfxcontext.h"
+#include "uploadmanager.h"
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+/*
+* Background asset streaming
+*
+* CPU work such as parsing, decoding and baking runs on worker threads. The resulting data is
+* uploaded from the thread that owns the renderer through the transfer queue, and every resource
+* is released by the transfer family at the end of its batch. Once the batch is known to have
+* executed, the matching acquire barriers are recorded into the primary upload batch, which
+* executes before the next frame.
+*/
+class AssetStreamer {
+
+public:
+
+	enum class Error {
+		OK,
+		INVALID_CONTEXT,
+		UNINITIALIZED_CONTEXT,
+		FAIL_INIT_UPLOADS
+	};
+
+	using Ticket = uint64_t;
+
+	AssetStreamer() = default;
+	~AssetStreamer();
+
+	Error init(GfxContext* Context, size_t ThreadCount);
+	void deinit();
+
+	bool is_initialized() { return is_init; }
+
+	// Runs Job on a worker thread, jobs must not touch the GPU
+	void enqueue(std::function<void()> Job);
+
+	/*
+	* Upload recording, only valid on the thread that owns the renderer
+	*/
+
+	void upload_buffer(BufferAllocation Dest, const void* Source, size_t Size);
+	// FinalLayout is reached as part of the ownership transfer
+	void upload_texture(TextureAllocation Dest, const void* Source, size_t Size, vk::ImageLayout FinalLayout);
+
+	// Submits everything uploaded since the last submit
+	Ticket submit();
+
+	// Non blocking, records the acquire barriers the first time the uploads of Ticket are found complete
+	bool is_resident(Ticket Ticket);
+
+	// Blocks until every submitted upload executed, and records all pending acquires
+	void wait();
+
+private:
+
+	void worker_main();
+
+	// Both halves of an ownership transfer must describe the same barrier
+	void record_acquires(Ticket Ticket);
+
+	bool is_init{ false };
+
+	GfxContext* context{ nullptr };
+
+	UploadManager uploads;
+	bool transfers_ownership{ false };
+
+	std::vector<vk::BufferMemoryBarrier> pending_buffer_barriers;
+	std::vector<vk::ImageMemoryBarrier> pending_image_barriers;
+
+	struct Acquires {
+		std::vector<vk::BufferMemoryBarrier> buffer_barriers;
+		std::vector<vk::ImageMemoryBarrier> image_barriers;
+	};
+
+	// acquires[Ticket]
+	std::unordered_map<Ticket, Acquires> acquires;
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex job_mutex;
+	std::condition_variable job_condition;
+	bool stopping{ false };
+
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "util.h"
+#include "animation.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <span>
+#include <chrono>
+#include <cstdint>
+
+// Largest error a removed key may introduce on top of quantization, rotations in radians
+struct AnimationCompressionSettings {
+	float rotation_tolerance{ 0.0005f };
+	float translation_tolerance{ 0.0001f };
+	float scale_tolerance{ 0.0001f };
+	float weight_tolerance{ 0.0001f };
+};
+
+/*
+* Quantized animation storage
+*
+* Every channel is split into rotation, translation, scale and weight tracks with their own key
+* times, each track only keeps the keys needed to stay within the tolerances and constant tracks
+* collapse to a single key. Rotations are stored as their three smallest components, the other
+* tracks as fractions of the bounds of the track, 16 bits per component. Sampling decodes the two
+* keys around the requested time in place.
+*/
+class CompressedAnimation {
+
+public:
+
+	enum class Error {
+		OK,
+		KEY_COUNT_MISMATCH
+	};
+
+	enum class TrackType : uint8_t {
+		Rotation,
+		Translation,
+		Scale,
+		Weight,
+		COUNT
+	};
+
+	static constexpr size_t TRACKS_PER_CHANNEL = static_cast<size_t>(TrackType::COUNT);
+
+	struct Track {
+		uint32_t first_key{ 0 };
+		uint32_t key_count{ 0 };
+		// Into values, components of the keys back to back
+		uint32_t first_value{ 0 };
+		// Into bounds, minimum of every component then extent of every component, unused by rotations
+		uint32_t first_bound{ 0 };
+	};
+
+	static Retval<CompressedAnimation, Error> compress(const Animation& Source, const AnimationCompressionSettings& Settings = {});
+	// Full precision channels with a key wherever any of their tracks has one
+	Animation decompress() const;
+
+	bool empty() const { return tracks.empty(); }
+	size_t channel_count() const { return channel_names.size(); }
+	bool has_keys(size_t Channel) const;
+	// Time of the last key of the channel
+	std::chrono::milliseconds get_channel_duration(size_t Channel) const;
+
+	// Cursors are the keyframe intervals of the tracks of the channel found by the previous sample of the same playback, start them at 0
+	Keyframe sample(size_t Channel, std::chrono::milliseconds Time, std::span<size_t, TRACKS_PER_CHANNEL> Cursors) const;
+	Keyframe sample(size_t Channel, std::chrono::milliseconds Time) const;
+
+	size_t get_memory_size() const;
+	static size_t get_memory_size(const Animation& Source);
+
+	// Raw encoded data, for decoders elsewhere such as the GPU animation kernel
+	uint32_t get_time_step() const { return time_step; }
+	const std::vector<Track>& get_tracks() const { return tracks; }
+	const std::vector<uint16_t>& get_times() const { return times; }
+	const std::vector<uint16_t>& get_values() const { return values; }
+	const std::vector<float>& get_bounds() const { return bounds; }
+
+private:
+
+	// Finds the keys around Time and the weight of the second one
+	void locate(const Track& Track, std::chrono::milliseconds Time, size_t& Cursor, size_t& KeyA, size_t& KeyB, float& Weight) const;
+
+	glm::quat decode_rotation(const Track& Track, size_t Key) const;
+	// Components of translation, scale and weight tracks
+	void decode_range(const Track& Track, size_t Components, size_t Key, float* Out) const;
+
+	// Key times are multiples of it, 1 ms unless the clip is longer than 16 bits of milliseconds
+	uint32_t time_step{ 1 };
+
+	// tracks[Channel Index * TRACKS_PER_CHANNEL + Track Type]
+	std::vector<Track> tracks;
+	std::vector<uint16_t> times;
+	std::vector<uint16_t> values;
+	std::vector<float> bounds;
+	std::vector<StringHash> channel_names;
+
+};
@@ -7,6 +7,7 @@
 #include "computepipeline.h"
 #include "mesh.h"
 #include "elasticskinning.h"
+#include "gpuprofiler.h"
 
 #include <vulkan/vulkan.hpp>
 
@@ -20,18 +21,24 @@ class ElasticFieldComposer {
 
 public:
 
-	ElasticFieldComposer(GfxContext* Context, Swapchain* Swapchain);
+	// FrameCount is the number of frames in flight, each owns a set of intermediate fields
+	ElasticFieldComposer(GfxContext* Context, size_t FrameCount);
 	~ElasticFieldComposer();
 
 	void init_render_data(size_t MaxBones, size_t TotalBones, size_t MaxJoints, size_t TotalJoints, vk::Extent3D MaxFieldDims);
+	// Frees the intermediates and descriptor sets, init_render_data may be called again afterwards
+	void reset_render_data();
 
-	void record_descriptor_sets(MeshId MeshId, float FieldScale, std::vector<GPUTexture>& PartIsogradfields, std::vector<GPUTexture>& OutIsogradfields, std::vector<BufferAllocation>& BoneBuffers, Skeleton* Skeleton);
-	void record_command_buffer(Swapchain::FrameId FrameId, vk::CommandBuffer CommandBuffer, MeshId MeshId);
+	void record_descriptor_sets(MeshId MeshId, float FieldScale, std::vector<GPUTexture>& PartIsogradfields, std::vector<GPUTexture>& OutIsogradfields, std::vector<vk::DescriptorBufferInfo>& BoneBuffers, Skeleton* Skeleton);
+	// With DispatchArgs every field dispatch reads its size from the VkDispatchIndirectCommand at DispatchArgsOffset
+	void record_command_buffer(Swapchain::FrameId FrameId, vk::CommandBuffer CommandBuffer, MeshId MeshId, GpuProfiler* Profiler = nullptr, vk::Buffer DispatchArgs = nullptr, vk::DeviceSize DispatchArgsOffset = 0);
+
+	vk::Extent3D get_field_dims() { return field_dims; }
 
 private:
 
 	GfxContext* context{ nullptr };
-	Swapchain* swapchain{ nullptr };
+	size_t frame_count{ 0 };
 
 	vk::Sampler texture_sampler;
 
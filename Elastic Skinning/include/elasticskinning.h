@@ -3,15 +3,26 @@
 #include "util.h"
 #include "mesh.h"
 #include "skeleton.h"
+#include "jobsystem.h"
+
+#ifndef ELASTIC_NO_VULKAN
 #include "computepipeline.h"
+#endif
 
 #include <unordered_map>
 #include <vector>
+#include <string>
+#include <cmath>
+#include <cfloat>
 
+#ifndef ELASTIC_NO_VULKAN
 using BoneBuffer = Compute::StorageBuffer<Bone, 0>;
+#endif
 
 namespace ElasticSkinning {
 
+	// Kernels of the renderer, field baking below runs on the CPU alone
+#ifndef ELASTIC_NO_VULKAN
 	using CurrentIsogradfieldSampler = Compute::ImageSampler<3>;
 
 	struct SkinningContext {
@@ -21,7 +32,7 @@ namespace ElasticSkinning {
 		alignas(8) glm::ivec3 field_dims;
 	};
 
-	using SkinningComputePipeline = ComputePipeline<SkinningContext, VertexBuffer, ElasticVertexBuffer, BoneBuffer, CurrentIsogradfieldSampler>;
+	using SkinningComputePipeline = ComputePipeline<SkinningContext, PositionStreamBuffer, AttributeStreamBuffer, ElasticVertexBuffer, BoneBuffer, CurrentIsogradfieldSampler>;
 
 	using IsogradfieldSourceBuffer = Compute::ImageSampler<1>;
 	using IsogradfieldABuffer = Compute::StorageImage<1>;
@@ -39,6 +50,7 @@ namespace ElasticSkinning {
 
 	using FieldTxComputePipeline = ComputePipeline<FieldTxContext, BoneBuffer, IsogradfieldSourceBuffer, IsogradfieldOutBuffer>;
 	using FieldBlendComputePipeline = ComputePipeline<FieldBlendContext, IsogradfieldABuffer, IsogradfieldBBuffer, IsogradfieldOutBuffer>;
+#endif
 
 	template<typename T, size_t W = 32, size_t H = 32, size_t D = 32>
 	struct ValueField3D {
@@ -153,7 +165,8 @@ namespace ElasticSkinning {
 
 	std::unordered_map<StringHash, MeshPart> partition_skeletal_mesh(const SkeletalMesh& mesh, Skeleton& skeleton);
 
-	std::unordered_map<StringHash, HRBFData> create_hrbf_data(const std::unordered_map<StringHash, MeshPart>& mesh_partitions);
+	// Parts, and the slices of every part's field, are sampled in parallel
+	std::unordered_map<StringHash, HRBFData> create_hrbf_data(const std::unordered_map<StringHash, MeshPart>& mesh_partitions, JobSystem& Jobs);
 
 	HRBFData compose_hrbfs(const std::unordered_map<StringHash, HRBFData>& hrbfs, const std::unordered_map<StringHash, MeshPart>& mesh_partitions);
 
@@ -163,5 +176,5 @@ namespace ElasticSkinning {
 		std::unordered_map<StringHash, HRBFData> part_fields;
 	};
 
-	MeshAndField convert_skeletal_mesh(const SkeletalMesh& mesh, Skeleton& skeleton);
+	MeshAndField convert_skeletal_mesh(const SkeletalMesh& mesh, Skeleton& skeleton, JobSystem& Jobs);
 }
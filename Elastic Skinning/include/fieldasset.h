@@ -0,0 +1,56 @@
+#pragma once
+
+#include "util.h"
+#include "asset.h"
+#include "mesh.h"
+#include "skeleton.h"
+#include "jobsystem.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <filesystem>
+#include <cstdint>
+
+/*
+* Baked elastic fields
+*
+* Everything the CPU derives from a skeletal mesh before it can be skinned: the elastic mesh with
+* its isovalues and bones, the composed rest field and a field per bone, each voxel holding the
+* isovalue followed by the gradient. Baking dominates the cost of digesting a skeletal mesh, so
+* elastic_bake saves it offline and the renderer digests the saved asset instead of baking again.
+*/
+struct FieldAsset {
+	// Of the skeletal mesh and bind pose the asset was baked from, see hash_field_asset_source
+	uint64_t source_hash{ 0 };
+
+	std::string material_name;
+	ElasticMesh mesh;
+
+	float field_scale{ 1.0f };
+	glm::uvec3 field_dims{ 0, 0, 0 };
+	std::vector<glm::vec4> rest_field;
+	// part_fields[Bone Index], empty for bones without a part
+	std::vector<std::vector<glm::vec4>> part_fields;
+};
+
+// Thread safe, only reads the mesh and the skeleton, the fields are sampled on Jobs
+FieldAsset bake_field_asset(const SkeletalMesh& Mesh, Skeleton& Skeleton, JobSystem& Jobs);
+
+// CRC of the vertices and indices of Mesh and the bones of Skeleton, an asset whose source_hash differs is stale
+uint64_t hash_field_asset_source(const SkeletalMesh& Mesh, const Skeleton& Skeleton);
+
+// Every member is written explicitly, in host byte order, so the same bake always gives the same bytes
+BinaryBlob serialize_field_asset(const FieldAsset& Asset);
+Retval<FieldAsset, AssetError> deserialize_field_asset(const BinaryBlob& Data);
+
+AssetError save_field_asset(std::filesystem::path Path, const FieldAsset& Asset);
+Retval<FieldAsset, AssetError> load_field_asset(std::filesystem::path Path);
+
+// Where elastic_bake saves the field asset of a model's mesh, <Directory>/<model name>.<mesh index>.field
+std::filesystem::path get_field_asset_path(const std::filesystem::path& Directory, const std::filesystem::path& ModelPath, size_t MeshIndex);
+
+// One element per mesh of the model, empty for meshes without a readable asset in Directory
+std::vector<std::optional<FieldAsset>> load_field_assets(const std::filesystem::path& Directory, const std::filesystem::path& ModelPath, size_t MeshCount);
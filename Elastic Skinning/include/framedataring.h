@@ -0,0 +1,88 @@
+#pragma once
+
+#include "util.h"
+#include "gfxcontext.h"
+#include "swapchain.h"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+
+/*
+* Persistently mapped ring of per-frame data
+*
+* A single host visible buffer is split into one region per frame in flight. Every region
+* shares the same linear layout, so a sub-allocation reserved once is addressed in any frame
+* by the region offset plus the sub-allocation offset. The CPU writes straight into the mapped
+* region of the frame being prepared and flushes it with one call. Sub-allocations may also be
+* read as indirect dispatch arguments.
+*/
+class FrameDataRing {
+
+public:
+
+	enum class Error {
+		OK,
+		INVALID_CONTEXT,
+		UNINITIALIZED_CONTEXT,
+		ALREADY_COMMITTED,
+		NOT_COMMITTED,
+		FAIL_CREATE_BUFFER
+	};
+
+	struct Allocation {
+		vk::DeviceSize offset{ 0 };
+		vk::DeviceSize size{ 0 };
+	};
+
+	FrameDataRing() = default;
+	~FrameDataRing();
+
+	Error init(GfxContext* Context, size_t FrameCount);
+	void deinit();
+
+	bool is_initialized() { return is_init; }
+	bool is_committed() { return buffer.buffer != VK_NULL_HANDLE; }
+
+	// Reserves Size bytes in every frame region, only valid before commit()
+	Retval<Allocation, Error> reserve(vk::DeviceSize Size);
+
+	// Creates and maps the backing buffer for all reserved allocations
+	Error commit();
+
+	// Drops all reservations and the backing buffer, keeps the frame count
+	void reset();
+
+	void* get_mapped(Swapchain::FrameId FrameId, Allocation Allocation);
+
+	template <typename T>
+	T* get_mapped(Swapchain::FrameId FrameId, Allocation Allocation) {
+		return reinterpret_cast<T*>(get_mapped(FrameId, Allocation));
+	}
+
+	vk::DescriptorBufferInfo get_descriptor_info(Swapchain::FrameId FrameId, Allocation Allocation);
+
+	// Flushes the whole region of a frame, noop on host coherent memory
+	void flush(Swapchain::FrameId FrameId);
+
+	size_t frame_count() { return frames; }
+	vk::DeviceSize region_size() { return region_stride; }
+
+private:
+
+	static vk::DeviceSize align_up(vk::DeviceSize Value, vk::DeviceSize Alignment) {
+		return (Value + Alignment - 1) & ~(Alignment - 1);
+	}
+
+	bool is_init{ false };
+
+	GfxContext* context{ nullptr };
+
+	BufferAllocation buffer;
+
+	size_t frames{ 0 };
+	vk::DeviceSize alignment{ 1 };
+	vk::DeviceSize region_used{ 0 };
+	vk::DeviceSize region_stride{ 0 };
+
+};
@@ -12,6 +12,9 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <memory>
+#include <array>
+#include <mutex>
 
 #define REQUIRED_VULKAN_EXTENSIONS 
 
@@ -24,11 +27,65 @@
 #define VULKAN_VALIDATION_LAYERS \
 	"VK_LAYER_KHRONOS_validation"
 
+// Pipeline cache blob, loaded at startup and written back on shutdown
+#define PIPELINE_CACHE_PATH "pipelinecache.bin"
+
+/*
+* GPU memory accounting, every buffer and texture is created on behalf of one owner
+*/
+enum class MemoryCategory : uint32_t {
+	Meshes,
+	PartFields,
+	TransformedFields,
+	ComposerIntermediates,
+	Textures,
+	Staging,
+	RenderTargets,
+	FrameData,
+	DrawData,
+	AnimationData,
+	VertexCaches,
+	COUNT
+};
+
+const char* memory_category_name(MemoryCategory Category);
+
+struct MemoryStatistics {
+	struct Category {
+		// Size of the backing allocations, including alignment padding
+		vk::DeviceSize bytes{ 0 };
+		vk::DeviceSize peak_bytes{ 0 };
+		uint32_t allocation_count{ 0 };
+	};
+
+	struct Heap {
+		vk::DeviceSize usage{ 0 };
+		vk::DeviceSize budget{ 0 };
+		bool device_local{ false };
+
+		vk::DeviceSize headroom() const { return budget > usage ? budget - usage : 0; }
+	};
+
+	std::array<Category, static_cast<size_t>(MemoryCategory::COUNT)> categories;
+	vk::DeviceSize total_bytes{ 0 };
+	vk::DeviceSize peak_total_bytes{ 0 };
+
+	std::vector<Heap> heaps;
+
+	// Without VK_EXT_memory_budget heap usage only covers this allocator and the budget is an estimate
+	bool has_memory_budget{ false };
+
+	const Category& operator[](MemoryCategory C) const { return categories[static_cast<size_t>(C)]; }
+};
+
 struct BufferAllocation {
 	vk::Buffer buffer;
 	VmaAllocation allocation;
 
 	vk::DeviceSize size;
+
+	// Only set for persistently mapped allocations
+	void* mapped_data{ nullptr };
 };
 
 struct TextureAllocation {
@@ -46,6 +103,9 @@ struct GPUTexture {
 
 using MeshId = uint32_t;
 using ModelId = uint32_t;
+using InstanceId = uint32_t;
+
+class UploadManager;
 
 class GfxContext {
 
@@ -54,34 +114,48 @@ class GfxContext {
 	friend class GfxPipelineImpl;
 	friend class ComputePipelineImpl;
 	friend class ElasticFieldComposer;
+	friend class GpuProfiler;
+	friend class UploadManager;
+	friend class AssetStreamer;
 
 public:
 
 
 	GfxContext(Window* Window, const std::string& AppName = "", const std::string& EngineName = "No Engine");
+	// Headless context, no window, surface, or presentation support
+	GfxContext(const std::string& AppName = "", const std::string& EngineName = "No Engine");
 	~GfxContext();
 
 	bool is_initialized() { return is_init; }
+	bool is_headless() { return window == nullptr; }
+	// Without a dedicated transfer family the transfer queue is the primary queue
+	bool has_dedicated_transfer_queue() { return transfer_queue_family_index != primary_queue_family_index; }
 
 	vk::PhysicalDeviceProperties get_physical_device_properties();
+	// Optional features are only enabled when the device supports them
+	const vk::PhysicalDeviceFeatures& get_enabled_features() { return enabled_features; }
+	const vk::PhysicalDeviceVulkan12Features& get_enabled_vulkan12_features() { return enabled_vulkan12_features; }
 
-	BufferAllocation create_vertex_buffer(vk::DeviceSize Size);
-	BufferAllocation create_index_buffer(vk::DeviceSize Size);
+	// Transfer buffers are always accounted as staging, depth buffers as render targets
+	BufferAllocation create_vertex_buffer(vk::DeviceSize Size, MemoryCategory Category);
+	BufferAllocation create_index_buffer(vk::DeviceSize Size, MemoryCategory Category);
 	BufferAllocation create_transfer_buffer(vk::DeviceSize Size);
-	BufferAllocation create_uniform_buffer(vk::DeviceSize Size);
-	BufferAllocation create_storage_buffer(vk::DeviceSize Size);
-	BufferAllocation create_gpu_storage_buffer(vk::DeviceSize Size);
-	BufferAllocation create_buffer(vk::DeviceSize Size, vk::BufferUsageFlags Usage, vk::SharingMode SharingMode, VmaMemoryUsage Locality);
+	BufferAllocation create_uniform_buffer(vk::DeviceSize Size, MemoryCategory Category);
+	BufferAllocation create_storage_buffer(vk::DeviceSize Size, MemoryCategory Category);
+	BufferAllocation create_gpu_storage_buffer(vk::DeviceSize Size, MemoryCategory Category);
+	BufferAllocation create_mapped_buffer(vk::DeviceSize Size, vk::BufferUsageFlags Usage, MemoryCategory Category);
+	BufferAllocation create_buffer(vk::DeviceSize Size, vk::BufferUsageFlags Usage, vk::SharingMode SharingMode, VmaMemoryUsage Locality, MemoryCategory Category, VmaAllocationCreateFlags Flags = 0);
 	void destroy_buffer(BufferAllocation Buffer);
 
-	TextureAllocation create_texture_2d(vk::Extent2D Dimensions, vk::Format Format = vk::Format::eR8G8B8A8Srgb);
-	TextureAllocation create_texture_3d(vk::Extent3D Dimensions, vk::Format Format = vk::Format::eR8G8B8A8Srgb);
+	TextureAllocation create_texture_2d(vk::Extent2D Dimensions, MemoryCategory Category, vk::Format Format = vk::Format::eR8G8B8A8Srgb);
+	TextureAllocation create_texture_3d(vk::Extent3D Dimensions, MemoryCategory Category, vk::Format Format = vk::Format::eR8G8B8A8Srgb);
 	TextureAllocation create_depth_buffer(vk::Extent2D Dimensions);
 	TextureAllocation create_texture(
 		vk::ImageType Type,
 		vk::Format Format,
 		vk::ImageUsageFlags Usage,
 		vk::Extent3D Dimensions,
+		MemoryCategory Category,
 		uint32_t MipLevels = 1,
 		uint32_t ArrayLayers = 1,
 		vk::SampleCountFlags Samples = vk::SampleCountFlagBits::e1,
@@ -93,33 +167,72 @@ public:
 	void destroy_image_view(vk::ImageView View);
 
 	void transfer_buffer_memory(BufferAllocation Dest, BufferAllocation Source, vk::DeviceSize Size);
+	// Copies Regions[i] from Sources[i] into Dest, all in a single submission
+	void transfer_buffer_memory(BufferAllocation Dest, const std::vector<BufferAllocation>& Sources, const std::vector<vk::BufferCopy>& Regions);
 	void transfer_buffer_to_texture(TextureAllocation Dest, BufferAllocation Source, vk::DeviceSize Size);
 	void transfer_texture_to_buffer(BufferAllocation Dest, TextureAllocation Source);
 
+	// Uploads and layout transitions are batched, and only submitted by flush_uploads or the next one time command
 	void upload_to_gpu_buffer(BufferAllocation Dest, const BinaryBlob& Source);
 	void upload_to_gpu_buffer(BufferAllocation Dest, const void* Source, size_t Size);
 	void upload_texture(TextureAllocation Dest, const Image& Source);
 	void upload_texture(TextureAllocation Dest, const BinaryBlob& Source);
 	void upload_texture(TextureAllocation Dest, const void* Source, size_t Size);
+	void upload_texture(TextureAllocation Dest, const void* Source, size_t Size, vk::ImageLayout FinalLayout);
 
 	BinaryBlob download_gpu_buffer(BufferAllocation Source);
 	BinaryBlob download_texture(TextureAllocation Source);
+	BinaryBlob download_texture(TextureAllocation Source, vk::ImageLayout CurrentLayout);
 
 	void transition_image_layout(TextureAllocation Texture, vk::Format Format, vk::ImageLayout Old, vk::ImageLayout New);
 
+	// Submits pending uploads, must be called before submitting work that reads them
+	void flush_uploads();
+
 	vk::ShaderModule create_shader_module(std::filesystem::path path);
 	vk::ShaderModule create_shader_module(const BinaryBlob& code);
 
+	// Live totals and high water marks per category, and per heap usage against the budget
+	MemoryStatistics get_memory_statistics();
+	void log_memory_statistics();
+	bool has_memory_budget() { return memory_budget_enabled; }
+
 	VmaAllocator allocator;
 
 private:
 
+	void constructor_impl(Window* Window, const std::string& AppName, const std::string& EngineName);
+
 	vk::CommandBuffer one_time_command_begin();
 	void one_time_command_end(vk::CommandBuffer command);
 
+	void record_image_layout_transition(vk::CommandBuffer CommandBuffer, TextureAllocation Texture, vk::ImageLayout Old, vk::ImageLayout New);
+
+	/*
+	* Pipeline cache persistence, the blob is prefixed with the identity of the device and driver
+	* that produced it, and a blob from any other device or driver is discarded
+	*/
+	struct PipelineCachePrefix {
+		uint32_t magic;
+		uint32_t vendor_id;
+		uint32_t device_id;
+		uint32_t driver_version;
+		uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+		uint64_t data_size;
+	};
+
+	static const uint32_t PIPELINE_CACHE_MAGIC = 0x45534B43;
+
+	void create_pipeline_cache();
+	void save_pipeline_cache();
+
+	// The category travels with the allocation as its user data
+	void track_allocation(VmaAllocation Allocation, MemoryCategory Category);
+	void untrack_allocation(VmaAllocation Allocation);
+
 	bool is_init{ false };
 
-	Window* window;
+	Window* window{ nullptr };
 
 	vk::Instance vulkan_instance;
 	vk::DispatchLoaderDynamic instance_extension_loader;
@@ -127,11 +240,26 @@ private:
 	vk::SurfaceKHR render_surface;
 	vk::PhysicalDevice primary_physical_device;
 	vk::Device primary_logical_device;
+	vk::PhysicalDeviceFeatures enabled_features;
+	vk::PhysicalDeviceVulkan12Features enabled_vulkan12_features;
 
 	vk::Queue primary_queue;
 	uint32_t primary_queue_family_index;
 	vk::Queue present_queue;
 	uint32_t present_queue_family_index;
+	vk::Queue transfer_queue;
+	uint32_t transfer_queue_family_index;
 
 	vk::CommandPool memory_transfer_command_pool;
+	std::unique_ptr<UploadManager> upload_manager;
+
+	// Shared by every graphics and compute pipeline
+	vk::PipelineCache pipeline_cache;
+
+	bool memory_budget_enabled{ false };
+
+	std::mutex memory_statistics_mutex;
+	std::array<MemoryStatistics::Category, static_cast<size_t>(MemoryCategory::COUNT)> memory_categories;
+	vk::DeviceSize memory_total_bytes{ 0 };
+	vk::DeviceSize memory_peak_total_bytes{ 0 };
 };
\ No newline at end of file
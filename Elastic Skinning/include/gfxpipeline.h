@@ -19,6 +19,7 @@ struct GfxPipelineImpl {
 		UNINITIALIZED_CONTEXT,
 		INVALID_RENDER_PASS,
 		NO_SHADERS,
+		NO_BINDLESS_LAYOUT,
 		FAIL_CREATE_DESCRIPTOR_SET_LAYOUT,
 		FAIL_CREATE_PIPELINE_LAYOUT,
 		FAIL_CREATE_PIPELINE
@@ -35,9 +36,14 @@ struct GfxPipelineImpl {
 	GfxPipelineImpl& set_tessellation_eval_shader(std::filesystem::path path);
 	GfxPipelineImpl& set_geometry_shader(std::filesystem::path path);
 	GfxPipelineImpl& set_fragment_shader(std::filesystem::path path);
+	// Used by the renderer's depth prepass, which only binds the position stream
+	GfxPipelineImpl& set_depth_vertex_shader(std::filesystem::path path);
 	GfxPipelineImpl& set_target(RenderTarget Target);
+	// Textures and materials are indexed from the shader through the renderer's bindless set
+	GfxPipelineImpl& set_bindless_textures(bool Bindless = true);
 
-	Error init(GfxContext* Context, vk::Extent2D* Viewport, vk::RenderPass* RenderPass, uint32_t Subpass);
+	// Viewport and scissor are dynamic, they're set by whoever records the draws
+	Error init(GfxContext* Context, vk::RenderPass* RenderPass, uint32_t Subpass);
 	Error reinit();
 	void deinit();
 
@@ -59,34 +65,44 @@ struct GfxPipelineImpl {
 	std::filesystem::path tessellation_eval_shader_path;
 	std::filesystem::path geometry_shader_path;
 	std::filesystem::path fragment_shader_path;
+	std::filesystem::path depth_vertex_shader_path;
 
 	RenderTarget target{ RenderTarget::Swapchain };
 
+	// Bindless pipelines use bindless_set_layout as set 1, it's owned by the renderer
+	bool bindless_textures{ false };
+	vk::DescriptorSetLayout bindless_set_layout;
+
 protected:
 
 	bool is_init{ false };
 
 	GfxContext* context{ nullptr };
 	Swapchain* swapchain{ nullptr };
-	vk::Extent2D* viewport_size;
 	vk::RenderPass* render_pass;
 	uint32_t subpass;
 
-	vk::VertexInputBindingDescription vertex_binding_description;
+	std::vector<vk::VertexInputBindingDescription> vertex_binding_descriptions;
 	std::vector<vk::VertexInputAttributeDescription> vertex_attribute_descriptions;
 
 };
 
 
-template <VertexType Vtx, bool EnableSamplers, DescriptorType... Descriptors>
+// PositionOnly keeps the first vertex binding alone, which holds positions for streamed vertex types
+template <VertexType Vtx, bool EnableSamplers, bool PositionOnly, DescriptorType... Descriptors>
 struct GfxPipelineBuilder : public GfxPipelineImpl {
 
 	GfxPipelineBuilder() {
-		vertex_binding_description = Vtx::binding_description();
+		for (auto& binding : Vtx::binding_description()) {
+			if (!PositionOnly || binding.binding == 0) {
+				vertex_binding_descriptions.push_back(binding);
+			}
+		}
 
-		vertex_attribute_descriptions.resize(Vtx::attribute_description().size());
-		for (size_t i = 0; i < vertex_attribute_descriptions.size(); i++) {
-			vertex_attribute_descriptions[i] = Vtx::attribute_description()[i];
+		for (auto& attribute : Vtx::attribute_description()) {
+			if (!PositionOnly || attribute.binding == 0) {
+				vertex_attribute_descriptions.push_back(attribute);
+			}
 		}
 
 		std::vector<StringHash> names = { (Descriptors::name())... };
@@ -110,8 +126,8 @@ struct GfxPipelineBuilder : public GfxPipelineImpl {
 };
 
 template <VertexType Vtx, DescriptorType... Descriptors>
-struct GfxPipeline : public GfxPipelineBuilder<Vtx, true, Descriptors...> {
+struct GfxPipeline : public GfxPipelineBuilder<Vtx, true, false, Descriptors...> {
 
-	using DepthPipelineType = GfxPipelineBuilder<Vtx, false, Descriptors...>;
+	using DepthPipelineType = GfxPipelineBuilder<Vtx, false, true, Descriptors...>;
 
 };
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "util.h"
+#include "computepipeline.h"
+#include "skeleton.h"
+#include "compressedanimation.h"
+
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+
+/*
+* Animation sampling on the GPU
+*
+* Every animated skeleton and every clip of it is uploaded once in its compressed form, the CPU
+* then only writes a small instance record per skeletal mesh each frame. The kernel poses one
+* instance per workgroup: bones decode their keys around the instance time into shared memory,
+* are propagated one hierarchy level at a time and are written as full bones where the composer
+* and skinning kernels read them.
+*/
+namespace GpuAnimation {
+
+	static constexpr uint32_t WORKGROUP_SIZE = 64;
+	// Poses live in shared memory, a scene with any skeleton of more bones poses all of its skeletons on the CPU
+	static constexpr uint32_t MAX_BONES = 256;
+	static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+	struct Instance {
+		uint32_t skeleton;
+		// Offset of the clip in the clip buffer, NO_INDEX for the rest pose
+		uint32_t clip;
+		// Milliseconds into the clip, already wrapped for looped playback
+		int32_t time;
+		uint32_t first_out_bone;
+	};
+
+	struct AnimatedSkeleton {
+		// Into the rest bone and hierarchy buffers
+		uint32_t first_bone;
+		uint32_t bone_count;
+		uint32_t depth_count;
+		uint32_t padding;
+	};
+
+	struct BoneNode {
+		uint32_t parent;
+		uint32_t depth;
+	};
+
+	struct SampleContext {
+		uint32_t instance_count;
+	};
+
+	using InstanceBuffer = Compute::StorageBuffer<Instance, 0>;
+	using SkeletonBuffer = Compute::StorageBuffer<AnimatedSkeleton, 1>;
+	using RestBoneBuffer = Compute::StorageBuffer<Bone, 2>;
+	using HierarchyBuffer = Compute::StorageBuffer<BoneNode, 3>;
+	using ClipBuffer = Compute::StorageBuffer<uint32_t, 4>;
+	using TrackBuffer = Compute::StorageBuffer<CompressedAnimation::Track, 5>;
+	using KeyDataBuffer = Compute::StorageBuffer<uint32_t, 6>;
+	using BoundsBuffer = Compute::StorageBuffer<float, 7>;
+	using OutBoneBuffer = Compute::StorageBuffer<Bone, 8>;
+
+	static constexpr uint32_t STORAGE_BUFFER_COUNT = 9;
+
+	using SampleComputePipeline = ComputePipeline<
+		SampleContext,
+		InstanceBuffer,
+		SkeletonBuffer,
+		RestBoneBuffer,
+		HierarchyBuffer,
+		ClipBuffer,
+		TrackBuffer,
+		KeyDataBuffer,
+		BoundsBuffer,
+		OutBoneBuffer
+	>;
+
+	/*
+	* Static inputs of the kernel, flattened in the layout of the buffers above
+	*/
+	struct SceneData {
+		std::vector<AnimatedSkeleton> skeletons;
+		std::vector<Bone> rest_bones;
+		std::vector<BoneNode> hierarchy;
+		// Per clip, the time step followed by the first track of every bone of the skeleton
+		std::vector<uint32_t> clips;
+		// Keys and values are indices of 16 bit halves of key_data
+		std::vector<CompressedAnimation::Track> tracks;
+		std::vector<uint16_t> key_data;
+		std::vector<float> bounds;
+
+		// skeleton_indices[Skeleton], a skeleton shared by several meshes is added once
+		std::unordered_map<const Skeleton*, uint32_t> skeleton_indices;
+		// clip_offsets[Skeleton][Animation Index]
+		std::unordered_map<const Skeleton*, std::vector<uint32_t>> clip_offsets;
+	};
+
+	// Adds the skeleton and every animation of it, finalizing the skeleton and compressing animations that
+	// keep their full precision keys. False when the skeleton can't be posed on the GPU
+	bool add_skeleton(SceneData& Data, Skeleton& Skeleton);
+
+	// Playback state of an added skeleton at Now
+	Instance make_instance(const SceneData& Data, Skeleton& Skeleton, std::chrono::steady_clock::time_point Now, uint32_t FirstOutBone);
+
+}
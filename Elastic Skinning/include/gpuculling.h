@@ -0,0 +1,102 @@
+#pragma once
+
+#include "util.h"
+#include "renderingtypes.h"
+#include "computepipeline.h"
+#include "mesh.h"
+
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+/*
+* Frustum culling of indirect draws on the GPU
+*
+* Every draw command is tested against the camera frustum using the bounding sphere of its
+* mesh placed by each of its instance transforms, a command stays visible while any instance
+* is. Visible commands are compacted per draw group and counted, so groups are drawn with
+* drawIndexedIndirectCount. Composition and skinning dispatch sizes of culled skeletal meshes
+* are zeroed, so their dispatches are issued indirectly and do no work. With scheduled
+* composition a visible skeletal mesh is only composed while the field of the frame is older
+* than the last pose of its skeleton.
+*/
+namespace GpuCulling {
+
+	static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+	// Draw group and mesh of a command
+	struct CommandGroup {
+		uint32_t group;
+		uint32_t first_command;
+		uint32_t mesh_id;
+	};
+
+	struct SkinningDispatch {
+		uint32_t mesh_id;
+		uint32_t first_transform;
+		uint32_t instance_count;
+		uint32_t field_groups_x;
+		uint32_t field_groups_y;
+		uint32_t field_groups_z;
+		uint32_t vertex_groups;
+	};
+
+	// Composition dispatch followed by skinning dispatch, per skeletal mesh
+	static constexpr uint32_t DISPATCHES_PER_SKELETAL_MESH = 2;
+
+	struct CullContext {
+		uint32_t command_count;
+		uint32_t skeletal_mesh_count;
+		// Without drawIndirectCount culled commands keep their slot with no instances
+		uint32_t compact;
+		// Compose only skeletal meshes whose pose generation changed since the field of the frame was composed
+		uint32_t scheduled_composition;
+	};
+
+	struct FrustumPlanes {
+		std::array<glm::vec4, 6> planes;
+	};
+
+	using ModelTransformBuffer = Compute::StorageBuffer<glm::mat4, 0>;
+	using FrustumBuffer = Compute::UniformBuffer<FrustumPlanes, 1>;
+	using MeshBoundsBuffer = Compute::StorageBuffer<glm::vec4, 2>;
+	using SourceCommandBuffer = Compute::StorageBuffer<vk::DrawIndexedIndirectCommand, 3>;
+	using CommandGroupBuffer = Compute::StorageBuffer<CommandGroup, 4>;
+	using SkinningDispatchBuffer = Compute::StorageBuffer<SkinningDispatch, 5>;
+	using CulledCommandBuffer = Compute::StorageBuffer<vk::DrawIndexedIndirectCommand, 6>;
+	using DrawCountBuffer = Compute::StorageBuffer<uint32_t, 7>;
+	using DispatchArgsBuffer = Compute::StorageBuffer<vk::DispatchIndirectCommand, 8>;
+	// Pose generation per skeletal mesh written by the CPU, and the generation each field of the frame was composed at
+	using PoseGenerationBuffer = Compute::StorageBuffer<uint32_t, 9>;
+	using ComposedGenerationBuffer = Compute::StorageBuffer<uint32_t, 10>;
+
+	static constexpr uint32_t STORAGE_BUFFER_COUNT = 10;
+
+	using CullComputePipeline = ComputePipeline<
+		CullContext,
+		ModelTransformBuffer,
+		FrustumBuffer,
+		MeshBoundsBuffer,
+		SourceCommandBuffer,
+		CommandGroupBuffer,
+		SkinningDispatchBuffer,
+		CulledCommandBuffer,
+		DrawCountBuffer,
+		DispatchArgsBuffer,
+		PoseGenerationBuffer,
+		ComposedGenerationBuffer
+	>;
+
+	// Model space bounding sphere, xyz center and w radius
+	glm::vec4 compute_bounding_sphere(const std::vector<Vertex>& Vertices);
+
+	// Skinned vertices never leave the composed field, a cube of half extent FieldScale about the origin
+	glm::vec4 compute_field_bounding_sphere(float FieldScale);
+
+	// Normalized inward facing planes of a [0, 1] depth clip space
+	FrustumPlanes extract_frustum_planes(const glm::mat4& ViewProjection);
+
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "util.h"
+#include "gfxcontext.h"
+#include "swapchain.h"
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <filesystem>
+#include <mutex>
+#include <cstdint>
+
+/*
+* Timestamp query based GPU profiler
+*
+* Scopes are recorded into command buffers once and keep writing timestamps every time
+* those command buffers are submitted. Results of a frame are collected the next time the
+* same frame is prepared, so reading them back never stalls the GPU.
+*/
+class GpuProfiler {
+
+public:
+
+	enum class Error {
+		OK,
+		INVALID_CONTEXT,
+		UNINITIALIZED_CONTEXT,
+		TIMESTAMPS_UNSUPPORTED,
+		FAIL_CREATE_QUERY_POOL,
+		NO_SAMPLES,
+		WRITE_ERROR
+	};
+
+	enum class Stage {
+		AnimationSampling,
+		FrustumCulling,
+		FieldTransform,
+		FieldBlend,
+		VertexProjection,
+		VertexCachePlayback,
+		VertexCopy,
+		DepthSubpass,
+		ColorSubpass,
+		COUNT
+	};
+
+	using ScopeId = uint32_t;
+
+	static constexpr MeshId ALL_MESHES = UINT32_MAX;
+	static constexpr ScopeId INVALID_SCOPE = UINT32_MAX;
+
+	struct Statistics {
+		Stage stage;
+		MeshId mesh{ ALL_MESHES };
+
+		double min_ms{ 0.0 };
+		double avg_ms{ 0.0 };
+		double p99_ms{ 0.0 };
+		double last_ms{ 0.0 };
+
+		size_t sample_count{ 0 };
+	};
+
+	GpuProfiler() = default;
+	~GpuProfiler();
+
+	Error init(GfxContext* Context, size_t FrameCount, uint32_t MaxScopesPerFrame = 1024, size_t HistoryLength = 240);
+	void deinit();
+
+	bool is_initialized() { return is_init; }
+
+	void set_per_mesh(bool PerMesh) { per_mesh = PerMesh; }
+	bool is_per_mesh() { return per_mesh; }
+
+	// Forgets the scopes of a frame, call before re-recording the command buffers that hold them
+	void clear_frame(Swapchain::FrameId FrameId);
+
+	// Must be recorded outside of a render pass, before any scope of the frame executes
+	void reset_frame(Swapchain::FrameId FrameId, vk::CommandBuffer CommandBuffer);
+
+	// Nested scopes are reported per mesh only and don't add to the stage total
+	ScopeId begin_scope(Swapchain::FrameId FrameId, vk::CommandBuffer CommandBuffer, Stage ProfiledStage, MeshId Mesh = ALL_MESHES, bool Nested = false);
+	void end_scope(Swapchain::FrameId FrameId, vk::CommandBuffer CommandBuffer, ScopeId Scope);
+
+	void mark_submitted(Swapchain::FrameId FrameId);
+	void collect(Swapchain::FrameId FrameId);
+
+	std::vector<Statistics> get_statistics();
+	Retval<Statistics, Error> get_statistics(Stage ProfiledStage, MeshId Mesh = ALL_MESHES);
+
+	Error export_csv(std::filesystem::path path);
+	Error export_json(std::filesystem::path path);
+
+	static const char* stage_name(Stage ProfiledStage);
+
+private:
+
+	static uint64_t sample_key(Stage ProfiledStage, MeshId Mesh) {
+		return (static_cast<uint64_t>(ProfiledStage) << 32) | static_cast<uint64_t>(Mesh);
+	}
+
+	Statistics compute_statistics(uint64_t Key);
+
+	bool is_init{ false };
+	bool per_mesh{ false };
+
+	GfxContext* context{ nullptr };
+
+	vk::QueryPool query_pool;
+	uint32_t queries_per_frame{ 0 };
+	uint64_t timestamp_mask{ 0 };
+	double timestamp_period_ns{ 1.0 };
+
+	struct Scope {
+		Stage stage;
+		MeshId mesh;
+		bool nested;
+
+		uint32_t begin_query;
+		uint32_t end_query;
+	};
+
+	struct FrameData {
+		std::vector<Scope> scopes;
+		uint32_t next_query{ 0 };
+		bool has_results{ false };
+	};
+
+	std::vector<FrameData> frames;
+	std::mutex scope_mutex;
+
+	// Rolling sample history, history[sample_key(ProfiledStage, Mesh)]
+	struct History {
+		std::vector<double> samples;
+		size_t head{ 0 };
+		size_t count{ 0 };
+	};
+
+	size_t history_length{ 0 };
+	std::unordered_map<uint64_t, History> history;
+
+	// Scratch storage reused between collections
+	std::vector<uint64_t> query_results;
+	std::unordered_map<uint64_t, double> frame_totals;
+
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "util.h"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+/*
+* Work stealing task scheduler
+*
+* Every worker owns a deque, it pushes and pops its own tasks at the back and steals from the
+* front of the other deques when it runs dry. The thread that initializes the system is worker
+* 0 and only runs tasks while it waits on a group, so waiting never idles a core. Tasks pinned
+* to the main thread run from pump_main_thread or while the main thread waits.
+*
+* A background system owns all of its threads and has no main thread, work queued on it is never
+* picked up by a thread waiting on another system, however long it runs.
+*/
+class JobSystem {
+
+public:
+
+	using Task = std::function<void()>;
+
+	enum class Affinity {
+		Any,
+		MainThread
+	};
+
+	static constexpr size_t NOT_A_WORKER = SIZE_MAX;
+
+	/*
+	* Tracks a set of tasks and the continuations that run once all of them finished,
+	* must outlive its tasks, waiting on it before it goes out of scope guarantees that
+	*/
+	class TaskGroup {
+
+		friend class JobSystem;
+
+	public:
+
+		TaskGroup() = default;
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		bool is_done() { return outstanding.load(std::memory_order_acquire) == 0; }
+
+	private:
+
+		struct Continuation {
+			Task task;
+			Affinity affinity;
+		};
+
+		std::mutex mutex;
+		// Tasks that have not finished, continuations are released when it drops to zero
+		size_t running{ 0 };
+		std::vector<Continuation> continuations;
+
+		// Tasks and continuations that have not finished
+		std::atomic<size_t> outstanding{ 0 };
+	};
+
+	struct WorkerStatistics {
+		uint64_t tasks_run{ 0 };
+		uint64_t steals{ 0 };
+		double idle_ms{ 0.0 };
+	};
+
+	JobSystem() = default;
+	~JobSystem();
+
+	// 0 threads uses every hardware thread, the calling thread counts as one of them unless Background.
+	// Background systems have no main thread, tasks must not be pinned to it
+	void init(size_t ThreadCount = 0, bool Background = false);
+	void deinit();
+
+	bool is_initialized() { return is_init; }
+
+	// Includes the main thread
+	size_t worker_count() { return workers.size(); }
+	// NOT_A_WORKER on threads the system does not own
+	size_t current_worker_index();
+
+	// Runs Task inline if the system is not initialized
+	void run(TaskGroup& Group, Task Task, Affinity Affinity = Affinity::Any);
+	// Scheduled once every task of Group run so far finished, Group is only done once the continuation is
+	void then(TaskGroup& Group, Task Continuation, Affinity Affinity = Affinity::Any);
+
+	// Helps running tasks until Group is done
+	void wait(TaskGroup& Group);
+
+	// Calls Body(Begin, End) over [0, Count) in chunks of Grain and waits for all of them, 0 picks a grain
+	void parallel_for(size_t Count, size_t Grain, const std::function<void(size_t, size_t)>& Body);
+
+	// Runs the tasks pinned to the main thread, returns how many ran
+	size_t pump_main_thread();
+
+	std::vector<WorkerStatistics> get_statistics();
+	void reset_statistics();
+
+private:
+
+	struct Job {
+		Task task;
+		TaskGroup* group{ nullptr };
+		bool is_continuation{ false };
+	};
+
+	struct Worker {
+		std::thread thread;
+
+		std::mutex mutex;
+		std::deque<Job> jobs;
+
+		std::atomic<uint64_t> tasks_run{ 0 };
+		std::atomic<uint64_t> steals{ 0 };
+		std::atomic<uint64_t> idle_ns{ 0 };
+	};
+
+	void worker_main(size_t WorkerIdx);
+
+	void push(Job Job, Affinity Affinity);
+	// Runs a single task, false if there was nothing to run
+	bool run_one(size_t WorkerIdx);
+	bool run_main_thread_job();
+	void execute(Job& Job, size_t WorkerIdx);
+	void finish(Job& Job);
+
+	bool is_init{ false };
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::thread::id main_thread_id;
+
+	std::mutex main_mutex;
+	std::deque<Job> main_jobs;
+	std::atomic<size_t> main_queued{ 0 };
+
+	// Queued on any worker deque, sleeping threads wake when it becomes non zero
+	std::atomic<size_t> queued{ 0 };
+	std::atomic<size_t> next_foreign_worker{ 0 };
+
+	std::mutex wake_mutex;
+	std::condition_variable wake_condition;
+	bool stopping{ false };
+
+};
@@ -3,11 +3,16 @@
 #include "util.h"
 #include "renderingtypes.h"
 
+#ifndef ELASTIC_NO_VULKAN
 #include <vulkan/vulkan.hpp>
+#endif
+
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 #include <vector>
+#include <string>
+#include <array>
 #include <span>
 #include <cstdint>
 
@@ -17,12 +22,15 @@ struct ModelTransform {
 	glm::vec3 scale{ 1.0f, 1.0f, 1.0f };
 };
 
+// Vertex layouts, stream copies and descriptor bindings only exist for the renderer
+#ifndef ELASTIC_NO_VULKAN
 template <typename T>
 concept VertexType =
 std::is_trivial_v<T> &&
 std::is_standard_layout_v<T> &&
 	requires {
-		{T::binding_description()} -> std::same_as<vk::VertexInputBindingDescription>;
+		{T::binding_description()} -> ArrayType;
+		{T::binding_description()[0]} -> std::same_as<vk::VertexInputBindingDescription&>;
 		{T::attribute_description()} -> ArrayType;
 		{T::attribute_description()[0]} -> std::same_as<vk::VertexInputAttributeDescription&>;
 };
@@ -42,6 +50,23 @@ std::is_standard_layout_v<T> &&
 
 #define END_DESCRIPTIONS \
 	return _ret_val
+#endif
+
+/*
+* GPU vertex streams
+*
+* Rendered vertices are stored as a position stream followed by an attribute stream in the same
+* buffer, so the depth prepass only fetches positions. Both streams are indexed by vertex.
+*/
+struct VertexPosition {
+	alignas(16) glm::vec3 position;
+};
+
+struct VertexAttributes {
+	alignas(16) glm::vec3 normal;
+	alignas(16) glm::vec3 color;
+	alignas(16) glm::vec2 texcoords;
+};
 
 struct Vertex {
 	alignas(16) glm::vec3 position;
@@ -49,25 +74,58 @@ struct Vertex {
 	alignas(16) glm::vec3 color;
 	alignas(16) glm::vec2 texcoords;
 
-	static vk::VertexInputBindingDescription binding_description() {
-		vk::VertexInputBindingDescription retval;
-
-		retval.binding = 0;
-		retval.stride = sizeof(Vertex);
-		retval.inputRate = vk::VertexInputRate::eVertex;
+	static const uint32_t POSITION_BINDING = 0;
+	static const uint32_t ATTRIBUTE_BINDING = 1;
 
-		return retval;
+#ifndef ELASTIC_NO_VULKAN
+	static std::vector<vk::VertexInputBindingDescription> binding_description() {
+		return {
+			{ POSITION_BINDING, sizeof(VertexPosition), vk::VertexInputRate::eVertex },
+			{ ATTRIBUTE_BINDING, sizeof(VertexAttributes), vk::VertexInputRate::eVertex }
+		};
 	}
 
+	// Locations match the interleaved layout, offsets are within each stream
 	static std::vector<vk::VertexInputAttributeDescription> attribute_description() {
-		BEGIN_DESCRIPTIONS(Vertex);
-		DESCRIPTION(position);
-		DESCRIPTION(normal);
-		DESCRIPTION(color);
-		DESCRIPTION(texcoords);
-		END_DESCRIPTIONS;
+		return {
+			{ 0, POSITION_BINDING, VkFormatType<glm::vec3>::format(), offsetof(VertexPosition, position) },
+			{ 1, ATTRIBUTE_BINDING, VkFormatType<glm::vec3>::format(), offsetof(VertexAttributes, normal) },
+			{ 2, ATTRIBUTE_BINDING, VkFormatType<glm::vec3>::format(), offsetof(VertexAttributes, color) },
+			{ 3, ATTRIBUTE_BINDING, VkFormatType<glm::vec2>::format(), offsetof(VertexAttributes, texcoords) }
+		};
 	}
+#endif
+};
+
+#ifndef ELASTIC_NO_VULKAN
+struct VertexStreams {
+	// Skinning binds the attribute stream as a storage buffer, 256 satisfies every device's offset alignment
+	static constexpr vk::DeviceSize STREAM_ALIGNMENT = 256;
+
+	static vk::DeviceSize attribute_offset(size_t VertexCount) {
+		return (VertexCount * sizeof(VertexPosition) + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+	}
+
+	static vk::DeviceSize size(size_t VertexCount) {
+		return attribute_offset(VertexCount) + VertexCount * sizeof(VertexAttributes);
+	}
+
+	// Copy regions moving Count vertices between two stream buffers holding SourceCapacity and DestCapacity vertices
+	static std::array<vk::BufferCopy, 2> copy_regions(size_t SourceCapacity, size_t SourceFirst, size_t DestCapacity, size_t DestFirst, size_t Count) {
+		return { {
+			{ SourceFirst * sizeof(VertexPosition), DestFirst * sizeof(VertexPosition), Count * sizeof(VertexPosition) },
+			{
+				attribute_offset(SourceCapacity) + SourceFirst * sizeof(VertexAttributes),
+				attribute_offset(DestCapacity) + DestFirst * sizeof(VertexAttributes),
+				Count * sizeof(VertexAttributes)
+			}
+		} };
+	}
+
+	// Splits interleaved vertices into the streamed layout, ready to upload
+	static std::vector<uint8_t> pack(const std::vector<Vertex>& Vertices);
 };
+#endif
 
 struct SkeletalVertex {
 	alignas(16) glm::uvec4 joints;
@@ -77,14 +135,15 @@ struct SkeletalVertex {
 	alignas(16) glm::vec3 color;
 	alignas(16) glm::vec2 texcoords;
 
-	static vk::VertexInputBindingDescription binding_description() {
+#ifndef ELASTIC_NO_VULKAN
+	static std::vector<vk::VertexInputBindingDescription> binding_description() {
 		vk::VertexInputBindingDescription retval;
 
 		retval.binding = 0;
 		retval.stride = sizeof(SkeletalVertex);
 		retval.inputRate = vk::VertexInputRate::eVertex;
 
-		return retval;
+		return { retval };
 	}
 
 	static std::vector<vk::VertexInputAttributeDescription> attribute_description() {
@@ -97,6 +156,7 @@ struct SkeletalVertex {
 		DESCRIPTION(texcoords);
 		END_DESCRIPTIONS;
 	}
+#endif
 };
 
 struct ElasticVertex {
@@ -107,14 +167,15 @@ struct ElasticVertex {
 	alignas(4) uint32_t bone;
 	alignas(4) float isovalue;
 
-	static vk::VertexInputBindingDescription binding_description() {
+#ifndef ELASTIC_NO_VULKAN
+	static std::vector<vk::VertexInputBindingDescription> binding_description() {
 		vk::VertexInputBindingDescription retval;
 
 		retval.binding = 0;
 		retval.stride = sizeof(ElasticVertex);
 		retval.inputRate = vk::VertexInputRate::eVertex;
 
-		return retval;
+		return { retval };
 	}
 
 	static std::vector<vk::VertexInputAttributeDescription> attribute_description() {
@@ -127,15 +188,19 @@ struct ElasticVertex {
 		DESCRIPTION(isovalue);
 		END_DESCRIPTIONS;
 	}
+#endif
 };
 
+#ifndef ELASTIC_NO_VULKAN
 #undef BEGIN_DESCRIPTIONS
 #undef DESCRIPTION
 #undef END_DESCRIPTIONS
 
 using ElasticVertexBuffer = StorageBuffer<"", ElasticVertex, 1, vk::ShaderStageFlagBits::eCompute, 1>;
 using SkeletalVertexBuffer = StorageBuffer<"", SkeletalVertex, 1, vk::ShaderStageFlagBits::eCompute, 1>;
-using VertexBuffer = StorageBuffer<"", Vertex, 2, vk::ShaderStageFlagBits::eCompute, 1>;
+using PositionStreamBuffer = StorageBuffer<"", VertexPosition, 2, vk::ShaderStageFlagBits::eCompute, 1>;
+using AttributeStreamBuffer = StorageBuffer<"", VertexAttributes, 4, vk::ShaderStageFlagBits::eCompute, 1>;
+#endif
 
 template <typename T>
 concept MeshType =
@@ -8,7 +8,17 @@
 #include "computepipeline.h"
 #include "mesh.h"
 #include "elasticskinning.h"
+#include "fieldasset.h"
 #include "elasticfieldcomposer.h"
+#include "gpuprofiler.h"
+#include "framedataring.h"
+#include "gpuculling.h"
+#include "gpuanimation.h"
+#include "animationscheduler.h"
+#include "animationbatch.h"
+#include "vertexcache.h"
+#include "assetstreamer.h"
+#include "jobsystem.h"
 
 #include <vulkan/vulkan.hpp>
 
@@ -17,8 +27,59 @@
 #include <unordered_map>
 #include <functional>
 #include <memory>
+#include <optional>
+#include <variant>
+#include <filesystem>
+#include <mutex>
+#include <unordered_set>
 #include <cstdint>
 
+struct RendererSettings {
+	// Frames the CPU may record ahead of the GPU, per frame data and skinning fields scale with this
+	uint32_t frames_in_flight{ 2 };
+
+	// Secondary command buffer recording tasks on the job system, each with its own command pools, 0 uses every hardware thread
+	uint32_t recording_threads{ 0 };
+	uint32_t meshes_per_command_buffer{ 256 };
+
+	// Suballocate all geometry from shared buffers and draw each pipeline/material group with one indirect draw
+	bool indirect_draws{ false };
+
+	// Cull indirect draws and skinning against the camera frustum on the GPU, only applies to indirect draws
+	bool frustum_culling{ true };
+
+	// Sample animations and pose skeletons on the GPU from compressed clips, the CPU only uploads playback times
+	bool gpu_animation{ false };
+
+	// Pose skeletons at a rate chosen by their size on screen and blend the last two poses in between, fields are
+	// only composed after a new pose. Only applies to skeletons posed on the CPU
+	bool animation_scheduling{ false };
+	AnimationScheduleSettings animation_schedule;
+
+	// Bind every texture and material once through descriptor indexing, for pipelines set up for it
+	bool bindless_textures{ false };
+	uint32_t max_bindless_textures{ 1024 };
+
+	// Worker threads loading and baking streamed models, uploads go through the transfer queue
+	uint32_t streaming_threads{ 2 };
+
+	// Job system threads for per frame CPU work and baking models digested up front, 0 uses every hardware thread
+	uint32_t worker_threads{ 0 };
+	// Threads of their own baking the fields of streamed models, 0 uses half the hardware threads
+	uint32_t bake_threads{ 0 };
+
+	// Offscreen render target configuration, used when the context is headless
+	vk::Extent2D offscreen_extent{ 1280, 720 };
+	uint32_t offscreen_image_count{ 2 };
+
+	// GPU timestamp profiling of the skinning and geometry stages
+	bool enable_profiling{ false };
+	bool profile_per_mesh{ false };
+
+	// Logs GPU memory per category and heap budget headroom every N submitted frames, 0 disables it
+	uint32_t memory_log_interval{ 0 };
+};
+
 class RendererImpl {
 
 protected:
@@ -41,13 +102,26 @@ public:
 		FAILED_TO_ALLOCATE_BUFFER,
 		FAILED_TO_ALLOCATE_COMMAND_BUFFERS,
 		TEXTURE_WITH_NAME_ALREADY_EXISTS,
-		MATERIAL_NOT_FOUND
+		MATERIAL_NOT_FOUND,
+		MESH_NOT_FOUND,
+		MESH_NOT_SKELETAL,
+		MODEL_NOT_FOUND,
+		MODEL_NOT_READY,
+		SKELETON_MISMATCH,
+		ANIMATION_NOT_FOUND,
+		FIELD_ASSET_MISMATCH,
+		BINDLESS_UNSUPPORTED,
+		NOT_OFFSCREEN,
+		NO_FRAME_RENDERED
 	};
 
-	RendererImpl(GfxContext* Context);
+	RendererImpl(GfxContext* Context, const RendererSettings& Settings = {});
 	~RendererImpl();
 
 	bool is_initialized() { return is_init; }
+	bool is_offscreen() { return render_swapchain.is_offscreen(); }
+	// False if disabled or unsupported by the device, bindless pipelines can't be registered then
+	bool has_bindless_textures() { return use_bindless_textures; }
 
 	Error register_pipeline_impl(const std::string& Name, GfxPipelineImpl& Pipeline);
 	Error register_pipeline_impl(StringHash Name, GfxPipelineImpl& Pipeline);
@@ -62,30 +136,104 @@ public:
 
 	Retval<MeshId, Error> digest_mesh(Mesh& Mesh, ModelTransform* Transform);
 	Retval<MeshId, Error> digest_mesh(SkeletalMesh& Mesh, Skeleton* Skeleton, ModelTransform* Transform);
-	Retval<ModelId, Error> digest_model(Model& Model, ModelTransform* Transform);
+	// Skips baking, Baked is usually saved by elastic_bake, FIELD_ASSET_MISMATCH if it wasn't baked from Source and Skeleton
+	Retval<MeshId, Error> digest_mesh(const FieldAsset& Baked, const SkeletalMesh& Source, Skeleton* Skeleton, ModelTransform* Transform);
+	// Baked[Mesh Index] is digested instead of baking the mesh when it matches, see load_field_assets
+	Retval<ModelId, Error> digest_model(Model& Model, ModelTransform* Transform, const std::vector<std::optional<FieldAsset>>& Baked = {});
+
+	/*
+	* Streamed models are loaded and baked in the background, the returned id is valid immediately
+	* and the model is drawn from the first frame after all of its resources are resident. Meshes
+	* with a field asset saved by elastic_bake in FieldDirectory load it instead of baking
+	*/
+	Retval<ModelId, Error> stream_model(const std::filesystem::path& Path, ModelTransform* Transform, const std::filesystem::path& FieldDirectory = {});
+	bool is_model_ready(ModelId Model);
+	// Null until the model is ready, owned by the renderer
+	Skeleton* get_model_skeleton(ModelId Model);
+
+	/*
+	* Instances reuse digested geometry and fields, creating them after the first frame rebuilds the scene
+	*/
+
+	// Draws Mesh again with another transform, skeletal meshes keep sharing their pose
+	Retval<InstanceId, Error> create_instance(MeshId Mesh, ModelTransform* Transform);
+	// Shares the rest and part fields of a skeletal mesh, with its own pose and skinned vertices
+	Retval<MeshId, Error> create_skeletal_instance(MeshId Mesh, Skeleton* Skeleton, ModelTransform* Transform);
+	// Skeletal meshes of the model get their own pose when Skeleton is given
+	Retval<ModelId, Error> create_model_instance(ModelId Model, ModelTransform* Transform, Skeleton* Skeleton = nullptr);
+
+	/*
+	* Baked playback, for skeletal meshes that only ever play one clip
+	*/
+
+	// Runs Mesh through the full skinning pipeline at FrameRate over Animation once the scene is next laid out, the
+	// mesh then replays the baked cache on the playback clock of its skeleton instead of composing fields
+	Error bake_vertex_cache(MeshId Mesh, const std::string& Animation, float FrameRate = 30.0f, bool Loop = true);
 
 	void set_camera(Camera* Camera);
 
 	void draw_frame();
 
+	// Copies the most recently drawn offscreen frame back to the CPU as RGBA8
+	Retval<Image, Error> read_back_frame();
+
+	// Null if profiling is disabled or unsupported by the device
+	GpuProfiler* get_profiler() { return profiler.is_initialized() ? &profiler : nullptr; }
+
+	JobSystem& get_job_system() { return job_system; }
+
 protected:
 
 	RendererImpl() = default;
 
-	void constructor_impl(GfxContext* Context);
+	void constructor_impl(GfxContext* Context, const RendererSettings& Settings);
 
+	// Swapchain, depth buffers and framebuffers, the render pass is only recreated when the surface format changes
 	void create_render_state();
 	void destroy_render_state();
+	void create_render_pass();
 
 	bool should_render();
 
-	void update_frame_data(Swapchain::FrameId ImageIdx);
+	void update_frame_data(Swapchain::FrameId FrameIdx);
 
 	void finish_mesh_digestion();
+	// Frees everything finish_mesh_digestion creates, except the merged geometry which is carried over
+	void reset_mesh_digestion();
+	// Lays the scene out again once meshes were added after the first frame
+	void rebuild_scene();
+
+	void merge_mesh_geometry();
+	void build_indirect_draw_commands();
+	void build_culling_data();
+	void build_animation_data();
+	void build_bindless_data();
+
+	enum class RecordingStage {
+		Sampling,
+		Culling,
+		Composition,
+		Animate,
+		Depth,
+		Color
+	};
 
-	void record_elastic_skinning_composition_command_buffer(Swapchain::FrameId ImageIdx);
-	void record_elastic_skinning_animate_command_buffer(Swapchain::FrameId ImageIdx);
-	void record_command_buffers();
+	// Records skeletal meshes [First, First + Count) for the skinning stages, or meshes for the draw stages
+	// Indirect draw stages record draw groups [First, First + Count) instead
+	void record_secondary_command_buffer(Swapchain::FrameId FrameIdx, RecordingStage Stage, size_t First, size_t Count, vk::CommandBuffer CommandBuffer);
+	void record_elastic_skinning_composition_command_buffer(Swapchain::FrameId FrameIdx, size_t First, size_t Count, vk::CommandBuffer CommandBuffer);
+	void record_elastic_skinning_animate_command_buffer(Swapchain::FrameId FrameIdx, size_t First, size_t Count, vk::CommandBuffer CommandBuffer);
+	void record_draw_command_buffer(Swapchain::FrameId FrameIdx, bool DepthOnly, size_t First, size_t Count, vk::CommandBuffer CommandBuffer);
+	void record_indirect_draw_command_buffer(Swapchain::FrameId FrameIdx, bool DepthOnly, size_t First, size_t Count, vk::CommandBuffer CommandBuffer);
+	void record_frustum_culling_command_buffer(Swapchain::FrameId FrameIdx, vk::CommandBuffer CommandBuffer);
+	void record_animation_sampling_command_buffer(Swapchain::FrameId FrameIdx, vk::CommandBuffer CommandBuffer);
+	void record_primary_command_buffer(const Swapchain::Frame& Frame);
+	// Dynamic state isn't inherited by secondaries, every draw secondary sets it for the current extent
+	void set_viewport_state(vk::CommandBuffer CommandBuffer);
+	// Falls back to the default texture when the material's albedo texture has no set
+	vk::DescriptorSet find_texture_descriptor_set(StringHash PipelineHash, StringHash MaterialHash);
+	// DrawStagesOnly re-records the depth and color secondaries, which are the only ones holding the viewport
+	void record_command_buffers(bool DrawStagesOnly = false);
 	void reset_command_buffers();
 
 
@@ -96,6 +244,9 @@ protected:
 
 	bool is_init{ false };
 	bool is_first_render{ true };
+	bool is_scene_dirty{ false };
+
+	RendererSettings settings;
 
 	struct InternalMaterial {
 		StringHash albedo_texture_name{ DEFAULT_TEXTURE_NAME };
@@ -111,8 +262,11 @@ protected:
 
 	GfxContext* context{ nullptr };
 	Swapchain render_swapchain;
+	std::optional<Swapchain::FrameId> last_drawn_frame;
+	uint64_t submitted_frame_count{ 0 };
 
 	vk::RenderPass geometry_render_pass;
+	vk::Format render_pass_color_format{ vk::Format::eUndefined };
 	uint32_t depth_subpass;
 	uint32_t color_subpass;
 
@@ -126,26 +280,85 @@ protected:
 
 	// texture_descriptor_sets[hash_combine(Pipeline Name, Sampler Name, Texture Name)]
 	// a la: texture_descriptor_sets[Pipeline Name][Sampler Name][Texture Name]
+	// Only allocated for pipelines without bindless textures
 	std::unordered_map<StringHash, vk::DescriptorSet> texture_descriptor_sets;
 
+	/*
+	* Bindless textures, one partially bound array of every texture and one buffer of every material,
+	* indexed through the material of each transform slot
+	*/
+	bool use_bindless_textures{ false };
+	uint32_t bindless_texture_capacity{ 0 };
+
+	vk::DescriptorSetLayout bindless_set_layout;
+	vk::DescriptorSet bindless_descriptor_set;
+
+	BufferAllocation material_buffer;
+	BufferAllocation material_index_buffer;
+
 	std::vector<StringHash> buffer_type_names;
 	std::vector<StringHash> sampler_type_names;
 	std::unordered_map<StringHash, size_t> buffer_type_sizes;
 	std::unordered_map<StringHash, bool> buffer_type_is_per_mesh;
 
+	// Per swapchain image state
 	struct FrameData {
+		GPUTexture depthbuffer;
+
+		vk::Framebuffer framebuffer;
+	};
+
+	std::vector<FrameData> frames;
+
+	// Per frame in flight state, indexed by Swapchain::Frame::in_flight_id
+	struct InFlightFrameData {
 		// buffer_descriptor_sets[Pipeline Name]
 		std::unordered_map<StringHash, vk::DescriptorSet> buffer_descriptor_sets;
 
-		// frame_data_buffers[Buffer Type]
-		std::unordered_map<StringHash, BufferAllocation> data_buffers;
+		// Re-recorded every frame for the acquired image, executes the secondaries below
+		vk::CommandBuffer primary_command_buffer;
+
+		// One secondary per chunk of meshes, in execution order
+		std::vector<vk::CommandBuffer> sampling_command_buffers;
+		std::vector<vk::CommandBuffer> culling_command_buffers;
+		std::vector<vk::CommandBuffer> composition_command_buffers;
+		std::vector<vk::CommandBuffer> animate_command_buffers;
+		std::vector<vk::CommandBuffer> depth_command_buffers;
+		std::vector<vk::CommandBuffer> color_command_buffers;
+
+		// Frustum culling output, compacted draw commands and counts per draw group
+		BufferAllocation culled_command_buffer;
+		BufferAllocation draw_count_buffer;
+		BufferAllocation dispatch_args_buffer;
+		vk::DescriptorSet cull_descriptor_set;
+
+		// GPU animation output, the bones of every skeletal mesh
+		BufferAllocation animated_bone_buffer;
+		vk::DescriptorSet animation_descriptor_set;
+
+		// Pose generation every field was last composed at, kept by the culling kernel
+		BufferAllocation composed_generation_buffer;
+	};
 
-		GPUTexture depthbuffer;
+	std::vector<InFlightFrameData> in_flight_frames;
 
-		vk::Framebuffer framebuffer;
+	// Command pools are externally synchronized, so every recording task owns one
+	struct RecordingThreadData {
+		vk::CommandPool command_pool;
+		std::vector<vk::CommandBuffer> secondary_command_buffers;
+
+		// Draw secondaries come from their own pool, so a resize can reset them alone
+		vk::CommandPool draw_command_pool;
+		std::vector<vk::CommandBuffer> draw_command_buffers;
 	};
 
-	std::vector<FrameData> frames;
+	std::vector<RecordingThreadData> recording_threads;
+
+	// Per frame uniforms, model transforms and sampled bones, laid out identically for every frame
+	FrameDataRing frame_data_ring;
+
+	// frame_data_allocations[Buffer Type]
+	std::unordered_map<StringHash, FrameDataRing::Allocation> frame_data_allocations;
 
 	vk::Sampler texture_sampler;
 
@@ -159,22 +372,124 @@ protected:
 
 		size_t vertex_count{ 0 };
 		size_t index_count{ 0 };
+
+		// Element offsets into the geometry buffers, zero unless geometry is merged
+		int32_t vertex_offset{ 0 };
+		uint32_t first_index{ 0 };
+
+		// Model space, xyz center and w radius
+		glm::vec4 bounding_sphere{ 0.0f };
+
+		// Skeletal instances draw the indices of the mesh they were instanced from
+		std::optional<MeshId> index_source;
+
+		// Every instance owns a transform slot, contiguous from first_transform
+		std::vector<ModelTransform*> instance_transforms;
+		uint32_t first_transform{ 0 };
 	};
 
 	std::vector<InternalMesh> meshes;
-	std::vector<ModelTransform*> mesh_transforms;
+
+	// Number of model transform slots, laid out once all instances are known
+	uint32_t transform_count{ 0 };
+
+	// model_meshes[Model Id]
+	std::vector<std::vector<MeshId>> model_meshes;
+
+	/*
+	* Indirect drawing, every mesh is suballocated from the geometry buffers and its instances are
+	* drawn from firstInstance, so transform slots reach the vertex shader through gl_InstanceIndex
+	*/
+	bool use_indirect_draws{ false };
+
+	// Vertex streams sized for geometry_vertex_count vertices, see VertexStreams
+	BufferAllocation geometry_vertex_buffer;
+	BufferAllocation geometry_index_buffer;
+	size_t geometry_vertex_count{ 0 };
+
+	// Depth commands followed by color commands, contiguous per draw group
+	BufferAllocation indirect_command_buffer;
+	uint32_t indirect_command_count{ 0 };
+	std::vector<MeshId> indirect_command_meshes;
+
+	struct DrawGroup {
+		StringHash pipeline_hash{ 0 };
+		StringHash material_hash{ 0 };
+
+		uint32_t first_command{ 0 };
+		uint32_t command_count{ 0 };
+	};
+
+	std::vector<DrawGroup> depth_draw_groups;
+	std::vector<DrawGroup> color_draw_groups;
+
+	/*
+	* Frustum culling, rewrites the indirect commands and skinning dispatch sizes every frame
+	*/
+	bool use_frustum_culling{ false };
+	bool frustum_culling_available{ false };
+
+	GpuCulling::CullComputePipeline cull_pipeline;
+
+	BufferAllocation mesh_bounds_buffer;
+	BufferAllocation command_groups_buffer;
+	BufferAllocation skinning_dispatch_buffer;
+
+	FrameDataRing::Allocation frustum_planes;
+
+	/*
+	* GPU animation, skeletons are posed by a compute kernel from clips resident on the GPU
+	*/
+	bool use_gpu_animation{ false };
+	bool gpu_animation_available{ false };
+
+	GpuAnimation::SampleComputePipeline animation_pipeline;
+	GpuAnimation::SceneData animation_data;
+
+	BufferAllocation animation_skeleton_buffer;
+	BufferAllocation animation_rest_bone_buffer;
+	BufferAllocation animation_hierarchy_buffer;
+	BufferAllocation animation_clip_buffer;
+	BufferAllocation animation_track_buffer;
+	BufferAllocation animation_key_buffer;
+	BufferAllocation animation_bounds_buffer;
+
+	FrameDataRing::Allocation animation_instances;
+
+	struct VertexCacheRequest {
+		StringHash animation{ 0 };
+		float frame_rate{ 30.0f };
+		bool loop{ true };
+	};
 
 	struct InternalSkeletalMesh {
+		// Read only, shared with skeletal instances and only destroyed by the owner
 		BufferAllocation vertex_source_buffer;
 		GPUTexture rest_isogradfield;
 		std::vector<GPUTexture> part_isogradfields;
+		bool owns_source_data{ true };
 
 		// Per frame animation data
 		std::vector<BufferAllocation> vertex_out_buffers;
-		std::vector<BufferAllocation> sampled_bone_buffers;
+		FrameDataRing::Allocation sampled_bones;
+		// Into the animated bone buffers instead of sampled_bones when animating on the GPU
+		uint32_t first_animated_bone{ 0 };
+
+		// Scheduler entry of the skeleton, and the pose generation the field of every frame was composed at
+		AnimationScheduler::EntryId schedule_entry{ 0 };
+		std::vector<uint32_t> composed_generations;
 		std::vector<GPUTexture> transformed_isogradfields;
 		std::vector<vk::DescriptorSet> skinning_descriptor_sets;
 
+		// Baked playback replacing composition and projection, pending until the next layout bakes it. Only the
+		// playback parameters of the cache stay on the CPU once uploaded
+		std::optional<VertexCacheRequest> vertex_cache_request;
+		std::optional<VertexCache::Clip> vertex_cache;
+		BufferAllocation vertex_cache_block_buffer;
+		BufferAllocation vertex_cache_data_buffer;
+		uint32_t vertex_cache_index{ 0 };
+		std::vector<vk::DescriptorSet> vertex_cache_descriptor_sets;
+
 		glm::ivec3 field_dims;
 
 		Skeleton* skeleton;
@@ -187,15 +502,133 @@ protected:
 
 	std::vector<InternalSkeletalMesh> skeletal_meshes;
 
+	// Reused every frame, poses are built in cached memory as propagation reads parents back, then copied to the mapped bone buffers
+	std::vector<Skeleton*> posed_skeletons;
+	std::vector<size_t> posed_skeleton_indices;
+	std::vector<std::vector<Bone>> skeleton_poses;
+
+	/*
+	* Batched posing, CPU posed skeletons sharing a rig with others are sampled a SIMD lane each
+	*/
+	struct BatchedSkeleton {
+		Skeleton* skeleton{ nullptr };
+		AnimationBatch::InstanceId instance{ 0 };
+
+		// Playback the instance was last started with, followed from the skeleton every frame
+		const Animation* animation{ nullptr };
+		bool is_looped{ false };
+	};
+
+	AnimationBatch animation_batch;
+	std::vector<BatchedSkeleton> batched_skeletons;
+	// batched_skeleton_indices[Skeletal Mesh Index], SIZE_MAX for meshes whose skeleton is posed on its own
+	std::vector<size_t> batched_skeleton_indices;
+
+	void build_animation_batch();
+
+	/*
+	* Animation scheduling, skeletons are posed at their own rate and fields only composed after a new pose
+	*/
+	bool use_animation_scheduling{ false };
+
+	AnimationScheduler animation_scheduler;
+	std::vector<float> schedule_screen_sizes;
+
+	// Pose generation per skeletal mesh for the culling kernel, or composition dispatch sizes without culling
+	FrameDataRing::Allocation pose_generations;
+	FrameDataRing::Allocation composition_dispatch_args;
+
+	/*
+	* Vertex cache playback, baked skeletal meshes decode their cache in place of composition and projection
+	*/
+	bool vertex_cache_available{ false };
+
+	VertexCache::PlaybackComputePipeline vertex_cache_pipeline;
+
+	// Baked frames of every skeletal mesh with a cache, by vertex_cache_index
+	FrameDataRing::Allocation vertex_cache_playbacks;
+
+	// Bakes pending requests through the kernels and resources of the first frame in flight, many frames per submission
+	void bake_vertex_caches();
+	void build_vertex_cache_data();
+
+	// Bones of the skeletal mesh the composition and skinning kernels read in the frame
+	vk::DescriptorBufferInfo get_bone_buffer_info(Swapchain::FrameId FrameIdx, const InternalSkeletalMesh& SkeletalMesh);
+
+	// Per frame skinning outputs, created for every skeletal mesh and skeletal instance
+	void create_skeletal_frame_data(InternalSkeletalMesh& SkeletalMesh);
+
+	/*
+	* Digestion is split so the CPU heavy bake can run on a worker thread, and the GPU resources
+	* can be uploaded through either the context or the streamer
+	*/
+	// Same data the offline bake tool saves
+	using BakedSkeletalMesh = FieldAsset;
+
+	struct DigestedSkeletalMesh {
+		InternalMesh mesh;
+		InternalSkeletalMesh skeletal_mesh;
+	};
+
+	// Thread safe, only reads the mesh and the skeleton, the fields are baked on Jobs
+	BakedSkeletalMesh bake_skeletal_mesh(const SkeletalMesh& Mesh, Skeleton& Skeleton, JobSystem& Jobs);
+	// Thread safe, whether a saved asset can stand in for baking Source against Skeleton
+	bool is_field_asset_compatible(const FieldAsset& Baked, const SkeletalMesh& Source, const Skeleton& Skeleton);
+
+	Retval<InternalMesh, Error> create_mesh_resources(const Mesh& Mesh, ModelTransform* Transform, bool Streamed);
+	Retval<DigestedSkeletalMesh, Error> create_skeletal_mesh_resources(const BakedSkeletalMesh& Baked, Skeleton* Skeleton, ModelTransform* Transform, bool Streamed);
+	MeshId add_skeletal_mesh(DigestedSkeletalMesh& Digested);
+
+	void upload_mesh_data(BufferAllocation Dest, const void* Source, size_t Size, bool Streamed);
+	void upload_field_data(TextureAllocation Dest, const void* Source, size_t Size, bool Streamed);
+
+	/*
+	* Background streaming
+	*/
+	struct StreamedModel {
+		ModelId id{ 0 };
+		ModelTransform* transform{ nullptr };
+		std::filesystem::path path;
+		std::filesystem::path field_directory;
+
+		// Written by the worker thread
+		std::unique_ptr<Model> model;
+		std::vector<std::optional<BakedSkeletalMesh>> baked_meshes;
+		bool failed{ false };
+
+		// Resources waiting for their uploads, in the order of the model's meshes
+		std::vector<std::variant<InternalMesh, DigestedSkeletalMesh>> digested;
+		AssetStreamer::Ticket ticket{ 0 };
+	};
+
+	// Creates the resources of baked models and adds the resident ones to the scene
+	void update_streaming();
+
+	JobSystem job_system;
+	// Outlives the streamer, whose workers bake through it. Kept apart from job_system, so the frame's
+	// waits never pick up a long field slice and stall while models stream in
+	JobSystem bake_job_system;
+
+	AssetStreamer streamer;
+
+	// Handed over by the workers
+	std::mutex baked_models_mutex;
+	std::vector<std::shared_ptr<StreamedModel>> baked_models;
+
+	std::vector<std::shared_ptr<StreamedModel>> uploading_models;
+
+	// streamed_models[Model Id], keeps skeletons alive for the meshes that reference them
+	std::unordered_map<ModelId, std::unique_ptr<Model>> streamed_models;
+	std::unordered_set<ModelId> pending_models;
+
 	ElasticSkinning::SkinningComputePipeline skinning_pipeline;
 	std::unique_ptr<ElasticFieldComposer> field_composer;
 
+	GpuProfiler profiler;
+
 	Camera* current_camera{ nullptr };
 
 	vk::CommandPool command_pool;
-	std::vector<vk::CommandBuffer> primary_render_command_buffers;
-	std::vector<vk::CommandBuffer> elastic_skinning_composition_command_buffers;
-	std::vector<vk::CommandBuffer> elastic_skinning_animate_command_buffers;
 	bool are_command_buffers_recorded{ false };
 
 };
@@ -205,7 +638,7 @@ class Renderer : public RendererImpl {
 	
 public:
 
-	Renderer(GfxContext* Context) {
+	Renderer(GfxContext* Context, const RendererSettings& Settings = {}) {
 
 		std::vector<StringHash> names = { (SupportedDescriptors::name())... };
 		std::vector<bool> isBuffer = { (BufferObjectType<SupportedDescriptors>)... };
@@ -236,7 +669,7 @@ public:
 		buffer_type_names = bufferNames;
 		sampler_type_names = samplerNames;
 
-		constructor_impl(Context);
+		constructor_impl(Context, Settings);
 	}
 
 	template <VertexType Vertex, DescriptorType... Descriptors>
@@ -247,8 +680,11 @@ public:
 	template <VertexType Vertex, DescriptorType... Descriptors>
 	Error register_pipeline(StringHash Name, GfxPipeline<Vertex, Descriptors...>& Pipeline) {
 		typename GfxPipeline<Vertex, Descriptors...>::DepthPipelineType depthPipeline;
-		depthPipeline.vertex_shader_path = Pipeline.vertex_shader_path;
+		// Depth pipelines only bind positions, their shader can't read the other attributes
+		depthPipeline.vertex_shader_path = Pipeline.depth_vertex_shader_path.empty() ?
+			Pipeline.vertex_shader_path : Pipeline.depth_vertex_shader_path;
 		depthPipeline.target = RenderTarget::DepthBuffer;
+		depthPipeline.bindless_textures = Pipeline.bindless_textures;
 
 		Error ret = register_pipeline_impl(Name, Pipeline);
 		
@@ -2,16 +2,22 @@
 
 #include "crc.h"
 
+// Offline tools build without Vulkan, only the CPU side asset types are available to them
+#ifndef ELASTIC_NO_VULKAN
 #include <vulkan/vulkan.hpp>
+#endif
+
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 #include <array>
+#include <string>
 #include <optional>
 #include <functional>
 #include <concepts>
 #include <type_traits>
 
+#ifndef ELASTIC_NO_VULKAN
 template <typename GLM_T>
 struct VkFormatType {
 	static constexpr vk::Format format() {
@@ -46,6 +52,7 @@ struct VkFormatType {
 		return vk::Format::eUndefined;
 	};
 };
+#endif
 
 enum class RenderTarget {
 	Swapchain,
@@ -100,6 +107,24 @@ struct Material {
 	float roughness_factor{ 0.0f };
 };
 
+// Material as laid out in the bindless material buffer, std430
+struct GpuMaterial {
+	static const uint32_t NO_TEXTURE = ~0u;
+
+	glm::vec4 albedo_factor;
+
+	// Indices into the bindless texture array
+	uint32_t albedo_texture;
+	uint32_t normal_texture;
+	uint32_t metallic_roughness_texture;
+
+	float metallic_factor;
+	float roughness_factor;
+
+	uint32_t padding[3];
+};
+
+#ifndef ELASTIC_NO_VULKAN
 template <typename T>
 concept BufferObjectType =
 	std::is_trivial_v<T> &&
@@ -214,6 +239,7 @@ struct ImageSampler {
 };
 
 using ModelBuffer = StorageBuffer<"Model", glm::mat4, 0, vk::ShaderStageFlagBits::eVertex, 1>;
+#endif
 
 #define NO_CAMERA nullptr
 
@@ -230,6 +256,16 @@ struct Camera {
 	}
 };
 
+#ifndef ELASTIC_NO_VULKAN
 using CameraBuffer = UniformBuffer<"Camera", Camera, 1, vk::ShaderStageFlagBits::eVertex, 1>;
 
-using ColorSampler = ImageSampler<"Color", 0, vk::ShaderStageFlagBits::eFragment, 1>;
\ No newline at end of file
+using ColorSampler = ImageSampler<"Color", 0, vk::ShaderStageFlagBits::eFragment, 1>;
+
+/*
+* Bindless set, bound as set 1 by pipelines with bindless textures. The texture array is sized
+* by the renderer, materials are indexed per transform slot like model transforms
+*/
+using BindlessTextureArray = ImageSampler<"BindlessTextures", 0, vk::ShaderStageFlagBits::eFragment, 1>;
+using MaterialBuffer = StorageBuffer<"Material", GpuMaterial, 1, vk::ShaderStageFlagBits::eFragment, 1>;
+using MaterialIndexBuffer = StorageBuffer<"MaterialIndex", uint32_t, 2, vk::ShaderStageFlagBits::eVertex, 1>;
+#endif
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/*
+* Four float lanes
+*
+* Backed by SSE2 where available and by plain arrays everywhere else, so lane based code
+* only has to be written once. Loads and stores expect 16 byte aligned memory.
+*/
+struct alignas(16) Float4 {
+
+#ifdef SIMD_SSE2
+	__m128 v;
+
+	Float4() = default;
+	explicit Float4(__m128 V) : v(V) {}
+	explicit Float4(float S) : v(_mm_set1_ps(S)) {}
+
+	static Float4 load(const float* Source) { return Float4{ _mm_load_ps(Source) }; }
+	void store(float* Dest) const { _mm_store_ps(Dest, v); }
+
+	friend Float4 operator+(Float4 A, Float4 B) { return Float4{ _mm_add_ps(A.v, B.v) }; }
+	friend Float4 operator-(Float4 A, Float4 B) { return Float4{ _mm_sub_ps(A.v, B.v) }; }
+	friend Float4 operator*(Float4 A, Float4 B) { return Float4{ _mm_mul_ps(A.v, B.v) }; }
+	friend Float4 operator/(Float4 A, Float4 B) { return Float4{ _mm_div_ps(A.v, B.v) }; }
+
+	friend Float4 sqrt(Float4 A) { return Float4{ _mm_sqrt_ps(A.v) }; }
+
+	// IfNegative where Test is below zero, Otherwise everywhere else
+	friend Float4 select_negative(Float4 Test, Float4 IfNegative, Float4 Otherwise) {
+		__m128 mask = _mm_cmplt_ps(Test.v, _mm_setzero_ps());
+		return Float4{ _mm_or_ps(_mm_and_ps(mask, IfNegative.v), _mm_andnot_ps(mask, Otherwise.v)) };
+	}
+#else
+	float v[4];
+
+	Float4() = default;
+	explicit Float4(float S) : v{ S, S, S, S } {}
+
+	static Float4 load(const float* Source) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = Source[i]; return r; }
+	void store(float* Dest) const { for (int i = 0; i < 4; i++) Dest[i] = v[i]; }
+
+	friend Float4 operator+(Float4 A, Float4 B) { for (int i = 0; i < 4; i++) A.v[i] += B.v[i]; return A; }
+	friend Float4 operator-(Float4 A, Float4 B) { for (int i = 0; i < 4; i++) A.v[i] -= B.v[i]; return A; }
+	friend Float4 operator*(Float4 A, Float4 B) { for (int i = 0; i < 4; i++) A.v[i] *= B.v[i]; return A; }
+	friend Float4 operator/(Float4 A, Float4 B) { for (int i = 0; i < 4; i++) A.v[i] /= B.v[i]; return A; }
+
+	friend Float4 sqrt(Float4 A) { for (int i = 0; i < 4; i++) A.v[i] = std::sqrt(A.v[i]); return A; }
+
+	friend Float4 select_negative(Float4 Test, Float4 IfNegative, Float4 Otherwise) {
+		for (int i = 0; i < 4; i++) Otherwise.v[i] = Test.v[i] < 0.0f ? IfNegative.v[i] : Otherwise.v[i];
+		return Otherwise;
+	}
+#endif
+
+	static constexpr size_t LANES = 4;
+};
+
+/*
+* Lane wise vector and quaternion math, lane i of every component belongs to the same element
+*/
+struct Vec3x4 {
+	Float4 x, y, z;
+};
+
+struct Quatx4 {
+	Float4 x, y, z, w;
+};
+
+inline Vec3x4 operator+(const Vec3x4& A, const Vec3x4& B) {
+	return { A.x + B.x, A.y + B.y, A.z + B.z };
+}
+
+inline Vec3x4 lerp(const Vec3x4& A, const Vec3x4& B, Float4 T) {
+	return { A.x + (B.x - A.x) * T, A.y + (B.y - A.y) * T, A.z + (B.z - A.z) * T };
+}
+
+inline Vec3x4 cross(const Vec3x4& A, const Vec3x4& B) {
+	return {
+		A.y * B.z - A.z * B.y,
+		A.z * B.x - A.x * B.z,
+		A.x * B.y - A.y * B.x
+	};
+}
+
+inline Quatx4 normalize(const Quatx4& Q) {
+	Float4 invLength = Float4(1.0f) / sqrt(Q.x * Q.x + Q.y * Q.y + Q.z * Q.z + Q.w * Q.w);
+	return { Q.x * invLength, Q.y * invLength, Q.z * invLength, Q.w * invLength };
+}
+
+// Normalized lerp along the shorter arc
+inline Quatx4 nlerp(const Quatx4& A, const Quatx4& B, Float4 T) {
+	Float4 dot = A.x * B.x + A.y * B.y + A.z * B.z + A.w * B.w;
+	Float4 sign = select_negative(dot, Float4(-1.0f), Float4(1.0f));
+	Float4 wa = Float4(1.0f) - T;
+	Float4 wb = T * sign;
+
+	return normalize({
+		A.x * wa + B.x * wb,
+		A.y * wa + B.y * wb,
+		A.z * wa + B.z * wb,
+		A.w * wa + B.w * wb
+	});
+}
+
+inline Quatx4 operator*(const Quatx4& A, const Quatx4& B) {
+	return {
+		A.w * B.x + A.x * B.w + A.y * B.z - A.z * B.y,
+		A.w * B.y + A.y * B.w + A.z * B.x - A.x * B.z,
+		A.w * B.z + A.z * B.w + A.x * B.y - A.y * B.x,
+		A.w * B.w - A.x * B.x - A.y * B.y - A.z * B.z
+	};
+}
+
+// Q * V * conjugate(Q) for unit quaternions
+inline Vec3x4 rotate(const Quatx4& Q, const Vec3x4& V) {
+	Vec3x4 u{ Q.x, Q.y, Q.z };
+	Vec3x4 t = cross(u, V);
+	t = { t.x + t.x, t.y + t.y, t.z + t.z };
+
+	Vec3x4 ut = cross(u, t);
+
+	return { V.x + Q.w * t.x + ut.x, V.y + Q.w * t.y + ut.y, V.z + Q.w * t.z + ut.z };
+}
@@ -2,11 +2,14 @@
 
 #include "util.h"
 #include "animation.h"
+#include "compressedanimation.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 #include <vector>
+#include <span>
+#include <chrono>
 
 struct Bone {
 	alignas(16) glm::mat4 bind_matrix;
@@ -25,9 +28,14 @@ struct Skeleton {
 	enum class Error {
 		OK,
 		BONE_NOT_FOUND,
-		ANIMATION_NOT_FOUND
+		ANIMATION_NOT_FOUND,
+		CYCLIC_HIERARCHY,
+		OUTPUT_TOO_SMALL,
+		INVALID_ANIMATION
 	};
 
+	static constexpr uint32_t NO_BONE = UINT32_MAX;
+
 	void add_bone(const Bone& bone, const std::string& name);
 	void add_bone(const Bone& bone, StringHash name);
 	Retval<Bone*, Error> get_bone(const std::string& name);
@@ -55,16 +63,52 @@ struct Skeleton {
 	Error play_animation(StringHash name, bool loop = false);
 	void clear_animation();
 
+	// Replaces the keys of every animation with quantized ones, the full precision keys are released
+	Error compress_animations(const AnimationCompressionSettings& settings = {});
+
+	// Builds the index based topology, adding bones, relationships or animations afterwards invalidates it
+	Error finalize();
+	bool is_finalized() { return finalized; }
+
+	// Time elapsed since the active animation started playing
+	std::chrono::milliseconds get_animation_time(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+	// Poses the skeleton at time into the active animation, into one bone per skeleton bone at the front of out.
+	// Looped animations wrap around, others hold their last keyframe. Never allocates once finalized
+	Error sample_animation_frame(std::chrono::milliseconds time, std::span<Bone> out);
+	// Allocating convenience over the above, sampled at the current time, finalizes the skeleton first if needed
 	std::vector<Bone> sample_animation_frame();
 
+	// Poses the skeleton at time into any animation without touching the active playback, nullptr gives the bind pose.
+	// cursors are the caller's keyframe intervals, kept between calls they make sampling forward in time cheap
+	Error sample_animation(const std::string& name, std::chrono::milliseconds time, bool loop, std::span<Bone> out, std::vector<size_t>& cursors);
+	Error sample_animation(StringHash name, std::chrono::milliseconds time, bool loop, std::span<Bone> out, std::vector<size_t>& cursors);
+	Error sample_animation(const Animation* animation, std::chrono::milliseconds time, bool loop, std::span<Bone> out, std::vector<size_t>& cursors);
+
 	std::vector<Bone> bones;
 	std::vector<StringHash> bone_names;
 	std::vector<BoneRelationship> bone_relationships;
 
+	// parent_indices[Bone Index], NO_BONE for roots
+	std::vector<uint32_t> parent_indices;
+	// Every bone comes after its parent, so poses propagate in a single pass
+	std::vector<uint32_t> topological_order;
+
 	std::vector<Animation> animations;
 	std::vector<StringHash> animation_names;
+	// compressed_animations[Animation Index], empty for animations that keep their full precision keys
+	std::vector<CompressedAnimation> compressed_animations;
+	// animation_channel_bones[Animation Index][Channel Index], NO_BONE for channels without keyframes or bone
+	std::vector<std::vector<uint32_t>> animation_channel_bones;
+	// animation_durations[Animation Index], last keyframe time of the longest channel
+	std::vector<std::chrono::milliseconds> animation_durations;
+
+	bool finalized{ false };
 
 	Animation* active_animation{ nullptr };
+	// channel_cursors[Channel Index], or [Channel Index * TRACKS_PER_CHANNEL + Track] for compressed animations,
+	// keyframe intervals of the active playback
+	std::vector<size_t> channel_cursors;
 	std::chrono::steady_clock::time_point animation_start_time;
 	bool is_looped{ false };
 };
\ No newline at end of file
@@ -16,6 +16,7 @@ struct Swapchain {
 		INVALID_CONTEXT,
 		UNINITIALIZED_CONTEXT,
 		FAIL_CREATE_SWAPCHAIN,
+		FAIL_CREATE_OFFSCREEN_IMAGE,
 		FAIL_CREATE_IMAGE_VIEW,
 		FAIL_CREATE_SYNCH_OBJECTS,
 		FAIL_ACQUIRE_IMAGE,
@@ -27,11 +28,15 @@ struct Swapchain {
 
 	~Swapchain();
 
-	Error init(GfxContext* Context);
+	// FramesInFlight bounds how many frames the CPU may record ahead of the GPU, independent of the image count
+	Error init(GfxContext* Context, size_t FramesInFlight = 2);
+	// Renders into plain images instead of a presentable swapchain, for headless contexts
+	Error init_offscreen(GfxContext* Context, vk::Extent2D Extent, size_t ImageCount, size_t FramesInFlight = 2);
 	Error reinit();
 	void deinit();
 
 	bool is_initialized() { return is_init; }
+	bool is_offscreen() { return offscreen; }
 
 	size_t size() {
 		assert(images.size() == image_views.size());
@@ -43,7 +48,10 @@ struct Swapchain {
 		vk::Semaphore render_finished_semaphore;
 		vk::Fence fence;
 
+		// Swapchain image index
 		FrameId id;
+		// Frame in flight index, selects per frame resources
+		FrameId in_flight_id;
 	};
 
 	Retval<Frame, Error> prepare_frame();
@@ -56,12 +64,20 @@ struct Swapchain {
 	std::vector<vk::Image> images;
 	std::vector<vk::ImageView> image_views;
 
+	// Backing allocations of images when offscreen
+	std::vector<TextureAllocation> offscreen_images;
+
 	size_t max_frames_in_flight{ 0 };
 	size_t current_frame{ 0 };
+	size_t current_offscreen_image{ 0 };
 
 private:
 
+	Error create_image_views();
+	Error create_sync_objects();
+
 	bool is_init{ false };
+	bool offscreen{ false };
 
 	GfxContext* context{ nullptr };
 
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "util.h"
+#include "gfxcontext.h"
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/*
+* Batched uploads through a persistently mapped staging ring
+*
+* Host data is copied into a ring buffer and the matching GPU copies are recorded into the
+* open batch, together with any layout transitions recorded by the context. A batch is
+* submitted to its queue once, ending in a global memory barrier, so later submissions
+* on the same queue see its writes without waiting. Staging space and command buffers are
+* reclaimed in submission order once the batch's fence signals.
+*/
+class UploadManager {
+
+public:
+
+	enum class Error {
+		OK,
+		INVALID_CONTEXT,
+		UNINITIALIZED_CONTEXT,
+		FAIL_CREATE_BUFFER,
+		FAIL_CREATE_COMMAND_POOL
+	};
+
+	UploadManager() = default;
+	~UploadManager();
+
+	Error init(GfxContext* Context, vk::Queue Queue, uint32_t QueueFamilyIndex, vk::DeviceSize StagingSize = 32 * 1024 * 1024, size_t BatchCount = 4);
+	void deinit();
+
+	bool is_initialized() { return is_init; }
+	bool has_open_batch() { return is_init && batches[current_batch].state == BatchState::Recording; }
+
+	// Copies Size bytes of Source into Dest at DestOffset once the batch executes
+	void upload_buffer(BufferAllocation Dest, const void* Source, size_t Size, vk::DeviceSize DestOffset = 0);
+
+	// Dest must be in transfer destination layout when the batch executes
+	void upload_texture(TextureAllocation Dest, const void* Source, size_t Size);
+
+	// Command buffer of the open batch, begins a new batch if none is open
+	vk::CommandBuffer get_command_buffer();
+
+	// Submits the open batch without waiting for it, returns the serial of the last submitted batch
+	uint64_t flush();
+
+	// Non blocking, true once the batch with Serial and every batch before it have executed
+	bool is_complete(uint64_t Serial);
+
+	// Waits for every submitted batch and reclaims its staging space
+	void wait();
+
+private:
+
+	enum class BatchState {
+		Free,
+		Recording,
+		InFlight
+	};
+
+	struct Batch {
+		vk::CommandBuffer command_buffer;
+		vk::Fence fence;
+		BatchState state{ BatchState::Free };
+		uint64_t serial{ 0 };
+
+		// Ring bytes consumed by this batch, including wrap padding
+		vk::DeviceSize ring_bytes{ 0 };
+
+		// Uploads larger than the ring get their own transfer buffer
+		std::vector<BufferAllocation> dedicated_buffers;
+	};
+
+	static vk::DeviceSize align_up(vk::DeviceSize Value, vk::DeviceSize Alignment) {
+		return (Value + Alignment - 1) & ~(Alignment - 1);
+	}
+
+	struct StagingRegion {
+		vk::Buffer buffer;
+		vk::DeviceSize offset{ 0 };
+	};
+
+	StagingRegion write_staging(const void* Source, size_t Size);
+
+	void begin_batch();
+	// Retires the oldest submitted batch, returns false if none is in flight
+	bool retire_oldest(bool Wait);
+	void retire(Batch& Retired);
+
+	bool is_init{ false };
+
+	GfxContext* context{ nullptr };
+
+	vk::Queue queue;
+	uint32_t queue_family_index{ 0 };
+	vk::CommandPool command_pool;
+
+	std::vector<Batch> batches;
+	uint64_t submitted_serial{ 0 };
+	uint64_t completed_serial{ 0 };
+	size_t current_batch{ 0 };
+	size_t oldest_batch{ 0 };
+
+	BufferAllocation staging;
+	vk::DeviceSize alignment{ 1 };
+	vk::DeviceSize ring_head{ 0 };
+	vk::DeviceSize ring_used{ 0 };
+
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "util.h"
+#include "computepipeline.h"
+#include "mesh.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <span>
+#include <chrono>
+#include <cstdint>
+
+/*
+* Baked vertex caches
+*
+* The skinned positions and normals of a skeletal mesh sampled at a fixed rate over one clip, for
+* meshes that only ever play that clip. Positions are quantized to 16 bits within the bounds of the
+* whole clip and normals to 16 bit octahedral coordinates. Frames are grouped in blocks, the first
+* frame of a block is stored whole and every following one as 8 bit deltas from the frame before it,
+* scaled by a power of two chosen per block. Any frame decodes from the start of its block, so
+* playback reads at most one block per baked frame.
+*/
+namespace VertexCache {
+
+	static constexpr uint32_t WORKGROUP_SIZE = 256;
+	static constexpr uint32_t FRAMES_PER_BLOCK = 8;
+	// Position x, y and z followed by the octahedral normal
+	static constexpr uint32_t CHANNELS = 5;
+
+	enum class Error {
+		OK,
+		INVALID_FRAMES
+	};
+
+	struct Block {
+		// Into the data words, the key frame comes first and the deltas of the following frames after it
+		uint32_t first_word;
+		uint32_t frame_count;
+		// Deltas are scaled by 1 << shift
+		uint32_t position_shift;
+		uint32_t normal_shift;
+	};
+
+	struct Clip {
+		uint32_t vertex_count{ 0 };
+		uint32_t frame_count{ 0 };
+		float frame_rate{ 30.0f };
+		// The last frame is sampled at the end of the clip, which may fall short of a whole frame
+		std::chrono::milliseconds duration{ 0 };
+		bool looped{ true };
+
+		glm::vec3 bounds_min{ 0.0f };
+		glm::vec3 bounds_extent{ 0.0f };
+
+		std::vector<Block> blocks;
+		// Key frames are 16 bits per channel and deltas 8, both packed into words
+		std::vector<uint32_t> data;
+	};
+
+	// Baked frames around a time and the weight of the second one
+	struct Playback {
+		uint32_t frame_a;
+		uint32_t frame_b;
+		float weight;
+		uint32_t padding;
+	};
+
+	// Positions and Normals hold every frame in turn, VertexCount of each per frame
+	Retval<Clip, Error> encode(std::span<const glm::vec3> Positions, std::span<const glm::vec3> Normals, uint32_t VertexCount, float FrameRate, std::chrono::milliseconds Duration, bool Looped);
+
+	// Same decoding as the playback kernel, one element per vertex at the front of Positions and Normals
+	Error decode_frame(const Clip& Clip, uint32_t Frame, std::span<glm::vec3> Positions, std::span<glm::vec3> Normals);
+
+	// Looped clips wrap around, others hold their last frame
+	Playback get_playback(const Clip& Clip, std::chrono::milliseconds Time);
+
+	struct PlaybackContext {
+		uint32_t vertex_count;
+		uint32_t playback_index;
+		alignas(16) glm::vec3 bounds_min;
+		alignas(16) glm::vec3 bounds_extent;
+	};
+
+	using BlockBuffer = Compute::StorageBuffer<Block, 0>;
+	using CacheDataBuffer = Compute::StorageBuffer<uint32_t, 3>;
+	using PlaybackBuffer = Compute::StorageBuffer<Playback, 5>;
+
+	static constexpr uint32_t STORAGE_BUFFER_COUNT = 6;
+
+	// Source vertices only provide the attributes the cache does not store
+	using PlaybackComputePipeline = ComputePipeline<
+		PlaybackContext,
+		BlockBuffer,
+		ElasticVertexBuffer,
+		PositionStreamBuffer,
+		CacheDataBuffer,
+		AttributeStreamBuffer,
+		PlaybackBuffer
+	>;
+
+}
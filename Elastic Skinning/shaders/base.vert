@@ -22,7 +22,7 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoords;
 
 void main() {
-	gl_Position = camera.proj * camera.view * models.transforms[push.ModelId] * vec4(inPosition, 1.0);
+	gl_Position = camera.proj * camera.view * models.transforms[push.ModelId + gl_InstanceIndex] * vec4(inPosition, 1.0);
 	fragColor = inColor;
 	fragTexCoords = inTexCoords;
 }
\ No newline at end of file
@@ -0,0 +1,30 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+struct Material {
+	vec4 albedoFactor;
+	uint albedoTexture;
+	uint normalTexture;
+	uint metallicRoughnessTexture;
+	float metallicFactor;
+	float roughnessFactor;
+};
+
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(std430, set = 1, binding = 1) readonly buffer Materials {
+	Material materials[];
+};
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoords;
+layout(location = 2) flat in uint fragMaterialId;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    Material material = materials[fragMaterialId];
+    vec4 albedo = texture(textures[nonuniformEXT(material.albedoTexture)], fragTexCoords) * material.albedoFactor;
+
+    outColor = vec4(albedo.rgb * fragColor, 1.0);
+}
\ No newline at end of file
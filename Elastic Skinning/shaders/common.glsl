@@ -25,6 +25,16 @@ struct Vertex {
 	vec2 texcoords;
 };
 
+struct VertexPosition {
+	vec3 position;
+};
+
+struct VertexAttributes {
+	vec3 normal;
+	vec3 color;
+	vec2 texcoords;
+};
+
 vec4 quat_mul(vec4 q1, vec4 q2) {
 	return vec4(
 		(q1.x * q2.x) - (q1.y * q2.y) - (q1.z * q2.z) - (q1.w * q1.w),
@@ -0,0 +1,21 @@
+#version 450
+
+layout(std140, set = 0, binding = 0) readonly buffer ModelUBO {
+	mat4 transforms[];
+} models;
+
+layout(set = 0, binding = 1) uniform CameraUBO {
+	mat4 view;
+	mat4 proj;
+} camera;
+
+layout(push_constant) uniform PushConstants {
+	uint ModelId;
+} push;
+
+// Only the position stream is bound in the depth prepass
+layout(location = 0) in vec3 inPosition;
+
+void main() {
+	gl_Position = camera.proj * camera.view * models.transforms[push.ModelId + gl_InstanceIndex] * vec4(inPosition, 1.0);
+}
\ No newline at end of file
@@ -2,40 +2,47 @@
 
 #include <glm/gtx/compatibility.hpp>
 
-Retval<Keyframe, Channel::Status> Channel::sample(std::chrono::milliseconds time) {
+#include <algorithm>
+
+Retval<Keyframe, Channel::Status> Channel::sample(std::chrono::milliseconds time) const {
+	size_t cursor = 0;
+	return sample(time, cursor);
+}
+
+Retval<Keyframe, Channel::Status> Channel::sample(std::chrono::milliseconds time, size_t& cursor) const {
 	if (time > time_points.back()) {
 		return { keyframes.back(), Status::PAST_END };
 	}
 
-	std::chrono::milliseconds timepointA;
-	std::chrono::milliseconds timepointB;
-	
-	Keyframe keyframeA;
-	Keyframe keyframeB;
-
-	if (time >= std::chrono::milliseconds(0) && time <= time_points[0]) {
-		keyframeA = keyframes[0];
-		keyframeB = keyframes[0];
-
-		timepointA = time + std::chrono::milliseconds(0);
-		timepointB = time + std::chrono::milliseconds(1);
+	if (time <= time_points[0]) {
+		cursor = 0;
+		return { keyframes[0], Status::OK };
 	}
-	else {
-		for (size_t keyframe = 1; keyframe < time_points.size(); keyframe++) {
-			if (time > time_points[keyframe - 1] && time <= time_points[keyframe]) {
-				timepointA = time_points[keyframe - 1];
-				timepointB = time_points[keyframe];
 
-				keyframeA = keyframes[keyframe - 1];
-				keyframeB = keyframes[keyframe];
+	// Interval k spans (time_points[k - 1], time_points[k]]
+	auto inInterval = [&](size_t k) {
+		return k >= 1 && k < time_points.size() && time_points[k - 1] < time && time <= time_points[k];
+	};
+
+	// Playback time only moves forward, so the last interval or the one after it almost always holds
+	size_t k = cursor;
 
-				break;
-			}
+	if (!inInterval(k)) {
+		if (inInterval(k + 1)) {
+			k++;
+		}
+		else {
+			k = std::lower_bound(time_points.begin() + 1, time_points.end(), time) - time_points.begin();
 		}
 	}
 
-	float numerator = static_cast<float>(time.count() - timepointA.count());
-	float denominator = static_cast<float>(timepointB.count() - timepointA.count());
+	cursor = k;
+
+	const Keyframe& keyframeA = keyframes[k - 1];
+	const Keyframe& keyframeB = keyframes[k];
+
+	float numerator = static_cast<float>((time - time_points[k - 1]).count());
+	float denominator = static_cast<float>((time_points[k] - time_points[k - 1]).count());
 	float interp = numerator / denominator;
 
 	return {
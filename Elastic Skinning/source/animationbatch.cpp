@@ -0,0 +1,328 @@
+#include "animationbatch.h"
+
+#include <algorithm>
+
+// Rotation x, y, z, w then position x, y, z
+static constexpr size_t COMPONENTS = 7;
+
+Retval<AnimationBatch::InstanceId, AnimationBatch::Error> AnimationBatch::add_instance(const Skeleton& Skeleton) {
+	if (!Skeleton.finalized) {
+		return { UINT32_MAX, Error::SKELETON_NOT_FINALIZED };
+	}
+
+	auto groupIt = std::find_if(groups.begin(), groups.end(), [&Skeleton](const SkeletonGroup& G) {
+		return G.skeleton == &Skeleton;
+	});
+
+	if (groupIt == groups.end()) {
+		groups.push_back({ &Skeleton, {}, {} });
+		groupIt = groups.end() - 1;
+	}
+
+	SkeletonGroup& group = *groupIt;
+	InstanceId id = static_cast<InstanceId>(instances.size());
+
+	Instance instance;
+	instance.group = static_cast<uint32_t>(groupIt - groups.begin());
+	instance.lane = static_cast<uint32_t>(group.instances.size());
+
+	// First lane of a new block
+	if (instance.lane % Float4::LANES == 0) {
+		blocks.push_back({ instance.group, static_cast<uint32_t>(instance.lane / Float4::LANES) });
+		group.poses.resize(group.poses.size() + Skeleton.bones.size());
+	}
+
+	group.instances.push_back(id);
+	instances.push_back(std::move(instance));
+
+	return { id, Error::OK };
+}
+
+void AnimationBatch::clear() {
+	instances.clear();
+	groups.clear();
+	blocks.clear();
+	clips.clear();
+}
+
+AnimationBatch::Error AnimationBatch::play_animation(InstanceId Instance, StringHash Name, bool Loop) {
+	if (Instance >= instances.size()) {
+		return Error::INSTANCE_NOT_FOUND;
+	}
+
+	auto& instance = instances[Instance];
+	const Skeleton& skeleton = *groups[instance.group].skeleton;
+
+	auto nameIt = std::find(skeleton.animation_names.begin(), skeleton.animation_names.end(), Name);
+
+	if (nameIt == skeleton.animation_names.end()) {
+		return Error::ANIMATION_NOT_FOUND;
+	}
+
+	instance.clip = get_clip(skeleton, nameIt - skeleton.animation_names.begin());
+	instance.is_looped = Loop;
+	instance.time = std::chrono::milliseconds(0);
+	instance.cursors.assign(instance.clip->tracks.size(), 0);
+
+	return Error::OK;
+}
+
+void AnimationBatch::clear_animation(InstanceId Instance) {
+	if (Instance < instances.size()) {
+		instances[Instance].clip = nullptr;
+	}
+}
+
+AnimationBatch::Error AnimationBatch::set_time(InstanceId Instance, std::chrono::milliseconds Time) {
+	if (Instance >= instances.size()) {
+		return Error::INSTANCE_NOT_FOUND;
+	}
+
+	instances[Instance].time = Time;
+
+	return Error::OK;
+}
+
+void AnimationBatch::advance(std::chrono::milliseconds Delta) {
+	for (auto& instance : instances) {
+		instance.time += Delta;
+
+		// Kept inside the clip, so looped playback never overflows
+		if (instance.clip != nullptr && instance.is_looped && instance.clip->duration.count() > 0 && instance.time > instance.clip->duration) {
+			instance.time %= instance.clip->duration;
+		}
+	}
+}
+
+void AnimationBatch::evaluate(JobSystem* Jobs) {
+	auto body = [this](size_t Begin, size_t End) {
+		for (size_t i = Begin; i < End; i++) {
+			evaluate_block(groups[blocks[i].group], blocks[i].block);
+		}
+	};
+
+	if (Jobs == nullptr) {
+		body(0, blocks.size());
+	}
+	else {
+		Jobs->parallel_for(blocks.size(), 0, body);
+	}
+}
+
+AnimationBatch::Error AnimationBatch::get_pose(InstanceId Instance, std::span<Bone> Out) {
+	if (Instance >= instances.size()) {
+		return Error::INSTANCE_NOT_FOUND;
+	}
+
+	const auto& instance = instances[Instance];
+	const SkeletonGroup& group = groups[instance.group];
+	const Skeleton& skeleton = *group.skeleton;
+	size_t boneCount = skeleton.bones.size();
+
+	if (Out.size() < boneCount) {
+		return Error::OUTPUT_TOO_SMALL;
+	}
+
+	const BoneLanes* lanes = &group.poses[(instance.lane / Float4::LANES) * boneCount];
+	size_t lane = instance.lane % Float4::LANES;
+
+	alignas(16) float components[COMPONENTS][Float4::LANES];
+
+	for (size_t b = 0; b < boneCount; b++) {
+		lanes[b].rotation.x.store(components[0]);
+		lanes[b].rotation.y.store(components[1]);
+		lanes[b].rotation.z.store(components[2]);
+		lanes[b].rotation.w.store(components[3]);
+		lanes[b].position.x.store(components[4]);
+		lanes[b].position.y.store(components[5]);
+		lanes[b].position.z.store(components[6]);
+
+		// Every bone is written whole, Out may be write combined memory
+		Bone bone = skeleton.bones[b];
+		bone.rotation = glm::quat(components[3][lane], components[0][lane], components[1][lane], components[2][lane]);
+		bone.position = glm::vec3(components[4][lane], components[5][lane], components[6][lane]);
+
+		Out[b] = bone;
+	}
+
+	return Error::OK;
+}
+
+const AnimationBatch::Clip* AnimationBatch::get_clip(const Skeleton& Skeleton, size_t AnimationIdx) {
+	auto& clip = clips[{ &Skeleton, AnimationIdx }];
+
+	if (clip) {
+		return clip.get();
+	}
+
+	clip = std::make_unique<Clip>();
+
+	// The batch keeps its own full precision copy, compressed keys are expanded once here
+	const CompressedAnimation& compressed = Skeleton.compressed_animations[AnimationIdx];
+	Animation decompressed = compressed.empty() ? Animation{} : compressed.decompress();
+	const Animation& animation = compressed.empty() ? Skeleton.animations[AnimationIdx] : decompressed;
+	const std::vector<uint32_t>& channelBones = Skeleton.animation_channel_bones[AnimationIdx];
+
+	clip->duration = Skeleton.animation_durations[AnimationIdx];
+	clip->bone_tracks.assign(Skeleton.bones.size(), NO_TRACK);
+
+	for (size_t c = 0; c < channelBones.size(); c++) {
+		if (channelBones[c] == Skeleton::NO_BONE) {
+			continue;
+		}
+
+		const Channel& channel = animation.channels[c];
+
+		// Later channels of the same bone win, like they do when sampling the skeleton
+		clip->bone_tracks[channelBones[c]] = static_cast<uint32_t>(clip->tracks.size());
+		clip->tracks.push_back({ static_cast<uint32_t>(clip->times.size()), static_cast<uint32_t>(channel.time_points.size()) });
+
+		for (size_t k = 0; k < channel.time_points.size(); k++) {
+			const Keyframe& keyframe = channel.keyframes[k];
+
+			clip->times.push_back(channel.time_points[k].count());
+			clip->rotation_x.push_back(keyframe.rotation.x);
+			clip->rotation_y.push_back(keyframe.rotation.y);
+			clip->rotation_z.push_back(keyframe.rotation.z);
+			clip->rotation_w.push_back(keyframe.rotation.w);
+			clip->position_x.push_back(keyframe.position.x);
+			clip->position_y.push_back(keyframe.position.y);
+			clip->position_z.push_back(keyframe.position.z);
+		}
+	}
+
+	return clip.get();
+}
+
+void AnimationBatch::evaluate_block(SkeletonGroup& Group, size_t Block) {
+	const Skeleton& skeleton = *Group.skeleton;
+	size_t boneCount = skeleton.bones.size();
+	BoneLanes* pose = &Group.poses[Block * boneCount];
+
+	// Padding lanes of the last block have no instance and hold the rest pose
+	Instance* laneInstances[Float4::LANES] = {};
+	int64_t laneTimes[Float4::LANES] = {};
+
+	for (size_t l = 0; l < Float4::LANES; l++) {
+		size_t lane = Block * Float4::LANES + l;
+
+		if (lane >= Group.instances.size()) {
+			continue;
+		}
+
+		Instance& instance = instances[Group.instances[lane]];
+
+		if (instance.clip == nullptr) {
+			continue;
+		}
+
+		std::chrono::milliseconds time = instance.time;
+
+		if (instance.is_looped && instance.clip->duration.count() > 0 && time > instance.clip->duration) {
+			time %= instance.clip->duration;
+		}
+
+		laneInstances[l] = &instance;
+		laneTimes[l] = time.count();
+	}
+
+	/*
+	* Sample every bone, the interval search and key gather are per lane, the blend is not
+	*/
+	alignas(16) float keysA[COMPONENTS][Float4::LANES];
+	alignas(16) float keysB[COMPONENTS][Float4::LANES];
+	alignas(16) float weights[Float4::LANES];
+
+	for (size_t b = 0; b < boneCount; b++) {
+		const Bone& rest = skeleton.bones[b];
+
+		for (size_t l = 0; l < Float4::LANES; l++) {
+			Instance* instance = laneInstances[l];
+			uint32_t trackIdx = instance == nullptr ? NO_TRACK : instance->clip->bone_tracks[b];
+
+			if (trackIdx == NO_TRACK) {
+				keysA[0][l] = keysB[0][l] = rest.rotation.x;
+				keysA[1][l] = keysB[1][l] = rest.rotation.y;
+				keysA[2][l] = keysB[2][l] = rest.rotation.z;
+				keysA[3][l] = keysB[3][l] = rest.rotation.w;
+				keysA[4][l] = keysB[4][l] = rest.position.x;
+				keysA[5][l] = keysB[5][l] = rest.position.y;
+				keysA[6][l] = keysB[6][l] = rest.position.z;
+				weights[l] = 0.0f;
+				continue;
+			}
+
+			const Clip& clip = *instance->clip;
+			const Clip::Track& track = clip.tracks[trackIdx];
+			const int64_t* times = &clip.times[track.first_key];
+			int64_t time = laneTimes[l];
+			size_t& cursor = instance->cursors[trackIdx];
+
+			// Keys a and b are relative to the track, interval k spans (times[k - 1], times[k]]
+			size_t a = 0;
+			size_t k = 0;
+			float weight = 0.0f;
+
+			if (time >= times[track.key_count - 1]) {
+				a = k = track.key_count - 1;
+			}
+			else if (time > times[0]) {
+				auto inInterval = [&](size_t K) {
+					return K >= 1 && K < track.key_count && times[K - 1] < time && time <= times[K];
+				};
+
+				k = cursor;
+
+				if (!inInterval(k)) {
+					if (inInterval(k + 1)) {
+						k++;
+					}
+					else {
+						k = std::lower_bound(times + 1, times + track.key_count, time) - times;
+					}
+				}
+
+				cursor = k;
+				a = k - 1;
+				weight = static_cast<float>(time - times[a]) / static_cast<float>(times[k] - times[a]);
+			}
+
+			size_t keyA = track.first_key + a;
+			size_t keyB = track.first_key + k;
+
+			keysA[0][l] = clip.rotation_x[keyA]; keysB[0][l] = clip.rotation_x[keyB];
+			keysA[1][l] = clip.rotation_y[keyA]; keysB[1][l] = clip.rotation_y[keyB];
+			keysA[2][l] = clip.rotation_z[keyA]; keysB[2][l] = clip.rotation_z[keyB];
+			keysA[3][l] = clip.rotation_w[keyA]; keysB[3][l] = clip.rotation_w[keyB];
+			keysA[4][l] = clip.position_x[keyA]; keysB[4][l] = clip.position_x[keyB];
+			keysA[5][l] = clip.position_y[keyA]; keysB[5][l] = clip.position_y[keyB];
+			keysA[6][l] = clip.position_z[keyA]; keysB[6][l] = clip.position_z[keyB];
+			weights[l] = weight;
+		}
+
+		Float4 t = Float4::load(weights);
+
+		Quatx4 rotationA{ Float4::load(keysA[0]), Float4::load(keysA[1]), Float4::load(keysA[2]), Float4::load(keysA[3]) };
+		Quatx4 rotationB{ Float4::load(keysB[0]), Float4::load(keysB[1]), Float4::load(keysB[2]), Float4::load(keysB[3]) };
+		Vec3x4 positionA{ Float4::load(keysA[4]), Float4::load(keysA[5]), Float4::load(keysA[6]) };
+		Vec3x4 positionB{ Float4::load(keysB[4]), Float4::load(keysB[5]), Float4::load(keysB[6]) };
+
+		pose[b].rotation = nlerp(rotationA, rotationB, t);
+		pose[b].position = lerp(positionA, positionB, t);
+	}
+
+	// Propagate transformations, parents are always final before their children
+	for (uint32_t boneIdx : skeleton.topological_order) {
+		uint32_t parentIdx = skeleton.parent_indices[boneIdx];
+
+		if (parentIdx == Skeleton::NO_BONE) {
+			continue;
+		}
+
+		const BoneLanes& parentBone = pose[parentIdx];
+		BoneLanes& childBone = pose[boneIdx];
+
+		childBone.position = parentBone.position + rotate(parentBone.rotation, childBone.position);
+		childBone.rotation = parentBone.rotation * childBone.rotation;
+	}
+}
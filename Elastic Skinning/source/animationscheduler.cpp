@@ -0,0 +1,206 @@
+#include "animationscheduler.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Fractional parts of multiples of it are spread evenly over [0, 1) however many there are
+static constexpr float GOLDEN_RATIO_FRACTION = 0.618034f;
+
+static void sample_pose(Skeleton& Skeleton, std::chrono::milliseconds Time, std::vector<Bone>& Pose) {
+	Pose.resize(Skeleton.bones.size());
+
+	if (Skeleton.sample_animation_frame(Time, Pose) != Skeleton::Error::OK) {
+		std::copy(Skeleton.bones.begin(), Skeleton.bones.end(), Pose.begin());
+	}
+}
+
+AnimationScheduler::EntryId AnimationScheduler::add_skeleton(Skeleton& Skeleton) {
+	auto it = entry_ids.find(&Skeleton);
+
+	if (it != entry_ids.end()) {
+		return it->second;
+	}
+
+	EntryId id = static_cast<EntryId>(entries.size());
+
+	Entry entry;
+	entry.skeleton = &Skeleton;
+	entry.phase = 1.0f - std::fmod(id * GOLDEN_RATIO_FRACTION, 1.0f);
+
+	entries.push_back(std::move(entry));
+	entry_ids[&Skeleton] = id;
+
+	return id;
+}
+
+void AnimationScheduler::clear() {
+	entries.clear();
+	entry_ids.clear();
+}
+
+void AnimationScheduler::set_screen_size(EntryId Entry, float ScreenSize) {
+	if (Entry < entries.size()) {
+		entries[Entry].screen_size = ScreenSize;
+	}
+}
+
+size_t AnimationScheduler::update(std::chrono::steady_clock::time_point Now, JobSystem* Jobs) {
+	due_entries.clear();
+
+	for (EntryId i = 0; i < entries.size(); i++) {
+		if (is_due(entries[i], Now)) {
+			due_entries.push_back(i);
+		}
+	}
+
+	auto body = [this, Now](size_t Begin, size_t End) {
+		for (size_t i = Begin; i < End; i++) {
+			pose(entries[due_entries[i]], Now);
+		}
+	};
+
+	if (Jobs == nullptr) {
+		body(0, due_entries.size());
+	}
+	else {
+		Jobs->parallel_for(due_entries.size(), 1, body);
+	}
+
+	return due_entries.size();
+}
+
+AnimationScheduler::Error AnimationScheduler::get_pose(EntryId Entry, std::chrono::steady_clock::time_point Now, std::span<Bone> Out) {
+	if (Entry >= entries.size()) {
+		return Error::ENTRY_NOT_FOUND;
+	}
+
+	const auto& entry = entries[Entry];
+	const Skeleton& skeleton = *entry.skeleton;
+
+	if (Out.size() < skeleton.bones.size()) {
+		return Error::OUTPUT_TOO_SMALL;
+	}
+
+	if (entry.generation == NO_GENERATION) {
+		std::copy(skeleton.bones.begin(), skeleton.bones.end(), Out.begin());
+		return Error::OK;
+	}
+
+	std::chrono::duration<float> elapsed = Now - entry.previous_time;
+	std::chrono::duration<float> period = entry.next_time - entry.previous_time;
+	float t = period.count() > 0.0f ? std::clamp(elapsed.count() / period.count(), 0.0f, 1.0f) : 1.0f;
+
+	// Every bone is written whole, Out may be write combined memory
+	for (size_t b = 0; b < entry.next_pose.size(); b++) {
+		const Bone& from = entry.previous_pose[b];
+		Bone bone = entry.next_pose[b];
+
+		glm::quat to = bone.rotation;
+
+		if (glm::dot(from.rotation, to) < 0.0f) {
+			to = -to;
+		}
+
+		bone.rotation = glm::normalize(glm::lerp(from.rotation, to, t));
+		bone.position = glm::mix(from.position, bone.position, t);
+
+		Out[b] = bone;
+	}
+
+	return Error::OK;
+}
+
+uint32_t AnimationScheduler::get_generation(EntryId Entry) {
+	return Entry < entries.size() ? entries[Entry].generation : NO_GENERATION;
+}
+
+float AnimationScheduler::get_screen_size(const glm::vec4& Sphere, const glm::mat4& Model, const glm::mat4& View, const glm::mat4& Projection) {
+	glm::vec4 center = View * Model * glm::vec4(glm::vec3(Sphere), 1.0f);
+
+	float scale = std::max(glm::length(glm::vec3(Model[0])), std::max(glm::length(glm::vec3(Model[1])), glm::length(glm::vec3(Model[2]))));
+	float radius = Sphere.w * scale;
+	float distance = glm::length(glm::vec3(center));
+
+	// The camera is inside the bounds
+	if (distance <= radius) {
+		return 1.0f;
+	}
+
+	// Projected diameter over the clip space height of 2
+	return radius * std::abs(Projection[1][1]) / distance;
+}
+
+std::chrono::steady_clock::duration AnimationScheduler::get_period(float ScreenSize) {
+	float range = settings.near_screen_size - settings.far_screen_size;
+	float t = range > 0.0f ? std::clamp((ScreenSize - settings.far_screen_size) / range, 0.0f, 1.0f) : (ScreenSize >= settings.near_screen_size ? 1.0f : 0.0f);
+	float rate = std::max(settings.far_rate + (settings.near_rate - settings.far_rate) * t, 0.001f);
+
+	return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(1.0f / rate));
+}
+
+bool AnimationScheduler::is_due(const Entry& Entry, std::chrono::steady_clock::time_point Now) {
+	const Skeleton& skeleton = *Entry.skeleton;
+
+	// Already holding the rest pose with nothing playing, posing again would only change the generation
+	if (Entry.generation != NO_GENERATION && Entry.animation == nullptr && skeleton.active_animation == nullptr) {
+		return false;
+	}
+
+	return Entry.generation == NO_GENERATION
+		|| Now >= Entry.next_time
+		|| Entry.animation != skeleton.active_animation
+		|| Entry.animation_start != skeleton.animation_start_time;
+}
+
+void AnimationScheduler::pose(Entry& Entry, std::chrono::steady_clock::time_point Now) {
+	Skeleton& skeleton = *Entry.skeleton;
+	std::chrono::steady_clock::duration period = get_period(Entry.screen_size);
+
+	bool isFirst = Entry.generation == NO_GENERATION;
+	bool isRestarted = Entry.animation != skeleton.active_animation || Entry.animation_start != skeleton.animation_start_time;
+
+	if (isFirst || isRestarted || Entry.ends_loop || Now >= Entry.next_time + period) {
+		// Nothing to carry over, or so far behind that the last pose is stale
+		sample_pose(skeleton, skeleton.get_animation_time(Now), Entry.previous_pose);
+		Entry.previous_time = Now;
+
+		if (isFirst) {
+			period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * Entry.phase);
+		}
+	}
+	else {
+		// The pose sampled ahead by the last update is current now
+		std::swap(Entry.previous_pose, Entry.next_pose);
+		Entry.previous_time = Entry.next_time;
+	}
+
+	Entry.next_time = Entry.previous_time + period;
+	Entry.ends_loop = false;
+
+	std::chrono::milliseconds nextAnimationTime = skeleton.get_animation_time(Entry.next_time);
+
+	// Blending across the wrap of a looped playback would run backwards through the clip, the period ends with the loop instead
+	if (skeleton.active_animation != nullptr && skeleton.is_looped && skeleton.is_finalized()) {
+		std::chrono::milliseconds duration = skeleton.animation_durations[skeleton.active_animation - skeleton.animations.data()];
+		std::chrono::milliseconds time = skeleton.get_animation_time(Entry.previous_time);
+
+		if (duration.count() > 0 && time > duration) {
+			time %= duration;
+		}
+
+		if (duration.count() > 0 && time + period > duration) {
+			Entry.next_time = Entry.previous_time + (duration - time);
+			Entry.ends_loop = true;
+			nextAnimationTime = duration;
+		}
+	}
+
+	sample_pose(skeleton, nextAnimationTime, Entry.next_pose);
+
+	Entry.animation = skeleton.active_animation;
+	Entry.animation_start = skeleton.animation_start_time;
+
+	Entry.generation = (Entry.generation + 1) % NO_GENERATION;
+}
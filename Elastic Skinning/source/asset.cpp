@@ -1,6 +1,7 @@
 #include "asset.h"
 
 #include <stb_image.h>
+#include <stb_image_write.h>
 #include <tiny_gltf.h>
 #include <glm/glm.hpp>
 
@@ -37,6 +38,28 @@ Retval<BinaryBlob, AssetError> load_binary_asset(std::filesystem::path path) {
 	return { ret, AssetError::OK };
 }
 
+AssetError save_binary_asset(std::filesystem::path path, const BinaryBlob& data) {
+
+	if (path.has_parent_path()) {
+		std::filesystem::create_directories(path.parent_path());
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open()) {
+		return AssetError::WRITE_ERROR;
+	}
+
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+	if (!file.good()) {
+		LOG_ERROR("File write error:\n\tPath %s", path.string().c_str());
+		return AssetError::WRITE_ERROR;
+	}
+
+	return AssetError::OK;
+}
+
 Retval<std::string, AssetError> load_text_asset(std::filesystem::path path) {
 
 	std::string ret{};
@@ -105,6 +128,30 @@ Retval<Image, AssetError> load_image(const BinaryBlob& data) {
 	};
 }
 
+AssetError save_image_png(std::filesystem::path path, const Image& image) {
+
+	if (image.width == 0 || image.height == 0) {
+		return AssetError::INVALID_DATA;
+	}
+
+	size_t channels = image.data.size() / (image.width * image.height);
+
+	if (channels == 0 || channels > 4) {
+		return AssetError::INVALID_DATA;
+	}
+
+	if (path.has_parent_path()) {
+		std::filesystem::create_directories(path.parent_path());
+	}
+
+	int stride = static_cast<int>(image.width * channels);
+
+	if (!stbi_write_png(path.string().c_str(), static_cast<int>(image.width), static_cast<int>(image.height), static_cast<int>(channels), image.data.data(), stride)) {
+		return AssetError::WRITE_ERROR;
+	}
+
+	return AssetError::OK;
+}
 
 static const Sampler tinygltf_sampler_convert(const tinygltf::Sampler& s) {
 	Sampler::Filter magFilter;
@@ -486,6 +533,16 @@ Retval<Model, AssetError> load_model(std::filesystem::path path) {
 		ret.skeleton.add_animation(outAnimation, animation.name);
 	}
 
+	if (ret.skeleton.compress_animations() != Skeleton::Error::OK) {
+		LOG_ERROR("Animations of %s have channels with mismatched key counts", path.string().c_str());
+		return { {}, AssetError::INVALID_DATA };
+	}
+
+	if (ret.skeleton.finalize() != Skeleton::Error::OK) {
+		LOG_ERROR("Skeleton of %s has a cyclic bone hierarchy", path.string().c_str());
+		return { {}, AssetError::INVALID_DATA };
+	}
+
 	// Texture/Material data
 	ret.materials.resize(model.materials.size());
 
@@ -0,0 +1,261 @@
+#include "assetstreamer.h"
+
+#include <algorithm>
+
+AssetStreamer::~AssetStreamer() {
+	deinit();
+}
+
+AssetStreamer::Error AssetStreamer::init(GfxContext* Context, size_t ThreadCount) {
+	if (is_init) {
+		deinit();
+	}
+
+	if (Context == nullptr) {
+		LOG_ERROR("Invalid context");
+		return Error::INVALID_CONTEXT;
+	}
+
+	if (!Context->is_initialized()) {
+		LOG_ERROR("Uninitialized context");
+		return Error::UNINITIALIZED_CONTEXT;
+	}
+
+	context = Context;
+	transfers_ownership = context->has_dedicated_transfer_queue();
+
+	if (uploads.init(context, context->transfer_queue, context->transfer_queue_family_index) != UploadManager::Error::OK) {
+		LOG_ERROR("Failed to initialize streaming uploads");
+		return Error::FAIL_INIT_UPLOADS;
+	}
+
+	stopping = false;
+
+	size_t threadCount = std::max<size_t>(ThreadCount, 1);
+	workers.reserve(threadCount);
+
+	for (size_t i = 0; i < threadCount; i++) {
+		workers.emplace_back(&AssetStreamer::worker_main, this);
+	}
+
+	is_init = true;
+
+	return Error::OK;
+}
+
+void AssetStreamer::deinit() {
+	if (!is_init) {
+		return;
+	}
+
+	{
+		std::scoped_lock lock(job_mutex);
+		stopping = true;
+		jobs.clear();
+	}
+
+	job_condition.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	workers.clear();
+
+	uploads.deinit();
+
+	pending_buffer_barriers.clear();
+	pending_image_barriers.clear();
+	acquires.clear();
+
+	is_init = false;
+}
+
+void AssetStreamer::enqueue(std::function<void()> Job) {
+	{
+		std::scoped_lock lock(job_mutex);
+		jobs.push_back(std::move(Job));
+	}
+
+	job_condition.notify_one();
+}
+
+void AssetStreamer::upload_buffer(BufferAllocation Dest, const void* Source, size_t Size) {
+	if (!is_init || Size == 0) {
+		return;
+	}
+
+	uploads.upload_buffer(Dest, Source, Size);
+
+	vk::BufferMemoryBarrier barrier;
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eNoneKHR;
+	barrier.srcQueueFamilyIndex = context->transfer_queue_family_index;
+	barrier.dstQueueFamilyIndex = context->primary_queue_family_index;
+	barrier.buffer = Dest.buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	// A shared family needs no transfer, the batch's trailing barrier already makes the data visible
+	if (!transfers_ownership) {
+		return;
+	}
+
+	uploads.get_command_buffer().pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::PipelineStageFlagBits::eBottomOfPipe,
+		vk::DependencyFlagBits(0),
+		nullptr,
+		barrier,
+		nullptr
+	);
+
+	pending_buffer_barriers.push_back(barrier);
+}
+
+void AssetStreamer::upload_texture(TextureAllocation Dest, const void* Source, size_t Size, vk::ImageLayout FinalLayout) {
+	if (!is_init || Size == 0) {
+		return;
+	}
+
+	vk::ImageMemoryBarrier barrier;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = Dest.image;
+	barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	barrier.oldLayout = vk::ImageLayout::eUndefined;
+	barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+	barrier.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
+	barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+	uploads.get_command_buffer().pipelineBarrier(
+		vk::PipelineStageFlagBits::eTopOfPipe,
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::DependencyFlagBits(0),
+		nullptr,
+		nullptr,
+		barrier
+	);
+
+	uploads.upload_texture(Dest, Source, Size);
+
+	// The final layout transition doubles as the release half of the ownership transfer
+	barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+	barrier.newLayout = FinalLayout;
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eNoneKHR;
+
+	if (transfers_ownership) {
+		barrier.srcQueueFamilyIndex = context->transfer_queue_family_index;
+		barrier.dstQueueFamilyIndex = context->primary_queue_family_index;
+	}
+
+	uploads.get_command_buffer().pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::PipelineStageFlagBits::eBottomOfPipe,
+		vk::DependencyFlagBits(0),
+		nullptr,
+		nullptr,
+		barrier
+	);
+
+	if (transfers_ownership) {
+		pending_image_barriers.push_back(barrier);
+	}
+}
+
+AssetStreamer::Ticket AssetStreamer::submit() {
+	if (!is_init) {
+		return 0;
+	}
+
+	Ticket ticket = uploads.flush();
+
+	if (!pending_buffer_barriers.empty() || !pending_image_barriers.empty()) {
+		Acquires& a = acquires[ticket];
+		a.buffer_barriers.insert(a.buffer_barriers.end(), pending_buffer_barriers.begin(), pending_buffer_barriers.end());
+		a.image_barriers.insert(a.image_barriers.end(), pending_image_barriers.begin(), pending_image_barriers.end());
+
+		pending_buffer_barriers.clear();
+		pending_image_barriers.clear();
+	}
+
+	return ticket;
+}
+
+bool AssetStreamer::is_resident(Ticket Ticket) {
+	if (!is_init || !uploads.is_complete(Ticket)) {
+		return false;
+	}
+
+	record_acquires(Ticket);
+
+	return true;
+}
+
+void AssetStreamer::wait() {
+	if (!is_init) {
+		return;
+	}
+
+	uploads.wait();
+
+	while (!acquires.empty()) {
+		record_acquires(acquires.begin()->first);
+	}
+}
+
+void AssetStreamer::worker_main() {
+	for (;;) {
+		std::function<void()> job;
+
+		{
+			std::unique_lock lock(job_mutex);
+			job_condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+			if (stopping) {
+				return;
+			}
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		job();
+	}
+}
+
+void AssetStreamer::record_acquires(Ticket Ticket) {
+	auto it = acquires.find(Ticket);
+
+	if (it == acquires.end()) {
+		return;
+	}
+
+	// The transfer batch already executed, so the acquire only needs to order against later work
+	for (auto& b : it->second.buffer_barriers) {
+		b.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
+		b.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+	}
+
+	for (auto& b : it->second.image_barriers) {
+		b.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
+		b.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+	}
+
+	context->upload_manager->get_command_buffer().pipelineBarrier(
+		vk::PipelineStageFlagBits::eTopOfPipe,
+		vk::PipelineStageFlagBits::eAllCommands,
+		vk::DependencyFlagBits(0),
+		nullptr,
+		it->second.buffer_barriers,
+		it->second.image_barriers
+	);
+
+	acquires.erase(it);
+}
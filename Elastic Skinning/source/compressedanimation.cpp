@@ -0,0 +1,473 @@
+#include "compressedanimation.h"
+
+#include <glm/gtx/compatibility.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// Key values as floats, rotations as x, y, z, w
+using KeyValue = std::array<float, 4>;
+
+static constexpr float RANGE_STEPS = 65535.0f;
+static constexpr float SMALLEST_THREE_STEPS = 32767.0f;
+// Every component but the largest of a unit quaternion lies within +-1/sqrt(2)
+static constexpr float SMALLEST_THREE_RANGE = 0.70710678f;
+// Components stored per key
+static constexpr size_t STORED_COMPONENTS[CompressedAnimation::TRACKS_PER_CHANNEL] = { 3, 3, 3, 1 };
+
+static KeyValue get_key_value(const Keyframe& Keyframe, CompressedAnimation::TrackType Type) {
+	switch (Type) {
+	case CompressedAnimation::TrackType::Rotation:
+		return { Keyframe.rotation.x, Keyframe.rotation.y, Keyframe.rotation.z, Keyframe.rotation.w };
+	case CompressedAnimation::TrackType::Translation:
+		return { Keyframe.position.x, Keyframe.position.y, Keyframe.position.z, 0.0f };
+	case CompressedAnimation::TrackType::Scale:
+		return { Keyframe.scale.x, Keyframe.scale.y, Keyframe.scale.z, 0.0f };
+	default:
+		return { Keyframe.weight, 0.0f, 0.0f, 0.0f };
+	}
+}
+
+/*
+* Smallest three, the largest component is dropped and rebuilt from the unit length, its index
+* takes the top bit of the first two stored components
+*/
+static void encode_smallest_three(const KeyValue& Rotation, uint16_t* Out) {
+	float length = std::sqrt(Rotation[0] * Rotation[0] + Rotation[1] * Rotation[1] + Rotation[2] * Rotation[2] + Rotation[3] * Rotation[3]);
+	KeyValue q = length > 0.0f ? KeyValue{ Rotation[0] / length, Rotation[1] / length, Rotation[2] / length, Rotation[3] / length } : KeyValue{ 0.0f, 0.0f, 0.0f, 1.0f };
+
+	size_t largest = 0;
+
+	for (size_t i = 1; i < 4; i++) {
+		if (std::abs(q[i]) > std::abs(q[largest])) {
+			largest = i;
+		}
+	}
+
+	// q and -q are the same rotation, a positive largest component needs no sign
+	float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+	size_t o = 0;
+
+	for (size_t i = 0; i < 4; i++) {
+		if (i == largest) {
+			continue;
+		}
+
+		float normalized = std::clamp((q[i] * sign / SMALLEST_THREE_RANGE + 1.0f) * 0.5f, 0.0f, 1.0f);
+		Out[o++] = static_cast<uint16_t>(std::lround(normalized * SMALLEST_THREE_STEPS));
+	}
+
+	Out[0] |= static_cast<uint16_t>((largest & 1) << 15);
+	Out[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+}
+
+static KeyValue decode_smallest_three(const uint16_t* In) {
+	size_t largest = (In[0] >> 15) | ((In[1] >> 15) << 1);
+
+	float smallest[3];
+	float lengthSquared = 0.0f;
+
+	for (size_t i = 0; i < 3; i++) {
+		smallest[i] = (static_cast<float>(In[i] & 0x7FFF) / SMALLEST_THREE_STEPS * 2.0f - 1.0f) * SMALLEST_THREE_RANGE;
+		lengthSquared += smallest[i] * smallest[i];
+	}
+
+	KeyValue ret;
+	size_t o = 0;
+
+	for (size_t i = 0; i < 4; i++) {
+		ret[i] = i == largest ? std::sqrt(std::max(1.0f - lengthSquared, 0.0f)) : smallest[o++];
+	}
+
+	return ret;
+}
+
+// Same blend sampling uses, rotations along the shorter arc
+static KeyValue interpolate(CompressedAnimation::TrackType Type, const KeyValue& A, const KeyValue& B, float T) {
+	float sign = 1.0f;
+
+	if (Type == CompressedAnimation::TrackType::Rotation && A[0] * B[0] + A[1] * B[1] + A[2] * B[2] + A[3] * B[3] < 0.0f) {
+		sign = -1.0f;
+	}
+
+	KeyValue ret;
+
+	for (size_t i = 0; i < 4; i++) {
+		ret[i] = A[i] + (B[i] * sign - A[i]) * T;
+	}
+
+	return ret;
+}
+
+static float key_error(CompressedAnimation::TrackType Type, const KeyValue& Reference, const KeyValue& Value) {
+	if (Type == CompressedAnimation::TrackType::Rotation) {
+		float length = std::sqrt(Value[0] * Value[0] + Value[1] * Value[1] + Value[2] * Value[2] + Value[3] * Value[3]);
+		float dot = std::abs(Reference[0] * Value[0] + Reference[1] * Value[1] + Reference[2] * Value[2] + Reference[3] * Value[3]) / length;
+
+		return 2.0f * std::acos(std::min(dot, 1.0f));
+	}
+
+	float ret = 0.0f;
+
+	for (size_t i = 0; i < 4; i++) {
+		ret = std::max(ret, std::abs(Reference[i] - Value[i]));
+	}
+
+	return ret;
+}
+
+Retval<CompressedAnimation, CompressedAnimation::Error> CompressedAnimation::compress(const Animation& Source, const AnimationCompressionSettings& Settings) {
+	CompressedAnimation ret;
+
+	int64_t duration = 0;
+
+	for (auto& channel : Source.channels) {
+		if (channel.time_points.size() != channel.keyframes.size()) {
+			return { {}, Error::KEY_COUNT_MISMATCH };
+		}
+
+		if (!channel.time_points.empty()) {
+			duration = std::max(duration, channel.time_points.back().count());
+		}
+	}
+
+	ret.time_step = static_cast<uint32_t>(std::max<int64_t>((duration + 65534) / 65535, 1));
+	ret.channel_names = Source.channel_names;
+
+	const float tolerances[TRACKS_PER_CHANNEL] = {
+		Settings.rotation_tolerance,
+		Settings.translation_tolerance,
+		Settings.scale_tolerance,
+		Settings.weight_tolerance
+	};
+
+	std::vector<uint16_t> keyTimes;
+	std::vector<KeyValue> decoded;
+	std::vector<uint16_t> encoded;
+	std::vector<size_t> kept;
+
+	for (auto& channel : Source.channels) {
+		size_t keyCount = channel.time_points.size();
+
+		keyTimes.resize(keyCount);
+
+		for (size_t k = 0; k < keyCount; k++) {
+			int64_t step = std::clamp<int64_t>((channel.time_points[k].count() + ret.time_step / 2) / ret.time_step, 0, 65535);
+			keyTimes[k] = static_cast<uint16_t>(step);
+		}
+
+		for (size_t t = 0; t < TRACKS_PER_CHANNEL; t++) {
+			TrackType type = static_cast<TrackType>(t);
+			size_t components = STORED_COMPONENTS[t];
+
+			Track track;
+			track.first_key = static_cast<uint32_t>(ret.times.size());
+			track.first_value = static_cast<uint32_t>(ret.values.size());
+			track.first_bound = static_cast<uint32_t>(ret.bounds.size());
+
+			if (keyCount == 0) {
+				ret.tracks.push_back(track);
+				continue;
+			}
+
+			/*
+			* Quantize every key first, removed keys are measured against what sampling decodes
+			*/
+			decoded.resize(keyCount);
+			encoded.resize(keyCount * components);
+
+			if (type == TrackType::Rotation) {
+				for (size_t k = 0; k < keyCount; k++) {
+					encode_smallest_three(get_key_value(channel.keyframes[k], type), &encoded[k * components]);
+					decoded[k] = decode_smallest_three(&encoded[k * components]);
+				}
+			}
+			else {
+				KeyValue minimum = get_key_value(channel.keyframes[0], type);
+				KeyValue maximum = minimum;
+
+				for (size_t k = 1; k < keyCount; k++) {
+					KeyValue value = get_key_value(channel.keyframes[k], type);
+
+					for (size_t c = 0; c < components; c++) {
+						minimum[c] = std::min(minimum[c], value[c]);
+						maximum[c] = std::max(maximum[c], value[c]);
+					}
+				}
+
+				for (size_t c = 0; c < components; c++) {
+					ret.bounds.push_back(minimum[c]);
+				}
+
+				for (size_t c = 0; c < components; c++) {
+					ret.bounds.push_back(maximum[c] - minimum[c]);
+				}
+
+				for (size_t k = 0; k < keyCount; k++) {
+					KeyValue value = get_key_value(channel.keyframes[k], type);
+					decoded[k] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+					for (size_t c = 0; c < components; c++) {
+						float extent = maximum[c] - minimum[c];
+						float normalized = extent > 0.0f ? std::clamp((value[c] - minimum[c]) / extent, 0.0f, 1.0f) : 0.0f;
+						uint16_t q = static_cast<uint16_t>(std::lround(normalized * RANGE_STEPS));
+
+						encoded[k * components + c] = q;
+						decoded[k][c] = minimum[c] + static_cast<float>(q) / RANGE_STEPS * extent;
+					}
+				}
+			}
+
+			/*
+			* Keep the first key, then extend every interval until a key in between strays too far
+			*/
+			kept.assign(1, 0);
+
+			bool isConstant = true;
+
+			for (size_t k = 1; k < keyCount && isConstant; k++) {
+				isConstant = key_error(type, decoded[k], decoded[0]) <= tolerances[t];
+			}
+
+			if (!isConstant) {
+				size_t a = 0;
+
+				for (size_t e = 2; e < keyCount; e++) {
+					float span = static_cast<float>(keyTimes[e] - keyTimes[a]);
+
+					for (size_t i = a + 1; i < e; i++) {
+						float weight = span > 0.0f ? static_cast<float>(keyTimes[i] - keyTimes[a]) / span : 0.0f;
+
+						if (key_error(type, decoded[i], interpolate(type, decoded[a], decoded[e], weight)) > tolerances[t]) {
+							a = e - 1;
+							kept.push_back(a);
+							break;
+						}
+					}
+				}
+
+				kept.push_back(keyCount - 1);
+			}
+
+			for (size_t k : kept) {
+				ret.times.push_back(keyTimes[k]);
+				ret.values.insert(ret.values.end(), encoded.begin() + k * components, encoded.begin() + (k + 1) * components);
+			}
+
+			track.key_count = static_cast<uint32_t>(kept.size());
+			ret.tracks.push_back(track);
+		}
+	}
+
+	return { std::move(ret), Error::OK };
+}
+
+Animation CompressedAnimation::decompress() const {
+	Animation ret;
+
+	std::vector<int64_t> keyTimes;
+
+	for (size_t c = 0; c < channel_count(); c++) {
+		Channel channel;
+		keyTimes.clear();
+
+		for (size_t t = 0; t < TRACKS_PER_CHANNEL; t++) {
+			const Track& track = tracks[c * TRACKS_PER_CHANNEL + t];
+
+			for (size_t k = 0; k < track.key_count; k++) {
+				keyTimes.push_back(static_cast<int64_t>(times[track.first_key + k]) * time_step);
+			}
+		}
+
+		std::sort(keyTimes.begin(), keyTimes.end());
+		keyTimes.erase(std::unique(keyTimes.begin(), keyTimes.end()), keyTimes.end());
+
+		size_t cursors[TRACKS_PER_CHANNEL] = {};
+
+		for (int64_t time : keyTimes) {
+			channel.time_points.push_back(std::chrono::milliseconds(time));
+			channel.keyframes.push_back(sample(c, std::chrono::milliseconds(time), cursors));
+		}
+
+		ret.add_channel(channel, channel_names[c]);
+	}
+
+	return ret;
+}
+
+bool CompressedAnimation::has_keys(size_t Channel) const {
+	for (size_t t = 0; t < TRACKS_PER_CHANNEL; t++) {
+		if (tracks[Channel * TRACKS_PER_CHANNEL + t].key_count != 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::chrono::milliseconds CompressedAnimation::get_channel_duration(size_t Channel) const {
+	int64_t ret = 0;
+
+	for (size_t t = 0; t < TRACKS_PER_CHANNEL; t++) {
+		const Track& track = tracks[Channel * TRACKS_PER_CHANNEL + t];
+
+		if (track.key_count != 0) {
+			ret = std::max(ret, static_cast<int64_t>(times[track.first_key + track.key_count - 1]) * time_step);
+		}
+	}
+
+	return std::chrono::milliseconds(ret);
+}
+
+Keyframe CompressedAnimation::sample(size_t Channel, std::chrono::milliseconds Time, std::span<size_t, TRACKS_PER_CHANNEL> Cursors) const {
+	Keyframe ret;
+
+	for (size_t t = 0; t < TRACKS_PER_CHANNEL; t++) {
+		const Track& track = tracks[Channel * TRACKS_PER_CHANNEL + t];
+
+		if (track.key_count == 0) {
+			continue;
+		}
+
+		size_t keyA = 0;
+		size_t keyB = 0;
+		float weight = 0.0f;
+
+		locate(track, Time, Cursors[t], keyA, keyB, weight);
+
+		switch (static_cast<TrackType>(t)) {
+		case TrackType::Rotation: {
+			glm::quat rotationA = decode_rotation(track, keyA);
+			glm::quat rotationB = decode_rotation(track, keyB);
+
+			// Quantization picks the sign of every key on its own
+			if (glm::dot(rotationA, rotationB) < 0.0f) {
+				rotationB = -rotationB;
+			}
+
+			ret.rotation = glm::lerp(rotationA, rotationB, weight);
+			break;
+		}
+		case TrackType::Translation:
+		case TrackType::Scale: {
+			float a[3];
+			float b[3];
+
+			decode_range(track, 3, keyA, a);
+			decode_range(track, 3, keyB, b);
+
+			glm::vec3 value = glm::lerp(glm::vec3{ a[0], a[1], a[2] }, glm::vec3{ b[0], b[1], b[2] }, weight);
+
+			if (static_cast<TrackType>(t) == TrackType::Translation) {
+				ret.position = value;
+			}
+			else {
+				ret.scale = value;
+			}
+
+			break;
+		}
+		default: {
+			float a;
+			float b;
+
+			decode_range(track, 1, keyA, &a);
+			decode_range(track, 1, keyB, &b);
+
+			ret.weight = glm::lerp(a, b, weight);
+			break;
+		}
+		}
+	}
+
+	return ret;
+}
+
+Keyframe CompressedAnimation::sample(size_t Channel, std::chrono::milliseconds Time) const {
+	size_t cursors[TRACKS_PER_CHANNEL] = {};
+	return sample(Channel, Time, cursors);
+}
+
+size_t CompressedAnimation::get_memory_size() const {
+	return sizeof(CompressedAnimation) +
+		tracks.size() * sizeof(Track) +
+		times.size() * sizeof(uint16_t) +
+		values.size() * sizeof(uint16_t) +
+		bounds.size() * sizeof(float) +
+		channel_names.size() * sizeof(StringHash);
+}
+
+size_t CompressedAnimation::get_memory_size(const Animation& Source) {
+	size_t ret = sizeof(Animation) + Source.channel_names.size() * sizeof(StringHash);
+
+	for (auto& channel : Source.channels) {
+		ret += sizeof(Channel);
+		ret += channel.time_points.size() * sizeof(std::chrono::milliseconds);
+		ret += channel.keyframes.size() * sizeof(Keyframe);
+	}
+
+	return ret;
+}
+
+void CompressedAnimation::locate(const Track& Track, std::chrono::milliseconds Time, size_t& Cursor, size_t& KeyA, size_t& KeyB, float& Weight) const {
+	const uint16_t* keyTimes = &times[Track.first_key];
+	int64_t step = time_step;
+	int64_t time = Time.count();
+	size_t last = Track.key_count - 1;
+
+	auto keyTime = [&](size_t K) {
+		return static_cast<int64_t>(keyTimes[K]) * step;
+	};
+
+	Weight = 0.0f;
+
+	if (time >= keyTime(last)) {
+		KeyA = KeyB = last;
+		return;
+	}
+
+	if (time <= keyTime(0)) {
+		Cursor = 0;
+		KeyA = KeyB = 0;
+		return;
+	}
+
+	// Interval k spans (keyTime(k - 1), keyTime(k)], same search as Channel::sample
+	auto inInterval = [&](size_t K) {
+		return K >= 1 && K <= last && keyTime(K - 1) < time && time <= keyTime(K);
+	};
+
+	size_t k = Cursor;
+
+	if (!inInterval(k)) {
+		if (inInterval(k + 1)) {
+			k++;
+		}
+		else {
+			k = std::lower_bound(keyTimes + 1, keyTimes + Track.key_count, time, [step](uint16_t Key, int64_t Time) {
+				return static_cast<int64_t>(Key) * step < Time;
+			}) - keyTimes;
+		}
+	}
+
+	Cursor = k;
+	KeyA = k - 1;
+	KeyB = k;
+	Weight = static_cast<float>(time - keyTime(k - 1)) / static_cast<float>(keyTime(k) - keyTime(k - 1));
+}
+
+glm::quat CompressedAnimation::decode_rotation(const Track& Track, size_t Key) const {
+	KeyValue q = decode_smallest_three(&values[Track.first_value + Key * 3]);
+	return glm::quat{ q[3], q[0], q[1], q[2] };
+}
+
+void CompressedAnimation::decode_range(const Track& Track, size_t Components, size_t Key, float* Out) const {
+	const uint16_t* keyValues = &values[Track.first_value + Key * Components];
+	const float* minimum = &bounds[Track.first_bound];
+	const float* extent = minimum + Components;
+
+	for (size_t c = 0; c < Components; c++) {
+		Out[c] = minimum[c] + static_cast<float>(keyValues[c]) / RANGE_STEPS * extent[c];
+	}
+}
@@ -67,7 +67,7 @@ ComputePipelineImpl::Error ComputePipelineImpl::init(GfxContext* Context) {
 	pipelineInfo.basePipelineHandle = nullptr;
 	pipelineInfo.basePipelineIndex = -1;
 
-	vk::Pipeline tpipeline = context->primary_logical_device.createComputePipeline(nullptr, pipelineInfo);
+	vk::Pipeline tpipeline = context->primary_logical_device.createComputePipeline(context->pipeline_cache, pipelineInfo);
 
 	if (!tpipeline) {
 		return Error::FAIL_CREATE_PIPELINE;
@@ -1,5 +1,7 @@
+#ifndef ELASTIC_NO_VULKAN
 #define VMA_IMPLEMENTATION
 #include "vk_mem_alloc.h"
+#endif
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_NO_STDIO
@@ -0,0 +1,282 @@
+// elastic_bake : Bakes the elastic fields of skeletal models offline, without Vulkan or SDL.
+//
+
+#include "util.h"
+#include "asset.h"
+#include "model.h"
+#include "fieldasset.h"
+#include "jobsystem.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <variant>
+#include <mutex>
+#include <sstream>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <unordered_set>
+
+struct BakeOptions {
+	std::vector<std::filesystem::path> inputs;
+	// output_dirs[Input Index]
+	std::vector<std::filesystem::path> output_dirs;
+	std::filesystem::path output_path{ "baked" };
+	size_t thread_count{ 0 };
+	bool valid{ true };
+};
+
+struct AssetTiming {
+	std::filesystem::path path;
+	double load_ms{ 0.0 };
+	double convert_ms{ 0.0 };
+	double write_ms{ 0.0 };
+
+	size_t mesh_count{ 0 };
+	size_t vertex_count{ 0 };
+	size_t bytes_written{ 0 };
+	bool failed{ false };
+};
+
+using BakeClock = std::chrono::steady_clock;
+
+static double elapsed_ms(BakeClock::time_point Start) {
+	return std::chrono::duration<double, std::milli>(BakeClock::now() - Start).count();
+}
+
+// One path per line, blank lines and lines starting with # are skipped, relative paths are relative to the manifest
+static bool read_manifest(const std::filesystem::path& Path, std::vector<std::filesystem::path>& Inputs) {
+	auto [text, error] = load_text_asset(Path);
+
+	if (error != AssetError::OK) {
+		LOG_ERROR("Failed to read manifest: %s", Path.string().c_str());
+		return false;
+	}
+
+	std::istringstream lines(text);
+	std::string line;
+
+	while (std::getline(lines, line)) {
+		size_t first = line.find_first_not_of(" \t\r");
+		size_t last = line.find_last_not_of(" \t\r");
+
+		if (first == std::string::npos || line[first] == '#') {
+			continue;
+		}
+
+		std::filesystem::path input = line.substr(first, last - first + 1);
+		Inputs.push_back(input.is_relative() ? Path.parent_path() / input : input);
+	}
+
+	return true;
+}
+
+// The deepest directory containing all of Directories, empty when they share no root
+static std::filesystem::path common_directory(const std::vector<std::filesystem::path>& Directories) {
+	std::filesystem::path ret = Directories.front();
+
+	for (const std::filesystem::path& dir : Directories) {
+		std::filesystem::path common;
+		auto a = ret.begin();
+		auto b = dir.begin();
+
+		for (; a != ret.end() && b != dir.end() && *a == *b; ++a, ++b) {
+			common /= *a;
+		}
+
+		ret = common;
+	}
+
+	return ret;
+}
+
+// Mirrors the directories of the inputs under the output path, so models with the same name in different directories don't overwrite each other
+static bool resolve_output_dirs(BakeOptions& Options) {
+	std::vector<std::filesystem::path> inputDirs;
+
+	for (const std::filesystem::path& input : Options.inputs) {
+		inputDirs.push_back(std::filesystem::absolute(input).lexically_normal().parent_path());
+	}
+
+	std::filesystem::path root = common_directory(inputDirs);
+
+	std::unordered_set<std::string> outputs;
+	bool ret = true;
+
+	for (size_t i = 0; i < Options.inputs.size(); i++) {
+		std::filesystem::path mirrored = root.empty() ? inputDirs[i].relative_path() : inputDirs[i].lexically_relative(root);
+		Options.output_dirs.push_back((Options.output_path / mirrored).lexically_normal());
+
+		// Still possible for the same model listed twice, or model.glb next to model.gltf
+		std::filesystem::path output = get_field_asset_path(Options.output_dirs[i], Options.inputs[i], 0);
+
+		if (!outputs.insert(output.string()).second) {
+			LOG_ERROR("%s would overwrite the fields of another input at %s", Options.inputs[i].string().c_str(), output.string().c_str());
+			ret = false;
+		}
+	}
+
+	return ret;
+}
+
+/*
+* Usage: elastic_bake [--manifest path] [--out directory] [--threads N] [model.glb ...]
+*
+* Every skeletal mesh of a model is saved as <out>/<model directory>/<model name>.<mesh index>.field,
+* the model directory being relative to the deepest directory all inputs share
+*/
+static BakeOptions parse_bake_options(int argc, char** argv) {
+	BakeOptions ret;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = (i + 1) < argc;
+
+		if (arg == "--manifest" && hasValue) {
+			ret.valid = read_manifest(argv[++i], ret.inputs) && ret.valid;
+		}
+		else if (arg == "--out" && hasValue) {
+			ret.output_path = argv[++i];
+		}
+		else if (arg == "--threads" && hasValue) {
+			const char* value = argv[++i];
+			const char* end = value + std::strlen(value);
+			auto [ptr, ec] = std::from_chars(value, end, ret.thread_count);
+
+			if (ec != std::errc{} || ptr != end) {
+				LOG_ERROR("Invalid thread count: %s", value);
+				ret.valid = false;
+			}
+		}
+		else if (arg.starts_with("--")) {
+			LOG_ERROR("Unknown argument: %s", arg.c_str());
+			ret.valid = false;
+		}
+		else {
+			ret.inputs.push_back(arg);
+		}
+	}
+
+	if (ret.valid && !ret.inputs.empty()) {
+		ret.valid = resolve_output_dirs(ret);
+	}
+
+	return ret;
+}
+
+static void bake_asset(AssetTiming& Timing, const std::filesystem::path& OutputPath, JobSystem& Jobs) {
+	auto start = BakeClock::now();
+	auto [model, error] = load_model(Timing.path);
+	Timing.load_ms = elapsed_ms(start);
+
+	if (error != AssetError::OK) {
+		LOG_ERROR("Failed to load model: %s", Timing.path.string().c_str());
+		Timing.failed = true;
+		return;
+	}
+
+	// Meshes of a model share its skeleton and bake one after the other, each one's fields in parallel
+	for (size_t i = 0; i < model.meshes.size(); i++) {
+		auto* skelmeshptr = std::get_if<SkeletalMesh>(&model.meshes[i]);
+
+		if (skelmeshptr == nullptr) {
+			continue;
+		}
+
+		start = BakeClock::now();
+		FieldAsset baked = bake_field_asset(*skelmeshptr, model.skeleton, Jobs);
+		Timing.convert_ms += elapsed_ms(start);
+
+		start = BakeClock::now();
+		BinaryBlob data = serialize_field_asset(baked);
+		std::filesystem::path path = get_field_asset_path(OutputPath, Timing.path, i);
+
+		if (save_binary_asset(path, data) != AssetError::OK) {
+			LOG_ERROR("Failed to write field asset: %s", path.string().c_str());
+			Timing.failed = true;
+		}
+		else {
+			Timing.bytes_written += data.size();
+		}
+
+		Timing.write_ms += elapsed_ms(start);
+
+		Timing.mesh_count++;
+		Timing.vertex_count += baked.mesh.vertices.size();
+	}
+}
+
+int main(int argc, char** argv) {
+	BakeOptions options = parse_bake_options(argc, argv);
+
+	if (!options.valid || options.inputs.empty()) {
+		LOG_ERROR("Usage: %s [--manifest path] [--out directory] [--threads N] [model.glb ...]", "elastic_bake");
+		return 1;
+	}
+
+	JobSystem jobs;
+	jobs.init(options.thread_count);
+
+	size_t threadCount = jobs.worker_count();
+
+	std::vector<AssetTiming> timings(options.inputs.size());
+	std::mutex logMutex;
+
+	auto start = BakeClock::now();
+
+	// Models bake concurrently, the fields of their meshes spread over whatever workers are left
+	JobSystem::TaskGroup group;
+
+	for (size_t i = 0; i < options.inputs.size(); i++) {
+		timings[i].path = options.inputs[i];
+
+		jobs.run(group, [&, i]() {
+			bake_asset(timings[i], options.output_dirs[i], jobs);
+
+			std::scoped_lock lock(logMutex);
+			LOG("%s %s\n", timings[i].failed ? "Failed" : "Baked", timings[i].path.string().c_str());
+		});
+	}
+
+	jobs.wait(group);
+
+	double wallMs = elapsed_ms(start);
+
+	jobs.deinit();
+
+	/*
+	* Summary
+	*/
+	AssetTiming total;
+	size_t failedCount = 0;
+
+	printf("\n%-40s %10s %10s %10s %7s %10s %12s\n", "asset", "load ms", "convert ms", "write ms", "meshes", "vertices", "bytes");
+
+	for (const AssetTiming& t : timings) {
+		printf("%-40s %10.1f %10.1f %10.1f %7zu %10zu %12zu%s\n",
+			t.path.filename().string().c_str(),
+			t.load_ms,
+			t.convert_ms,
+			t.write_ms,
+			t.mesh_count,
+			t.vertex_count,
+			t.bytes_written,
+			t.failed ? " FAILED" : ""
+		);
+
+		total.load_ms += t.load_ms;
+		total.convert_ms += t.convert_ms;
+		total.write_ms += t.write_ms;
+		total.mesh_count += t.mesh_count;
+		total.vertex_count += t.vertex_count;
+		total.bytes_written += t.bytes_written;
+		failedCount += t.failed ? 1 : 0;
+	}
+
+	// Stage times add up over assets baked at the same time, so together they exceed the wall time
+	printf("%-40s %10.1f %10.1f %10.1f %7zu %10zu %12zu\n", "total", total.load_ms, total.convert_ms, total.write_ms, total.mesh_count, total.vertex_count, total.bytes_written);
+	printf("\n%zu assets, %zu failed, %.1f ms on %zu threads\n", timings.size(), failedCount, wallMs, threadCount);
+
+	return failedCount == 0 ? 0 : 1;
+}
@@ -2,9 +2,9 @@
 
 #include <algorithm>
 
-ElasticFieldComposer::ElasticFieldComposer(GfxContext* Context, Swapchain* Swapchain) {
+ElasticFieldComposer::ElasticFieldComposer(GfxContext* Context, size_t FrameCount) {
 	context = Context;
-	swapchain = Swapchain;
+	frame_count = FrameCount;
 
 	vk::PhysicalDeviceProperties deviceProperties = context->get_physical_device_properties();
 
@@ -45,9 +45,14 @@ ElasticFieldComposer::ElasticFieldComposer(GfxContext* Context, Swapchain* Swapc
 }
 
 ElasticFieldComposer::~ElasticFieldComposer() {
-	context->primary_logical_device.destroyDescriptorPool(descriptor_pool);
+	reset_render_data();
 
 	context->primary_logical_device.destroy(texture_sampler);
+}
+
+void ElasticFieldComposer::reset_render_data() {
+	context->primary_logical_device.destroyDescriptorPool(descriptor_pool);
+	descriptor_pool = nullptr;
 
 	for (auto& f : frames) {
 		for (auto& i : f.tx_intermediates) {
@@ -62,6 +67,8 @@ ElasticFieldComposer::~ElasticFieldComposer() {
 			context->destroy_texture(i.isogradfield.texture);
 		}
 	}
+
+	frames.clear();
 }
 
 void ElasticFieldComposer::init_render_data(size_t MaxBones, size_t TotalBones, size_t MaxJoints, size_t TotalJoints, vk::Extent3D MaxFieldDims) {
@@ -73,7 +80,10 @@ void ElasticFieldComposer::init_render_data(size_t MaxBones, size_t TotalBones,
 	// 1 in field + 1 out field
 	numIntermediateFields += 2 * TotalBones;
 
-	numIntermediateFields *= swapchain->size();
+	numIntermediateFields *= frame_count;
+
+	// Pools can't be empty, scenes without skeletal meshes still create one
+	numIntermediateFields = std::max<uint32_t>(numIntermediateFields, 1);
 
 	std::vector<vk::DescriptorPoolSize> poolSizes = {
 		{ vk::DescriptorType::eStorageImage, numIntermediateFields }
@@ -93,7 +103,7 @@ void ElasticFieldComposer::init_render_data(size_t MaxBones, size_t TotalBones,
 		return;
 	}
 
-	frames.resize(swapchain->size());
+	frames.resize(frame_count);
 
 	for (auto& f : frames) {
 		f.tx_intermediates.resize(MaxBones);
@@ -101,6 +111,7 @@ void ElasticFieldComposer::init_render_data(size_t MaxBones, size_t TotalBones,
 		for (auto& i : f.tx_intermediates) {
 			i.isogradfield.texture = context->create_texture_3d(
 				MaxFieldDims,
+				MemoryCategory::ComposerIntermediates,
 				vk::Format::eR32G32B32A32Sfloat
 			);
 
@@ -151,6 +162,7 @@ void ElasticFieldComposer::init_render_data(size_t MaxBones, size_t TotalBones,
 		for (auto& i : f.blend_intermediates) {
 			i.isogradfield.texture = context->create_texture_3d(
 				MaxFieldDims,
+				MemoryCategory::ComposerIntermediates,
 				vk::Format::eR32G32B32A32Sfloat
 			);
 
@@ -198,8 +210,8 @@ void ElasticFieldComposer::init_render_data(size_t MaxBones, size_t TotalBones,
 	}
 }
 
-void ElasticFieldComposer::record_descriptor_sets(MeshId MeshId, float FieldScale, std::vector<GPUTexture>& PartIsogradfields, std::vector<GPUTexture>& OutIsogradfields, std::vector<BufferAllocation>& BoneBuffers, Skeleton* Skeleton) {
-	for (size_t frame = 0; frame < swapchain->size(); frame++) {
+void ElasticFieldComposer::record_descriptor_sets(MeshId MeshId, float FieldScale, std::vector<GPUTexture>& PartIsogradfields, std::vector<GPUTexture>& OutIsogradfields, std::vector<vk::DescriptorBufferInfo>& BoneBuffers, Skeleton* Skeleton) {
+	for (size_t frame = 0; frame < frame_count; frame++) {
 		
 		// Transforms
 		{
@@ -237,13 +249,7 @@ void ElasticFieldComposer::record_descriptor_sets(MeshId MeshId, float FieldScal
 					boneBufWrite.descriptorType = BoneBuffer::layout_binding().descriptorType;
 					boneBufWrite.descriptorCount = BoneBuffer::layout_binding().descriptorCount;
 
-					vk::DescriptorBufferInfo boneBufferInfo;
-
-					boneBufferInfo.buffer = BoneBuffers[frame].buffer;
-					boneBufferInfo.offset = 0;
-					boneBufferInfo.range = VK_WHOLE_SIZE;
-
-					bufferInfos.push_back(boneBufferInfo);
+					bufferInfos.push_back(BoneBuffers[frame]);
 
 					boneBufWrite.pBufferInfo = &bufferInfos.back();
 					boneBufWrite.pImageInfo = nullptr;
@@ -474,15 +480,24 @@ void ElasticFieldComposer::record_descriptor_sets(MeshId MeshId, float FieldScal
 	}
 }
 
-void ElasticFieldComposer::record_command_buffer(Swapchain::FrameId FrameId, vk::CommandBuffer CommandBuffer, MeshId MeshId) {
+void ElasticFieldComposer::record_command_buffer(Swapchain::FrameId FrameId, vk::CommandBuffer CommandBuffer, MeshId MeshId, GpuProfiler* Profiler, vk::Buffer DispatchArgs, vk::DeviceSize DispatchArgsOffset) {
 	FrameData& currentFrame = frames[FrameId];
 
-	std::vector<ElasticSkinning::FieldTxContext>& currentTxContexts = currentFrame.kernel_contexts[MeshId];
-	std::vector<vk::DescriptorSet>& currentTxDescriptors = currentFrame.tx_descriptor_sets[MeshId];
+	bool profile = (Profiler != nullptr) && Profiler->is_initialized();
+	uint32_t profiledMesh = (profile && Profiler->is_per_mesh()) ? MeshId : GpuProfiler::ALL_MESHES;
+	GpuProfiler::ScopeId scope = GpuProfiler::INVALID_SCOPE;
+
+	// May be called from several recording threads at once, look up without inserting
+	std::vector<ElasticSkinning::FieldTxContext>& currentTxContexts = currentFrame.kernel_contexts.at(MeshId);
+	std::vector<vk::DescriptorSet>& currentTxDescriptors = currentFrame.tx_descriptor_sets.at(MeshId);
 
-	std::vector<vk::DescriptorSet>& currentBlendDescriptors = currentFrame.blend_descriptor_sets[MeshId];
+	std::vector<vk::DescriptorSet>& currentBlendDescriptors = currentFrame.blend_descriptor_sets.at(MeshId);
 
 	// Transform
+	if (profile) {
+		scope = Profiler->begin_scope(FrameId, CommandBuffer, GpuProfiler::Stage::FieldTransform, profiledMesh);
+	}
+
 	for (auto& field : currentFrame.tx_intermediates) {
 		vk::ClearColorValue clearColor;
 		clearColor.setFloat32({ 0.0f, 0.0f, 0.0f, 0.0f });
@@ -526,7 +541,7 @@ void ElasticFieldComposer::record_command_buffer(Swapchain::FrameId FrameId, vk:
 			field_tx_pipeline.pipeline_layout,
 			field_tx_pipeline.context_push_constant.stageFlags,
 			field_tx_pipeline.context_push_constant.offset,
-			currentFrame.kernel_contexts[MeshId][i]
+			currentTxContexts[i]
 		);
 
 		std::vector<vk::DescriptorSet> descriptorSets = {
@@ -541,10 +556,23 @@ void ElasticFieldComposer::record_command_buffer(Swapchain::FrameId FrameId, vk:
 			nullptr
 		);
 
-		CommandBuffer.dispatch(field_dims.width / 8, field_dims.height / 8, field_dims.depth / 8);
+		if (DispatchArgs) {
+			CommandBuffer.dispatchIndirect(DispatchArgs, DispatchArgsOffset);
+		}
+		else {
+			CommandBuffer.dispatch(field_dims.width / 8, field_dims.height / 8, field_dims.depth / 8);
+		}
+	}
+
+	if (profile) {
+		Profiler->end_scope(FrameId, CommandBuffer, scope);
 	}
 
 	// Blend
+	if (profile) {
+		scope = Profiler->begin_scope(FrameId, CommandBuffer, GpuProfiler::Stage::FieldBlend, profiledMesh);
+	}
+
 	for (auto& field : currentFrame.blend_intermediates) {
 		vk::ClearColorValue clearColor;
 		clearColor.setFloat32({ 0.0f, 0.0f, 0.0f, 0.0f });
@@ -596,6 +624,15 @@ void ElasticFieldComposer::record_command_buffer(Swapchain::FrameId FrameId, vk:
 			nullptr
 		);
 
-		CommandBuffer.dispatch(field_dims.width / 8, field_dims.height / 8, field_dims.depth / 8);
+		if (DispatchArgs) {
+			CommandBuffer.dispatchIndirect(DispatchArgs, DispatchArgsOffset);
+		}
+		else {
+			CommandBuffer.dispatch(field_dims.width / 8, field_dims.height / 8, field_dims.depth / 8);
+		}
+	}
+
+	if (profile) {
+		Profiler->end_scope(FrameId, CommandBuffer, scope);
 	}
 }
@@ -131,7 +131,7 @@ std::vector<float> coefficients_f(const glm::vec3& x, const std::vector<Skeletal
 			beta_z = dz_phi(x, p.position);
 
 			if (std::isnan(alpha) || std::isnan(beta_x) || std::isnan(beta_y) || std::isnan(beta_z)) {
-				LOG("NaN coefficient produced\n");
+				LOG("%s", "NaN coefficient produced\n");
 			}
 		}
 
@@ -170,7 +170,7 @@ std::vector<glm::vec3> coefficients_grad_f(const glm::vec3& x, const std::vector
 				|| glm::isnan(hessian[2].z);
 
 			if (isnan) {
-				LOG("NaN coefficient produced\n");
+				LOG("%s", "NaN coefficient produced\n");
 			}
 		}
 
@@ -713,7 +713,7 @@ namespace ElasticSkinning {
 		return out;
 	}
 
-	std::unordered_map<StringHash, HRBFData> create_hrbf_data(const std::unordered_map<StringHash, MeshPart>& mesh_partitions) {
+	std::unordered_map<StringHash, HRBFData> create_hrbf_data(const std::unordered_map<StringHash, MeshPart>& mesh_partitions, JobSystem& Jobs) {
 		std::unordered_map<StringHash, HRBFData> out;
 
 		float maxAxis = 0.0f;
@@ -734,69 +734,81 @@ namespace ElasticSkinning {
 			}
 		}
 
+		// Every entry exists before the jobs start, so the map is never modified concurrently
+		std::vector<std::pair<const MeshPart*, HRBFData*>> parts;
+		parts.reserve(mesh_partitions.size());
+
 		for (auto& [name, meshPart] : mesh_partitions) {
-			std::vector<SkeletalVertex> samples = sample_points(meshPart, 50);
+			parts.push_back({ &meshPart, &out[name] });
+		}
 
-			std::vector<glm::vec4> constants = solve_constants(samples);
+		Jobs.parallel_for(parts.size(), 1, [&](size_t PartBegin, size_t PartEnd) {
+			for (size_t partIdx = PartBegin; partIdx < PartEnd; partIdx++) {
+				const MeshPart& meshPart = *parts[partIdx].first;
+				HRBFData& field = *parts[partIdx].second;
 
-			out[name].constants = constants;
+				std::vector<SkeletalVertex> samples = sample_points(meshPart, 50);
 
-			out[name].centers.resize(samples.size());
+				std::vector<glm::vec4> constants = solve_constants(samples);
 
-			for (size_t i = 0; i < samples.size(); i++) {
-				out[name].centers[i] = samples[i].position;
-			}
+				field.constants = constants;
 
-			float maxDist = 0.0f;
+				field.centers.resize(samples.size());
 
-			glm::vec3 boneVec = glm::normalize(meshPart.bone.tail - meshPart.bone.head);
+				for (size_t i = 0; i < samples.size(); i++) {
+					field.centers[i] = samples[i].position;
+				}
 
-			for (auto& p : samples) {
-				glm::vec3 pAtO = p.position - meshPart.bone.head;
+				float maxDist = 0.0f;
 
-				glm::vec3 proj = glm::dot(pAtO, boneVec) * boneVec;
+				glm::vec3 boneVec = glm::normalize(meshPart.bone.tail - meshPart.bone.head);
 
-				if (glm::distance(pAtO, proj) > maxDist) {
-					maxDist = glm::distance(pAtO, proj);
-				}
-			}
+				for (auto& p : samples) {
+					glm::vec3 pAtO = p.position - meshPart.bone.head;
 
-			out[name].Scale = maxAxis * 1.5f;
-
-			for (size_t z = 0; z < out[name].Depth; z++) {
-				for (size_t y = 0; y < out[name].Height; y++) {
-					for (size_t x = 0; x < out[name].Width; x++) {
-						float halfW = static_cast<float>(out[name].Width - 1) / 2.0f;
-						float halfH = static_cast<float>(out[name].Height - 1) / 2.0f;
-						float halfD = static_cast<float>(out[name].Depth - 1) / 2.0f;
-
-						glm::vec3 point{
-							static_cast<float>(x) - halfW,
-							static_cast<float>(y) - halfH,
-							static_cast<float>(z) - halfD
-						};
-
-						point *= glm::vec3{
-							out[name].Scale / halfW,
-							out[name].Scale / halfH,
-							out[name].Scale / halfD
-						};
-						
-						float f_x = hrbf(point, out[name].centers, constants);
-						glm::vec3 grad_f_x = hrbf_gradient(point, out[name].centers, constants);
-						float tr_f_x = hrbf_compact_map(f_x, maxDist);
-						float dtr_f_x = hrbf_gradient_compact_map(f_x, maxDist);
-
-						if (tr_f_x > 0.0f) {
-							LOG("");
-						}
+					glm::vec3 proj = glm::dot(pAtO, boneVec) * boneVec;
 
-						out[name].isofield.valref(x, y, z) = tr_f_x;
-						out[name].gradients.valref(x, y, z) = dtr_f_x * grad_f_x;
+					if (glm::distance(pAtO, proj) > maxDist) {
+						maxDist = glm::distance(pAtO, proj);
 					}
 				}
+
+				field.Scale = maxAxis * 1.5f;
+
+				// Field evaluation dominates, a waiting part helps with the slices of the others
+				Jobs.parallel_for(field.Depth, 1, [&](size_t ZBegin, size_t ZEnd) {
+					for (size_t z = ZBegin; z < ZEnd; z++) {
+						for (size_t y = 0; y < field.Height; y++) {
+							for (size_t x = 0; x < field.Width; x++) {
+								float halfW = static_cast<float>(field.Width - 1) / 2.0f;
+								float halfH = static_cast<float>(field.Height - 1) / 2.0f;
+								float halfD = static_cast<float>(field.Depth - 1) / 2.0f;
+
+								glm::vec3 point{
+									static_cast<float>(x) - halfW,
+									static_cast<float>(y) - halfH,
+									static_cast<float>(z) - halfD
+								};
+
+								point *= glm::vec3{
+									field.Scale / halfW,
+									field.Scale / halfH,
+									field.Scale / halfD
+								};
+
+								float f_x = hrbf(point, field.centers, constants);
+								glm::vec3 grad_f_x = hrbf_gradient(point, field.centers, constants);
+								float tr_f_x = hrbf_compact_map(f_x, maxDist);
+								float dtr_f_x = hrbf_gradient_compact_map(f_x, maxDist);
+
+								field.isofield.valref(x, y, z) = tr_f_x;
+								field.gradients.valref(x, y, z) = dtr_f_x * grad_f_x;
+							}
+						}
+					}
+				});
 			}
-		}
+		});
 
 		return out;
 	}
@@ -848,9 +860,9 @@ namespace ElasticSkinning {
 		return out;
 	}
 
-	MeshAndField convert_skeletal_mesh(const SkeletalMesh& mesh, Skeleton& skeleton) {
+	MeshAndField convert_skeletal_mesh(const SkeletalMesh& mesh, Skeleton& skeleton, JobSystem& Jobs) {
 		auto partitions = partition_skeletal_mesh(mesh, skeleton);
-		auto partFields = create_hrbf_data(partitions);
+		auto partFields = create_hrbf_data(partitions, Jobs);
 		auto outField = compose_hrbfs(partFields, partitions);
 
 		ElasticMesh outMesh;
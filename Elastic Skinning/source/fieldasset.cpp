@@ -0,0 +1,346 @@
+#include "fieldasset.h"
+#include "elasticskinning.h"
+#include "crc.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+static constexpr uint32_t FIELD_ASSET_MAGIC = 0x41464C45; // "ELFA"
+static constexpr uint32_t FIELD_ASSET_VERSION = 2;
+
+template <typename T>
+static void write_value(BinaryBlob& Out, const T& Value) {
+	static_assert(std::is_trivially_copyable_v<T>);
+
+	size_t offset = Out.size();
+	Out.resize(offset + sizeof(T));
+	std::memcpy(Out.data() + offset, &Value, sizeof(T));
+}
+
+static void write_field(BinaryBlob& Out, const std::vector<glm::vec4>& Field) {
+	write_value(Out, static_cast<uint64_t>(Field.size()));
+
+	for (const glm::vec4& voxel : Field) {
+		write_value(Out, voxel.x);
+		write_value(Out, voxel.y);
+		write_value(Out, voxel.z);
+		write_value(Out, voxel.w);
+	}
+}
+
+// Every read is bounds checked, a truncated or corrupt asset fails instead of reading past the end
+struct FieldAssetReader {
+	const BinaryBlob& data;
+	size_t offset{ 0 };
+	bool failed{ false };
+
+	template <typename T>
+	T read() {
+		T ret{};
+
+		if (failed || offset + sizeof(T) > data.size()) {
+			failed = true;
+			return ret;
+		}
+
+		std::memcpy(&ret, data.data() + offset, sizeof(T));
+		offset += sizeof(T);
+
+		return ret;
+	}
+
+	// Counts larger than what is left cannot be valid, checked before anything is allocated for them
+	uint64_t read_count(size_t ElementSize) {
+		uint64_t count = read<uint64_t>();
+
+		if (!failed && count > (data.size() - offset) / ElementSize) {
+			failed = true;
+			return 0;
+		}
+
+		return count;
+	}
+
+	void read_field(std::vector<glm::vec4>& Field) {
+		Field.resize(read_count(sizeof(float) * 4));
+
+		for (glm::vec4& voxel : Field) {
+			voxel.x = read<float>();
+			voxel.y = read<float>();
+			voxel.z = read<float>();
+			voxel.w = read<float>();
+		}
+	}
+};
+
+FieldAsset bake_field_asset(const SkeletalMesh& Mesh, Skeleton& Skeleton, JobSystem& Jobs) {
+	ElasticSkinning::MeshAndField elasticMesh = ElasticSkinning::convert_skeletal_mesh(Mesh, Skeleton, Jobs);
+
+	FieldAsset ret;
+	ret.source_hash = hash_field_asset_source(Mesh, Skeleton);
+	ret.material_name = Mesh.material_name;
+	ret.mesh = std::move(elasticMesh.mesh);
+	ret.field_scale = elasticMesh.rest_field.Scale;
+	ret.field_dims = glm::uvec3{
+		elasticMesh.rest_field.Width,
+		elasticMesh.rest_field.Height,
+		elasticMesh.rest_field.Depth
+	};
+
+	ret.rest_field = ElasticSkinning::combine_fields(elasticMesh.rest_field.isofield, elasticMesh.rest_field.gradients).values;
+
+	// Bones without a part keep an empty field
+	ret.part_fields.resize(Skeleton.bones.size());
+
+	for (auto& [boneName, field] : elasticMesh.part_fields) {
+		auto [idx, e] = Skeleton.get_bone_index(boneName);
+
+		if (e != Skeleton::Error::OK) {
+			continue;
+		}
+
+		ret.part_fields[idx] = ElasticSkinning::combine_fields(field.isofield, field.gradients).values;
+	}
+
+	return ret;
+}
+
+uint64_t hash_field_asset_source(const SkeletalMesh& Mesh, const Skeleton& Skeleton) {
+	BinaryBlob data;
+
+	auto writeVec = [&data](const auto& Vec) {
+		for (glm::length_t c = 0; c < Vec.length(); c++) {
+			write_value(data, Vec[c]);
+		}
+	};
+
+	auto writeMat = [&writeVec](const glm::mat4& Mat) {
+		for (glm::length_t c = 0; c < 4; c++) {
+			writeVec(Mat[c]);
+		}
+	};
+
+	// Member by member like the asset itself, padding would make equal sources hash differently
+	write_value(data, static_cast<uint64_t>(Mesh.vertices.size()));
+
+	for (const SkeletalVertex& v : Mesh.vertices) {
+		writeVec(v.joints);
+		writeVec(v.weights);
+		writeVec(v.position);
+		writeVec(v.normal);
+		writeVec(v.color);
+		writeVec(v.texcoords);
+	}
+
+	write_value(data, static_cast<uint64_t>(Mesh.indices.size()));
+
+	for (uint32_t index : Mesh.indices) {
+		write_value(data, index);
+	}
+
+	write_value(data, static_cast<uint64_t>(Skeleton.bones.size()));
+
+	for (size_t b = 0; b < Skeleton.bones.size(); b++) {
+		const Bone& bone = Skeleton.bones[b];
+
+		write_value(data, b < Skeleton.bone_names.size() ? Skeleton.bone_names[b] : NULL_HASH);
+		writeMat(bone.bind_matrix);
+		writeMat(bone.inverse_bind_matrix);
+		writeVec(bone.rotation);
+		writeVec(bone.position);
+		writeVec(bone.scale);
+	}
+
+	return CRC::crc64(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+}
+
+BinaryBlob serialize_field_asset(const FieldAsset& Asset) {
+	BinaryBlob ret;
+
+	write_value(ret, FIELD_ASSET_MAGIC);
+	write_value(ret, FIELD_ASSET_VERSION);
+	write_value(ret, Asset.source_hash);
+
+	write_value(ret, static_cast<uint64_t>(Asset.material_name.size()));
+	ret.insert(ret.end(), Asset.material_name.begin(), Asset.material_name.end());
+
+	/*
+	* Mesh, member by member so padding never reaches the file
+	*/
+	write_value(ret, static_cast<uint64_t>(Asset.mesh.vertices.size()));
+
+	for (const ElasticVertex& v : Asset.mesh.vertices) {
+		for (glm::length_t c = 0; c < 3; c++) {
+			write_value(ret, v.position[c]);
+		}
+
+		for (glm::length_t c = 0; c < 3; c++) {
+			write_value(ret, v.normal[c]);
+		}
+
+		for (glm::length_t c = 0; c < 3; c++) {
+			write_value(ret, v.color[c]);
+		}
+
+		write_value(ret, v.texcoords.x);
+		write_value(ret, v.texcoords.y);
+		write_value(ret, v.bone);
+		write_value(ret, v.isovalue);
+	}
+
+	write_value(ret, static_cast<uint64_t>(Asset.mesh.indices.size()));
+
+	for (uint32_t index : Asset.mesh.indices) {
+		write_value(ret, index);
+	}
+
+	/*
+	* Fields
+	*/
+	write_value(ret, Asset.field_scale);
+	write_value(ret, Asset.field_dims.x);
+	write_value(ret, Asset.field_dims.y);
+	write_value(ret, Asset.field_dims.z);
+
+	write_field(ret, Asset.rest_field);
+
+	write_value(ret, static_cast<uint64_t>(Asset.part_fields.size()));
+
+	for (const auto& field : Asset.part_fields) {
+		write_field(ret, field);
+	}
+
+	return ret;
+}
+
+Retval<FieldAsset, AssetError> deserialize_field_asset(const BinaryBlob& Data) {
+	FieldAssetReader reader{ Data };
+	FieldAsset ret;
+
+	// Older versions lack the source hash and are baked again
+	if (reader.read<uint32_t>() != FIELD_ASSET_MAGIC || reader.read<uint32_t>() != FIELD_ASSET_VERSION) {
+		return { {}, AssetError::INCORRECT_FILE_FORMAT };
+	}
+
+	ret.source_hash = reader.read<uint64_t>();
+
+	ret.material_name.resize(reader.read_count(1));
+
+	for (char& c : ret.material_name) {
+		c = reader.read<char>();
+	}
+
+	ret.mesh.material_name = ret.material_name;
+	ret.mesh.vertices.resize(reader.read_count(sizeof(float) * 13));
+
+	for (ElasticVertex& v : ret.mesh.vertices) {
+		v = {};
+
+		for (glm::length_t c = 0; c < 3; c++) {
+			v.position[c] = reader.read<float>();
+		}
+
+		for (glm::length_t c = 0; c < 3; c++) {
+			v.normal[c] = reader.read<float>();
+		}
+
+		for (glm::length_t c = 0; c < 3; c++) {
+			v.color[c] = reader.read<float>();
+		}
+
+		v.texcoords.x = reader.read<float>();
+		v.texcoords.y = reader.read<float>();
+		v.bone = reader.read<uint32_t>();
+		v.isovalue = reader.read<float>();
+	}
+
+	ret.mesh.indices.resize(reader.read_count(sizeof(uint32_t)));
+
+	for (uint32_t& index : ret.mesh.indices) {
+		index = reader.read<uint32_t>();
+	}
+
+	ret.field_scale = reader.read<float>();
+	ret.field_dims.x = reader.read<uint32_t>();
+	ret.field_dims.y = reader.read<uint32_t>();
+	ret.field_dims.z = reader.read<uint32_t>();
+
+	reader.read_field(ret.rest_field);
+
+	ret.part_fields.resize(reader.read_count(sizeof(uint64_t)));
+
+	for (auto& field : ret.part_fields) {
+		reader.read_field(field);
+	}
+
+	if (reader.failed || reader.offset != Data.size()) {
+		return { {}, AssetError::INVALID_DATA };
+	}
+
+	// Fields are uploaded as whole volumes, part fields may also be empty
+	size_t voxelCount = static_cast<size_t>(ret.field_dims.x) * ret.field_dims.y * ret.field_dims.z;
+
+	bool fieldsMatch = ret.rest_field.size() == voxelCount && std::all_of(ret.part_fields.begin(), ret.part_fields.end(), [voxelCount](const std::vector<glm::vec4>& f) {
+		return f.empty() || f.size() == voxelCount;
+	});
+
+	if (!fieldsMatch) {
+		return { {}, AssetError::INVALID_DATA };
+	}
+
+	// Indices reach the index buffer as they are
+	size_t vertexCount = ret.mesh.vertices.size();
+
+	bool indicesInRange = std::all_of(ret.mesh.indices.begin(), ret.mesh.indices.end(), [vertexCount](uint32_t Index) {
+		return Index < vertexCount;
+	});
+
+	if (!indicesInRange) {
+		return { {}, AssetError::INVALID_DATA };
+	}
+
+	return { ret, AssetError::OK };
+}
+
+AssetError save_field_asset(std::filesystem::path Path, const FieldAsset& Asset) {
+	return save_binary_asset(Path, serialize_field_asset(Asset));
+}
+
+Retval<FieldAsset, AssetError> load_field_asset(std::filesystem::path Path) {
+	auto [data, error] = load_binary_asset(Path);
+
+	if (error != AssetError::OK) {
+		return { {}, error };
+	}
+
+	return deserialize_field_asset(data);
+}
+
+std::filesystem::path get_field_asset_path(const std::filesystem::path& Directory, const std::filesystem::path& ModelPath, size_t MeshIndex) {
+	return Directory / (ModelPath.stem().string() + "." + std::to_string(MeshIndex) + ".field");
+}
+
+std::vector<std::optional<FieldAsset>> load_field_assets(const std::filesystem::path& Directory, const std::filesystem::path& ModelPath, size_t MeshCount) {
+	std::vector<std::optional<FieldAsset>> ret(MeshCount);
+
+	for (size_t i = 0; i < MeshCount; i++) {
+		std::filesystem::path path = get_field_asset_path(Directory, ModelPath, i);
+
+		if (!std::filesystem::exists(path)) {
+			continue;
+		}
+
+		auto [asset, error] = load_field_asset(path);
+
+		if (error != AssetError::OK) {
+			LOG_ERROR("Failed to load field asset %s", path.string().c_str());
+			continue;
+		}
+
+		ret[i] = std::move(asset);
+	}
+
+	return ret;
+}
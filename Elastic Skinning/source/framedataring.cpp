@@ -0,0 +1,130 @@
+#include "framedataring.h"
+
+#include <algorithm>
+
+FrameDataRing::~FrameDataRing() {
+	deinit();
+}
+
+FrameDataRing::Error FrameDataRing::init(GfxContext* Context, size_t FrameCount) {
+	if (is_init) {
+		deinit();
+	}
+
+	if (Context == nullptr) {
+		LOG_ERROR("Invalid context");
+		return Error::INVALID_CONTEXT;
+	}
+
+	if (!Context->is_initialized()) {
+		LOG_ERROR("Uninitialized context");
+		return Error::UNINITIALIZED_CONTEXT;
+	}
+
+	context = Context;
+	frames = FrameCount;
+
+	// Sub-allocations are bound as both uniform and storage buffers, and flushed per region
+	vk::PhysicalDeviceLimits limits = context->get_physical_device_properties().limits;
+
+	alignment = std::max({
+		limits.minUniformBufferOffsetAlignment,
+		limits.minStorageBufferOffsetAlignment,
+		limits.nonCoherentAtomSize,
+		vk::DeviceSize(16)
+	});
+
+	region_used = 0;
+	region_stride = 0;
+
+	is_init = true;
+
+	return Error::OK;
+}
+
+void FrameDataRing::deinit() {
+	if (!is_init) {
+		return;
+	}
+
+	reset();
+
+	is_init = false;
+}
+
+Retval<FrameDataRing::Allocation, FrameDataRing::Error> FrameDataRing::reserve(vk::DeviceSize Size) {
+	if (is_committed()) {
+		return { {}, Error::ALREADY_COMMITTED };
+	}
+
+	Allocation ret;
+	ret.offset = align_up(region_used, alignment);
+	ret.size = std::max<vk::DeviceSize>(Size, 1);
+
+	region_used = ret.offset + ret.size;
+
+	return { ret, Error::OK };
+}
+
+FrameDataRing::Error FrameDataRing::commit() {
+	if (!is_init) {
+		return Error::UNINITIALIZED_CONTEXT;
+	}
+
+	if (is_committed()) {
+		return Error::ALREADY_COMMITTED;
+	}
+
+	region_stride = align_up(std::max<vk::DeviceSize>(region_used, 1), alignment);
+
+	// Also a copy target, for recording several frames' data into one submission
+	buffer = context->create_mapped_buffer(
+		region_stride * frames,
+		vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		MemoryCategory::FrameData
+	);
+
+	if (!buffer.buffer || buffer.mapped_data == nullptr) {
+		LOG_ERROR("Failed to create persistently mapped frame data buffer");
+
+		if (buffer.buffer) {
+			context->destroy_buffer(buffer);
+		}
+
+		buffer = {};
+		return Error::FAIL_CREATE_BUFFER;
+	}
+
+	return Error::OK;
+}
+
+void FrameDataRing::reset() {
+	if (is_committed()) {
+		context->destroy_buffer(buffer);
+	}
+
+	buffer = {};
+	region_used = 0;
+	region_stride = 0;
+}
+
+void* FrameDataRing::get_mapped(Swapchain::FrameId FrameId, Allocation Allocation) {
+	return static_cast<uint8_t*>(buffer.mapped_data) + (FrameId * region_stride) + Allocation.offset;
+}
+
+vk::DescriptorBufferInfo FrameDataRing::get_descriptor_info(Swapchain::FrameId FrameId, Allocation Allocation) {
+	vk::DescriptorBufferInfo ret;
+	ret.buffer = buffer.buffer;
+	ret.offset = (FrameId * region_stride) + Allocation.offset;
+	ret.range = Allocation.size;
+
+	return ret;
+}
+
+void FrameDataRing::flush(Swapchain::FrameId FrameId) {
+	if (!is_committed()) {
+		return;
+	}
+
+	vmaFlushAllocation(context->allocator, buffer.allocation, FrameId * region_stride, region_stride);
+}
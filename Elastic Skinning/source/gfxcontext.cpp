@@ -1,4 +1,5 @@
 #include "gfxcontext.h"
+#include "uploadmanager.h"
 
 #include <algorithm>
 #include <set>
@@ -19,23 +20,17 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 	return VK_FALSE;
 }
 
-int scoreDevice(vk::PhysicalDevice device, vk::SurfaceKHR surface) {
+int scoreDevice(vk::PhysicalDevice device, vk::SurfaceKHR surface, const std::vector<const char*>& requiredDeviceExtensions) {
 	auto properties = device.getProperties();
 	auto memoryProperties = device.getMemoryProperties();
 	auto features = device.getFeatures();
 	auto extensions = device.enumerateDeviceExtensionProperties();
 
-	auto surfaceCapabilities = device.getSurfaceCapabilitiesKHR(surface);
-	auto surfaceFormats = device.getSurfaceFormatsKHR(surface);
-	auto surfacePresentModes = device.getSurfacePresentModesKHR(surface);
-
 	int result = 0;
 
 
 	// Test for required extensions
-	std::vector<std::string> requiredDeviceExtensions = { REQUIRED_DEVICE_EXTENSIONS };
-
-	for (auto extension : requiredDeviceExtensions) {
+	for (std::string extension : requiredDeviceExtensions) {
 		if (extensions.end() == std::find_if(
 				extensions.begin(),
 				extensions.end(),
@@ -52,9 +47,14 @@ int scoreDevice(vk::PhysicalDevice device, vk::SurfaceKHR surface) {
 		return 0;
 	}
 
-	// Test for adequate swapchain
-	if (surfaceFormats.empty() || surfacePresentModes.empty()) {
-		return 0;
+	// Test for adequate swapchain, headless contexts have no surface to present to
+	if (surface) {
+		auto surfaceFormats = device.getSurfaceFormatsKHR(surface);
+		auto surfacePresentModes = device.getSurfacePresentModesKHR(surface);
+
+		if (surfaceFormats.empty() || surfacePresentModes.empty()) {
+			return 0;
+		}
 	}
 
 	// Score based on heuristics
@@ -65,6 +65,10 @@ int scoreDevice(vk::PhysicalDevice device, vk::SurfaceKHR surface) {
 			|| properties.deviceType == vk::PhysicalDeviceType::eVirtualGpu) {
 		result += 1000;
 	}
+	else if (properties.deviceType == vk::PhysicalDeviceType::eCpu) {
+		// Software rasterizers (e.g. lavapipe) are only picked when nothing else is available
+		result += 1;
+	}
 
 	int approxVRAMGB = memoryProperties.memoryHeaps[0].size / 1'000'000'000;
 
@@ -85,6 +89,15 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 		return;
 	}
 
+	constructor_impl(Window, AppName, EngineName);
+}
+
+GfxContext::GfxContext(const std::string& AppName, const std::string& EngineName) {
+	constructor_impl(nullptr, AppName, EngineName);
+}
+
+void GfxContext::constructor_impl(Window* Window, const std::string& AppName, const std::string& EngineName) {
+
 	window = Window;
 
 	/*
@@ -102,18 +115,21 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 #endif
 
 
-	uint32_t nonSDLRequiredExtensionCount = vkRequiredExtensions.size();
+	// Surface extensions are only needed when presenting to a window
+	if (!is_headless()) {
+		uint32_t nonSDLRequiredExtensionCount = vkRequiredExtensions.size();
 
-	if (!SDL_Vulkan_GetInstanceExtensions(window->window, &vkRequiredExtensionCount, nullptr)) {
-		LOG_ERROR("Failed to get required Vulkan extensions for SDL");
-		return;
-	}
+		if (!SDL_Vulkan_GetInstanceExtensions(window->window, &vkRequiredExtensionCount, nullptr)) {
+			LOG_ERROR("Failed to get required Vulkan extensions for SDL");
+			return;
+		}
 
-	vkRequiredExtensions.resize(vkRequiredExtensionCount + vkRequiredExtensions.size());
+		vkRequiredExtensions.resize(vkRequiredExtensionCount + vkRequiredExtensions.size());
 
-	if (!SDL_Vulkan_GetInstanceExtensions(window->window, &vkRequiredExtensionCount, vkRequiredExtensions.data() + nonSDLRequiredExtensionCount)) {
-		LOG_ERROR("Failed to get required Vulkan extensions for SDL");
-		return;
+		if (!SDL_Vulkan_GetInstanceExtensions(window->window, &vkRequiredExtensionCount, vkRequiredExtensions.data() + nonSDLRequiredExtensionCount)) {
+			LOG_ERROR("Failed to get required Vulkan extensions for SDL");
+			return;
+		}
 	}
 
 	std::vector<vk::ExtensionProperties> supportedExtensions = vk::enumerateInstanceExtensionProperties();
@@ -249,19 +265,27 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 	* Create render surface
 	*/
 
-	VkSurfaceKHR surface;
+	if (!is_headless()) {
+		VkSurfaceKHR surface;
 
-	if (!SDL_Vulkan_CreateSurface(window->window, vulkan_instance, &surface)) {
-		LOG_ERROR("Failed to create window surface");
-		return;
-	}
+		if (!SDL_Vulkan_CreateSurface(window->window, vulkan_instance, &surface)) {
+			LOG_ERROR("Failed to create window surface");
+			return;
+		}
 
-	render_surface = surface;
+		render_surface = surface;
+	}
 
 	/*
 	* Device Selection
 	*/
 
+	std::vector<const char*> requiredDeviceExtensions;
+
+	if (!is_headless()) {
+		requiredDeviceExtensions = { REQUIRED_DEVICE_EXTENSIONS };
+	}
+
 	std::vector<vk::PhysicalDevice> physicalDevices = vulkan_instance.enumeratePhysicalDevices();
 
 	if (physicalDevices.size() == 0) {
@@ -272,18 +296,33 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 	vk::PhysicalDevice bestDevice = physicalDevices[0];
 
 	for (auto device : physicalDevices) {
-		if (scoreDevice(device, render_surface) > scoreDevice(bestDevice, render_surface)) {
+		if (scoreDevice(device, render_surface, requiredDeviceExtensions) > scoreDevice(bestDevice, render_surface, requiredDeviceExtensions)) {
 			bestDevice = device;
 		}
 	}
 
-	if (scoreDevice(bestDevice, render_surface) == 0) {
+	if (scoreDevice(bestDevice, render_surface, requiredDeviceExtensions) == 0) {
 		LOG_ERROR("Failed to find suitable device");
 		return;
 	}
 
 	primary_physical_device = bestDevice;
 
+	// Optional, only used to report how much of each heap's budget is left
+	std::vector<vk::ExtensionProperties> supportedDeviceExtensions = primary_physical_device.enumerateDeviceExtensionProperties();
+
+	memory_budget_enabled = std::any_of(
+		supportedDeviceExtensions.begin(),
+		supportedDeviceExtensions.end(),
+		[](vk::ExtensionProperties e) -> bool {
+			return std::strcmp(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, e.extensionName) == 0;
+		}
+	);
+
+	if (memory_budget_enabled) {
+		requiredDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+
 	/*
 	* Queue Selection
 	*/
@@ -303,11 +342,16 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 		}
 	}
 
-	// Attempt to find a queue for presenting
-	for (uint32_t idx = 0; idx < queueProperties.size(); idx++) {
-		if (primary_physical_device.getSurfaceSupportKHR(idx, render_surface)) {
-			presentQueueFamilyIndex = idx;
-			break;
+	// Attempt to find a queue for presenting, offscreen frames are "presented" on the primary queue
+	if (is_headless()) {
+		presentQueueFamilyIndex = primaryQueueFamilyIndex;
+	}
+	else {
+		for (uint32_t idx = 0; idx < queueProperties.size(); idx++) {
+			if (primary_physical_device.getSurfaceSupportKHR(idx, render_surface)) {
+				presentQueueFamilyIndex = idx;
+				break;
+			}
 		}
 	}
 
@@ -316,6 +360,22 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 		return;
 	}
 
+	// Prefer a transfer only family for streaming, usually backed by a DMA engine, else share the primary queue
+	std::optional<uint32_t> transferQueueFamilyIndex;
+
+	for (uint32_t idx = 0; idx < queueProperties.size(); idx++) {
+		if (queueProperties[idx].queueFlags & vk::QueueFlagBits::eTransfer
+			&& !(queueProperties[idx].queueFlags & vk::QueueFlagBits::eGraphics)
+			&& !(queueProperties[idx].queueFlags & vk::QueueFlagBits::eCompute)) {
+			transferQueueFamilyIndex = idx;
+			break;
+		}
+	}
+
+	if (!transferQueueFamilyIndex.has_value()) {
+		transferQueueFamilyIndex = primaryQueueFamilyIndex;
+	}
+
 	/*
 	* Create logical devices
 	*/
@@ -323,7 +383,7 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 	// Define queues
 	float queuePriority = 1.0f;
 	std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies = { primaryQueueFamilyIndex.value(), presentQueueFamilyIndex.value() };
+	std::set<uint32_t> uniqueQueueFamilies = { primaryQueueFamilyIndex.value(), presentQueueFamilyIndex.value(), transferQueueFamilyIndex.value() };
 
 	for (uint32_t queueFamily : uniqueQueueFamilies) {
 		vk::DeviceQueueCreateInfo queueCreateInfo;
@@ -335,12 +395,42 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 	}
 
 	// Define actual device
+	vk::PhysicalDeviceFeatures supportedFeatures = primary_physical_device.getFeatures();
+
 	vk::PhysicalDeviceFeatures deviceFeatures;
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 
-	std::vector<const char*> requiredDeviceExtensions = { REQUIRED_DEVICE_EXTENSIONS };
+	// Used by indirect drawing when available
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+	enabled_features = deviceFeatures;
+
+	// Vulkan 1.2 features can only be queried and enabled on 1.2 devices
+	bool hasVulkan12 = primary_physical_device.getProperties().apiVersion >= VK_API_VERSION_1_2;
+
+	vk::PhysicalDeviceVulkan12Features supportedVulkan12Features;
+
+	if (hasVulkan12) {
+		vk::PhysicalDeviceFeatures2 supportedFeatures2;
+		supportedFeatures2.pNext = &supportedVulkan12Features;
+
+		primary_physical_device.getFeatures2(&supportedFeatures2);
+	}
+
+	vk::PhysicalDeviceVulkan12Features vulkan12Features;
+	vulkan12Features.drawIndirectCount = supportedVulkan12Features.drawIndirectCount;
+
+	// Descriptor indexing, the renderer only uses bindless textures when all of these are available
+	vulkan12Features.descriptorIndexing = supportedVulkan12Features.descriptorIndexing;
+	vulkan12Features.runtimeDescriptorArray = supportedVulkan12Features.runtimeDescriptorArray;
+	vulkan12Features.descriptorBindingPartiallyBound = supportedVulkan12Features.descriptorBindingPartiallyBound;
+	vulkan12Features.shaderSampledImageArrayNonUniformIndexing = supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+
+	enabled_vulkan12_features = vulkan12Features;
 
 	vk::DeviceCreateInfo deviceCreateInfo;
+	deviceCreateInfo.pNext = hasVulkan12 ? &vulkan12Features : nullptr;
 	deviceCreateInfo.setQueueCreateInfos(queueCreateInfos);
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 	deviceCreateInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
@@ -361,6 +451,8 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 	primary_queue_family_index = primaryQueueFamilyIndex.value();
 	present_queue = logicalDevice.getQueue(presentQueueFamilyIndex.value(), 0);
 	present_queue_family_index = presentQueueFamilyIndex.value();
+	transfer_queue = logicalDevice.getQueue(transferQueueFamilyIndex.value(), 0);
+	transfer_queue_family_index = transferQueueFamilyIndex.value();
 
 	/*
 	* VMA allocator creation
@@ -372,6 +464,10 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 	allocatorInfo.device = primary_logical_device;
 	allocatorInfo.instance = vulkan_instance;
 
+	if (memory_budget_enabled) {
+		allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+	}
+
 	if (vmaCreateAllocator(&allocatorInfo, &allocator) != VK_SUCCESS) {
 		LOG_ERROR("Failed to create memory allocator");
 		return;
@@ -392,6 +488,23 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 		return;
 	}
 
+	/*
+	* Create pipeline cache
+	*/
+
+	create_pipeline_cache();
+
+	/*
+	* Create upload manager
+	*/
+
+	upload_manager = std::make_unique<UploadManager>();
+
+	if (upload_manager->init(this, primary_queue, primary_queue_family_index) != UploadManager::Error::OK) {
+		LOG_ERROR("Failed to create upload manager");
+		return;
+	}
+
 	/*
 	* Finish initialization
 	*/
@@ -402,6 +515,11 @@ GfxContext::GfxContext(Window* Window, const std::string& AppName, const std::st
 GfxContext::~GfxContext() {
 	if (is_initialized()) {
 
+		upload_manager.reset();
+
+		save_pipeline_cache();
+		primary_logical_device.destroy(pipeline_cache);
+
 		primary_logical_device.destroy(memory_transfer_command_pool);
 
 		if (allocator) {
@@ -426,25 +544,218 @@ GfxContext::~GfxContext() {
 	is_init = false;
 }
 
+void GfxContext::create_pipeline_cache() {
+	vk::PhysicalDeviceProperties properties = get_physical_device_properties();
+
+	BinaryBlob initialData;
+	auto [blob, error] = load_binary_asset(PIPELINE_CACHE_PATH);
+
+	if (error == AssetError::OK && blob.size() >= sizeof(PipelineCachePrefix)) {
+		PipelineCachePrefix prefix;
+		std::memcpy(&prefix, blob.data(), sizeof(prefix));
+
+		bool isValid = prefix.magic == PIPELINE_CACHE_MAGIC
+			&& prefix.vendor_id == properties.vendorID
+			&& prefix.device_id == properties.deviceID
+			&& prefix.driver_version == properties.driverVersion
+			&& std::memcmp(prefix.pipeline_cache_uuid, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0
+			&& prefix.data_size == blob.size() - sizeof(prefix);
+
+		if (isValid) {
+			initialData.assign(blob.begin() + sizeof(prefix), blob.end());
+		}
+		else {
+			LOG("Discarding pipeline cache from another device or driver\n");
+		}
+	}
+
+	vk::PipelineCacheCreateInfo cacheInfo;
+	cacheInfo.initialDataSize = initialData.size();
+	cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+	pipeline_cache = primary_logical_device.createPipelineCache(cacheInfo);
+
+	if (!pipeline_cache) {
+		LOG_ERROR("Failed to create pipeline cache, pipelines are created without one");
+	}
+}
+
+void GfxContext::save_pipeline_cache() {
+	if (!pipeline_cache) {
+		return;
+	}
+
+	std::vector<uint8_t> data = primary_logical_device.getPipelineCacheData(pipeline_cache);
+
+	if (data.empty()) {
+		return;
+	}
+
+	vk::PhysicalDeviceProperties properties = get_physical_device_properties();
+
+	PipelineCachePrefix prefix;
+	prefix.magic = PIPELINE_CACHE_MAGIC;
+	prefix.vendor_id = properties.vendorID;
+	prefix.device_id = properties.deviceID;
+	prefix.driver_version = properties.driverVersion;
+	std::memcpy(prefix.pipeline_cache_uuid, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+	prefix.data_size = data.size();
+
+	BinaryBlob blob(sizeof(prefix) + data.size());
+	std::memcpy(blob.data(), &prefix, sizeof(prefix));
+	std::memcpy(blob.data() + sizeof(prefix), data.data(), data.size());
+
+	if (save_binary_asset(PIPELINE_CACHE_PATH, blob) != AssetError::OK) {
+		LOG_ERROR("Failed to write %s", PIPELINE_CACHE_PATH);
+	}
+}
+
+const char* memory_category_name(MemoryCategory Category) {
+	switch (Category) {
+	case MemoryCategory::Meshes: return "Meshes";
+	case MemoryCategory::PartFields: return "Part fields";
+	case MemoryCategory::TransformedFields: return "Transformed fields";
+	case MemoryCategory::ComposerIntermediates: return "Composer intermediates";
+	case MemoryCategory::Textures: return "Textures";
+	case MemoryCategory::Staging: return "Staging";
+	case MemoryCategory::RenderTargets: return "Render targets";
+	case MemoryCategory::FrameData: return "Frame data";
+	case MemoryCategory::DrawData: return "Draw data";
+	case MemoryCategory::AnimationData: return "Animation data";
+	case MemoryCategory::VertexCaches: return "Vertex caches";
+	default: return "Unknown";
+	}
+}
+
+void GfxContext::track_allocation(VmaAllocation Allocation, MemoryCategory Category) {
+	vmaSetAllocationUserData(allocator, Allocation, reinterpret_cast<void*>(static_cast<uintptr_t>(Category)));
+
+	VmaAllocationInfo allocationInfo;
+	vmaGetAllocationInfo(allocator, Allocation, &allocationInfo);
+
+	std::scoped_lock lock(memory_statistics_mutex);
+
+	MemoryStatistics::Category& category = memory_categories[static_cast<size_t>(Category)];
+	category.bytes += allocationInfo.size;
+	category.peak_bytes = std::max(category.peak_bytes, category.bytes);
+	category.allocation_count++;
+
+	memory_total_bytes += allocationInfo.size;
+	memory_peak_total_bytes = std::max(memory_peak_total_bytes, memory_total_bytes);
+}
+
+void GfxContext::untrack_allocation(VmaAllocation Allocation) {
+	if (Allocation == VK_NULL_HANDLE) {
+		return;
+	}
+
+	VmaAllocationInfo allocationInfo;
+	vmaGetAllocationInfo(allocator, Allocation, &allocationInfo);
+
+	size_t categoryIndex = reinterpret_cast<uintptr_t>(allocationInfo.pUserData);
+
+	if (categoryIndex >= memory_categories.size()) {
+		return;
+	}
+
+	std::scoped_lock lock(memory_statistics_mutex);
+
+	MemoryStatistics::Category& category = memory_categories[categoryIndex];
+	category.bytes -= std::min(category.bytes, allocationInfo.size);
+	category.allocation_count -= std::min(category.allocation_count, 1u);
+
+	memory_total_bytes -= std::min(memory_total_bytes, allocationInfo.size);
+}
+
+MemoryStatistics GfxContext::get_memory_statistics() {
+	MemoryStatistics ret;
+
+	{
+		std::scoped_lock lock(memory_statistics_mutex);
+
+		ret.categories = memory_categories;
+		ret.total_bytes = memory_total_bytes;
+		ret.peak_total_bytes = memory_peak_total_bytes;
+	}
+
+	ret.has_memory_budget = memory_budget_enabled;
+
+	const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+	vmaGetMemoryProperties(allocator, &memoryProperties);
+
+	std::vector<VmaBudget> budgets(memoryProperties->memoryHeapCount);
+	vmaGetHeapBudgets(allocator, budgets.data());
+
+	ret.heaps.resize(budgets.size());
+
+	for (size_t i = 0; i < budgets.size(); i++) {
+		ret.heaps[i].usage = budgets[i].usage;
+		ret.heaps[i].budget = budgets[i].budget;
+		ret.heaps[i].device_local = (memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+
+	return ret;
+}
+
+void GfxContext::log_memory_statistics() {
+	MemoryStatistics stats = get_memory_statistics();
+
+	auto toMiB = [](vk::DeviceSize Bytes) -> double {
+		return static_cast<double>(Bytes) / (1024.0 * 1024.0);
+	};
+
+	LOG("GPU memory:\n%s", "");
+
+	for (size_t i = 0; i < stats.categories.size(); i++) {
+		const MemoryStatistics::Category& c = stats.categories[i];
+
+		LOG(
+			"\t%-24s %10.2f MiB (peak %10.2f MiB) in %u allocations\n",
+			memory_category_name(static_cast<MemoryCategory>(i)),
+			toMiB(c.bytes),
+			toMiB(c.peak_bytes),
+			c.allocation_count
+		);
+	}
+
+	LOG("\t%-24s %10.2f MiB (peak %10.2f MiB)\n", "Total", toMiB(stats.total_bytes), toMiB(stats.peak_total_bytes));
+
+	for (size_t i = 0; i < stats.heaps.size(); i++) {
+		const MemoryStatistics::Heap& h = stats.heaps[i];
+
+		LOG(
+			"\tHeap %zu%s: %.2f of %.2f MiB budget used, %.2f MiB headroom%s\n",
+			i,
+			h.device_local ? " (device local)" : "",
+			toMiB(h.usage),
+			toMiB(h.budget),
+			toMiB(h.headroom()),
+			stats.has_memory_budget ? "" : " (estimated)"
+		);
+	}
+}
+
 vk::PhysicalDeviceProperties GfxContext::get_physical_device_properties() {
 	return primary_physical_device.getProperties();
 }
 
-BufferAllocation GfxContext::create_vertex_buffer(vk::DeviceSize Size) {
+BufferAllocation GfxContext::create_vertex_buffer(vk::DeviceSize Size, MemoryCategory Category) {
 	return create_buffer(
 		Size,
-		vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
 		vk::SharingMode::eExclusive,
-		VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY
+		VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY,
+		Category
 	);
 }
 
-BufferAllocation GfxContext::create_index_buffer(vk::DeviceSize Size) {
+BufferAllocation GfxContext::create_index_buffer(vk::DeviceSize Size, MemoryCategory Category) {
 	return create_buffer(
 		Size,
-		vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
 		vk::SharingMode::eExclusive,
-		VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY
+		VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY,
+		Category
 	);
 }
 
@@ -453,38 +764,53 @@ BufferAllocation GfxContext::create_transfer_buffer(vk::DeviceSize Size) {
 		Size,
 		vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
 		vk::SharingMode::eExclusive,
-		VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_ONLY
+		VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_ONLY,
+		MemoryCategory::Staging
 	);
 }
 
-BufferAllocation GfxContext::create_uniform_buffer(vk::DeviceSize Size) {
+BufferAllocation GfxContext::create_uniform_buffer(vk::DeviceSize Size, MemoryCategory Category) {
 	return create_buffer(
 		Size,
 		vk::BufferUsageFlagBits::eUniformBuffer,
 		vk::SharingMode::eExclusive,
-		VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_TO_GPU
+		VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_TO_GPU,
+		Category
 	);
 }
 
-BufferAllocation GfxContext::create_storage_buffer(vk::DeviceSize Size) {
+BufferAllocation GfxContext::create_storage_buffer(vk::DeviceSize Size, MemoryCategory Category) {
 	return create_buffer(
 		Size,
 		vk::BufferUsageFlagBits::eStorageBuffer,
 		vk::SharingMode::eExclusive,
-		VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_TO_GPU
+		VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_TO_GPU,
+		Category
 	);
 }
 
-BufferAllocation GfxContext::create_gpu_storage_buffer(vk::DeviceSize Size) {
+BufferAllocation GfxContext::create_gpu_storage_buffer(vk::DeviceSize Size, MemoryCategory Category) {
 	return create_buffer(
 		Size,
 		vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
 		vk::SharingMode::eExclusive,
-		VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY
+		VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY,
+		Category
+	);
+}
+
+BufferAllocation GfxContext::create_mapped_buffer(vk::DeviceSize Size, vk::BufferUsageFlags Usage, MemoryCategory Category) {
+	return create_buffer(
+		Size,
+		Usage,
+		vk::SharingMode::eExclusive,
+		VmaMemoryUsage::VMA_MEMORY_USAGE_CPU_TO_GPU,
+		Category,
+		VMA_ALLOCATION_CREATE_MAPPED_BIT
 	);
 }
 
-BufferAllocation GfxContext::create_buffer(vk::DeviceSize Size, vk::BufferUsageFlags Usage, vk::SharingMode SharingMode, VmaMemoryUsage Locality) {
+BufferAllocation GfxContext::create_buffer(vk::DeviceSize Size, vk::BufferUsageFlags Usage, vk::SharingMode SharingMode, VmaMemoryUsage Locality, MemoryCategory Category, VmaAllocationCreateFlags Flags) {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.size = Size;
@@ -493,29 +819,35 @@ BufferAllocation GfxContext::create_buffer(vk::DeviceSize Size, vk::BufferUsageF
 
 	VmaAllocationCreateInfo allocateInfo{};
 	allocateInfo.usage = Locality;
+	allocateInfo.flags = Flags;
 
 	VkBuffer buffer;
 	VmaAllocation allocation;
+	VmaAllocationInfo allocationInfo{};
 
-	vmaCreateBuffer(allocator, &bufferInfo, &allocateInfo, &buffer, &allocation, nullptr);
+	if (vmaCreateBuffer(allocator, &bufferInfo, &allocateInfo, &buffer, &allocation, &allocationInfo) == VK_SUCCESS) {
+		track_allocation(allocation, Category);
+	}
 
-	return { buffer, allocation, Size };
+	return { buffer, allocation, Size, allocationInfo.pMappedData };
 }
 
 void GfxContext::destroy_buffer(BufferAllocation Buffer) {
+	untrack_allocation(Buffer.allocation);
 	vmaDestroyBuffer(allocator, Buffer.buffer, Buffer.allocation);
 }
 
-TextureAllocation GfxContext::create_texture_2d(vk::Extent2D Dimensions, vk::Format Format) {
+TextureAllocation GfxContext::create_texture_2d(vk::Extent2D Dimensions, MemoryCategory Category, vk::Format Format) {
 	return create_texture(
 		vk::ImageType::e2D,
 		Format,
 		vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
-		vk::Extent3D{ Dimensions, 1 }
+		vk::Extent3D{ Dimensions, 1 },
+		Category
 	);
 }
 
-TextureAllocation GfxContext::create_texture_3d(vk::Extent3D Dimensions, vk::Format Format) {
+TextureAllocation GfxContext::create_texture_3d(vk::Extent3D Dimensions, MemoryCategory Category, vk::Format Format) {
 	return create_texture(
 		vk::ImageType::e3D,
 		Format,
@@ -523,7 +855,8 @@ TextureAllocation GfxContext::create_texture_3d(vk::Extent3D Dimensions, vk::For
 		| vk::ImageUsageFlagBits::eStorage
 		| vk::ImageUsageFlagBits::eTransferDst
 		| vk::ImageUsageFlagBits::eTransferSrc,
-		Dimensions
+		Dimensions,
+		Category
 	);
 }
 
@@ -532,11 +865,12 @@ TextureAllocation GfxContext::create_depth_buffer(vk::Extent2D Dimensions) {
 		vk::ImageType::e2D,
 		vk::Format::eD32Sfloat,
 		vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled,
-		vk::Extent3D{ Dimensions, 1 }
+		vk::Extent3D{ Dimensions, 1 },
+		MemoryCategory::RenderTargets
 	);
 }
 
-TextureAllocation GfxContext::create_texture(vk::ImageType Type, vk::Format Format, vk::ImageUsageFlags Usage, vk::Extent3D Dimensions, uint32_t MipLevels, uint32_t ArrayLayers, vk::SampleCountFlags Samples, VmaMemoryUsage Locality) {
+TextureAllocation GfxContext::create_texture(vk::ImageType Type, vk::Format Format, vk::ImageUsageFlags Usage, vk::Extent3D Dimensions, MemoryCategory Category, uint32_t MipLevels, uint32_t ArrayLayers, vk::SampleCountFlags Samples, VmaMemoryUsage Locality) {
 	VkImageCreateInfo imageInfo{};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 	imageInfo.flags = 0;
@@ -559,7 +893,9 @@ TextureAllocation GfxContext::create_texture(vk::ImageType Type, vk::Format Form
 	VkImage image;
 	VmaAllocation allocation;
 
-	vmaCreateImage(allocator, &imageInfo, &allocateInfo, &image, &allocation, nullptr);
+	if (vmaCreateImage(allocator, &imageInfo, &allocateInfo, &image, &allocation, nullptr) == VK_SUCCESS) {
+		track_allocation(allocation, Category);
+	}
 
 	return {
 		image,
@@ -570,6 +906,7 @@ TextureAllocation GfxContext::create_texture(vk::ImageType Type, vk::Format Form
 }
 
 void GfxContext::destroy_texture(TextureAllocation Texture) {
+	untrack_allocation(Texture.allocation);
 	vmaDestroyImage(allocator, Texture.image, Texture.allocation);
 }
 
@@ -605,6 +942,26 @@ void GfxContext::transfer_buffer_memory(BufferAllocation Dest, BufferAllocation
 	one_time_command_end(transferCommandBuffer);
 }
 
+void GfxContext::transfer_buffer_memory(BufferAllocation Dest, const std::vector<BufferAllocation>& Sources, const std::vector<vk::BufferCopy>& Regions) {
+	assert(Sources.size() == Regions.size());
+
+	if (Regions.empty()) {
+		return;
+	}
+
+	vk::CommandBuffer transferCommandBuffer = one_time_command_begin();
+
+	for (size_t i = 0; i < Regions.size(); i++) {
+		if (Regions[i].size == 0) {
+			continue;
+		}
+
+		transferCommandBuffer.copyBuffer(Sources[i].buffer, Dest.buffer, Regions[i]);
+	}
+
+	one_time_command_end(transferCommandBuffer);
+}
+
 void GfxContext::transfer_buffer_to_texture(TextureAllocation Dest, BufferAllocation Source, vk::DeviceSize Size) {
 	
 	vk::CommandBuffer transferCommandBuffer = one_time_command_begin();
@@ -655,18 +1012,7 @@ void GfxContext::upload_to_gpu_buffer(BufferAllocation Dest, const BinaryBlob& S
 }
 
 void GfxContext::upload_to_gpu_buffer(BufferAllocation Dest, const void* Source, size_t Size) {
-	BufferAllocation transferBuffer = create_transfer_buffer(Size);
-
-	void* data;
-	vmaMapMemory(allocator, transferBuffer.allocation, &data);
-	std::memcpy(data, Source, Size);
-	vmaUnmapMemory(allocator, transferBuffer.allocation);
-
-	vmaFlushAllocation(allocator, transferBuffer.allocation, 0, Size);
-
-	transfer_buffer_memory(Dest, transferBuffer, Size);
-
-	destroy_buffer(transferBuffer);
+	upload_manager->upload_buffer(Dest, Source, Size);
 }
 
 void GfxContext::upload_texture(TextureAllocation Dest, const Image& Source) {
@@ -678,22 +1024,16 @@ void GfxContext::upload_texture(TextureAllocation Dest, const BinaryBlob& Source
 }
 
 void GfxContext::upload_texture(TextureAllocation Dest, const void* Source, size_t Size) {
-	transition_image_layout(Dest, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-
-	BufferAllocation transferBuffer = create_transfer_buffer(Size);
-	
-	void* data;
-	vmaMapMemory(allocator, transferBuffer.allocation, &data);
-	std::memcpy(data, Source, Size);
-	vmaUnmapMemory(allocator, transferBuffer.allocation);
-
-	vmaFlushAllocation(allocator, transferBuffer.allocation, 0, Size);
+	upload_texture(Dest, Source, Size, vk::ImageLayout::eShaderReadOnlyOptimal);
+}
 
-	transfer_buffer_to_texture(Dest, transferBuffer, transferBuffer.size);
+void GfxContext::upload_texture(TextureAllocation Dest, const void* Source, size_t Size, vk::ImageLayout FinalLayout) {
+	// The copy may start a new batch when the ring is full, so each step fetches the open command buffer
+	record_image_layout_transition(upload_manager->get_command_buffer(), Dest, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
 
-	destroy_buffer(transferBuffer);
+	upload_manager->upload_texture(Dest, Source, Size);
 
-	transition_image_layout(Dest, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+	record_image_layout_transition(upload_manager->get_command_buffer(), Dest, vk::ImageLayout::eTransferDstOptimal, FinalLayout);
 }
 
 BinaryBlob GfxContext::download_gpu_buffer(BufferAllocation Source) {
@@ -717,7 +1057,16 @@ BinaryBlob GfxContext::download_gpu_buffer(BufferAllocation Source) {
 }
 
 BinaryBlob GfxContext::download_texture(TextureAllocation Source) {
-	transition_image_layout(Source, Source.format, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferSrcOptimal);
+	return download_texture(Source, vk::ImageLayout::eUndefined);
+}
+
+BinaryBlob GfxContext::download_texture(TextureAllocation Source, vk::ImageLayout CurrentLayout) {
+	// Render targets are left in transfer source layout and can be copied from directly
+	bool needsTransition = CurrentLayout != vk::ImageLayout::eTransferSrcOptimal;
+
+	if (needsTransition) {
+		transition_image_layout(Source, Source.format, CurrentLayout, vk::ImageLayout::eTransferSrcOptimal);
+	}
 
 	size_t volume = Source.dimensions.width * Source.dimensions.height * Source.dimensions.depth;
 	size_t bytesize = 1;
@@ -729,6 +1078,12 @@ BinaryBlob GfxContext::download_texture(TextureAllocation Source) {
 	case vk::Format::eR32Sfloat:
 		bytesize = sizeof(float);
 		break;
+	case vk::Format::eR8G8B8A8Srgb:
+	case vk::Format::eR8G8B8A8Unorm:
+	case vk::Format::eB8G8R8A8Srgb:
+	case vk::Format::eB8G8R8A8Unorm:
+		bytesize = 4 * sizeof(uint8_t);
+		break;
 	default:
 		bytesize = 1;
 		break;
@@ -740,7 +1095,9 @@ BinaryBlob GfxContext::download_texture(TextureAllocation Source) {
 
 	transfer_texture_to_buffer(transferBuffer, Source);
 	
-	transition_image_layout(Source, Source.format, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+	if (needsTransition) {
+		transition_image_layout(Source, Source.format, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+	}
 
 	BinaryBlob ret;
 	ret.resize(size);
@@ -758,8 +1115,19 @@ BinaryBlob GfxContext::download_texture(TextureAllocation Source) {
 }
 
 void GfxContext::transition_image_layout(TextureAllocation Texture, vk::Format Format, vk::ImageLayout Old, vk::ImageLayout New) {
-	vk::CommandBuffer transitionCommandBuffer = one_time_command_begin();
+	record_image_layout_transition(upload_manager->get_command_buffer(), Texture, Old, New);
+}
+
+void GfxContext::flush_uploads() {
+	upload_manager->flush();
+
+	// Frames may be submitted to a present queue that isn't ordered with the primary queue
+	if (present_queue != primary_queue) {
+		upload_manager->wait();
+	}
+}
 
+void GfxContext::record_image_layout_transition(vk::CommandBuffer CommandBuffer, TextureAllocation Texture, vk::ImageLayout Old, vk::ImageLayout New) {
 	vk::ImageMemoryBarrier barrier;
 	barrier.oldLayout = Old;
 	barrier.newLayout = New;
@@ -818,8 +1186,16 @@ void GfxContext::transition_image_layout(TextureAllocation Texture, vk::Format F
 		sourceStage = vk::PipelineStageFlagBits::eTransfer;
 		destStage = vk::PipelineStageFlagBits::eFragmentShader;
 	}
+	else if (Old == vk::ImageLayout::eTransferDstOptimal && New == vk::ImageLayout::eGeneral) {
+		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead
+			| vk::AccessFlagBits::eShaderWrite;
+
+		sourceStage = vk::PipelineStageFlagBits::eTransfer;
+		destStage = vk::PipelineStageFlagBits::eComputeShader;
+	}
 
-	transitionCommandBuffer.pipelineBarrier(
+	CommandBuffer.pipelineBarrier(
 		sourceStage,
 		destStage,
 		vk::DependencyFlagBits(0),
@@ -827,8 +1203,6 @@ void GfxContext::transition_image_layout(TextureAllocation Texture, vk::Format F
 		nullptr,
 		barrier
 	);
-
-	one_time_command_end(transitionCommandBuffer);
 }
 
 vk::ShaderModule GfxContext::create_shader_module(std::filesystem::path path) {
@@ -862,6 +1236,9 @@ vk::CommandBuffer GfxContext::one_time_command_begin() {
 void GfxContext::one_time_command_end(vk::CommandBuffer command) {
 	command.end();
 
+	// Pending uploads are submitted first so the command sees them in queue order
+	upload_manager->flush();
+
 	vk::SubmitInfo submitInfo;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &command;
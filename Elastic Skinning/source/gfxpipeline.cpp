@@ -36,13 +36,25 @@ GfxPipelineImpl& GfxPipelineImpl::set_fragment_shader(std::filesystem::path path
 	return *this;
 }
 
+GfxPipelineImpl& GfxPipelineImpl::set_depth_vertex_shader(std::filesystem::path path) {
+	depth_vertex_shader_path = path;
+
+	return *this;
+}
+
 GfxPipelineImpl& GfxPipelineImpl::set_target(RenderTarget Target) {
 	target = Target;
 
 	return *this;
 }
 
-GfxPipelineImpl::Error GfxPipelineImpl::init(GfxContext* Context, vk::Extent2D* Viewport, vk::RenderPass* RenderPass, uint32_t Subpass) {
+GfxPipelineImpl& GfxPipelineImpl::set_bindless_textures(bool Bindless) {
+	bindless_textures = Bindless;
+
+	return *this;
+}
+
+GfxPipelineImpl::Error GfxPipelineImpl::init(GfxContext* Context, vk::RenderPass* RenderPass, uint32_t Subpass) {
 	if (!Context) {
 		return Error::INVALID_CONTEXT;
 	}
@@ -55,8 +67,11 @@ GfxPipelineImpl::Error GfxPipelineImpl::init(GfxContext* Context, vk::Extent2D*
 		return Error::INVALID_RENDER_PASS;
 	}
 
+	if (bindless_textures && !bindless_set_layout) {
+		return Error::NO_BINDLESS_LAYOUT;
+	}
+
 	context = Context;
-	viewport_size = Viewport;
 	render_pass = RenderPass;
 	subpass = Subpass;
 
@@ -136,8 +151,8 @@ GfxPipelineImpl::Error GfxPipelineImpl::init(GfxContext* Context, vk::Extent2D*
 
 	// Vertex input definition
 	vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.pVertexBindingDescriptions = &vertex_binding_description;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertex_binding_descriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = vertex_binding_descriptions.data();
 	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_attribute_descriptions.size());
 	vertexInputInfo.pVertexAttributeDescriptions = vertex_attribute_descriptions.data();
 
@@ -146,24 +161,12 @@ GfxPipelineImpl::Error GfxPipelineImpl::init(GfxContext* Context, vk::Extent2D*
 	inputAssemblyInfo.topology = vk::PrimitiveTopology::eTriangleList;
 	inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
 
-	// Viewport definition
-	vk::Viewport viewport;
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = viewport_size->width;
-	viewport.height = viewport_size->height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	vk::Rect2D scissor;
-	scissor.offset = vk::Offset2D{ 0, 0 };
-	scissor.extent = *viewport_size;
-
+	// Viewport definition, both are dynamic so the pipeline outlives the window size
 	vk::PipelineViewportStateCreateInfo viewportStateInfo;
 	viewportStateInfo.viewportCount = 1;
-	viewportStateInfo.pViewports = &viewport;
+	viewportStateInfo.pViewports = nullptr;
 	viewportStateInfo.scissorCount = 1;
-	viewportStateInfo.pScissors = &scissor;
+	viewportStateInfo.pScissors = nullptr;
 
 	// Rasterizer definition
 	vk::PipelineRasterizationStateCreateInfo rasterizerInfo;
@@ -234,7 +237,7 @@ GfxPipelineImpl::Error GfxPipelineImpl::init(GfxContext* Context, vk::Extent2D*
 	// Dynamic state
 	vk::DynamicState dynamicStates[] = {
 		vk::DynamicState::eViewport,
-		vk::DynamicState::eLineWidth
+		vk::DynamicState::eScissor
 	};
 
 	vk::PipelineDynamicStateCreateInfo dynamicStateInfo;
@@ -272,7 +275,7 @@ GfxPipelineImpl::Error GfxPipelineImpl::init(GfxContext* Context, vk::Extent2D*
 
 	std::vector<vk::DescriptorSetLayout> descriptorSetLayouts{
 		buffer_descriptor_set_layout,
-		texture_descriptor_set_layout
+		bindless_textures ? bindless_set_layout : texture_descriptor_set_layout
 	};
 
 	// Push constant ranges
@@ -303,14 +306,14 @@ GfxPipelineImpl::Error GfxPipelineImpl::init(GfxContext* Context, vk::Extent2D*
 	pipelineInfo.pMultisampleState = &multisampleInfo;
 	pipelineInfo.pDepthStencilState = &depthStencilState;
 	pipelineInfo.pColorBlendState = &colorBlendInfo;
-	pipelineInfo.pDynamicState = nullptr; // &dynamicStateInfo;
+	pipelineInfo.pDynamicState = &dynamicStateInfo;
 	pipelineInfo.layout = pipeline_layout;
 	pipelineInfo.renderPass = *render_pass;
 	pipelineInfo.subpass = subpass;
 	pipelineInfo.basePipelineHandle = nullptr;
 	pipelineInfo.basePipelineIndex = -1;
 
-	vk::Pipeline tpipeline = context->primary_logical_device.createGraphicsPipeline(nullptr, pipelineInfo);
+	vk::Pipeline tpipeline = context->primary_logical_device.createGraphicsPipeline(context->pipeline_cache, pipelineInfo);
 
 	if (!tpipeline) {
 		return Error::FAIL_CREATE_PIPELINE;
@@ -330,7 +333,7 @@ GfxPipelineImpl::Error GfxPipelineImpl::init(GfxContext* Context, vk::Extent2D*
 GfxPipelineImpl::Error GfxPipelineImpl::reinit() {
 	deinit();
 
-	return init(context, viewport_size, render_pass, subpass);
+	return init(context, render_pass, subpass);
 }
 
 void GfxPipelineImpl::deinit() {
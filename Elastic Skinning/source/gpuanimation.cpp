@@ -0,0 +1,124 @@
+#include "gpuanimation.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace GpuAnimation {
+
+	bool add_skeleton(SceneData& Data, Skeleton& Skeleton) {
+		if (Data.skeleton_indices.contains(&Skeleton)) {
+			return true;
+		}
+
+		if (Skeleton.bones.size() > MAX_BONES) {
+			return false;
+		}
+
+		if (!Skeleton.is_finalized() && Skeleton.finalize() != Skeleton::Error::OK) {
+			return false;
+		}
+
+		/*
+		* Rest pose and hierarchy levels
+		*/
+		uint32_t firstBone = static_cast<uint32_t>(Data.rest_bones.size());
+		uint32_t boneCount = static_cast<uint32_t>(Skeleton.bones.size());
+
+		Data.rest_bones.insert(Data.rest_bones.end(), Skeleton.bones.begin(), Skeleton.bones.end());
+		Data.hierarchy.resize(firstBone + boneCount, BoneNode{ NO_INDEX, 0 });
+
+		uint32_t depthCount = boneCount > 0 ? 1 : 0;
+
+		// Parents come first in topological order, so their depth is known
+		for (uint32_t boneIdx : Skeleton.topological_order) {
+			uint32_t parentIdx = Skeleton.parent_indices[boneIdx];
+			BoneNode& node = Data.hierarchy[firstBone + boneIdx];
+
+			if (parentIdx != Skeleton::NO_BONE) {
+				node.parent = parentIdx;
+				node.depth = Data.hierarchy[firstBone + parentIdx].depth + 1;
+				depthCount = std::max(depthCount, node.depth + 1);
+			}
+		}
+
+		Data.skeleton_indices[&Skeleton] = static_cast<uint32_t>(Data.skeletons.size());
+		Data.skeletons.push_back({ firstBone, boneCount, depthCount, 0 });
+
+		/*
+		* Clips
+		*/
+		std::vector<uint32_t>& clipOffsets = Data.clip_offsets[&Skeleton];
+
+		for (size_t a = 0; a < Skeleton.animations.size(); a++) {
+			CompressedAnimation converted;
+			const CompressedAnimation* compressed = &Skeleton.compressed_animations[a];
+
+			if (compressed->empty()) {
+				auto [c, e] = CompressedAnimation::compress(Skeleton.animations[a]);
+
+				if (e != CompressedAnimation::Error::OK) {
+					return false;
+				}
+
+				converted = std::move(c);
+				compressed = &converted;
+			}
+
+			uint32_t clipOffset = static_cast<uint32_t>(Data.clips.size());
+			clipOffsets.push_back(clipOffset);
+
+			Data.clips.push_back(compressed->get_time_step());
+			Data.clips.resize(clipOffset + 1 + boneCount, NO_INDEX);
+
+			uint32_t firstTrack = static_cast<uint32_t>(Data.tracks.size());
+			uint32_t firstTime = static_cast<uint32_t>(Data.key_data.size());
+			uint32_t firstValue = firstTime + static_cast<uint32_t>(compressed->get_times().size());
+			uint32_t firstBound = static_cast<uint32_t>(Data.bounds.size());
+
+			for (auto track : compressed->get_tracks()) {
+				track.first_key += firstTime;
+				track.first_value += firstValue;
+				track.first_bound += firstBound;
+
+				Data.tracks.push_back(track);
+			}
+
+			Data.key_data.insert(Data.key_data.end(), compressed->get_times().begin(), compressed->get_times().end());
+			Data.key_data.insert(Data.key_data.end(), compressed->get_values().begin(), compressed->get_values().end());
+			Data.bounds.insert(Data.bounds.end(), compressed->get_bounds().begin(), compressed->get_bounds().end());
+
+			const std::vector<uint32_t>& channelBones = Skeleton.animation_channel_bones[a];
+
+			for (size_t c = 0; c < channelBones.size(); c++) {
+				if (channelBones[c] != Skeleton::NO_BONE) {
+					Data.clips[clipOffset + 1 + channelBones[c]] = firstTrack + static_cast<uint32_t>(c * CompressedAnimation::TRACKS_PER_CHANNEL);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	Instance make_instance(const SceneData& Data, Skeleton& Skeleton, std::chrono::steady_clock::time_point Now, uint32_t FirstOutBone) {
+		Instance ret{ Data.skeleton_indices.at(&Skeleton), NO_INDEX, 0, FirstOutBone };
+
+		if (Skeleton.active_animation == nullptr) {
+			return ret;
+		}
+
+		size_t animationIdx = Skeleton.active_animation - Skeleton.animations.data();
+		std::chrono::milliseconds duration = Skeleton.animation_durations[animationIdx];
+		std::chrono::milliseconds time = Skeleton.get_animation_time(Now);
+
+		// Same wrapping as Skeleton::sample_animation_frame
+		if (Skeleton.is_looped && duration.count() > 0 && time > duration) {
+			time %= duration;
+		}
+
+		ret.clip = Data.clip_offsets.at(&Skeleton)[animationIdx];
+		ret.time = static_cast<int32_t>(std::clamp<int64_t>(time.count(), 0, std::numeric_limits<int32_t>::max()));
+
+		return ret;
+	}
+
+}
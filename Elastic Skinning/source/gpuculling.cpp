@@ -0,0 +1,61 @@
+#include "gpuculling.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace GpuCulling {
+
+	glm::vec4 compute_bounding_sphere(const std::vector<Vertex>& Vertices) {
+		if (Vertices.empty()) {
+			return glm::vec4(0.0f);
+		}
+
+		glm::vec3 min{ std::numeric_limits<float>::max() };
+		glm::vec3 max{ std::numeric_limits<float>::lowest() };
+
+		for (auto& v : Vertices) {
+			min = glm::min(min, v.position);
+			max = glm::max(max, v.position);
+		}
+
+		glm::vec3 center = (min + max) * 0.5f;
+		float radius = 0.0f;
+
+		for (auto& v : Vertices) {
+			radius = std::max(radius, glm::length(v.position - center));
+		}
+
+		return glm::vec4(center, radius);
+	}
+
+	glm::vec4 compute_field_bounding_sphere(float FieldScale) {
+		return glm::vec4(0.0f, 0.0f, 0.0f, FieldScale * std::sqrt(3.0f));
+	}
+
+	FrustumPlanes extract_frustum_planes(const glm::mat4& ViewProjection) {
+		auto row = [&ViewProjection](int i) {
+			return glm::vec4(ViewProjection[0][i], ViewProjection[1][i], ViewProjection[2][i], ViewProjection[3][i]);
+		};
+
+		FrustumPlanes ret;
+
+		ret.planes[0] = row(3) + row(0); // Left
+		ret.planes[1] = row(3) - row(0); // Right
+		ret.planes[2] = row(3) + row(1); // Bottom
+		ret.planes[3] = row(3) - row(1); // Top
+		ret.planes[4] = row(2);          // Near
+		ret.planes[5] = row(3) - row(2); // Far
+
+		for (auto& p : ret.planes) {
+			float length = glm::length(glm::vec3(p));
+
+			if (length > 0.0f) {
+				p /= length;
+			}
+		}
+
+		return ret;
+	}
+
+}
@@ -0,0 +1,410 @@
+#include "gpuprofiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+GpuProfiler::~GpuProfiler() {
+	deinit();
+}
+
+GpuProfiler::Error GpuProfiler::init(GfxContext* Context, size_t FrameCount, uint32_t MaxScopesPerFrame, size_t HistoryLength) {
+	if (is_init) {
+		deinit();
+	}
+
+	if (Context == nullptr) {
+		LOG_ERROR("Invalid context");
+		return Error::INVALID_CONTEXT;
+	}
+
+	if (!Context->is_initialized()) {
+		LOG_ERROR("Uninitialized context");
+		return Error::UNINITIALIZED_CONTEXT;
+	}
+
+	context = Context;
+
+	vk::PhysicalDeviceProperties deviceProperties = context->get_physical_device_properties();
+
+	if (deviceProperties.limits.timestampPeriod == 0.0f) {
+		LOG_ERROR("Device does not support timestamp queries");
+		return Error::TIMESTAMPS_UNSUPPORTED;
+	}
+
+	std::vector<vk::QueueFamilyProperties> queueFamilies = context->primary_physical_device.getQueueFamilyProperties();
+	uint32_t validBits = queueFamilies[context->primary_queue_family_index].timestampValidBits;
+
+	if (validBits == 0) {
+		LOG_ERROR("Primary queue does not support timestamp queries");
+		return Error::TIMESTAMPS_UNSUPPORTED;
+	}
+
+	timestamp_mask = (validBits >= 64) ? std::numeric_limits<uint64_t>::max() : ((uint64_t(1) << validBits) - 1);
+	timestamp_period_ns = static_cast<double>(deviceProperties.limits.timestampPeriod);
+
+	// Two timestamps per scope, each frame owns a contiguous range of the pool
+	queries_per_frame = 2 * MaxScopesPerFrame;
+
+	vk::QueryPoolCreateInfo queryPoolInfo;
+	queryPoolInfo.queryType = vk::QueryType::eTimestamp;
+	queryPoolInfo.queryCount = queries_per_frame * static_cast<uint32_t>(FrameCount);
+
+	query_pool = context->primary_logical_device.createQueryPool(queryPoolInfo);
+
+	if (!query_pool) {
+		LOG_ERROR("Failed to create timestamp query pool");
+		return Error::FAIL_CREATE_QUERY_POOL;
+	}
+
+	frames.clear();
+	frames.resize(FrameCount);
+
+	for (auto& f : frames) {
+		f.scopes.reserve(MaxScopesPerFrame);
+	}
+
+	history_length = std::max<size_t>(HistoryLength, 1);
+	history.clear();
+
+	query_results.resize(2 * static_cast<size_t>(queries_per_frame));
+
+	is_init = true;
+
+	return Error::OK;
+}
+
+void GpuProfiler::deinit() {
+	if (!is_init) {
+		return;
+	}
+
+	context->primary_logical_device.destroyQueryPool(query_pool);
+	query_pool = nullptr;
+
+	frames.clear();
+	history.clear();
+
+	is_init = false;
+}
+
+void GpuProfiler::clear_frame(Swapchain::FrameId FrameId) {
+	if (!is_init) {
+		return;
+	}
+
+	std::scoped_lock lock(scope_mutex);
+
+	FrameData& frame = frames[FrameId];
+
+	frame.scopes.clear();
+	frame.next_query = 0;
+	frame.has_results = false;
+}
+
+void GpuProfiler::reset_frame(Swapchain::FrameId FrameId, vk::CommandBuffer CommandBuffer) {
+	if (!is_init) {
+		return;
+	}
+
+	CommandBuffer.resetQueryPool(query_pool, FrameId * queries_per_frame, queries_per_frame);
+}
+
+GpuProfiler::ScopeId GpuProfiler::begin_scope(Swapchain::FrameId FrameId, vk::CommandBuffer CommandBuffer, Stage ProfiledStage, MeshId Mesh, bool Nested) {
+	if (!is_init) {
+		return INVALID_SCOPE;
+	}
+
+	FrameData& frame = frames[FrameId];
+	ScopeId scope = INVALID_SCOPE;
+	uint32_t beginQuery = 0;
+
+	{
+		std::scoped_lock lock(scope_mutex);
+
+		if (frame.next_query + 2 > queries_per_frame) {
+			return INVALID_SCOPE;
+		}
+
+		beginQuery = frame.next_query;
+		frame.next_query += 2;
+
+		scope = static_cast<ScopeId>(frame.scopes.size());
+		frame.scopes.push_back({ ProfiledStage, Mesh, Nested, beginQuery, beginQuery + 1 });
+	}
+
+	CommandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, query_pool, FrameId * queries_per_frame + beginQuery);
+
+	return scope;
+}
+
+void GpuProfiler::end_scope(Swapchain::FrameId FrameId, vk::CommandBuffer CommandBuffer, ScopeId Scope) {
+	if (!is_init || Scope == INVALID_SCOPE) {
+		return;
+	}
+
+	uint32_t endQuery = 0;
+
+	{
+		std::scoped_lock lock(scope_mutex);
+
+		endQuery = frames[FrameId].scopes[Scope].end_query;
+	}
+
+	CommandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, query_pool, FrameId * queries_per_frame + endQuery);
+}
+
+void GpuProfiler::mark_submitted(Swapchain::FrameId FrameId) {
+	if (!is_init) {
+		return;
+	}
+
+	frames[FrameId].has_results = true;
+}
+
+void GpuProfiler::collect(Swapchain::FrameId FrameId) {
+	if (!is_init) {
+		return;
+	}
+
+	FrameData& frame = frames[FrameId];
+
+	if (!frame.has_results || frame.next_query == 0) {
+		return;
+	}
+
+	// Value + availability pairs, never waits on the device
+	vk::Result result = context->primary_logical_device.getQueryPoolResults(
+		query_pool,
+		FrameId * queries_per_frame,
+		frame.next_query,
+		frame.next_query * 2 * sizeof(uint64_t),
+		query_results.data(),
+		2 * sizeof(uint64_t),
+		vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability
+	);
+
+	if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) {
+		return;
+	}
+
+	frame_totals.clear();
+
+	for (const auto& s : frame.scopes) {
+		uint64_t beginAvailable = query_results[2 * s.begin_query + 1];
+		uint64_t endAvailable = query_results[2 * s.end_query + 1];
+
+		if (beginAvailable == 0 || endAvailable == 0) {
+			continue;
+		}
+
+		uint64_t begin = query_results[2 * s.begin_query] & timestamp_mask;
+		uint64_t end = query_results[2 * s.end_query] & timestamp_mask;
+		uint64_t ticks = (end - begin) & timestamp_mask;
+
+		double ms = static_cast<double>(ticks) * timestamp_period_ns * 1e-6;
+
+		frame_totals[sample_key(s.stage, s.mesh)] += ms;
+
+		if (s.mesh != ALL_MESHES && !s.nested) {
+			frame_totals[sample_key(s.stage, ALL_MESHES)] += ms;
+		}
+	}
+
+	for (const auto& [key, ms] : frame_totals) {
+		History& h = history[key];
+
+		if (h.samples.size() != history_length) {
+			h.samples.resize(history_length);
+		}
+
+		h.samples[h.head] = ms;
+		h.head = (h.head + 1) % history_length;
+		h.count = std::min(h.count + 1, history_length);
+	}
+
+	frame.has_results = false;
+}
+
+GpuProfiler::Statistics GpuProfiler::compute_statistics(uint64_t Key) {
+	Statistics stats;
+	stats.stage = static_cast<Stage>(Key >> 32);
+	stats.mesh = static_cast<MeshId>(Key & 0xFFFFFFFF);
+
+	auto it = history.find(Key);
+
+	if (it == history.end() || it->second.count == 0) {
+		return stats;
+	}
+
+	const History& h = it->second;
+
+	std::vector<double> sorted(h.samples.begin(), h.samples.begin() + h.count);
+
+	double sum = 0.0;
+	for (double s : sorted) {
+		sum += s;
+	}
+
+	stats.sample_count = h.count;
+	stats.avg_ms = sum / static_cast<double>(h.count);
+	stats.min_ms = *std::min_element(sorted.begin(), sorted.end());
+	stats.last_ms = h.samples[(h.head + history_length - 1) % history_length];
+
+	size_t p99Index = std::min(sorted.size() - 1, (sorted.size() * 99) / 100);
+	std::nth_element(sorted.begin(), sorted.begin() + p99Index, sorted.end());
+	stats.p99_ms = sorted[p99Index];
+
+	return stats;
+}
+
+std::vector<GpuProfiler::Statistics> GpuProfiler::get_statistics() {
+	std::vector<uint64_t> keys;
+	keys.reserve(history.size());
+
+	for (const auto& [key, h] : history) {
+		keys.push_back(key);
+	}
+
+	// Stage major, aggregate before individual meshes
+	std::sort(keys.begin(), keys.end(), [](uint64_t a, uint64_t b) {
+		uint64_t stageA = a >> 32;
+		uint64_t stageB = b >> 32;
+
+		if (stageA != stageB) {
+			return stageA < stageB;
+		}
+
+		return static_cast<uint32_t>(a + 1) < static_cast<uint32_t>(b + 1);
+	});
+
+	std::vector<Statistics> out;
+	out.reserve(keys.size());
+
+	for (uint64_t key : keys) {
+		out.push_back(compute_statistics(key));
+	}
+
+	return out;
+}
+
+Retval<GpuProfiler::Statistics, GpuProfiler::Error> GpuProfiler::get_statistics(Stage ProfiledStage, MeshId Mesh) {
+	Statistics stats = compute_statistics(sample_key(ProfiledStage, Mesh));
+
+	if (stats.sample_count == 0) {
+		return { stats, Error::NO_SAMPLES };
+	}
+
+	return { stats, Error::OK };
+}
+
+GpuProfiler::Error GpuProfiler::export_csv(std::filesystem::path path) {
+	std::vector<Statistics> stats = get_statistics();
+
+	if (stats.empty()) {
+		return Error::NO_SAMPLES;
+	}
+
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+
+	if (!file.is_open()) {
+		LOG_ERROR("Failed to open %s for writing", path.string().c_str());
+		return Error::WRITE_ERROR;
+	}
+
+	file << "stage,mesh,samples,min_ms,avg_ms,p99_ms,last_ms\n";
+
+	for (const auto& s : stats) {
+		file << stage_name(s.stage) << ",";
+
+		if (s.mesh == ALL_MESHES) {
+			file << "all";
+		}
+		else {
+			file << s.mesh;
+		}
+
+		file << "," << s.sample_count
+			<< "," << s.min_ms
+			<< "," << s.avg_ms
+			<< "," << s.p99_ms
+			<< "," << s.last_ms
+			<< "\n";
+	}
+
+	if (file.fail()) {
+		return Error::WRITE_ERROR;
+	}
+
+	return Error::OK;
+}
+
+GpuProfiler::Error GpuProfiler::export_json(std::filesystem::path path) {
+	std::vector<Statistics> stats = get_statistics();
+
+	if (stats.empty()) {
+		return Error::NO_SAMPLES;
+	}
+
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+
+	if (!file.is_open()) {
+		LOG_ERROR("Failed to open %s for writing", path.string().c_str());
+		return Error::WRITE_ERROR;
+	}
+
+	file << "{\n\t\"stages\": [\n";
+
+	for (size_t i = 0; i < stats.size(); i++) {
+		const Statistics& s = stats[i];
+
+		file << "\t\t{ \"stage\": \"" << stage_name(s.stage) << "\", \"mesh\": ";
+
+		if (s.mesh == ALL_MESHES) {
+			file << "null";
+		}
+		else {
+			file << s.mesh;
+		}
+
+		file << ", \"samples\": " << s.sample_count
+			<< ", \"min_ms\": " << s.min_ms
+			<< ", \"avg_ms\": " << s.avg_ms
+			<< ", \"p99_ms\": " << s.p99_ms
+			<< ", \"last_ms\": " << s.last_ms
+			<< " }" << ((i + 1 < stats.size()) ? "," : "") << "\n";
+	}
+
+	file << "\t]\n}\n";
+
+	if (file.fail()) {
+		return Error::WRITE_ERROR;
+	}
+
+	return Error::OK;
+}
+
+const char* GpuProfiler::stage_name(Stage ProfiledStage) {
+	switch (ProfiledStage) {
+	case Stage::AnimationSampling:
+		return "animation_sampling";
+	case Stage::FrustumCulling:
+		return "frustum_culling";
+	case Stage::FieldTransform:
+		return "field_transform";
+	case Stage::FieldBlend:
+		return "field_blend";
+	case Stage::VertexProjection:
+		return "vertex_projection";
+	case Stage::VertexCachePlayback:
+		return "vertex_cache_playback";
+	case Stage::VertexCopy:
+		return "vertex_copy";
+	case Stage::DepthSubpass:
+		return "depth_subpass";
+	case Stage::ColorSubpass:
+		return "color_subpass";
+	default:
+		return "unknown";
+	}
+}
@@ -0,0 +1,403 @@
+#include "jobsystem.h"
+
+#include <algorithm>
+#include <chrono>
+
+// Lets a thread find its own deque, a thread can only be a worker of one system
+static thread_local JobSystem* current_system = nullptr;
+static thread_local size_t current_worker = JobSystem::NOT_A_WORKER;
+
+JobSystem::~JobSystem() {
+	deinit();
+}
+
+void JobSystem::init(size_t ThreadCount, bool Background) {
+	if (is_init) {
+		deinit();
+	}
+
+	size_t threadCount = ThreadCount;
+
+	if (threadCount == 0) {
+		threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+
+	stopping = false;
+	queued = 0;
+	main_queued = 0;
+	next_foreign_worker = 0;
+
+	// A default id matches no thread
+	main_thread_id = Background ? std::thread::id{} : std::this_thread::get_id();
+
+	if (!Background) {
+		current_system = this;
+		current_worker = 0;
+	}
+
+	workers.clear();
+
+	for (size_t i = 0; i < threadCount; i++) {
+		workers.push_back(std::make_unique<Worker>());
+	}
+
+	// Only started once every deque exists, workers steal from each other
+	for (size_t i = Background ? 0 : 1; i < workers.size(); i++) {
+		workers[i]->thread = std::thread(&JobSystem::worker_main, this, i);
+	}
+
+	is_init = true;
+}
+
+void JobSystem::deinit() {
+	if (!is_init) {
+		return;
+	}
+
+	{
+		std::scoped_lock lock(wake_mutex);
+		stopping = true;
+	}
+
+	wake_condition.notify_all();
+
+	for (auto& worker : workers) {
+		if (worker->thread.joinable()) {
+			worker->thread.join();
+		}
+	}
+
+	// Anything still queued was never waited on and is dropped
+	workers.clear();
+	main_jobs.clear();
+
+	if (current_system == this) {
+		current_system = nullptr;
+		current_worker = NOT_A_WORKER;
+	}
+
+	is_init = false;
+}
+
+size_t JobSystem::current_worker_index() {
+	return current_system == this ? current_worker : NOT_A_WORKER;
+}
+
+void JobSystem::run(TaskGroup& Group, Task Task, Affinity Affinity) {
+	if (!is_init) {
+		Task();
+		return;
+	}
+
+	Group.outstanding.fetch_add(1, std::memory_order_acq_rel);
+
+	{
+		std::scoped_lock lock(Group.mutex);
+		Group.running++;
+	}
+
+	push({ std::move(Task), &Group, false }, Affinity);
+}
+
+void JobSystem::then(TaskGroup& Group, Task Continuation, Affinity Affinity) {
+	// Every task already ran inline
+	if (!is_init) {
+		Continuation();
+		return;
+	}
+
+	Group.outstanding.fetch_add(1, std::memory_order_acq_rel);
+
+	{
+		std::scoped_lock lock(Group.mutex);
+
+		if (Group.running != 0) {
+			Group.continuations.push_back({ std::move(Continuation), Affinity });
+			return;
+		}
+	}
+
+	push({ std::move(Continuation), &Group, true }, Affinity);
+}
+
+void JobSystem::wait(TaskGroup& Group) {
+	size_t workerIdx = current_worker_index();
+	bool isMainThread = is_init && std::this_thread::get_id() == main_thread_id;
+
+	while (!Group.is_done()) {
+		if (isMainThread && run_main_thread_job()) {
+			continue;
+		}
+
+		if (run_one(workerIdx)) {
+			continue;
+		}
+
+		// Nothing to help with, the remaining tasks are running on other threads
+		auto idleStart = std::chrono::steady_clock::now();
+
+		{
+			std::unique_lock lock(wake_mutex);
+
+			wake_condition.wait(lock, [&]() {
+				return Group.is_done() || queued.load() > 0 || (isMainThread && main_queued.load() > 0);
+			});
+		}
+
+		if (workerIdx != NOT_A_WORKER) {
+			workers[workerIdx]->idle_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - idleStart).count();
+		}
+	}
+}
+
+void JobSystem::parallel_for(size_t Count, size_t Grain, const std::function<void(size_t, size_t)>& Body) {
+	if (Count == 0) {
+		return;
+	}
+
+	size_t grain = Grain;
+
+	// A few chunks per worker, so stealing can even out chunks of uneven cost
+	if (grain == 0) {
+		grain = std::max<size_t>(Count / (std::max<size_t>(workers.size(), 1) * 4), 1);
+	}
+
+	if (!is_init || Count <= grain) {
+		Body(0, Count);
+		return;
+	}
+
+	TaskGroup group;
+
+	for (size_t begin = 0; begin < Count; begin += grain) {
+		size_t end = std::min(begin + grain, Count);
+
+		run(group, [&Body, begin, end]() {
+			Body(begin, end);
+		});
+	}
+
+	wait(group);
+}
+
+size_t JobSystem::pump_main_thread() {
+	if (!is_init || std::this_thread::get_id() != main_thread_id) {
+		return 0;
+	}
+
+	size_t count = 0;
+
+	while (run_main_thread_job()) {
+		count++;
+	}
+
+	return count;
+}
+
+std::vector<JobSystem::WorkerStatistics> JobSystem::get_statistics() {
+	std::vector<WorkerStatistics> ret(workers.size());
+
+	for (size_t i = 0; i < workers.size(); i++) {
+		ret[i].tasks_run = workers[i]->tasks_run.load();
+		ret[i].steals = workers[i]->steals.load();
+		ret[i].idle_ms = static_cast<double>(workers[i]->idle_ns.load()) / 1000000.0;
+	}
+
+	return ret;
+}
+
+void JobSystem::reset_statistics() {
+	for (auto& worker : workers) {
+		worker->tasks_run = 0;
+		worker->steals = 0;
+		worker->idle_ns = 0;
+	}
+}
+
+void JobSystem::worker_main(size_t WorkerIdx) {
+	current_system = this;
+	current_worker = WorkerIdx;
+
+	Worker& self = *workers[WorkerIdx];
+
+	for (;;) {
+		if (run_one(WorkerIdx)) {
+			continue;
+		}
+
+		auto idleStart = std::chrono::steady_clock::now();
+
+		{
+			std::unique_lock lock(wake_mutex);
+			wake_condition.wait(lock, [this]() { return stopping || queued.load() > 0; });
+
+			if (stopping) {
+				return;
+			}
+		}
+
+		self.idle_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - idleStart).count();
+	}
+}
+
+void JobSystem::push(Job Job, Affinity Affinity) {
+	if (Affinity == Affinity::MainThread) {
+		main_queued++;
+
+		{
+			std::scoped_lock lock(main_mutex);
+			main_jobs.push_back(std::move(Job));
+		}
+
+		// The main thread may be asleep in wait, only notify_all is sure to reach it
+		{
+			std::scoped_lock lock(wake_mutex);
+		}
+
+		wake_condition.notify_all();
+
+		return;
+	}
+
+	size_t workerIdx = current_worker_index();
+
+	// Threads outside the system spread their tasks over the workers
+	if (workerIdx == NOT_A_WORKER) {
+		workerIdx = next_foreign_worker++ % workers.size();
+	}
+
+	// Counted before it is visible, so a thief never takes the count below zero
+	queued++;
+
+	{
+		std::scoped_lock lock(workers[workerIdx]->mutex);
+		workers[workerIdx]->jobs.push_back(std::move(Job));
+	}
+
+	{
+		std::scoped_lock lock(wake_mutex);
+	}
+
+	wake_condition.notify_one();
+}
+
+bool JobSystem::run_one(size_t WorkerIdx) {
+	if (queued.load() == 0) {
+		return false;
+	}
+
+	Job job;
+	bool found = false;
+	bool stolen = false;
+
+	// Newest first from the own deque, it is the most likely to still be in cache
+	if (WorkerIdx != NOT_A_WORKER) {
+		Worker& self = *workers[WorkerIdx];
+		std::scoped_lock lock(self.mutex);
+
+		if (!self.jobs.empty()) {
+			job = std::move(self.jobs.back());
+			self.jobs.pop_back();
+			found = true;
+		}
+	}
+
+	// Oldest first from the others, those tend to be the largest pieces of work left
+	size_t start = WorkerIdx == NOT_A_WORKER ? 0 : WorkerIdx + 1;
+
+	for (size_t i = 0; i < workers.size() && !found; i++) {
+		size_t victimIdx = (start + i) % workers.size();
+
+		if (victimIdx == WorkerIdx) {
+			continue;
+		}
+
+		Worker& victim = *workers[victimIdx];
+		std::scoped_lock lock(victim.mutex);
+
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			found = true;
+			stolen = true;
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	queued--;
+
+	if (stolen && WorkerIdx != NOT_A_WORKER) {
+		workers[WorkerIdx]->steals++;
+	}
+
+	execute(job, WorkerIdx);
+
+	return true;
+}
+
+bool JobSystem::run_main_thread_job() {
+	Job job;
+
+	{
+		std::scoped_lock lock(main_mutex);
+
+		if (main_jobs.empty()) {
+			return false;
+		}
+
+		job = std::move(main_jobs.front());
+		main_jobs.pop_front();
+	}
+
+	main_queued--;
+
+	execute(job, current_worker_index());
+
+	return true;
+}
+
+void JobSystem::execute(Job& Job, size_t WorkerIdx) {
+	Job.task();
+
+	if (WorkerIdx != NOT_A_WORKER) {
+		workers[WorkerIdx]->tasks_run++;
+	}
+
+	finish(Job);
+}
+
+void JobSystem::finish(Job& Job) {
+	TaskGroup* group = Job.group;
+
+	if (group == nullptr) {
+		return;
+	}
+
+	if (!Job.is_continuation) {
+		std::vector<TaskGroup::Continuation> ready;
+
+		{
+			std::scoped_lock lock(group->mutex);
+
+			if (--group->running == 0) {
+				ready.swap(group->continuations);
+			}
+		}
+
+		for (auto& c : ready) {
+			push({ std::move(c.task), group, true }, c.affinity);
+		}
+	}
+
+	// The group may be destroyed by its waiter as soon as this reaches zero
+	if (group->outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		{
+			std::scoped_lock lock(wake_mutex);
+		}
+
+		wake_condition.notify_all();
+	}
+}
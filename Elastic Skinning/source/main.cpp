@@ -6,21 +6,172 @@
 #include "window.h"
 #include "gfxcontext.h"
 #include "renderer.h"
+#include "fieldasset.h"
 
 #include <chrono>
+#include <memory>
+#include <string>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
 
 const std::string APP_NAME{ "Elastic Skinning" };
 
+struct LaunchOptions {
+	bool headless{ false };
+	uint32_t width{ 1280 };
+	uint32_t height{ 720 };
+	size_t frame_count{ 300 };
+	uint32_t frames_in_flight{ 2 };
+	std::filesystem::path png_path;
+	std::filesystem::path raw_path;
+	std::filesystem::path profile_path;
+	std::filesystem::path fields_path;
+	bool profile_per_mesh{ false };
+	bool indirect_draws{ false };
+	bool frustum_culling{ true };
+	bool stream{ false };
+	bool bindless{ false };
+	uint32_t memory_log_interval{ 0 };
+	bool valid{ true };
+};
+
+// Whole decimal numbers of at least Min, anything else is reported and fails the options
+template <typename T>
+static bool parse_number(const char* Name, const char* Value, T& Out, T Min) {
+	const char* end = Value + std::strlen(Value);
+	T value{};
+	auto [ptr, ec] = std::from_chars(Value, end, value);
+
+	if (ec != std::errc{} || ptr != end || value < Min) {
+		LOG_ERROR("Invalid value for %s: %s", Name, Value);
+		return false;
+	}
+
+	Out = value;
+	return true;
+}
+
+/*
+* Usage: [--headless] [--width N] [--height N] [--frames N] [--png path] [--raw path]
+*        [--profile path_prefix] [--profile-per-mesh] [--frames-in-flight N] [--indirect-draws]
+*        [--no-frustum-culling] [--stream] [--bindless] [--memory-log frames] [--fields directory]
+*
+* --fields digests the field assets elastic_bake saved in directory instead of baking them
+*/
+LaunchOptions parse_launch_options(int argc, char** argv) {
+	LaunchOptions ret;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = (i + 1) < argc;
+
+		if (arg == "--headless") {
+			ret.headless = true;
+		}
+		else if (arg == "--width" && hasValue) {
+			ret.valid = parse_number("--width", argv[++i], ret.width, 1u) && ret.valid;
+		}
+		else if (arg == "--height" && hasValue) {
+			ret.valid = parse_number("--height", argv[++i], ret.height, 1u) && ret.valid;
+		}
+		else if (arg == "--frames" && hasValue) {
+			ret.valid = parse_number<size_t>("--frames", argv[++i], ret.frame_count, 1) && ret.valid;
+		}
+		else if (arg == "--png" && hasValue) {
+			ret.png_path = argv[++i];
+		}
+		else if (arg == "--raw" && hasValue) {
+			ret.raw_path = argv[++i];
+		}
+		else if (arg == "--profile" && hasValue) {
+			ret.profile_path = argv[++i];
+		}
+		else if (arg == "--profile-per-mesh") {
+			ret.profile_per_mesh = true;
+		}
+		else if (arg == "--frames-in-flight" && hasValue) {
+			ret.valid = parse_number("--frames-in-flight", argv[++i], ret.frames_in_flight, 1u) && ret.valid;
+		}
+		else if (arg == "--indirect-draws") {
+			ret.indirect_draws = true;
+		}
+		else if (arg == "--no-frustum-culling") {
+			ret.frustum_culling = false;
+		}
+		else if (arg == "--stream") {
+			ret.stream = true;
+		}
+		else if (arg == "--bindless") {
+			ret.bindless = true;
+		}
+		else if (arg == "--memory-log" && hasValue) {
+			ret.valid = parse_number("--memory-log", argv[++i], ret.memory_log_interval, 0u) && ret.valid;
+		}
+		else if (arg == "--fields" && hasValue) {
+			ret.fields_path = argv[++i];
+		}
+		else {
+			LOG_ERROR("Unknown argument: %s", arg.c_str());
+		}
+	}
+
+	return ret;
+}
+
 int main(int argc, char** argv) {
-	Window window(APP_NAME, true);
-	GfxContext context(&window, APP_NAME);
+	LaunchOptions options = parse_launch_options(argc, argv);
+
+	if (!options.valid) {
+		LOG_ERROR("Usage: %s [--headless] [--width N] [--height N] [--frames N] [--png path] [--raw path] [--profile path_prefix] [--profile-per-mesh] [--frames-in-flight N] [--indirect-draws] [--no-frustum-culling] [--stream] [--bindless] [--memory-log frames] [--fields directory]", argv[0]);
+		return 1;
+	}
+
+	std::unique_ptr<Window> window;
+	std::unique_ptr<GfxContext> context;
+
+	if (options.headless) {
+		context = std::make_unique<GfxContext>(APP_NAME);
+	}
+	else {
+		window = std::make_unique<Window>(APP_NAME, true);
+		context = std::make_unique<GfxContext>(window.get(), APP_NAME);
+	}
+
+	auto get_aspect_ratio = [&]() -> float {
+		if (options.headless) {
+			return static_cast<float>(options.width) / static_cast<float>(options.height);
+		}
+
+		return window->get_aspect_ratio();
+	};
+
+	RendererSettings settings;
+	settings.offscreen_extent = vk::Extent2D{ options.width, options.height };
+	settings.frames_in_flight = options.frames_in_flight;
+	settings.enable_profiling = !options.profile_path.empty();
+	settings.profile_per_mesh = options.profile_per_mesh;
+	settings.indirect_draws = options.indirect_draws;
+	settings.frustum_culling = options.frustum_culling;
+	settings.bindless_textures = options.bindless;
+	settings.memory_log_interval = options.memory_log_interval;
 
-	Renderer<ModelBuffer, CameraBuffer, ColorSampler> renderer(&context);
+	Renderer<ModelBuffer, CameraBuffer, ColorSampler> renderer(context.get(), settings);
 
 	GfxPipeline<Vertex, ModelBuffer, CameraBuffer, ColorSampler> base_pipeline;
-	base_pipeline
-		.set_vertex_shader("shaders/base.vert.bin")
-		.set_fragment_shader("shaders/base.frag.bin");
+	if (renderer.has_bindless_textures()) {
+		base_pipeline
+			.set_vertex_shader("shaders/bindless.vert.bin")
+			.set_fragment_shader("shaders/bindless.frag.bin")
+			.set_depth_vertex_shader("shaders/depth.vert.bin")
+			.set_bindless_textures();
+	}
+	else {
+		base_pipeline
+			.set_vertex_shader("shaders/base.vert.bin")
+			.set_fragment_shader("shaders/base.frag.bin")
+			.set_depth_vertex_shader("shaders/depth.vert.bin");
+	}
 
 	renderer.register_pipeline("base", base_pipeline);
 
@@ -92,7 +243,7 @@ int main(int argc, char** argv) {
 		0, 1, 2, 2, 3, 0
 	};
 
-	auto [model, modelError] = load_model("models/plaidtube_clean.glb");
+	const std::filesystem::path model_path{ "models/plaidtube_clean.glb" };
 	ModelTransform model_transform;
 	model_transform.scale = { 0.25f, 0.25f, 0.25f };
 
@@ -100,36 +251,65 @@ int main(int argc, char** argv) {
 	//renderer.digest_mesh(triangle2, &t2);
 	//renderer.digest_mesh(square, &s1);
 
-	renderer.digest_model(model, &model_transform);
+	// Streamed models are loaded in the background and their skeleton only exists once they're ready
+	Model model;
+	ModelId streamed_model = 0;
+	Skeleton* skeleton = nullptr;
+
+	if (options.stream) {
+		streamed_model = renderer.stream_model(model_path, &model_transform, options.fields_path).value;
+	}
+	else {
+		model = load_model(model_path).value;
+
+		std::vector<std::optional<FieldAsset>> bakedFields;
+
+		if (!options.fields_path.empty()) {
+			bakedFields = load_field_assets(options.fields_path, model_path, model.meshes.size());
+		}
+
+		renderer.digest_model(model, &model_transform, bakedFields);
+		skeleton = &model.skeleton;
+	}
 
 	Camera c;
 	c.look_at(
 		{ 3.0f, 1.2f, -0.0f },
 		{ 0.0f, 0.0f, 0.0f }
 	);
-	c.projection = glm::perspective(45.0f, window.get_aspect_ratio(), 0.1f, 10.0f);
+	c.projection = glm::perspective(45.0f, get_aspect_ratio(), 0.1f, 10.0f);
 
 	renderer.set_camera(&c);
 
 	auto start_time = std::chrono::steady_clock::now();
 
-	while (!window.should_close()) {
-		window.poll_events();
+	size_t frame_number = 0;
+
+	while (options.headless ? (frame_number < options.frame_count) : !window->should_close()) {
+		if (window) {
+			window->poll_events();
+		}
 
-		c.projection = glm::perspective(45.0f, window.get_aspect_ratio(), 0.1f, 10.f);
+		c.projection = glm::perspective(45.0f, get_aspect_ratio(), 0.1f, 10.f);
 
 		auto current_time = std::chrono::steady_clock::now();
 
 		std::chrono::milliseconds t = std::chrono::duration_cast<std::chrono::milliseconds>(current_time - start_time);
 		
-		if ((t.count() / 5000) % 3 == 0) {
-			model.skeleton.play_animation("LightBend", true);
+		if (skeleton == nullptr) {
+			skeleton = renderer.get_model_skeleton(streamed_model);
 		}
-		else if ((t.count() / 5000) % 3 == 1) {
-			model.skeleton.play_animation("HeavyBend", true);
-		}
-		else {
-			model.skeleton.clear_animation();
+
+		if (skeleton != nullptr) {
+			if ((t.count() / 5000) % 3 == 0) {
+				skeleton->play_animation("LightBend", true);
+			}
+			else if ((t.count() / 5000) % 3 == 1) {
+				skeleton->play_animation("HeavyBend", true);
+			}
+			else {
+				skeleton->clear_animation();
+			}
 		}
 		
 		float t_f = static_cast<float>(t.count());
@@ -149,6 +329,56 @@ int main(int argc, char** argv) {
 		//model_transform.rotation = r1 * r2;
 
 		renderer.draw_frame();
+
+		frame_number++;
+	}
+
+	if (options.headless && (!options.png_path.empty() || !options.raw_path.empty())) {
+		auto [frame, frameError] = renderer.read_back_frame();
+
+		if (frameError != RendererImpl::Error::OK) {
+			LOG_ERROR("Failed to read back offscreen frame");
+			return 1;
+		}
+
+		if (!options.png_path.empty() && save_image_png(options.png_path, frame) != AssetError::OK) {
+			LOG_ERROR("Failed to write %s", options.png_path.string().c_str());
+		}
+
+		if (!options.raw_path.empty() && save_binary_asset(options.raw_path, frame.data) != AssetError::OK) {
+			LOG_ERROR("Failed to write %s", options.raw_path.string().c_str());
+		}
+	}
+
+	if (GpuProfiler* profiler = renderer.get_profiler()) {
+		std::filesystem::path csvPath = options.profile_path;
+		std::filesystem::path jsonPath = options.profile_path;
+		csvPath += ".csv";
+		jsonPath += ".json";
+
+		if (profiler->export_csv(csvPath) != GpuProfiler::Error::OK) {
+			LOG_ERROR("Failed to write %s", csvPath.string().c_str());
+		}
+
+		if (profiler->export_json(jsonPath) != GpuProfiler::Error::OK) {
+			LOG_ERROR("Failed to write %s", jsonPath.string().c_str());
+		}
+
+		for (const auto& stats : profiler->get_statistics()) {
+			if (stats.mesh == GpuProfiler::ALL_MESHES) {
+				LOG("%-18s avg %.3f ms  p99 %.3f ms  min %.3f ms\n", GpuProfiler::stage_name(stats.stage), stats.avg_ms, stats.p99_ms, stats.min_ms);
+			}
+		}
+
+		std::vector<JobSystem::WorkerStatistics> workerStats = renderer.get_job_system().get_statistics();
+
+		for (size_t i = 0; i < workerStats.size(); i++) {
+			LOG("Worker %-11zu %llu tasks  %llu steals  idle %.3f ms\n", i, static_cast<unsigned long long>(workerStats[i].tasks_run), static_cast<unsigned long long>(workerStats[i].steals), workerStats[i].idle_ms);
+		}
+	}
+
+	if (options.memory_log_interval != 0) {
+		context->log_memory_statistics();
 	}
 
 	return 0;
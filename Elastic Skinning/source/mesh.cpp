@@ -1 +1,25 @@
-#include "mesh.h"
\ No newline at end of file
+#include "mesh.h"
+
+#include <cstring>
+
+std::vector<uint8_t> VertexStreams::pack(const std::vector<Vertex>& Vertices) {
+	std::vector<uint8_t> ret(size(Vertices.size()), 0);
+
+	uint8_t* positions = ret.data();
+	uint8_t* attributes = ret.data() + attribute_offset(Vertices.size());
+
+	for (size_t i = 0; i < Vertices.size(); i++) {
+		VertexPosition position{};
+		position.position = Vertices[i].position;
+
+		VertexAttributes attribute{};
+		attribute.normal = Vertices[i].normal;
+		attribute.color = Vertices[i].color;
+		attribute.texcoords = Vertices[i].texcoords;
+
+		std::memcpy(positions + i * sizeof(VertexPosition), &position, sizeof(VertexPosition));
+		std::memcpy(attributes + i * sizeof(VertexAttributes), &attribute, sizeof(VertexAttributes));
+	}
+
+	return ret;
+}
\ No newline at end of file
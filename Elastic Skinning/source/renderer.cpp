@@ -1,14 +1,103 @@
 #include "Renderer.h"
 
+#include <algorithm>
 #include <array>
 #include <list>
 #include <memory>
+#include <thread>
+#include <atomic>
+#include <numeric>
+#include <cmath>
 
-RendererImpl::RendererImpl(GfxContext* Context) {
-	constructor_impl(Context);
+// Skinned frames read back by one submission when baking a vertex cache
+static constexpr size_t VERTEX_CACHE_BAKE_CHUNK_BYTES = 64 * 1024 * 1024;
+
+template <typename T>
+static void append_bytes(BinaryBlob& Out, const T* Data, size_t Count) {
+	static_assert(std::is_trivially_copyable_v<T>);
+
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(Data);
+	Out.insert(Out.end(), bytes, bytes + Count * sizeof(T));
+}
+
+template <typename T>
+static void append_bytes(BinaryBlob& Out, const std::vector<T>& Values) {
+	uint64_t count = Values.size();
+
+	append_bytes(Out, &count, 1);
+	append_bytes(Out, Values.data(), Values.size());
+}
+
+// Everything a skeleton is posed from, bones, hierarchy and the keys of every clip. Skeletons with equal keys
+// pose alike whatever they play, so the clips of one can pose the other
+static BinaryBlob get_rig_key(const Skeleton& Skeleton) {
+	BinaryBlob ret;
+
+	append_bytes(ret, Skeleton.bone_names);
+	append_bytes(ret, Skeleton.parent_indices);
+
+	// Member by member, padding would tell equal bones apart
+	for (const Bone& bone : Skeleton.bones) {
+		append_bytes(ret, &bone.bind_matrix, 1);
+		append_bytes(ret, &bone.inverse_bind_matrix, 1);
+		append_bytes(ret, &bone.rotation, 1);
+		append_bytes(ret, &bone.position, 1);
+		append_bytes(ret, &bone.scale, 1);
+	}
+
+	append_bytes(ret, Skeleton.animation_names);
+
+	for (size_t a = 0; a < Skeleton.animations.size(); a++) {
+		const CompressedAnimation& compressed = Skeleton.compressed_animations[a];
+
+		// Which bone every channel drives
+		append_bytes(ret, Skeleton.animation_channel_bones[a]);
+
+		if (!compressed.empty()) {
+			uint32_t timeStep = compressed.get_time_step();
+
+			append_bytes(ret, &timeStep, 1);
+			append_bytes(ret, compressed.get_tracks());
+			append_bytes(ret, compressed.get_times());
+			append_bytes(ret, compressed.get_values());
+			append_bytes(ret, compressed.get_bounds());
+			continue;
+		}
+
+		for (const Channel& channel : Skeleton.animations[a].channels) {
+			append_bytes(ret, &channel.interpolation, 1);
+			append_bytes(ret, channel.time_points);
+
+			for (const Keyframe& keyframe : channel.keyframes) {
+				append_bytes(ret, &keyframe.rotation, 1);
+				append_bytes(ret, &keyframe.position, 1);
+				append_bytes(ret, &keyframe.scale, 1);
+				append_bytes(ret, &keyframe.weight, 1);
+			}
+		}
+	}
+
+	return ret;
+}
+
+// Scale, rotation then translation, identity for instances without a transform
+static glm::mat4 get_model_matrix(const ModelTransform* Transform) {
+	if (Transform == nullptr) {
+		return glm::mat4(1.0f);
+	}
+
+	glm::mat4 scale = glm::scale(glm::mat4(1.0f), Transform->scale);
+	glm::mat4 rotation = glm::mat4_cast(Transform->rotation);
+	glm::mat4 position = glm::translate(glm::mat4(1.0f), Transform->position);
+
+	return position * rotation * scale;
+}
+
+RendererImpl::RendererImpl(GfxContext* Context, const RendererSettings& Settings) {
+	constructor_impl(Context, Settings);
 }
 
-void RendererImpl::constructor_impl(GfxContext* Context) {
+void RendererImpl::constructor_impl(GfxContext* Context, const RendererSettings& Settings) {
 	if (Context == nullptr) {
 		LOG_ERROR("Graphics context doesn't exist");
 		return;
@@ -20,33 +109,56 @@ void RendererImpl::constructor_impl(GfxContext* Context) {
 	}
 
 	context = Context;
+	settings = Settings;
+	settings.frames_in_flight = std::max<uint32_t>(settings.frames_in_flight, 1);
 
-	context->window->add_resized_callback(
-		[this](size_t w, size_t h) {
-			this->window_resized_callback(w, h);
-		}
-	);
+	// Transform slots are passed as firstInstance, which indirect commands may only set with this feature
+	use_indirect_draws = settings.indirect_draws;
 
-	context->window->add_minimized_callback(
-		[this]() {
-			this->window_minimized_callback();
-		}
-	);
+	if (use_indirect_draws && !context->get_enabled_features().drawIndirectFirstInstance) {
+		LOG_ERROR("Device does not support drawIndirectFirstInstance, falling back to direct draws");
+		use_indirect_draws = false;
+	}
 
-	context->window->add_maximized_callback(
-		[this]() {
-			this->window_maximized_callback();
-		}
-	);
+	use_frustum_culling = use_indirect_draws && settings.frustum_culling;
 
-	context->window->add_restored_callback(
-		[this]() {
-			this->window_restored_callback();
-		}
-	);
+	if (!context->is_headless()) {
+		context->window->add_resized_callback(
+			[this](size_t w, size_t h) {
+				this->window_resized_callback(w, h);
+			}
+		);
+
+		context->window->add_minimized_callback(
+			[this]() {
+				this->window_minimized_callback();
+			}
+		);
+
+		context->window->add_maximized_callback(
+			[this]() {
+				this->window_maximized_callback();
+			}
+		);
+
+		context->window->add_restored_callback(
+			[this]() {
+				this->window_restored_callback();
+			}
+		);
+	}
 
 	create_render_state();
 
+	/*
+	* Per frame data ring, allocated once all meshes are known
+	*/
+
+	if (frame_data_ring.init(context, settings.frames_in_flight) != FrameDataRing::Error::OK) {
+		LOG_ERROR("Failed to initialize frame data ring");
+		return;
+	}
+
 	/*
 	* Create command pool
 	*/
@@ -63,21 +175,54 @@ void RendererImpl::constructor_impl(GfxContext* Context) {
 	}
 
 	/*
-	* Allocate primary command buffers
+	* Allocate per frame in flight command buffers
 	*/
 
+	in_flight_frames.resize(settings.frames_in_flight);
+
 	vk::CommandBufferAllocateInfo commandBufferInfo;
 	commandBufferInfo.commandPool = command_pool;
 	commandBufferInfo.level = vk::CommandBufferLevel::ePrimary;
-	commandBufferInfo.commandBufferCount = static_cast<uint32_t>(render_swapchain.size());
+	commandBufferInfo.commandBufferCount = static_cast<uint32_t>(in_flight_frames.size());
 
-	primary_render_command_buffers = context->primary_logical_device.allocateCommandBuffers(commandBufferInfo);
+	std::vector<vk::CommandBuffer> primaryCommandBuffers = context->primary_logical_device.allocateCommandBuffers(commandBufferInfo);
 
-	if (primary_render_command_buffers.empty()) {
+	if (primaryCommandBuffers.size() != in_flight_frames.size()) {
 		LOG_ERROR("Failed to allocate primary command buffers");
 		return;
 	}
 
+	for (size_t i = 0; i < in_flight_frames.size(); i++) {
+		in_flight_frames[i].primary_command_buffer = primaryCommandBuffers[i];
+	}
+
+	/*
+	* Create per recording thread command pools, secondaries are allocated as chunks are recorded
+	*/
+
+	size_t recordingThreadCount = settings.recording_threads;
+
+	if (recordingThreadCount == 0) {
+		recordingThreadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+
+	settings.meshes_per_command_buffer = std::max<uint32_t>(settings.meshes_per_command_buffer, 1);
+
+	recording_threads.resize(recordingThreadCount);
+
+	for (auto& thread : recording_threads) {
+		vk::CommandPoolCreateInfo threadPoolInfo;
+		threadPoolInfo.queueFamilyIndex = context->primary_queue_family_index;
+
+		thread.command_pool = context->primary_logical_device.createCommandPool(threadPoolInfo);
+		thread.draw_command_pool = context->primary_logical_device.createCommandPool(threadPoolInfo);
+
+		if (!thread.command_pool || !thread.draw_command_pool) {
+			LOG_ERROR("Failed to create recording thread command pool");
+			return;
+		}
+	}
+
 	/*
 	* Texture sampler creation
 	*/
@@ -115,21 +260,192 @@ void RendererImpl::constructor_impl(GfxContext* Context) {
 		return;
 	}
 
+	/*
+	* Frustum culling kernel init
+	*/
+
+	if (use_frustum_culling && deviceProperties.limits.maxPerStageDescriptorStorageBuffers < GpuCulling::STORAGE_BUFFER_COUNT) {
+		LOG_ERROR("Device does not support enough storage buffers for frustum culling, continuing without culling");
+		use_frustum_culling = false;
+	}
+
+	if (use_frustum_culling) {
+		cull_pipeline.shader_path = "shaders/frustumcull.comp.bin";
+		ComputePipelineImpl::Error cullError = cull_pipeline.init(context);
+
+		if (cullError != ComputePipelineImpl::Error::OK) {
+			LOG_ERROR("Failed to initialize frustum culling kernel, continuing without culling");
+			use_frustum_culling = false;
+		}
+	}
+
+	/*
+	* Animation sampling kernel init
+	*/
+
+	gpu_animation_available = settings.gpu_animation;
+
+	if (gpu_animation_available && deviceProperties.limits.maxPerStageDescriptorStorageBuffers < GpuAnimation::STORAGE_BUFFER_COUNT) {
+		LOG_ERROR("Device does not support enough storage buffers for GPU animation, posing skeletons on the CPU");
+		gpu_animation_available = false;
+	}
+
+	if (gpu_animation_available) {
+		animation_pipeline.shader_path = "shaders/animsample.comp.bin";
+		ComputePipelineImpl::Error animationError = animation_pipeline.init(context);
+
+		if (animationError != ComputePipelineImpl::Error::OK) {
+			LOG_ERROR("Failed to initialize animation sampling kernel, posing skeletons on the CPU");
+			gpu_animation_available = false;
+		}
+	}
+
+	/*
+	* Vertex cache playback kernel init
+	*/
+
+	vertex_cache_available = deviceProperties.limits.maxPerStageDescriptorStorageBuffers >= VertexCache::STORAGE_BUFFER_COUNT;
+
+	if (vertex_cache_available) {
+		vertex_cache_pipeline.shader_path = "shaders/vertexcacheplay.comp.bin";
+		vertex_cache_available = vertex_cache_pipeline.init(context) == ComputePipelineImpl::Error::OK;
+	}
+
+	if (!vertex_cache_available) {
+		LOG_ERROR("Failed to initialize vertex cache playback kernel, baked meshes are skinned every frame");
+	}
+
+	/*
+	* Animation scheduling
+	*/
+
+	animation_scheduler.set_settings(settings.animation_schedule);
+
+	/*
+	* Bindless texture set layout, pipelines registered later are created against it
+	*/
+
+	if (settings.bindless_textures) {
+		const vk::PhysicalDeviceVulkan12Features& vulkan12Features = context->get_enabled_vulkan12_features();
+
+		use_bindless_textures = vulkan12Features.descriptorIndexing
+			&& vulkan12Features.runtimeDescriptorArray
+			&& vulkan12Features.descriptorBindingPartiallyBound
+			&& vulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+
+		if (!use_bindless_textures) {
+			LOG_ERROR("Device does not support descriptor indexing, continuing without bindless textures");
+		}
+	}
+
+	if (use_bindless_textures) {
+		bindless_texture_capacity = std::max<uint32_t>(std::min({
+			settings.max_bindless_textures,
+			deviceProperties.limits.maxPerStageDescriptorSamplers,
+			deviceProperties.limits.maxPerStageDescriptorSampledImages,
+			deviceProperties.limits.maxDescriptorSetSamplers,
+			deviceProperties.limits.maxDescriptorSetSampledImages
+		}), 1);
+
+		std::array<vk::DescriptorSetLayoutBinding, 3> bindlessBindings = {
+			BindlessTextureArray::layout_binding(),
+			MaterialBuffer::layout_binding(),
+			MaterialIndexBuffer::layout_binding()
+		};
+
+		bindlessBindings[0].descriptorCount = bindless_texture_capacity;
+
+		// Only registered textures are written, the rest of the array stays unbound
+		std::array<vk::DescriptorBindingFlags, 3> bindlessBindingFlags = {
+			vk::DescriptorBindingFlagBits::ePartiallyBound,
+			vk::DescriptorBindingFlags(),
+			vk::DescriptorBindingFlags()
+		};
+
+		vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo;
+		bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindlessBindingFlags.size());
+		bindingFlagsInfo.pBindingFlags = bindlessBindingFlags.data();
+
+		vk::DescriptorSetLayoutCreateInfo bindlessLayoutInfo;
+		bindlessLayoutInfo.pNext = &bindingFlagsInfo;
+		bindlessLayoutInfo.bindingCount = static_cast<uint32_t>(bindlessBindings.size());
+		bindlessLayoutInfo.pBindings = bindlessBindings.data();
+
+		bindless_set_layout = context->primary_logical_device.createDescriptorSetLayout(bindlessLayoutInfo);
+
+		if (!bindless_set_layout) {
+			LOG_ERROR("Failed to create bindless set layout, continuing without bindless textures");
+			use_bindless_textures = false;
+		}
+	}
+
 	/*
 	* Field blending context init
 	*/
 
-	field_composer = std::make_unique<ElasticFieldComposer>(context, &render_swapchain);
+	field_composer = std::make_unique<ElasticFieldComposer>(context, in_flight_frames.size());
+
+	/*
+	* Job system init
+	*/
+
+	job_system.init(settings.worker_threads);
+	bake_job_system.init(settings.bake_threads != 0 ? settings.bake_threads : std::max<size_t>(std::thread::hardware_concurrency() / 2, 1), true);
+
+	/*
+	* Background streaming init
+	*/
+
+	if (streamer.init(context, settings.streaming_threads) != AssetStreamer::Error::OK) {
+		LOG_ERROR("Failed to initialize asset streaming");
+		return;
+	}
+
+	/*
+	* GPU profiler init
+	*/
+
+	if (settings.enable_profiling) {
+		GpuProfiler::Error profilerError = profiler.init(context, in_flight_frames.size());
+
+		if (profilerError != GpuProfiler::Error::OK) {
+			LOG_ERROR("Failed to initialize GPU profiler, continuing without profiling");
+		}
+
+		profiler.set_per_mesh(settings.profile_per_mesh);
+	}
 
 	/*
 	* Finish initialization
 	*/
 
+	// Scenes are rebuilt as models stream in, and culling may be dropped for one of them
+	frustum_culling_available = use_frustum_culling;
+
 	is_init = true;
 }
 
 RendererImpl::~RendererImpl() {
 	if (is_initialized()) {
+		// Meshes still uploading are adopted so they're freed with the rest
+		streamer.wait();
+
+		for (auto& streamed : uploading_models) {
+			for (auto& d : streamed->digested) {
+				if (auto* mesh = std::get_if<InternalMesh>(&d)) {
+					meshes.push_back(*mesh);
+				}
+				else {
+					add_skeletal_mesh(std::get<DigestedSkeletalMesh>(d));
+				}
+			}
+		}
+
+		uploading_models.clear();
+
+		streamer.deinit();
+
+		context->flush_uploads();
 		context->primary_logical_device.waitIdle();
 
 		context->primary_logical_device.destroy(texture_sampler);
@@ -143,45 +459,92 @@ RendererImpl::~RendererImpl() {
 
 		for (auto& mesh : meshes) {
 			context->destroy_buffer(mesh.vertex_buffer);
-			context->destroy_buffer(mesh.index_buffer);
+
+			if (!mesh.index_source.has_value()) {
+				context->destroy_buffer(mesh.index_buffer);
+			}
+		}
+
+		context->destroy_buffer(geometry_vertex_buffer);
+		context->destroy_buffer(geometry_index_buffer);
+		context->destroy_buffer(indirect_command_buffer);
+
+		context->destroy_buffer(mesh_bounds_buffer);
+		context->destroy_buffer(command_groups_buffer);
+		context->destroy_buffer(skinning_dispatch_buffer);
+
+		context->destroy_buffer(material_buffer);
+		context->destroy_buffer(material_index_buffer);
+
+		context->destroy_buffer(animation_skeleton_buffer);
+		context->destroy_buffer(animation_rest_bone_buffer);
+		context->destroy_buffer(animation_hierarchy_buffer);
+		context->destroy_buffer(animation_clip_buffer);
+		context->destroy_buffer(animation_track_buffer);
+		context->destroy_buffer(animation_key_buffer);
+		context->destroy_buffer(animation_bounds_buffer);
+
+		for (auto& frame : in_flight_frames) {
+			context->destroy_buffer(frame.culled_command_buffer);
+			context->destroy_buffer(frame.draw_count_buffer);
+			context->destroy_buffer(frame.dispatch_args_buffer);
+			context->destroy_buffer(frame.composed_generation_buffer);
+			context->destroy_buffer(frame.animated_bone_buffer);
 		}
 
 		for (auto& mesh : skeletal_meshes) {
-			context->destroy_buffer(mesh.vertex_source_buffer);
+			if (mesh.owns_source_data) {
+				context->destroy_buffer(mesh.vertex_source_buffer);
 
-			context->destroy_image_view(mesh.rest_isogradfield.view);
-			context->destroy_texture(mesh.rest_isogradfield.texture);
+				context->destroy_image_view(mesh.rest_isogradfield.view);
+				context->destroy_texture(mesh.rest_isogradfield.texture);
 
-			for (auto& f : mesh.part_isogradfields) {
-				context->destroy_image_view(f.view);
-				context->destroy_texture(f.texture);
+				for (auto& f : mesh.part_isogradfields) {
+					context->destroy_image_view(f.view);
+					context->destroy_texture(f.texture);
+				}
 			}
 
 			for (auto& buf : mesh.vertex_out_buffers) {
 				context->destroy_buffer(buf);
 			}
 
-			for (auto& buf : mesh.sampled_bone_buffers) {
-				context->destroy_buffer(buf);
-			}
-
 			for (auto& f : mesh.transformed_isogradfields) {
 				context->destroy_image_view(f.view);
 				context->destroy_texture(f.texture);
 			}
+
+			context->destroy_buffer(mesh.vertex_cache_block_buffer);
+			context->destroy_buffer(mesh.vertex_cache_data_buffer);
 		}
 
 		field_composer.reset(nullptr);
 
+		profiler.deinit();
+
+		frame_data_ring.deinit();
+
 		context->primary_logical_device.destroy(command_pool);
 
+		for (auto& thread : recording_threads) {
+			context->primary_logical_device.destroy(thread.command_pool);
+			context->primary_logical_device.destroy(thread.draw_command_pool);
+		}
+
 		skinning_pipeline.deinit();
+		cull_pipeline.deinit();
+		animation_pipeline.deinit();
+		vertex_cache_pipeline.deinit();
 
 		for (auto& pipeline : pipelines) {
 			pipeline.second.deinit();
 		}
+
+		context->primary_logical_device.destroy(bindless_set_layout);
 		
 		destroy_render_state();
+
+		context->primary_logical_device.destroy(geometry_render_pass);
 	}
 
 	is_init = false;
@@ -199,14 +562,24 @@ RendererImpl::Error RendererImpl::register_pipeline_impl(StringHash Name, GfxPip
 	pipelines.emplace(Name, std::move(Pipeline));
 	pipelines[Name].deinit();
 
+	if (pipelines[Name].bindless_textures) {
+		if (!use_bindless_textures) {
+			LOG_ERROR("Pipeline uses bindless textures, which are disabled or unsupported");
+			pipelines.erase(Name);
+			return Error::BINDLESS_UNSUPPORTED;
+		}
+
+		pipelines[Name].bindless_set_layout = bindless_set_layout;
+	}
+
 	GfxPipelineImpl::Error pipelineError;
 
 	switch(pipelines[Name].target) {
 	case RenderTarget::Swapchain:
-		pipelineError = pipelines[Name].init(context, &render_swapchain.extent, &geometry_render_pass, color_subpass);
+		pipelineError = pipelines[Name].init(context, &geometry_render_pass, color_subpass);
 		break;
 	case RenderTarget::DepthBuffer:
-		pipelineError = pipelines[Name].init(context, &render_swapchain.extent, &geometry_render_pass, depth_subpass);
+		pipelineError = pipelines[Name].init(context, &geometry_render_pass, depth_subpass);
 	default:
 		return Error::PIPELINE_HAS_UNSUPPORTED_RENDER_TARGET;
 		break;
@@ -229,6 +602,10 @@ RendererImpl::Error RendererImpl::register_pipeline_impl(StringHash Name, GfxPip
 		LOG_ERROR("Pipeline was given no shaders");
 		return Error::PIPELINE_INIT_ERROR;
 		break;
+	case GfxPipelineImpl::Error::NO_BINDLESS_LAYOUT:
+		LOG_ERROR("Pipeline was given no bindless set layout");
+		return Error::PIPELINE_INIT_ERROR;
+		break;
 	case GfxPipelineImpl::Error::FAIL_CREATE_DESCRIPTOR_SET_LAYOUT:
 		LOG_ERROR("Failed to create descriptor set layout");
 		return Error::PIPELINE_INIT_ERROR;
@@ -323,7 +700,7 @@ RendererImpl::Error RendererImpl::register_texture(StringHash Name, const Image&
 	TextureAllocation texture = context->create_texture_2d({
 		static_cast<uint32_t>(Image.width),
 		static_cast<uint32_t>(Image.height)
-	});
+	}, MemoryCategory::Textures);
 	context->upload_texture(texture, Image);
 
 	vk::ImageViewCreateInfo viewInfo;
@@ -354,6 +731,65 @@ RendererImpl::Error RendererImpl::set_default_texture(const Image& Image) {
 }
 
 Retval<MeshId, RendererImpl::Error> RendererImpl::digest_mesh(Mesh& Mesh, ModelTransform* Transform) {
+	auto [digestedMesh, error] = create_mesh_resources(Mesh, Transform, false);
+
+	if (error != Error::OK) {
+		return { {}, error };
+	}
+
+	meshes.push_back(digestedMesh);
+	is_scene_dirty = true;
+
+	return { static_cast<MeshId>(meshes.size() - 1), Error::OK };
+}
+
+Retval<MeshId, RendererImpl::Error> RendererImpl::digest_mesh(SkeletalMesh& Mesh, Skeleton* Skeleton, ModelTransform* Transform) {
+	BakedSkeletalMesh baked = bake_skeletal_mesh(Mesh, *Skeleton, job_system);
+
+	auto [digested, error] = create_skeletal_mesh_resources(baked, Skeleton, Transform, false);
+
+	if (error != Error::OK) {
+		return { {}, error };
+	}
+
+	return { add_skeletal_mesh(digested), Error::OK };
+}
+
+Retval<MeshId, RendererImpl::Error> RendererImpl::digest_mesh(const FieldAsset& Baked, const SkeletalMesh& Source, Skeleton* Skeleton, ModelTransform* Transform) {
+	if (!is_field_asset_compatible(Baked, Source, *Skeleton)) {
+		return { {}, Error::FIELD_ASSET_MISMATCH };
+	}
+
+	auto [digested, error] = create_skeletal_mesh_resources(Baked, Skeleton, Transform, false);
+
+	if (error != Error::OK) {
+		return { {}, error };
+	}
+
+	return { add_skeletal_mesh(digested), Error::OK };
+}
+
+RendererImpl::BakedSkeletalMesh RendererImpl::bake_skeletal_mesh(const SkeletalMesh& Mesh, Skeleton& Skeleton, JobSystem& Jobs) {
+	return bake_field_asset(Mesh, Skeleton, Jobs);
+}
+
+bool RendererImpl::is_field_asset_compatible(const FieldAsset& Baked, const SkeletalMesh& Source, const Skeleton& Skeleton) {
+	if (Baked.part_fields.size() != Skeleton.bones.size() || Baked.mesh.vertices.empty() || Baked.rest_field.empty()) {
+		return false;
+	}
+
+	// The model was edited after the asset was baked
+	if (Baked.source_hash != hash_field_asset_source(Source, Skeleton)) {
+		return false;
+	}
+
+	// Vertices are skinned by the part field of their bone
+	return std::all_of(Baked.mesh.vertices.begin(), Baked.mesh.vertices.end(), [&Skeleton](const ElasticVertex& v) {
+		return v.bone < Skeleton.bones.size();
+	});
+}
+
+Retval<RendererImpl::InternalMesh, RendererImpl::Error> RendererImpl::create_mesh_resources(const Mesh& Mesh, ModelTransform* Transform, bool Streamed) {
 	StringHash MaterialHash = Mesh.material_name.empty() ? DEFAULT_MATERIAL_NAME : CRC::crc64(Mesh.material_name);
 
 	if (!materials.contains(MaterialHash)) {
@@ -370,34 +806,35 @@ Retval<MeshId, RendererImpl::Error> RendererImpl::digest_mesh(Mesh& Mesh, ModelT
 	digestedMesh.vertex_count = Mesh.vertices.size();
 	digestedMesh.index_count = Mesh.indices.size();
 
+	digestedMesh.bounding_sphere = GpuCulling::compute_bounding_sphere(Mesh.vertices);
+
 	/*
-	* Create and allocate GPU buffer for vertices
+	* Create and allocate GPU buffer for the vertex streams
 	*/
-	size_t vertexMemorySize = sizeof(Vertex) * Mesh.vertices.size();
+	std::vector<uint8_t> vertexStreams = VertexStreams::pack(Mesh.vertices);
 
-	digestedMesh.vertex_buffer = context->create_vertex_buffer(vertexMemorySize);
+	digestedMesh.vertex_buffer = context->create_vertex_buffer(vertexStreams.size(), MemoryCategory::Meshes);
 
 	/*
 	* Create and allocate GPU buffer for indices
 	*/
 	size_t indexMemorySize = sizeof(uint32_t) * Mesh.indices.size();
 
-	digestedMesh.index_buffer = context->create_index_buffer(indexMemorySize);
+	digestedMesh.index_buffer = context->create_index_buffer(indexMemorySize, MemoryCategory::Meshes);
 
 	/*
 	* Upload data to GPU
 	*/
-	context->upload_to_gpu_buffer(digestedMesh.vertex_buffer, Mesh.vertices.data(), vertexMemorySize);
-	context->upload_to_gpu_buffer(digestedMesh.index_buffer, Mesh.indices.data(), indexMemorySize);
+	upload_mesh_data(digestedMesh.vertex_buffer, vertexStreams.data(), vertexStreams.size(), Streamed);
+	upload_mesh_data(digestedMesh.index_buffer, Mesh.indices.data(), indexMemorySize, Streamed);
 
-	mesh_transforms.push_back(Transform);
-	meshes.push_back(digestedMesh);
+	digestedMesh.instance_transforms.push_back(Transform);
 
-	return { static_cast<MeshId>(meshes.size() - 1), Error::OK };
+	return { digestedMesh, Error::OK };
 }
 
-Retval<MeshId, RendererImpl::Error> RendererImpl::digest_mesh(SkeletalMesh& Mesh, Skeleton* Skeleton, ModelTransform* Transform) {
-	StringHash MaterialHash = Mesh.material_name.empty() ? DEFAULT_MATERIAL_NAME : CRC::crc64(Mesh.material_name);
+Retval<RendererImpl::DigestedSkeletalMesh, RendererImpl::Error> RendererImpl::create_skeletal_mesh_resources(const BakedSkeletalMesh& Baked, Skeleton* Skeleton, ModelTransform* Transform, bool Streamed) {
+	StringHash MaterialHash = Baked.material_name.empty() ? DEFAULT_MATERIAL_NAME : CRC::crc64(Baked.material_name);
 
 	if (!materials.contains(MaterialHash)) {
 		return { {}, RendererImpl::Error::MATERIAL_NOT_FOUND };
@@ -405,179 +842,477 @@ Retval<MeshId, RendererImpl::Error> RendererImpl::digest_mesh(SkeletalMesh& Mesh
 
 	InternalMaterial& material = materials[MaterialHash];
 
-	InternalMesh digestedMesh;
+	DigestedSkeletalMesh ret;
+
+	/*
+	* Skinned output mesh
+	*/
+	InternalMesh& digestedMesh = ret.mesh;
 	digestedMesh.pipeline_hash = material.pipeline_name;
 	digestedMesh.depth_pipeline_hash = hash_combine(digestedMesh.pipeline_hash, RendererImpl::DEPTH_PIPELINE_NAME);
 	digestedMesh.material_hash = MaterialHash;
 
-	digestedMesh.vertex_count = Mesh.vertices.size();
-	digestedMesh.index_count = Mesh.indices.size();
+	digestedMesh.vertex_count = Baked.mesh.vertices.size();
+	digestedMesh.index_count = Baked.mesh.indices.size();
+
+	// Skinned vertices are projected onto the field, which bounds them in every pose
+	digestedMesh.bounding_sphere = GpuCulling::compute_field_bounding_sphere(Baked.field_scale);
 
 	/*
-	* Create and allocate GPU buffer for vertices
+	* Create and allocate GPU buffer for the vertex streams, written by skinning
 	*/
-	size_t vertexMemorySize = sizeof(Vertex) * Mesh.vertices.size();
-
-	digestedMesh.vertex_buffer = context->create_vertex_buffer(vertexMemorySize);
+	digestedMesh.vertex_buffer = context->create_vertex_buffer(VertexStreams::size(Baked.mesh.vertices.size()), MemoryCategory::Meshes);
 
 	/*
 	* Create and allocate GPU buffer for indices
 	*/
-	size_t indexMemorySize = sizeof(uint32_t) * Mesh.indices.size();
-
-	digestedMesh.index_buffer = context->create_index_buffer(indexMemorySize);
-
-	mesh_transforms.push_back(Transform);
-	meshes.push_back(digestedMesh);
+	size_t indexMemorySize = sizeof(uint32_t) * Baked.mesh.indices.size();
 
-	MeshId staticMeshId = static_cast<MeshId>(meshes.size() - 1);
+	digestedMesh.index_buffer = context->create_index_buffer(indexMemorySize, MemoryCategory::Meshes);
 
+	digestedMesh.instance_transforms.push_back(Transform);
 
 	/*
 	* Prepare source mesh to transform from
 	*/
-	InternalSkeletalMesh digestedSkeletalMesh;
-	
+	InternalSkeletalMesh& digestedSkeletalMesh = ret.skeletal_mesh;
+
 	digestedSkeletalMesh.skeleton = Skeleton;
-	digestedSkeletalMesh.vertex_count = Mesh.vertices.size();
-	digestedSkeletalMesh.out_mesh_id = staticMeshId;
+	digestedSkeletalMesh.vertex_count = Baked.mesh.vertices.size();
 
 	/*
 	* Create and allocate GPU buffer for skeletal vertices
 	*/
-	size_t skelVertexMemorySize = sizeof(ElasticVertex) * Mesh.vertices.size();
+	size_t skelVertexMemorySize = sizeof(ElasticVertex) * Baked.mesh.vertices.size();
+
+	digestedSkeletalMesh.vertex_source_buffer = context->create_gpu_storage_buffer(skelVertexMemorySize, MemoryCategory::Meshes);
 
-	digestedSkeletalMesh.vertex_source_buffer = context->create_gpu_storage_buffer(skelVertexMemorySize);
-	
 	/*
-	* Create per frame vertex output buffers
+	* Create rest and part fields
 	*/
-	digestedSkeletalMesh.vertex_out_buffers.resize(render_swapchain.size());
+	vk::Extent3D fieldExtent{ Baked.field_dims.x, Baked.field_dims.y, Baked.field_dims.z };
 
-	for (auto& buf : digestedSkeletalMesh.vertex_out_buffers) {
-		buf = context->create_gpu_storage_buffer(vertexMemorySize);
-	}
+	digestedSkeletalMesh.rest_isogradfield.texture = context->create_texture_3d(fieldExtent, MemoryCategory::PartFields, vk::Format::eR32G32B32A32Sfloat);
+	digestedSkeletalMesh.rest_isogradfield.view = context->create_image_view(digestedSkeletalMesh.rest_isogradfield.texture, vk::ImageViewType::e3D);
 
-	/*
-	* Create per frame buffers for bone states
-	*/
-	size_t bonesMemorySize = Skeleton->bones.size() * sizeof(Bone);
-	digestedSkeletalMesh.sampled_bone_buffers.resize(render_swapchain.size());
+	digestedSkeletalMesh.part_isogradfields.resize(Skeleton->bones.size());
 
-	for (auto& buf : digestedSkeletalMesh.sampled_bone_buffers) {
-		buf = context->create_storage_buffer(bonesMemorySize);
+	for (auto& f : digestedSkeletalMesh.part_isogradfields) {
+		f.texture = context->create_texture_3d(fieldExtent, MemoryCategory::PartFields, vk::Format::eR32G32B32A32Sfloat);
+		f.view = context->create_image_view(f.texture, vk::ImageViewType::e3D);
 	}
 
+	create_skeletal_frame_data(digestedSkeletalMesh);
+
+	digestedSkeletalMesh.field_dims = glm::ivec3(Baked.field_dims);
+	digestedSkeletalMesh.isofield_scale = Baked.field_scale;
+
 	/*
-	* Convert geometric skeletal mesh to elastic skeletal mesh
+	* Upload data to GPU
 	*/
-	auto parts = ElasticSkinning::partition_skeletal_mesh(Mesh, *Skeleton);
-	auto hrbf_data = ElasticSkinning::create_hrbf_data(parts);
-	auto whole = ElasticSkinning::compose_hrbfs(hrbf_data, parts);
+	upload_mesh_data(digestedSkeletalMesh.vertex_source_buffer, Baked.mesh.vertices.data(), skelVertexMemorySize, Streamed);
+	upload_mesh_data(digestedMesh.index_buffer, Baked.mesh.indices.data(), indexMemorySize, Streamed);
 
-	ElasticSkinning::create_debug_csv(hrbf_data, "debug/parts");
-	ElasticSkinning::create_debug_csv(whole, "debug/whole");
+	upload_field_data(digestedSkeletalMesh.rest_isogradfield.texture, Baked.rest_field.data(), Baked.rest_field.size() * sizeof(glm::vec4), Streamed);
 
-	ElasticSkinning::MeshAndField elasticMesh = ElasticSkinning::convert_skeletal_mesh(Mesh, *Skeleton);
+	for (size_t i = 0; i < Baked.part_fields.size(); i++) {
+		upload_field_data(digestedSkeletalMesh.part_isogradfields[i].texture, Baked.part_fields[i].data(), Baked.part_fields[i].size() * sizeof(glm::vec4), Streamed);
+	}
 
-	digestedSkeletalMesh.rest_isogradfield.texture = context->create_texture_3d(
-		{
-			elasticMesh.rest_field.Width,
-			elasticMesh.rest_field.Height,
-			elasticMesh.rest_field.Depth
-		},
-		vk::Format::eR32G32B32A32Sfloat
-	);
+	return { ret, Error::OK };
+}
 
-	digestedSkeletalMesh.rest_isogradfield.view = context->create_image_view(digestedSkeletalMesh.rest_isogradfield.texture, vk::ImageViewType::e3D);
+MeshId RendererImpl::add_skeletal_mesh(DigestedSkeletalMesh& Digested) {
+	meshes.push_back(Digested.mesh);
 
+	Digested.skeletal_mesh.out_mesh_id = static_cast<MeshId>(meshes.size() - 1);
+	skeletal_meshes.push_back(Digested.skeletal_mesh);
 
-	digestedSkeletalMesh.part_isogradfields.resize(Skeleton->bones.size());
+	is_scene_dirty = true;
 
-	for (size_t i = 0; i < Skeleton->bones.size(); i++) {
-		digestedSkeletalMesh.part_isogradfields[i].texture = context->create_texture_3d(
-			{
-				elasticMesh.rest_field.Width,
-				elasticMesh.rest_field.Height,
-				elasticMesh.rest_field.Depth
-			},
-			vk::Format::eR32G32B32A32Sfloat
-		);
+	return Digested.skeletal_mesh.out_mesh_id;
+}
 
-		digestedSkeletalMesh.part_isogradfields[i].view = context->create_image_view(digestedSkeletalMesh.part_isogradfields[i].texture, vk::ImageViewType::e3D);
+void RendererImpl::upload_mesh_data(BufferAllocation Dest, const void* Source, size_t Size, bool Streamed) {
+	if (Streamed) {
+		streamer.upload_buffer(Dest, Source, Size);
 	}
-
-	digestedSkeletalMesh.transformed_isogradfields.resize(render_swapchain.size());
-
-	for (auto& f : digestedSkeletalMesh.transformed_isogradfields) {
-		f.texture = context->create_texture_3d(
-			{
-				elasticMesh.rest_field.Width,
-				elasticMesh.rest_field.Height,
-				elasticMesh.rest_field.Depth
-			},
-			vk::Format::eR32G32B32A32Sfloat
-		);
-
-		context->transition_image_layout(f.texture, f.texture.format, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
-
-		f.view = context->create_image_view(f.texture, vk::ImageViewType::e3D);
+	else {
+		context->upload_to_gpu_buffer(Dest, Source, Size);
 	}
+}
 
-	digestedSkeletalMesh.field_dims = glm::ivec3{ elasticMesh.rest_field.Width, elasticMesh.rest_field.Height, elasticMesh.rest_field.Depth };
-	digestedSkeletalMesh.isofield_scale = elasticMesh.rest_field.Scale;
+void RendererImpl::upload_field_data(TextureAllocation Dest, const void* Source, size_t Size, bool Streamed) {
+	// Fields are sampled and written by the skinning kernels, which expect the general layout
+	if (Streamed) {
+		streamer.upload_texture(Dest, Source, Size, vk::ImageLayout::eGeneral);
+	}
+	else if (Size > 0) {
+		context->upload_texture(Dest, Source, Size, vk::ImageLayout::eGeneral);
+	}
+	else {
+		context->transition_image_layout(Dest, Dest.format, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
+	}
+}
+
+Retval<ModelId, RendererImpl::Error> RendererImpl::digest_model(Model& Model, ModelTransform* Transform, const std::vector<std::optional<FieldAsset>>& Baked) {
+	for (auto& material : Model.materials) {
+		register_material(material);
+	}
+
+	std::vector<MeshId> digestedMeshes;
+
+	for (size_t i = 0; i < Model.meshes.size(); i++) {
+		auto* meshptr = std::get_if<Mesh>(&Model.meshes[i]);
+		auto* skelmeshptr = std::get_if<SkeletalMesh>(&Model.meshes[i]);
+
+		if (meshptr != nullptr) {
+			auto [meshId, error] = digest_mesh(*meshptr, Transform);
+
+			if (error == Error::OK) {
+				digestedMeshes.push_back(meshId);
+			}
+		}
+		else if (skelmeshptr != nullptr) {
+			Retval<MeshId, Error> digested{ {}, Error::FIELD_ASSET_MISMATCH };
+
+			if (i < Baked.size() && Baked[i].has_value()) {
+				digested = digest_mesh(Baked[i].value(), *skelmeshptr, &Model.skeleton, Transform);
+
+				if (digested.status == Error::FIELD_ASSET_MISMATCH) {
+					LOG_ERROR("Field asset of mesh %zu is stale or doesn't match the skeleton, baking it instead", i);
+				}
+			}
+
+			if (digested.status == Error::FIELD_ASSET_MISMATCH) {
+				digested = digest_mesh(*skelmeshptr, &Model.skeleton, Transform);
+			}
+
+			auto [meshId, error] = digested;
+
+			if (error == Error::OK) {
+				digestedMeshes.push_back(meshId);
+			}
+		}
+	}
+
+	model_meshes.push_back(digestedMeshes);
+
+	return { static_cast<ModelId>(model_meshes.size() - 1), Error::OK };
+}
+
+Retval<ModelId, RendererImpl::Error> RendererImpl::stream_model(const std::filesystem::path& Path, ModelTransform* Transform, const std::filesystem::path& FieldDirectory) {
+	// The id is handed out now, its meshes are filled in once resident
+	model_meshes.push_back({});
+
+	auto streamed = std::make_shared<StreamedModel>();
+	streamed->id = static_cast<ModelId>(model_meshes.size() - 1);
+	streamed->transform = Transform;
+	streamed->path = Path;
+	streamed->field_directory = FieldDirectory;
+
+	pending_models.insert(streamed->id);
+
+	streamer.enqueue([this, streamed]() {
+		auto [model, error] = load_model(streamed->path);
+
+		if (error != AssetError::OK) {
+			streamed->failed = true;
+		}
+		else {
+			streamed->model = std::make_unique<Model>(std::move(model));
+			streamed->baked_meshes.resize(streamed->model->meshes.size());
+
+			if (!streamed->field_directory.empty()) {
+				streamed->baked_meshes = load_field_assets(streamed->field_directory, streamed->path, streamed->model->meshes.size());
+			}
+
+			for (size_t i = 0; i < streamed->model->meshes.size(); i++) {
+				auto* skelmeshptr = std::get_if<SkeletalMesh>(&streamed->model->meshes[i]);
+				auto& baked = streamed->baked_meshes[i];
+
+				if (skelmeshptr == nullptr) {
+					baked.reset();
+				}
+				// Saved assets baked from another version of the model are baked again
+				else if (!baked.has_value() || !is_field_asset_compatible(baked.value(), *skelmeshptr, streamed->model->skeleton)) {
+					baked = bake_skeletal_mesh(*skelmeshptr, streamed->model->skeleton, bake_job_system);
+				}
+			}
+		}
+
+		std::scoped_lock lock(baked_models_mutex);
+		baked_models.push_back(streamed);
+	});
+
+	return { streamed->id, Error::OK };
+}
+
+bool RendererImpl::is_model_ready(ModelId Model) {
+	return Model < model_meshes.size() && !pending_models.contains(Model);
+}
+
+Skeleton* RendererImpl::get_model_skeleton(ModelId Model) {
+	auto it = streamed_models.find(Model);
+
+	if (it == streamed_models.end() || !it->second) {
+		return nullptr;
+	}
+
+	return &it->second->skeleton;
+}
+
+void RendererImpl::update_streaming() {
+	std::vector<std::shared_ptr<StreamedModel>> baked;
+
+	{
+		std::scoped_lock lock(baked_models_mutex);
+		baked.swap(baked_models);
+	}
 
 	/*
-	* Upload data to GPU
+	* Create the resources of freshly baked models, and submit their uploads together
+	*/
+	for (auto& streamed : baked) {
+		if (streamed->failed) {
+			LOG_ERROR("Failed to stream model %s", streamed->path.string().c_str());
+			pending_models.erase(streamed->id);
+			continue;
+		}
+
+		for (auto& material : streamed->model->materials) {
+			register_material(material);
+		}
+
+		for (size_t i = 0; i < streamed->model->meshes.size(); i++) {
+			auto* meshptr = std::get_if<Mesh>(&streamed->model->meshes[i]);
+
+			if (meshptr != nullptr) {
+				auto [digestedMesh, error] = create_mesh_resources(*meshptr, streamed->transform, true);
+
+				if (error == Error::OK) {
+					streamed->digested.push_back(digestedMesh);
+				}
+			}
+			else if (streamed->baked_meshes[i].has_value()) {
+				auto [digested, error] = create_skeletal_mesh_resources(streamed->baked_meshes[i].value(), &streamed->model->skeleton, streamed->transform, true);
+
+				if (error == Error::OK) {
+					streamed->digested.push_back(digested);
+				}
+			}
+		}
+
+		// Host copies are no longer needed once they're staged
+		streamed->model->meshes.clear();
+		streamed->baked_meshes.clear();
+
+		uploading_models.push_back(streamed);
+	}
+
+	if (!baked.empty()) {
+		AssetStreamer::Ticket ticket = streamer.submit();
+
+		for (auto& streamed : baked) {
+			streamed->ticket = ticket;
+		}
+	}
+
+	/*
+	* Add the models whose uploads executed to the scene
 	*/
-	auto restSkeleton = Skeleton->sample_animation_frame();
+	for (auto it = uploading_models.begin(); it != uploading_models.end();) {
+		StreamedModel& streamed = **it;
+
+		if (!streamer.is_resident(streamed.ticket)) {
+			++it;
+			continue;
+		}
+
+		std::vector<MeshId> digestedMeshes;
+
+		for (auto& d : streamed.digested) {
+			if (auto* mesh = std::get_if<InternalMesh>(&d)) {
+				meshes.push_back(*mesh);
+				digestedMeshes.push_back(static_cast<MeshId>(meshes.size() - 1));
+			}
+			else {
+				digestedMeshes.push_back(add_skeletal_mesh(std::get<DigestedSkeletalMesh>(d)));
+			}
+		}
+
+		model_meshes[streamed.id] = digestedMeshes;
+		streamed_models[streamed.id] = std::move(streamed.model);
+		pending_models.erase(streamed.id);
 
-	for (auto& b : restSkeleton) {
-		b.position = -b.position;
-		b.rotation = glm::inverse(b.rotation);
-		b.scale = 1.0f / b.scale;
+		is_scene_dirty = true;
+
+		it = uploading_models.erase(it);
 	}
+}
 
-	context->upload_to_gpu_buffer(digestedSkeletalMesh.vertex_source_buffer, elasticMesh.mesh.vertices.data(), skelVertexMemorySize);
-	context->upload_to_gpu_buffer(digestedMesh.index_buffer, elasticMesh.mesh.indices.data(), indexMemorySize);
+Retval<InstanceId, RendererImpl::Error> RendererImpl::create_instance(MeshId Mesh, ModelTransform* Transform) {
+	if (Mesh >= meshes.size()) {
+		return { {}, Error::MESH_NOT_FOUND };
+	}
 
-	ElasticSkinning::ScalarVectorField3D combinedRestField = ElasticSkinning::combine_fields(elasticMesh.rest_field.isofield, elasticMesh.rest_field.gradients);
+	meshes[Mesh].instance_transforms.push_back(Transform);
+	is_scene_dirty = true;
 
-	context->upload_texture(digestedSkeletalMesh.rest_isogradfield.texture, combinedRestField.values.data(), combinedRestField.values.size() * sizeof(glm::vec4));
-	context->transition_image_layout(digestedSkeletalMesh.rest_isogradfield.texture, digestedSkeletalMesh.rest_isogradfield.texture.format, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
+	return { static_cast<InstanceId>(meshes[Mesh].instance_transforms.size() - 1), Error::OK };
+}
 
-	for (auto& [boneName, field] : elasticMesh.part_fields) {
-		auto [idx, e] = Skeleton->get_bone_index(boneName);
+Retval<MeshId, RendererImpl::Error> RendererImpl::create_skeletal_instance(MeshId Mesh, Skeleton* Skeleton, ModelTransform* Transform) {
+	auto source = std::find_if(skeletal_meshes.begin(), skeletal_meshes.end(), [Mesh](const InternalSkeletalMesh& m) {
+		return m.out_mesh_id == Mesh;
+	});
 
-		ElasticSkinning::ScalarVectorField3D combinedField = ElasticSkinning::combine_fields(field.isofield, field.gradients);
+	if (source == skeletal_meshes.end()) {
+		return { {}, Error::MESH_NOT_SKELETAL };
+	}
 
-		context->upload_texture(digestedSkeletalMesh.part_isogradfields[idx].texture, combinedField.values.data(), combinedField.values.size() * sizeof(glm::vec4));
-		context->transition_image_layout(digestedSkeletalMesh.part_isogradfields[idx].texture, digestedSkeletalMesh.part_isogradfields[idx].texture.format, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
+	if (Skeleton == nullptr || Skeleton->bones.size() != source->skeleton->bones.size()) {
+		return { {}, Error::SKELETON_MISMATCH };
 	}
 
-	skeletal_meshes.push_back(digestedSkeletalMesh);
+	/*
+	* Skinned output mesh, drawn with the indices of the source mesh
+	*/
+	const InternalMesh& sourceMesh = meshes[Mesh];
+
+	InternalMesh instanceMesh;
+	instanceMesh.pipeline_hash = sourceMesh.pipeline_hash;
+	instanceMesh.depth_pipeline_hash = sourceMesh.depth_pipeline_hash;
+	instanceMesh.material_hash = sourceMesh.material_hash;
+
+	instanceMesh.vertex_count = sourceMesh.vertex_count;
+	instanceMesh.index_count = sourceMesh.index_count;
+	instanceMesh.bounding_sphere = sourceMesh.bounding_sphere;
+
+	instanceMesh.index_source = sourceMesh.index_source.value_or(Mesh);
+	instanceMesh.index_buffer = meshes[instanceMesh.index_source.value()].index_buffer;
+
+	instanceMesh.vertex_buffer = context->create_vertex_buffer(VertexStreams::size(instanceMesh.vertex_count), MemoryCategory::Meshes);
+
+	instanceMesh.instance_transforms.push_back(Transform);
+
+	/*
+	* Share the read only source vertices and fields
+	*/
+	InternalSkeletalMesh instanceSkeletalMesh;
+
+	instanceSkeletalMesh.vertex_source_buffer = source->vertex_source_buffer;
+	instanceSkeletalMesh.rest_isogradfield = source->rest_isogradfield;
+	instanceSkeletalMesh.part_isogradfields = source->part_isogradfields;
+	instanceSkeletalMesh.owns_source_data = false;
+
+	instanceSkeletalMesh.skeleton = Skeleton;
+	instanceSkeletalMesh.vertex_count = source->vertex_count;
+	instanceSkeletalMesh.field_dims = source->field_dims;
+	instanceSkeletalMesh.isofield_scale = source->isofield_scale;
+
+	create_skeletal_frame_data(instanceSkeletalMesh);
+
+	meshes.push_back(instanceMesh);
 
-	return { staticMeshId, Error::OK };
+	instanceSkeletalMesh.out_mesh_id = static_cast<MeshId>(meshes.size() - 1);
+
+	skeletal_meshes.push_back(instanceSkeletalMesh);
+	is_scene_dirty = true;
+
+	return { instanceSkeletalMesh.out_mesh_id, Error::OK };
 }
 
-Retval<ModelId, RendererImpl::Error> RendererImpl::digest_model(Model& Model, ModelTransform* Transform) {
-	for (auto& material : Model.materials) {
-		register_material(material);
+Retval<ModelId, RendererImpl::Error> RendererImpl::create_model_instance(ModelId Model, ModelTransform* Transform, Skeleton* Skeleton) {
+	if (Model >= model_meshes.size()) {
+		return { {}, Error::MODEL_NOT_FOUND };
 	}
 
-	for (auto& mesh : Model.meshes) {
-		auto* meshptr = std::get_if<Mesh>(&mesh);
-		auto* skelmeshptr = std::get_if<SkeletalMesh>(&mesh);
+	if (pending_models.contains(Model)) {
+		return { {}, Error::MODEL_NOT_READY };
+	}
 
-		if (meshptr != nullptr) {
-			digest_mesh(*meshptr, Transform);
+	std::vector<MeshId> sourceMeshes = model_meshes[Model];
+	std::vector<MeshId> instanceMeshes;
+
+	for (MeshId meshId : sourceMeshes) {
+		bool isSkeletal = std::any_of(skeletal_meshes.begin(), skeletal_meshes.end(), [meshId](const InternalSkeletalMesh& m) {
+			return m.out_mesh_id == meshId;
+		});
+
+		if (isSkeletal && Skeleton != nullptr) {
+			auto [instanceMeshId, error] = create_skeletal_instance(meshId, Skeleton, Transform);
+
+			if (error != Error::OK) {
+				return { {}, error };
+			}
+
+			instanceMeshes.push_back(instanceMeshId);
 		}
-		else if (skelmeshptr != nullptr) {
-			digest_mesh(*skelmeshptr, &Model.skeleton, Transform);
+		else {
+			auto [instanceId, error] = create_instance(meshId, Transform);
+
+			if (error != Error::OK) {
+				return { {}, error };
+			}
+
+			instanceMeshes.push_back(meshId);
 		}
 	}
 
-	return { 0, Error::OK };
+	model_meshes.push_back(instanceMeshes);
+
+	return { static_cast<ModelId>(model_meshes.size() - 1), Error::OK };
+}
+
+RendererImpl::Error RendererImpl::bake_vertex_cache(MeshId Mesh, const std::string& Animation, float FrameRate, bool Loop) {
+	auto skelMesh = std::find_if(skeletal_meshes.begin(), skeletal_meshes.end(), [Mesh](const InternalSkeletalMesh& m) {
+		return m.out_mesh_id == Mesh;
+	});
+
+	if (skelMesh == skeletal_meshes.end()) {
+		return Mesh < meshes.size() ? Error::MESH_NOT_SKELETAL : Error::MESH_NOT_FOUND;
+	}
+
+	StringHash animationName = CRC::crc64(Animation);
+
+	if (skelMesh->skeleton->get_animation(animationName).status != Skeleton::Error::OK) {
+		return Error::ANIMATION_NOT_FOUND;
+	}
+
+	// Replaces any earlier cache once baked, the old one may still be in flight until then
+	skelMesh->vertex_cache_request = VertexCacheRequest{ animationName, std::max(FrameRate, 1.0f), Loop };
+	is_scene_dirty = true;
+
+	return Error::OK;
+}
+
+void RendererImpl::create_skeletal_frame_data(InternalSkeletalMesh& SkeletalMesh) {
+	/*
+	* Create per frame vertex output buffers
+	*/
+	SkeletalMesh.vertex_out_buffers.resize(settings.frames_in_flight);
+
+	for (auto& buf : SkeletalMesh.vertex_out_buffers) {
+		buf = context->create_gpu_storage_buffer(VertexStreams::size(SkeletalMesh.vertex_count), MemoryCategory::Meshes);
+	}
+
+	/*
+	* Create per frame transformed fields, matching the rest field
+	*/
+	SkeletalMesh.transformed_isogradfields.resize(settings.frames_in_flight);
+
+	for (auto& f : SkeletalMesh.transformed_isogradfields) {
+		f.texture = context->create_texture_3d(
+			SkeletalMesh.rest_isogradfield.texture.dimensions,
+			MemoryCategory::TransformedFields,
+			vk::Format::eR32G32B32A32Sfloat
+		);
+
+		context->transition_image_layout(f.texture, f.texture.format, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
+
+		f.view = context->create_image_view(f.texture, vk::ImageViewType::e3D);
+	}
 }
 
 void RendererImpl::set_camera(Camera* Camera) {
@@ -585,10 +1320,16 @@ void RendererImpl::set_camera(Camera* Camera) {
 }
 
 void RendererImpl::draw_frame() {
+	update_streaming();
+
 	if (is_first_render) {
 		finish_mesh_digestion();
 		record_command_buffers();
 		is_first_render = false;
+		is_scene_dirty = false;
+	}
+	else if (is_scene_dirty) {
+		rebuild_scene();
 	}
 
 	if (!should_render()) {
@@ -605,23 +1346,46 @@ void RendererImpl::draw_frame() {
 		LOG_ERROR("Swapchain is out of date");
 	}
 
-	update_frame_data(frame.value.id);
+	// The frame's fence has been waited on, so its previous timestamps are final
+	profiler.collect(frame.value.in_flight_id);
+
+	update_frame_data(frame.value.in_flight_id);
+
+	record_primary_command_buffer(frame.value);
+
+	context->flush_uploads();
 
 	vk::Semaphore waitSemaphores[] = { frame.value.image_available_semaphore };
 	vk::Semaphore signalSemaphores[] = { frame.value.render_finished_semaphore };
 	vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
 
+	// Offscreen frames have no presentation engine to synchronize with
+	uint32_t waitSemaphoreCount = frame.value.image_available_semaphore ? 1 : 0;
+	uint32_t signalSemaphoreCount = frame.value.render_finished_semaphore ? 1 : 0;
+
 	vk::SubmitInfo submitInfo;
-	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.waitSemaphoreCount = waitSemaphoreCount;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &primary_render_command_buffers[frame.value.id];
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pCommandBuffers = &in_flight_frames[frame.value.in_flight_id].primary_command_buffer;
+	submitInfo.signalSemaphoreCount = signalSemaphoreCount;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	context->present_queue.submit({ submitInfo }, frame.value.fence);
 
+	profiler.mark_submitted(frame.value.in_flight_id);
+
+	last_drawn_frame = frame.value.id;
+	submitted_frame_count++;
+
+	// Also lets the allocator refresh its heap budgets
+	vmaSetCurrentFrameIndex(context->allocator, static_cast<uint32_t>(submitted_frame_count));
+
+	if (settings.memory_log_interval != 0 && submitted_frame_count % settings.memory_log_interval == 0) {
+		context->log_memory_statistics();
+	}
+
 	if (render_swapchain.present_frame(frame.value) != Swapchain::Error::OK) {
 		LOG_ERROR("Swapchain presentation failure");
 	}
@@ -650,12 +1414,41 @@ void RendererImpl::draw_frame() {
 #endif
 }
 
+Retval<Image, RendererImpl::Error> RendererImpl::read_back_frame() {
+	if (!render_swapchain.is_offscreen()) {
+		return { {}, Error::NOT_OFFSCREEN };
+	}
+
+	if (!last_drawn_frame.has_value()) {
+		return { {}, Error::NO_FRAME_RENDERED };
+	}
+
+	context->primary_logical_device.waitIdle();
+
+	TextureAllocation& target = render_swapchain.offscreen_images[last_drawn_frame.value()];
+
+	Image ret;
+	ret.data = context->download_texture(target, vk::ImageLayout::eTransferSrcOptimal);
+	ret.width = target.dimensions.width;
+	ret.height = target.dimensions.height;
+	ret.channel_count = 4;
+
+	return { ret, Error::OK };
+}
+
 void RendererImpl::create_render_state() {
 	/*
 	* Create the swapchain
 	*/
 
-	auto swapchainError = render_swapchain.init(context);
+	Swapchain::Error swapchainError;
+
+	if (context->is_headless()) {
+		swapchainError = render_swapchain.init_offscreen(context, settings.offscreen_extent, settings.offscreen_image_count, settings.frames_in_flight);
+	}
+	else {
+		swapchainError = render_swapchain.init(context, settings.frames_in_flight);
+	}
 
 	if (swapchainError != Swapchain::Error::OK) {
 		switch (swapchainError) {
@@ -671,6 +1464,10 @@ void RendererImpl::create_render_state() {
 			LOG_ERROR("Failed to create swapchain");
 			return;
 			break;
+		case Swapchain::Error::FAIL_CREATE_OFFSCREEN_IMAGE:
+			LOG_ERROR("Failed to create offscreen render target");
+			return;
+			break;
 		case Swapchain::Error::FAIL_CREATE_IMAGE_VIEW:
 			LOG_ERROR("Failed to create swapchain image view");
 			return;
@@ -714,9 +1511,52 @@ void RendererImpl::create_render_state() {
 	}
 
 	/*
-	* Create render pass
+	* Create render pass, kept across resizes unless the surface format changes
+	*/
+
+	if (geometry_render_pass && render_pass_color_format != render_swapchain.format) {
+		context->primary_logical_device.destroy(geometry_render_pass);
+		geometry_render_pass = nullptr;
+	}
+
+	if (!geometry_render_pass) {
+		create_render_pass();
+
+		if (!geometry_render_pass) {
+			return;
+		}
+	}
+
+	/*
+	* Create framebuffers
 	*/
 
+	for (size_t i = 0; i < frames.size(); i++) {
+		std::vector<vk::ImageView> attachments{
+			frames[i].depthbuffer.view,
+			render_swapchain.image_views[i]
+		};
+
+		vk::FramebufferCreateInfo framebufferInfo;
+		framebufferInfo.renderPass = geometry_render_pass;
+		framebufferInfo.attachmentCount = attachments.size();
+		framebufferInfo.pAttachments = attachments.data();
+		framebufferInfo.width = render_swapchain.extent.width;
+		framebufferInfo.height = render_swapchain.extent.height;
+		framebufferInfo.layers = 1;
+
+		vk::Framebuffer framebuffer = context->primary_logical_device.createFramebuffer(framebufferInfo);
+
+		if (!framebuffer) {
+			LOG_ERROR("Failed to create swapchain framebuffer");
+			return;
+		}
+
+		frames[i].framebuffer = framebuffer;
+	}
+}
+
+void RendererImpl::create_render_pass() {
 	vk::AttachmentDescription depthAttachment;
 	depthAttachment.format = frames[0].depthbuffer.texture.format;
 	depthAttachment.samples = vk::SampleCountFlagBits::e1;
@@ -735,7 +1575,9 @@ void RendererImpl::create_render_state() {
 	colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
 	colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
 	colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-	colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+	// Offscreen targets are kept ready to be copied back instead of presented
+	colorAttachment.finalLayout = render_swapchain.is_offscreen() ?
+		vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
 
 	std::vector<vk::AttachmentDescription> attachments{
 		depthAttachment,
@@ -792,6 +1634,19 @@ void RendererImpl::create_render_state() {
 		colorSubpassDependency
 	};
 
+	// Make color writes visible to the readback copy of offscreen targets
+	if (render_swapchain.is_offscreen()) {
+		vk::SubpassDependency readbackDependency;
+		readbackDependency.srcSubpass = 1;
+		readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+		readbackDependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+		readbackDependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+		readbackDependency.dstStageMask = vk::PipelineStageFlagBits::eTransfer;
+		readbackDependency.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
+		subpassDependencies.push_back(readbackDependency);
+	}
+
 	vk::RenderPassCreateInfo renderPassInfo;
 	renderPassInfo.attachmentCount = attachments.size();
 	renderPassInfo.pAttachments = attachments.data();
@@ -809,153 +1664,347 @@ void RendererImpl::create_render_state() {
 		return;
 	}
 
-	/*
-	* Create framebuffers
-	*/
-
-	for (size_t i = 0; i < frames.size(); i++) {
-		std::vector<vk::ImageView> attachments{
-			frames[i].depthbuffer.view,
-			render_swapchain.image_views[i]
-		};
-
-		vk::FramebufferCreateInfo framebufferInfo;
-		framebufferInfo.renderPass = geometry_render_pass;
-		framebufferInfo.attachmentCount = attachments.size();
-		framebufferInfo.pAttachments = attachments.data();
-		framebufferInfo.width = render_swapchain.extent.width;
-		framebufferInfo.height = render_swapchain.extent.height;
-		framebufferInfo.layers = 1;
-
-		vk::Framebuffer framebuffer = context->primary_logical_device.createFramebuffer(framebufferInfo);
-
-		if (!framebuffer) {
-			LOG_ERROR("Failed to create swapchain framebuffer");
-			return;
-		}
-
-		frames[i].framebuffer = framebuffer;
-	}
+	render_pass_color_format = render_swapchain.format;
 }
 
 void RendererImpl::destroy_render_state() {
-	context->primary_logical_device.destroy(geometry_render_pass);
-
 	for (auto& frame : frames) {
 		context->primary_logical_device.destroy(frame.framebuffer);
 
 		context->primary_logical_device.destroy(frame.depthbuffer.view);
 		context->destroy_texture(frame.depthbuffer.texture);
-
-		for (auto& buffer : frame.data_buffers) {
-			context->destroy_buffer(buffer.second);
-		}
 	}
 
 	render_swapchain.deinit();
 }
 
 bool RendererImpl::should_render() {
-	return !context->window->is_minimized()
+	return (context->is_headless() || !context->window->is_minimized())
 		&& render_swapchain.is_initialized()
 		&& are_command_buffers_recorded;
 }
 
-void RendererImpl::update_frame_data(Swapchain::FrameId ImageIdx) {
-	std::vector<VmaAllocation> updated_allocations;
-	std::vector<VkDeviceSize> updated_allocation_offsets;
-	std::vector<VkDeviceSize> updated_allocation_sizes;
+void RendererImpl::update_frame_data(Swapchain::FrameId FrameIdx) {
+	if (!frame_data_ring.is_committed()) {
+		return;
+	}
 
-	// Animation data
-	for (auto& skelMesh : skeletal_meshes) {
-		VmaAllocation activeAllocation = skelMesh.sampled_bone_buffers[ImageIdx].allocation;
+	// Animation data, every skeleton is posed at the same instant
+	auto frameTime = std::chrono::steady_clock::now();
+
+	if (use_gpu_animation) {
+		GpuAnimation::Instance* instances = frame_data_ring.get_mapped<GpuAnimation::Instance>(FrameIdx, animation_instances);
+
+		for (size_t i = 0; i < skeletal_meshes.size(); i++) {
+			InternalSkeletalMesh& skelMesh = skeletal_meshes[i];
+			instances[i] = GpuAnimation::make_instance(animation_data, *skelMesh.skeleton, frameTime, skelMesh.first_animated_bone);
+		}
+	}
+	else if (use_animation_scheduling) {
+		// Skeletons are scheduled by the largest of the meshes they pose
+		schedule_screen_sizes.assign(animation_scheduler.entry_count(), 0.0f);
+
+		for (auto& skelMesh : skeletal_meshes) {
+			InternalMesh& mesh = meshes[skelMesh.out_mesh_id];
+			float& screenSize = schedule_screen_sizes[skelMesh.schedule_entry];
+
+			if (current_camera == nullptr) {
+				screenSize = 1.0f;
+				continue;
+			}
 
-		std::vector<Bone> sampledBones = skelMesh.skeleton->sample_animation_frame();
+			for (ModelTransform* transform : mesh.instance_transforms) {
+				float size = AnimationScheduler::get_screen_size(mesh.bounding_sphere, get_model_matrix(transform), current_camera->view, current_camera->projection);
+				screenSize = std::max(screenSize, size);
+			}
+		}
+
+		for (AnimationScheduler::EntryId e = 0; e < schedule_screen_sizes.size(); e++) {
+			animation_scheduler.set_screen_size(e, schedule_screen_sizes[e]);
+		}
 
-		size_t transferSize = sampledBones.size() * sizeof(Bone);
+		animation_scheduler.update(frameTime, &job_system);
 
-		void* data;
-		vmaMapMemory(context->allocator, activeAllocation, &data);
-		std::memcpy(data, sampledBones.data(), transferSize);
-		vmaUnmapMemory(context->allocator, activeAllocation);
+		job_system.parallel_for(skeletal_meshes.size(), 16, [&](size_t Begin, size_t End) {
+			for (size_t i = Begin; i < End; i++) {
+				InternalSkeletalMesh& skelMesh = skeletal_meshes[i];
+				std::span<Bone> bones(frame_data_ring.get_mapped<Bone>(FrameIdx, skelMesh.sampled_bones), skelMesh.skeleton->bones.size());
 
-		updated_allocations.push_back(activeAllocation);
-		updated_allocation_offsets.push_back(0);
-		updated_allocation_sizes.push_back(transferSize);
+				animation_scheduler.get_pose(skelMesh.schedule_entry, frameTime, bones);
+			}
+		});
 	}
+	else {
+		// Batched skeletons follow the playback of their skeleton, restarting the instance when it changes
+		for (BatchedSkeleton& batched : batched_skeletons) {
+			Skeleton& skeleton = *batched.skeleton;
+
+			if (batched.animation != skeleton.active_animation || batched.is_looped != skeleton.is_looped) {
+				batched.animation = skeleton.active_animation;
+				batched.is_looped = skeleton.is_looped;
+
+				bool isPlaying = skeleton.active_animation != nullptr && animation_batch.play_animation(
+					batched.instance,
+					skeleton.animation_names[skeleton.active_animation - skeleton.animations.data()],
+					skeleton.is_looped
+				) == AnimationBatch::Error::OK;
+
+				if (!isPlaying) {
+					animation_batch.clear_animation(batched.instance);
+				}
+			}
 
-	// Render data
-	for (auto& name : buffer_type_names) {
-		VmaAllocation activeAllocation = frames[ImageIdx].data_buffers[name].allocation;
+			animation_batch.set_time(batched.instance, skeleton.get_animation_time(frameTime));
+		}
 
-		if (name == ModelBuffer::name()) {
-			std::vector<glm::mat4> modelmats;
-			modelmats.resize(mesh_transforms.size());
+		if (!batched_skeletons.empty()) {
+			animation_batch.evaluate(&job_system);
+		}
+
+		// Meshes of the same model share a skeleton which is only sampled once
+		posed_skeletons.clear();
+		posed_skeleton_indices.resize(skeletal_meshes.size());
+
+		for (size_t i = 0; i < skeletal_meshes.size(); i++) {
+			if (batched_skeleton_indices[i] != SIZE_MAX) {
+				continue;
+			}
+
+			auto it = std::find(posed_skeletons.begin(), posed_skeletons.end(), skeletal_meshes[i].skeleton);
+			posed_skeleton_indices[i] = std::distance(posed_skeletons.begin(), it);
 
-			for (size_t i = 0; i < modelmats.size(); i++) {
-				modelmats[i] = glm::mat4(1.0f);
+			if (it == posed_skeletons.end()) {
+				posed_skeletons.push_back(skeletal_meshes[i].skeleton);
+			}
+		}
+
+		if (skeleton_poses.size() < posed_skeletons.size()) {
+			skeleton_poses.resize(posed_skeletons.size());
+		}
 
-				if (mesh_transforms[i] != nullptr) {
-					glm::mat4 scale = glm::scale(glm::mat4(1.0f), mesh_transforms[i]->scale);
-					glm::mat4 rotation = glm::mat4_cast(mesh_transforms[i]->rotation);
-					glm::mat4 position = glm::translate(glm::mat4(1.0f), mesh_transforms[i]->position);
-					modelmats[i] = position * rotation * scale;
+		job_system.parallel_for(posed_skeletons.size(), 1, [&](size_t Begin, size_t End) {
+			for (size_t i = Begin; i < End; i++) {
+				Skeleton* skeleton = posed_skeletons[i];
+				std::vector<Bone>& pose = skeleton_poses[i];
+
+				// Keeps its capacity from frame to frame, so this only allocates when the scene changes
+				pose.resize(skeleton->bones.size());
+
+				if (skeleton->sample_animation_frame(skeleton->get_animation_time(frameTime), pose) != Skeleton::Error::OK) {
+					std::copy(skeleton->bones.begin(), skeleton->bones.end(), pose.begin());
 				}
 			}
+		});
 
-			size_t transferSize = modelmats.size() * sizeof(glm::mat4);
+		for (size_t i = 0; i < skeletal_meshes.size(); i++) {
+			InternalSkeletalMesh& skelMesh = skeletal_meshes[i];
 
-			void* data;
-			vmaMapMemory(context->allocator, activeAllocation, &data);
-			std::memcpy(data, modelmats.data(), transferSize);
-			vmaUnmapMemory(context->allocator, activeAllocation);
-		
-			updated_allocations.push_back(activeAllocation);
-			updated_allocation_offsets.push_back(0);
-			updated_allocation_sizes.push_back(transferSize);
+			// Lanes go straight to the bone buffer, there is no propagation left to read them back
+			if (batched_skeleton_indices[i] != SIZE_MAX) {
+				std::span<Bone> bones(frame_data_ring.get_mapped<Bone>(FrameIdx, skelMesh.sampled_bones), skelMesh.skeleton->bones.size());
+
+				animation_batch.get_pose(batched_skeletons[batched_skeleton_indices[i]].instance, bones);
+				continue;
+			}
+
+			const std::vector<Bone>& bones = skeleton_poses[posed_skeleton_indices[i]];
+
+			std::memcpy(
+				frame_data_ring.get_mapped(FrameIdx, skelMesh.sampled_bones),
+				bones.data(),
+				std::min<size_t>(bones.size() * sizeof(Bone), skelMesh.sampled_bones.size)
+			);
+		}
+	}
+
+	// Baked frames follow the clock of the skeleton, like the poses they replace
+	if (vertex_cache_playbacks.size > 0) {
+		VertexCache::Playback* playbacks = frame_data_ring.get_mapped<VertexCache::Playback>(FrameIdx, vertex_cache_playbacks);
+
+		for (auto& skelMesh : skeletal_meshes) {
+			if (skelMesh.vertex_cache.has_value()) {
+				playbacks[skelMesh.vertex_cache_index] = VertexCache::get_playback(*skelMesh.vertex_cache, skelMesh.skeleton->get_animation_time(frameTime));
+			}
+		}
+	}
+
+	// Render data
+	for (auto& name : buffer_type_names) {
+		FrameDataRing::Allocation& allocation = frame_data_allocations[name];
+
+		if (name == ModelBuffer::name()) {
+			glm::mat4* modelmats = frame_data_ring.get_mapped<glm::mat4>(FrameIdx, allocation);
+
+			// Every mesh writes its own transform slots
+			job_system.parallel_for(meshes.size(), 64, [&](size_t Begin, size_t End) {
+				for (size_t m = Begin; m < End; m++) {
+					InternalMesh& mesh = meshes[m];
+
+					for (size_t i = 0; i < mesh.instance_transforms.size(); i++) {
+						modelmats[mesh.first_transform + i] = get_model_matrix(mesh.instance_transforms[i]);
+					}
+				}
+			});
 		}
 
 		if (name == CameraBuffer::name()) {
-			CameraBuffer camera{ glm::mat4(1.0f), glm::mat4(1.0f) };
+			CameraBuffer* camera = frame_data_ring.get_mapped<CameraBuffer>(FrameIdx, allocation);
+
+			camera->data.view = glm::mat4(1.0f);
+			camera->data.projection = glm::mat4(1.0f);
 
 			if (current_camera != nullptr) {
-				camera.data.projection = current_camera->projection;
-				camera.data.view = current_camera->view, glm::vec3{ 1.0f, 1.0f, 1.0f };
+				camera->data.projection = current_camera->projection;
+				camera->data.view = current_camera->view;
 			}
+		}
+	}
 
-			size_t transferSize = sizeof(CameraBuffer);
+	if (use_frustum_culling) {
+		glm::mat4 viewProjection = glm::mat4(1.0f);
 
-			void* data;
-			vmaMapMemory(context->allocator, activeAllocation, &data);
-			std::memcpy(data, &camera, transferSize);
-			vmaUnmapMemory(context->allocator, activeAllocation);
-		
-			updated_allocations.push_back(activeAllocation);
-			updated_allocation_offsets.push_back(0);
-			updated_allocation_sizes.push_back(transferSize);
+		if (current_camera != nullptr) {
+			viewProjection = current_camera->projection * current_camera->view;
+		}
+
+		*frame_data_ring.get_mapped<GpuCulling::FrustumPlanes>(FrameIdx, frustum_planes) = GpuCulling::extract_frustum_planes(viewProjection);
+	}
+
+	// Fields are composed in every frame until each holds the last pose, the culling kernel decides so itself
+	if (use_animation_scheduling && use_frustum_culling) {
+		uint32_t* generations = frame_data_ring.get_mapped<uint32_t>(FrameIdx, pose_generations);
+
+		for (size_t i = 0; i < skeletal_meshes.size(); i++) {
+			generations[i] = animation_scheduler.get_generation(skeletal_meshes[i].schedule_entry);
+		}
+	}
+	else if (use_animation_scheduling) {
+		vk::DispatchIndirectCommand* args = frame_data_ring.get_mapped<vk::DispatchIndirectCommand>(FrameIdx, composition_dispatch_args);
+		vk::Extent3D fieldDims = field_composer->get_field_dims();
+
+		for (size_t i = 0; i < skeletal_meshes.size(); i++) {
+			InternalSkeletalMesh& skelMesh = skeletal_meshes[i];
+			uint32_t generation = animation_scheduler.get_generation(skelMesh.schedule_entry);
+			uint32_t& composed = skelMesh.composed_generations[FrameIdx];
+
+			args[i] = composed != generation ? vk::DispatchIndirectCommand{ fieldDims.width / 8, fieldDims.height / 8, fieldDims.depth / 8 } : vk::DispatchIndirectCommand{ 0, 0, 0 };
+			composed = generation;
 		}
 	}
 
-	vmaFlushAllocations(context->allocator, updated_allocations.size(), updated_allocations.data(), updated_allocation_offsets.data(), updated_allocation_sizes.data());
+	frame_data_ring.flush(FrameIdx);
 }
 
 void RendererImpl::finish_mesh_digestion() {
-	// Allocate buffer objects
+	// Lay out the transform slots of every instance
+	transform_count = 0;
+
+	for (auto& mesh : meshes) {
+		mesh.first_transform = transform_count;
+		transform_count += static_cast<uint32_t>(mesh.instance_transforms.size());
+	}
+
+	if (use_indirect_draws) {
+		merge_mesh_geometry();
+		build_indirect_draw_commands();
+	}
+
+	// Lay out the per frame data ring
+	frame_data_ring.reset();
+	frame_data_allocations.clear();
+
 	for (auto& name : buffer_type_names) {
-		// Only allocate SSBOs that are per mesh
+		// SSBOs hold one element per transform slot, UBOs a single element
+		vk::DeviceSize size = buffer_type_sizes[name];
+
 		if (buffer_type_is_per_mesh[name]) {
-			for (auto& frame : frames) {
-				frame.data_buffers[name] = context->create_storage_buffer(buffer_type_sizes[name] * meshes.size());
-			}
+			size *= transform_count;
 		}
-		// Allocate UBOs that aren't per mesh
-		else {
-			for (auto& frame : frames) {
-				frame.data_buffers[name] = context->create_uniform_buffer(buffer_type_sizes[name]);
+
+		frame_data_allocations[name] = frame_data_ring.reserve(size).value;
+	}
+
+	// GPU animation poses every skeletal mesh into the animated bone buffers, which only need the instance table here.
+	// It's all or nothing, one skeleton the kernel can't pose sends every skeleton of the scene to the CPU
+	use_gpu_animation = gpu_animation_available && !skeletal_meshes.empty();
+	animation_data = {};
+
+	for (size_t i = 0; i < skeletal_meshes.size() && use_gpu_animation; i++) {
+		const Skeleton& skeleton = *skeletal_meshes[i].skeleton;
+
+		if (!GpuAnimation::add_skeleton(animation_data, *skeletal_meshes[i].skeleton)) {
+			LOG_ERROR("Skeleton of skeletal mesh %zu (mesh %u, %zu bones) can't be animated on the GPU, %s, posing all skeletons on the CPU",
+				i,
+				skeletal_meshes[i].out_mesh_id,
+				skeleton.bones.size(),
+				skeleton.bones.size() > GpuAnimation::MAX_BONES ? "too many bones" : "its hierarchy or animations are invalid"
+			);
+			use_gpu_animation = false;
+		}
+	}
+
+	if (use_gpu_animation) {
+		animation_instances = frame_data_ring.reserve(skeletal_meshes.size() * sizeof(GpuAnimation::Instance)).value;
+	}
+	else {
+		animation_data = {};
+
+		for (auto& skelMesh : skeletal_meshes) {
+			skelMesh.sampled_bones = frame_data_ring.reserve(skelMesh.skeleton->bones.size() * sizeof(Bone)).value;
+		}
+	}
+
+	// Culling reads the model transforms written for the frame
+	if (use_frustum_culling && (meshes.empty() || !frame_data_allocations.contains(ModelBuffer::name()))) {
+		use_frustum_culling = false;
+	}
+
+	if (use_frustum_culling) {
+		frustum_planes = frame_data_ring.reserve(sizeof(GpuCulling::FrustumPlanes)).value;
+	}
+
+	// GPU posed skeletons are sampled every frame
+	use_animation_scheduling = settings.animation_scheduling && !use_gpu_animation;
+	animation_scheduler.clear();
+
+	if (use_animation_scheduling) {
+		for (auto& skelMesh : skeletal_meshes) {
+			skelMesh.schedule_entry = animation_scheduler.add_skeleton(*skelMesh.skeleton);
+			skelMesh.composed_generations.assign(in_flight_frames.size(), AnimationScheduler::NO_GENERATION);
+		}
+	}
+
+	build_animation_batch();
+
+	// The culling kernel always binds the generations
+	if (use_frustum_culling) {
+		pose_generations = frame_data_ring.reserve(skeletal_meshes.size() * sizeof(uint32_t)).value;
+	}
+	else if (use_animation_scheduling) {
+		composition_dispatch_args = frame_data_ring.reserve(skeletal_meshes.size() * sizeof(vk::DispatchIndirectCommand)).value;
+	}
+
+	// Meshes with a pending request get their slot now, a bake that fails leaves it unused
+	uint32_t vertexCacheCount = 0;
+	vertex_cache_playbacks = {};
+
+	if (vertex_cache_available) {
+		for (auto& skelMesh : skeletal_meshes) {
+			if (skelMesh.vertex_cache.has_value() || skelMesh.vertex_cache_request.has_value()) {
+				skelMesh.vertex_cache_index = vertexCacheCount++;
 			}
 		}
 	}
 
+	if (vertexCacheCount > 0) {
+		vertex_cache_playbacks = frame_data_ring.reserve(vertexCacheCount * sizeof(VertexCache::Playback)).value;
+	}
+
+	if (frame_data_ring.commit() != FrameDataRing::Error::OK) {
+		LOG_ERROR("Failed to allocate frame data ring");
+		return;
+	}
+
 	// Create descriptor pool
 
 	uint32_t numPerMeshBuffers = 0;
@@ -973,10 +2022,15 @@ void RendererImpl::finish_mesh_digestion() {
 		}
 	}
 
-	numPerMeshBuffers *= render_swapchain.size();
-	numGlobalBuffers *= render_swapchain.size();
+	numPerMeshBuffers *= in_flight_frames.size();
+	numGlobalBuffers *= in_flight_frames.size();
+
+	// Bindless pipelines index the shared bindless set instead of a set per texture
+	uint32_t numTexturedPipelines = static_cast<uint32_t>(std::count_if(pipelines.begin(), pipelines.end(), [](const auto& p) {
+		return !p.second.bindless_textures;
+	}));
 
-	numSamplers *= pipelines.size();
+	numSamplers *= numTexturedPipelines;
 	numPerMeshBuffers *= pipelines.size();
 	numGlobalBuffers *= pipelines.size();
 
@@ -1003,9 +2057,10 @@ void RendererImpl::finish_mesh_digestion() {
 		numJoints += joints;
 	}
 
-	uint32_t numSkinningBuffers = render_swapchain.size() * skeletal_meshes.size();
-	uint32_t numSkinningFields = skeletal_meshes.size() + (2 * numBones) + (skeletal_meshes.size() * render_swapchain.size());
-	uint32_t numIntermediateFields = 6 * numJoints * render_swapchain.size();
+	// Source vertices, bones and both output streams
+	uint32_t numSkinningBuffers = 4 * in_flight_frames.size() * skeletal_meshes.size();
+	uint32_t numSkinningFields = skeletal_meshes.size() + (2 * numBones) + (skeletal_meshes.size() * in_flight_frames.size());
+	uint32_t numIntermediateFields = 6 * numJoints * in_flight_frames.size();
 
 	std::vector<vk::DescriptorPoolSize> descriptorPoolSizes = {
 		{ vk::DescriptorType::eStorageBuffer, numSkinningBuffers },
@@ -1016,7 +2071,49 @@ void RendererImpl::finish_mesh_digestion() {
 		{ vk::DescriptorType::eCombinedImageSampler, numSamplers }
 	};
 
-	uint32_t totalSets = numSkinningBuffers + numPerMeshBuffers + numGlobalBuffers + numSamplers;
+	uint32_t numCullingBuffers = 0;
+	uint32_t numCullingUniforms = 0;
+
+	if (use_frustum_culling) {
+		numCullingBuffers = GpuCulling::STORAGE_BUFFER_COUNT * in_flight_frames.size();
+		numCullingUniforms = in_flight_frames.size();
+
+		descriptorPoolSizes.push_back({ vk::DescriptorType::eStorageBuffer, numCullingBuffers });
+		descriptorPoolSizes.push_back({ vk::DescriptorType::eUniformBuffer, numCullingUniforms });
+	}
+
+	uint32_t numAnimationBuffers = 0;
+	uint32_t numAnimationSets = 0;
+
+	if (use_gpu_animation) {
+		numAnimationBuffers = GpuAnimation::STORAGE_BUFFER_COUNT * in_flight_frames.size();
+		numAnimationSets = in_flight_frames.size();
+
+		descriptorPoolSizes.push_back({ vk::DescriptorType::eStorageBuffer, numAnimationBuffers });
+	}
+
+	uint32_t numVertexCacheBuffers = VertexCache::STORAGE_BUFFER_COUNT * in_flight_frames.size() * vertexCacheCount;
+	uint32_t numVertexCacheSets = in_flight_frames.size() * vertexCacheCount;
+
+	if (vertexCacheCount > 0) {
+		descriptorPoolSizes.push_back({ vk::DescriptorType::eStorageBuffer, numVertexCacheBuffers });
+	}
+
+	uint32_t numBindlessSets = 0;
+
+	if (use_bindless_textures) {
+		numBindlessSets = 1;
+
+		descriptorPoolSizes.push_back({ vk::DescriptorType::eCombinedImageSampler, bindless_texture_capacity });
+		descriptorPoolSizes.push_back({ vk::DescriptorType::eStorageBuffer, 2 });
+	}
+
+	// Pools can't have empty sizes, which an empty scene waiting for streamed models would produce
+	for (auto& size : descriptorPoolSizes) {
+		size.descriptorCount = std::max<uint32_t>(size.descriptorCount, 1);
+	}
+
+	uint32_t totalSets = std::max<uint32_t>(numSkinningBuffers + numPerMeshBuffers + numGlobalBuffers + numSamplers + numCullingUniforms + numAnimationSets + numVertexCacheSets + numBindlessSets, 1);
 
 	vk::DescriptorPoolCreateInfo descriptorPoolInfo;
 	descriptorPoolInfo.poolSizeCount = descriptorPoolSizes.size();
@@ -1032,7 +2129,7 @@ void RendererImpl::finish_mesh_digestion() {
 
 	// Allocate buffer descriptor sets
 	for (auto& pipeline : pipelines) {
-		std::vector<vk::DescriptorSetLayout> bufferLayouts(render_swapchain.size(), pipeline.second.buffer_descriptor_set_layout);
+		std::vector<vk::DescriptorSetLayout> bufferLayouts(in_flight_frames.size(), pipeline.second.buffer_descriptor_set_layout);
 
 		vk::DescriptorSetAllocateInfo bufferDescriptorSetInfo;
 		bufferDescriptorSetInfo.descriptorPool = descriptor_pool;
@@ -1042,7 +2139,7 @@ void RendererImpl::finish_mesh_digestion() {
 		auto descriptorSets = context->primary_logical_device.allocateDescriptorSets(bufferDescriptorSetInfo);
 	
 		for (size_t i = 0; i < descriptorSets.size(); i++) {
-			frames[i].buffer_descriptor_sets[pipeline.first] = descriptorSets[i];
+			in_flight_frames[i].buffer_descriptor_sets[pipeline.first] = descriptorSets[i];
 		}
 	}
 
@@ -1054,15 +2151,26 @@ void RendererImpl::finish_mesh_digestion() {
 		}
 	}
 
+	// Bone buffers are bound by the composer and skinning descriptors below
+	if (use_gpu_animation) {
+		build_animation_data();
+	}
+
 	field_composer->init_render_data(maxBones, numBones, maxJoints, numJoints, maxFieldDims);
 
 	for (auto& skelMesh : skeletal_meshes) {
-		field_composer->record_descriptor_sets(skelMesh.out_mesh_id, skelMesh.isofield_scale, skelMesh.part_isogradfields, skelMesh.transformed_isogradfields, skelMesh.sampled_bone_buffers, skelMesh.skeleton);
+		std::vector<vk::DescriptorBufferInfo> boneBufferInfos(in_flight_frames.size());
+
+		for (size_t i = 0; i < boneBufferInfos.size(); i++) {
+			boneBufferInfos[i] = get_bone_buffer_info(i, skelMesh);
+		}
+
+		field_composer->record_descriptor_sets(skelMesh.out_mesh_id, skelMesh.isofield_scale, skelMesh.part_isogradfields, skelMesh.transformed_isogradfields, boneBufferInfos, skelMesh.skeleton);
 	}
 
 	// Allocate skinning descriptor sets
 	for (auto& skelMesh : skeletal_meshes) {
-		std::vector<vk::DescriptorSetLayout> descriptorLayouts(render_swapchain.size(), skinning_pipeline.descriptor_set_layout);
+		std::vector<vk::DescriptorSetLayout> descriptorLayouts(in_flight_frames.size(), skinning_pipeline.descriptor_set_layout);
 
 		vk::DescriptorSetAllocateInfo skinningDescriptorSetInfo;
 		skinningDescriptorSetInfo.descriptorPool = descriptor_pool;
@@ -1074,6 +2182,10 @@ void RendererImpl::finish_mesh_digestion() {
 
 	// Allocate texture descriptor sets
 	for (auto& pipeline : pipelines) {
+		if (pipeline.second.bindless_textures) {
+			continue;
+		}
+
 		for (auto& sampler : sampler_type_names) {
 			for (auto& texture : textures) {
 				vk::DescriptorSetLayout textureLayout = pipeline.second.texture_descriptor_set_layout;
@@ -1097,7 +2209,7 @@ void RendererImpl::finish_mesh_digestion() {
 		std::list<vk::DescriptorBufferInfo> bufferInfos;
 		std::list<vk::DescriptorImageInfo> imageInfos;
 
-		for (size_t i = 0; i < render_swapchain.size(); i++) {
+		for (size_t i = 0; i < in_flight_frames.size(); i++) {
 			// In vertices
 			{
 				vk::WriteDescriptorSet sourceBufWrite;
@@ -1133,13 +2245,7 @@ void RendererImpl::finish_mesh_digestion() {
 				boneBufWrite.descriptorType = BoneBuffer::layout_binding().descriptorType;
 				boneBufWrite.descriptorCount = BoneBuffer::layout_binding().descriptorCount;
 
-				vk::DescriptorBufferInfo boneBufferInfo;
-
-				boneBufferInfo.buffer = skelMesh.sampled_bone_buffers[i].buffer;
-				boneBufferInfo.offset = 0;
-				boneBufferInfo.range = VK_WHOLE_SIZE;
-
-				bufferInfos.push_back(boneBufferInfo);
+				bufferInfos.push_back(get_bone_buffer_info(i, skelMesh));
 
 				boneBufWrite.pBufferInfo = &bufferInfos.back();
 				boneBufWrite.pImageInfo = nullptr;
@@ -1148,20 +2254,45 @@ void RendererImpl::finish_mesh_digestion() {
 				descriptorWrites.push_back(boneBufWrite);
 			}
 
-			// Out vertices
+			// Out position stream
 			{
 				vk::WriteDescriptorSet outBufWrite;
 
 				outBufWrite.dstSet = skelMesh.skinning_descriptor_sets[i];
-				outBufWrite.dstBinding = VertexBuffer::layout_binding().binding;
+				outBufWrite.dstBinding = PositionStreamBuffer::layout_binding().binding;
 				outBufWrite.dstArrayElement = 0;
-				outBufWrite.descriptorType = VertexBuffer::layout_binding().descriptorType;
-				outBufWrite.descriptorCount = VertexBuffer::layout_binding().descriptorCount;
+				outBufWrite.descriptorType = PositionStreamBuffer::layout_binding().descriptorType;
+				outBufWrite.descriptorCount = PositionStreamBuffer::layout_binding().descriptorCount;
 
 				vk::DescriptorBufferInfo outBufferInfo;
 
 				outBufferInfo.buffer = skelMesh.vertex_out_buffers[i].buffer;
 				outBufferInfo.offset = 0;
+				outBufferInfo.range = std::max<vk::DeviceSize>(skelMesh.vertex_count * sizeof(VertexPosition), sizeof(VertexPosition));
+
+				bufferInfos.push_back(outBufferInfo);
+
+				outBufWrite.pBufferInfo = &bufferInfos.back();
+				outBufWrite.pImageInfo = nullptr;
+				outBufWrite.pTexelBufferView = nullptr;
+
+				descriptorWrites.push_back(outBufWrite);
+			}
+
+			// Out attribute stream
+			{
+				vk::WriteDescriptorSet outBufWrite;
+
+				outBufWrite.dstSet = skelMesh.skinning_descriptor_sets[i];
+				outBufWrite.dstBinding = AttributeStreamBuffer::layout_binding().binding;
+				outBufWrite.dstArrayElement = 0;
+				outBufWrite.descriptorType = AttributeStreamBuffer::layout_binding().descriptorType;
+				outBufWrite.descriptorCount = AttributeStreamBuffer::layout_binding().descriptorCount;
+
+				vk::DescriptorBufferInfo outBufferInfo;
+
+				outBufferInfo.buffer = skelMesh.vertex_out_buffers[i].buffer;
+				outBufferInfo.offset = VertexStreams::attribute_offset(skelMesh.vertex_count);
 				outBufferInfo.range = VK_WHOLE_SIZE;
 
 				bufferInfos.push_back(outBufferInfo);
@@ -1211,23 +2342,18 @@ void RendererImpl::finish_mesh_digestion() {
 
 			if (pipeline.second.descriptor_is_buffer[descriptorName]) {
 				// Per frame state
-				for (size_t i = 0; i < render_swapchain.size(); i++) {
+				for (size_t i = 0; i < in_flight_frames.size(); i++) {
 					vk::WriteDescriptorSet descriptorWrite;
 
-					// buffer_descriptor_sets[Pipeline Name][Swapchain Image #]
-					descriptorWrite.dstSet = frames[i].buffer_descriptor_sets[pipeline.first];
+					// buffer_descriptor_sets[Pipeline Name][Frame In Flight #]
+					descriptorWrite.dstSet = in_flight_frames[i].buffer_descriptor_sets[pipeline.first];
 					descriptorWrite.dstBinding = pipeline.second.descriptor_layout_bindings[descriptorName].binding;
 					descriptorWrite.dstArrayElement = 0;
 					descriptorWrite.descriptorType = pipeline.second.descriptor_layout_bindings[descriptorName].descriptorType;
 					descriptorWrite.descriptorCount = pipeline.second.descriptor_layout_bindings[descriptorName].descriptorCount;
 
-					vk::DescriptorBufferInfo bufferInfo;
-					// frame_data_buffers[Buffer Type][Swapchain Image #]
-					bufferInfo.buffer = frames[i].data_buffers[descriptorName].buffer;
-					bufferInfo.offset = 0;
-					bufferInfo.range = VK_WHOLE_SIZE;
-
-					bufferInfos.push_back(bufferInfo);
+					// frame_data_allocations[Buffer Type] in the ring region of Frame In Flight #
+					bufferInfos.push_back(frame_data_ring.get_descriptor_info(i, frame_data_allocations[descriptorName]));
 
 					descriptorWrite.pBufferInfo = &bufferInfos.back();
 					descriptorWrite.pImageInfo = nullptr;
@@ -1236,7 +2362,7 @@ void RendererImpl::finish_mesh_digestion() {
 					descriptorWrites.push_back(descriptorWrite);
 				}
 			}
-			else {
+			else if (!pipeline.second.bindless_textures) {
 				size_t i = 0;
 
 				// Per texture
@@ -1271,275 +2397,1485 @@ void RendererImpl::finish_mesh_digestion() {
 			context->primary_logical_device.updateDescriptorSets(descriptorWrites, nullptr);
 		}
 	}
-}
 
-void RendererImpl::record_elastic_skinning_composition_command_buffer(Swapchain::FrameId ImageIdx) {
-	if (elastic_skinning_composition_command_buffers.empty()) {
-		vk::CommandBufferAllocateInfo commandBufferInfo;
-		commandBufferInfo.commandPool = command_pool;
-		commandBufferInfo.level = vk::CommandBufferLevel::eSecondary;
-		commandBufferInfo.commandBufferCount = 3;
-
-		elastic_skinning_composition_command_buffers = context->primary_logical_device.allocateCommandBuffers(commandBufferInfo);
+	if (use_frustum_culling) {
+		build_culling_data();
 	}
 
-	vk::CommandBuffer currentCommandBuffer = elastic_skinning_composition_command_buffers[ImageIdx];
+	if (use_bindless_textures) {
+		build_bindless_data();
+	}
 
-	currentCommandBuffer.reset();
+	// Bakes borrow the composer and skinning descriptors written above
+	if (vertexCacheCount > 0) {
+		bake_vertex_caches();
+		build_vertex_cache_data();
+	}
+}
 
-	vk::CommandBufferInheritanceInfo inheritanceInfo;
-	inheritanceInfo.renderPass = geometry_render_pass;
-	inheritanceInfo.subpass = 0;
-	inheritanceInfo.framebuffer = nullptr;
-	inheritanceInfo.occlusionQueryEnable = VK_FALSE;
-	inheritanceInfo.queryFlags = vk::QueryControlFlagBits(0);
-	inheritanceInfo.pipelineStatistics = vk::QueryPipelineStatisticFlagBits(0);
+void RendererImpl::reset_mesh_digestion() {
+	context->primary_logical_device.destroy(descriptor_pool);
+	descriptor_pool = nullptr;
 
-	vk::CommandBufferBeginInfo beginInfo;
-	beginInfo.flags = (vk::CommandBufferUsageFlagBits)(0);
-	beginInfo.pInheritanceInfo = &inheritanceInfo;
+	texture_descriptor_sets.clear();
 
-	currentCommandBuffer.begin(beginInfo);
+	for (auto& frame : in_flight_frames) {
+		frame.buffer_descriptor_sets.clear();
 
-	for (auto& skelMesh : skeletal_meshes) {
-		field_composer->record_command_buffer(
-			ImageIdx,
-			currentCommandBuffer,
-			skelMesh.out_mesh_id
-		);
-	}
+		context->destroy_buffer(frame.culled_command_buffer);
+		context->destroy_buffer(frame.draw_count_buffer);
+		context->destroy_buffer(frame.dispatch_args_buffer);
+		context->destroy_buffer(frame.composed_generation_buffer);
 
-	currentCommandBuffer.end();
-}
+		frame.culled_command_buffer = {};
+		frame.draw_count_buffer = {};
+		frame.dispatch_args_buffer = {};
+		frame.composed_generation_buffer = {};
+		frame.cull_descriptor_set = nullptr;
 
-void RendererImpl::record_elastic_skinning_animate_command_buffer(Swapchain::FrameId ImageIdx) {
-	if (elastic_skinning_animate_command_buffers.empty()) {
-		vk::CommandBufferAllocateInfo commandBufferInfo;
-		commandBufferInfo.commandPool = command_pool;
-		commandBufferInfo.level = vk::CommandBufferLevel::eSecondary;
-		commandBufferInfo.commandBufferCount = 3;
+		context->destroy_buffer(frame.animated_bone_buffer);
 
-		elastic_skinning_animate_command_buffers = context->primary_logical_device.allocateCommandBuffers(commandBufferInfo);
+		frame.animated_bone_buffer = {};
+		frame.animation_descriptor_set = nullptr;
 	}
 
-	vk::CommandBuffer currentCommandBuffer = elastic_skinning_animate_command_buffers[ImageIdx];
+	for (auto& skelMesh : skeletal_meshes) {
+		skelMesh.skinning_descriptor_sets.clear();
+		skelMesh.vertex_cache_descriptor_sets.clear();
+	}
 
-	currentCommandBuffer.reset();
+	context->destroy_buffer(animation_skeleton_buffer);
+	context->destroy_buffer(animation_rest_bone_buffer);
+	context->destroy_buffer(animation_hierarchy_buffer);
+	context->destroy_buffer(animation_clip_buffer);
+	context->destroy_buffer(animation_track_buffer);
+	context->destroy_buffer(animation_key_buffer);
+	context->destroy_buffer(animation_bounds_buffer);
+
+	animation_skeleton_buffer = {};
+	animation_rest_bone_buffer = {};
+	animation_hierarchy_buffer = {};
+	animation_clip_buffer = {};
+	animation_track_buffer = {};
+	animation_key_buffer = {};
+	animation_bounds_buffer = {};
+
+	field_composer->reset_render_data();
+
+	context->destroy_buffer(indirect_command_buffer);
+	context->destroy_buffer(mesh_bounds_buffer);
+	context->destroy_buffer(command_groups_buffer);
+	context->destroy_buffer(skinning_dispatch_buffer);
+
+	indirect_command_buffer = {};
+	mesh_bounds_buffer = {};
+	command_groups_buffer = {};
+	skinning_dispatch_buffer = {};
+
+	context->destroy_buffer(material_buffer);
+	context->destroy_buffer(material_index_buffer);
+
+	material_buffer = {};
+	material_index_buffer = {};
+	bindless_descriptor_set = nullptr;
+
+	// An earlier layout may have dropped culling, the new one decides again
+	use_frustum_culling = frustum_culling_available;
+}
 
-	vk::CommandBufferInheritanceInfo inheritanceInfo;
-	inheritanceInfo.renderPass = geometry_render_pass;
-	inheritanceInfo.subpass = 0;
-	inheritanceInfo.framebuffer = nullptr;
-	inheritanceInfo.occlusionQueryEnable = VK_FALSE;
-	inheritanceInfo.queryFlags = vk::QueryControlFlagBits(0);
-	inheritanceInfo.pipelineStatistics = vk::QueryPipelineStatisticFlagBits(0);
+void RendererImpl::rebuild_scene() {
+	reset_command_buffers();
 
-	vk::CommandBufferBeginInfo beginInfo;
-	beginInfo.flags = (vk::CommandBufferUsageFlagBits)(0);
-	beginInfo.pInheritanceInfo = &inheritanceInfo;
+	reset_mesh_digestion();
+	finish_mesh_digestion();
 
-	currentCommandBuffer.begin(beginInfo);
+	record_command_buffers();
 
-	// Skinning for skeletal meshes
-	currentCommandBuffer.bindPipeline(
-		vk::PipelineBindPoint::eCompute,
-		skinning_pipeline.pipeline
-	);
+	is_scene_dirty = false;
+}
 
-	for (auto& skelMesh : skeletal_meshes) {
-		InternalMesh& targetMesh = meshes[skelMesh.out_mesh_id];
+void RendererImpl::merge_mesh_geometry() {
+	if (meshes.empty()) {
+		return;
+	}
 
-		// Execute skinning kernel
-		{
-			ElasticSkinning::SkinningContext skinContext{
-				static_cast<uint32_t>(skelMesh.vertex_count),
-				static_cast<uint32_t>(skelMesh.skeleton->bones.size()),
-				skelMesh.isofield_scale,
-				skelMesh.field_dims
-			};
+	/*
+	* Lay out every mesh back to back
+	*/
+	size_t totalVertices = 0;
+	size_t totalIndices = 0;
 
-			currentCommandBuffer.pushConstants<ElasticSkinning::SkinningContext>(
-				skinning_pipeline.pipeline_layout,
-				skinning_pipeline.context_push_constant.stageFlags,
-				skinning_pipeline.context_push_constant.offset,
-				skinContext
-			);
+	// Meshes merged by a previous layout no longer have their own buffers, and move from the old shared buffers
+	std::vector<int32_t> previousVertexOffsets(meshes.size());
+	std::vector<uint32_t> previousFirstIndices(meshes.size());
 
-			std::vector<vk::DescriptorSet> descriptorSets = { skelMesh.skinning_descriptor_sets[ImageIdx] };
+	for (size_t i = 0; i < meshes.size(); i++) {
+		previousVertexOffsets[i] = meshes[i].vertex_offset;
+		previousFirstIndices[i] = meshes[i].first_index;
+	}
 
-			currentCommandBuffer.bindDescriptorSets(
-				vk::PipelineBindPoint::eCompute,
-				skinning_pipeline.pipeline_layout,
-				0,
-				descriptorSets,
-				nullptr
-			);
+	BufferAllocation previousVertexBuffer = geometry_vertex_buffer;
+	BufferAllocation previousIndexBuffer = geometry_index_buffer;
 
-			uint32_t groupCount = (skelMesh.vertex_count / 256) + 1;
+	for (auto& mesh : meshes) {
+		mesh.vertex_offset = static_cast<int32_t>(totalVertices);
+		totalVertices += mesh.vertex_count;
 
-			currentCommandBuffer.dispatch(groupCount, 1, 1);
+		// Skeletal instances reuse the indices of their source, which is always digested first
+		if (mesh.index_source.has_value()) {
+			continue;
 		}
 
-		// Barrier the output buffer
-		{
-			vk::BufferMemoryBarrier barrier;
-			barrier.buffer = skelMesh.vertex_out_buffers[ImageIdx].buffer;
-			barrier.offset = 0;
-			barrier.size = VK_WHOLE_SIZE;
-			barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
-			barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
-			barrier.srcQueueFamilyIndex = context->primary_queue_family_index;
-			barrier.dstQueueFamilyIndex = context->primary_queue_family_index;
+		mesh.first_index = static_cast<uint32_t>(totalIndices);
+		totalIndices += mesh.index_count;
+	}
 
-			currentCommandBuffer.pipelineBarrier(
-				vk::PipelineStageFlagBits::eComputeShader,
-				vk::PipelineStageFlagBits::eTransfer,
-				(vk::DependencyFlagBits)0,
-				nullptr,
-				barrier,
-				nullptr
-			);
+	for (auto& mesh : meshes) {
+		if (mesh.index_source.has_value()) {
+			mesh.first_index = meshes[mesh.index_source.value()].first_index;
 		}
+	}
 
-		// Transfer skinned output vertices to the vertex buffers to be rendered
-		{
-			vk::BufferCopy copyRegion;
-			copyRegion.srcOffset = 0;
-			copyRegion.dstOffset = 0;
-			copyRegion.size = skelMesh.vertex_count * sizeof(Vertex);
+	size_t previousVertexCount = geometry_vertex_count;
+	geometry_vertex_count = totalVertices;
 
-			currentCommandBuffer.copyBuffer(skelMesh.vertex_out_buffers[ImageIdx].buffer, targetMesh.vertex_buffer.buffer, copyRegion);
+	geometry_vertex_buffer = context->create_vertex_buffer(std::max<vk::DeviceSize>(VertexStreams::size(totalVertices), 1), MemoryCategory::Meshes);
+	geometry_index_buffer = context->create_index_buffer(std::max<vk::DeviceSize>(totalIndices * sizeof(uint32_t), 1), MemoryCategory::Meshes);
+
+	/*
+	* Move the per mesh geometry into the shared buffers
+	*/
+	std::vector<BufferAllocation> vertexSources;
+	std::vector<BufferAllocation> indexSources;
+	std::vector<vk::BufferCopy> vertexRegions;
+	std::vector<vk::BufferCopy> indexRegions;
+
+	vertexSources.reserve(2 * meshes.size());
+	indexSources.reserve(meshes.size());
+	vertexRegions.reserve(2 * meshes.size());
+	indexRegions.reserve(meshes.size());
+
+	for (size_t i = 0; i < meshes.size(); i++) {
+		InternalMesh& mesh = meshes[i];
+		bool isMerged = !mesh.vertex_buffer.buffer;
+
+		// One region per vertex stream
+		std::array<vk::BufferCopy, 2> streamRegions = isMerged ?
+			VertexStreams::copy_regions(previousVertexCount, previousVertexOffsets[i], totalVertices, mesh.vertex_offset, mesh.vertex_count) :
+			VertexStreams::copy_regions(mesh.vertex_count, 0, totalVertices, mesh.vertex_offset, mesh.vertex_count);
+
+		for (auto& region : streamRegions) {
+			vertexSources.push_back(isMerged ? previousVertexBuffer : mesh.vertex_buffer);
+			vertexRegions.push_back(region);
 		}
 
-		// Barrier the rendered buffer
-		{
-			vk::BufferMemoryBarrier barrier;
-			barrier.buffer = targetMesh.vertex_buffer.buffer;
-			barrier.offset = 0;
-			barrier.size = VK_WHOLE_SIZE;
-			barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-			barrier.dstAccessMask = vk::AccessFlagBits::eVertexAttributeRead;
-			barrier.srcQueueFamilyIndex = context->primary_queue_family_index;
-			barrier.dstQueueFamilyIndex = context->primary_queue_family_index;
+		if (mesh.index_source.has_value()) {
+			continue;
+		}
 
-			currentCommandBuffer.pipelineBarrier(
-				vk::PipelineStageFlagBits::eTransfer,
-				vk::PipelineStageFlagBits::eVertexInput,
-				(vk::DependencyFlagBits)0,
-				nullptr,
-				barrier,
-				nullptr
-			);
+		if (isMerged) {
+			indexSources.push_back(previousIndexBuffer);
+			indexRegions.push_back({ previousFirstIndices[i] * sizeof(uint32_t), mesh.first_index * sizeof(uint32_t), mesh.index_count * sizeof(uint32_t) });
+		}
+		else {
+			indexSources.push_back(mesh.index_buffer);
+			indexRegions.push_back({ 0, mesh.first_index * sizeof(uint32_t), mesh.index_count * sizeof(uint32_t) });
 		}
 	}
 
-	currentCommandBuffer.end();
-}
-
-void RendererImpl::record_command_buffers() {
-	context->primary_logical_device.waitIdle();
+	context->transfer_buffer_memory(geometry_vertex_buffer, vertexSources, vertexRegions);
+	context->transfer_buffer_memory(geometry_index_buffer, indexSources, indexRegions);
 
-	for (size_t i = 0; i < primary_render_command_buffers.size(); i++) {
+	if (previousVertexBuffer.buffer) {
+		context->destroy_buffer(previousVertexBuffer);
+		context->destroy_buffer(previousIndexBuffer);
+	}
 
-		record_elastic_skinning_composition_command_buffer(i);
-		record_elastic_skinning_animate_command_buffer(i);
+	for (auto& mesh : meshes) {
+		context->destroy_buffer(mesh.vertex_buffer);
 
-		vk::CommandBuffer currentCommandBuffer = primary_render_command_buffers[i];
+		if (!mesh.index_source.has_value()) {
+			context->destroy_buffer(mesh.index_buffer);
+		}
+
+		mesh.vertex_buffer = {};
+		mesh.index_buffer = {};
+	}
+}
+
+void RendererImpl::build_indirect_draw_commands() {
+	depth_draw_groups.clear();
+	color_draw_groups.clear();
+	indirect_command_meshes.clear();
+
+	if (meshes.empty()) {
+		return;
+	}
+
+	std::vector<vk::DrawIndexedIndirectCommand> commands;
+	commands.reserve(2 * meshes.size());
+
+	// Depth draws only depend on the pipeline, color draws also bind the material's textures
+	std::vector<MeshId> depthOrder(meshes.size());
+	std::iota(depthOrder.begin(), depthOrder.end(), 0);
+
+	std::stable_sort(depthOrder.begin(), depthOrder.end(), [this](MeshId a, MeshId b) {
+		return meshes[a].pipeline_hash < meshes[b].pipeline_hash;
+	});
+
+	std::vector<MeshId> colorOrder = depthOrder;
+
+	std::stable_sort(colorOrder.begin(), colorOrder.end(), [this](MeshId a, MeshId b) {
+		if (meshes[a].pipeline_hash != meshes[b].pipeline_hash) {
+			return meshes[a].pipeline_hash < meshes[b].pipeline_hash;
+		}
+
+		return meshes[a].material_hash < meshes[b].material_hash;
+	});
+
+	auto appendGroups = [&](const std::vector<MeshId>& Order, bool ByMaterial, std::vector<DrawGroup>& Groups) {
+		for (MeshId meshId : Order) {
+			const InternalMesh& mesh = meshes[meshId];
+
+			// Bindless pipelines look materials up per transform slot, so one group covers every material
+			bool splitByMaterial = ByMaterial && !pipelines.at(mesh.pipeline_hash).bindless_textures;
+			StringHash materialHash = splitByMaterial ? mesh.material_hash : 0;
+
+			if (Groups.empty() || Groups.back().pipeline_hash != mesh.pipeline_hash || Groups.back().material_hash != materialHash) {
+				Groups.push_back({ mesh.pipeline_hash, materialHash, static_cast<uint32_t>(commands.size()), 0 });
+			}
+
+			vk::DrawIndexedIndirectCommand command;
+			command.indexCount = static_cast<uint32_t>(mesh.index_count);
+			command.instanceCount = static_cast<uint32_t>(mesh.instance_transforms.size());
+			command.firstIndex = mesh.first_index;
+			command.vertexOffset = mesh.vertex_offset;
+			command.firstInstance = mesh.first_transform;
+
+			commands.push_back(command);
+			indirect_command_meshes.push_back(meshId);
+			Groups.back().command_count++;
+		}
+	};
+
+	appendGroups(depthOrder, false, depth_draw_groups);
+	appendGroups(colorOrder, true, color_draw_groups);
+
+	indirect_command_count = static_cast<uint32_t>(commands.size());
+
+	size_t commandMemorySize = commands.size() * sizeof(vk::DrawIndexedIndirectCommand);
+
+	// Also read by the culling kernel as the source of the per frame commands
+	indirect_command_buffer = context->create_buffer(
+		commandMemorySize,
+		vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		vk::SharingMode::eExclusive,
+		VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY,
+		MemoryCategory::DrawData
+	);
+
+	context->upload_to_gpu_buffer(indirect_command_buffer, commands.data(), commandMemorySize);
+}
+
+void RendererImpl::build_culling_data() {
+	/*
+	* Static inputs, bounds per mesh, group per command, and full dispatch sizes per skeletal mesh
+	*/
+	std::vector<glm::vec4> bounds;
+	bounds.reserve(meshes.size());
+
+	for (auto& mesh : meshes) {
+		bounds.push_back(mesh.bounding_sphere);
+	}
+
+	size_t boundsMemorySize = bounds.size() * sizeof(glm::vec4);
+
+	mesh_bounds_buffer = context->create_gpu_storage_buffer(boundsMemorySize, MemoryCategory::DrawData);
+	context->upload_to_gpu_buffer(mesh_bounds_buffer, bounds.data(), boundsMemorySize);
+
+	// Draw counts are indexed by group, depth groups first
+	std::vector<GpuCulling::CommandGroup> commandGroups(indirect_command_count);
+	uint32_t groupCount = 0;
+
+	for (auto* groups : { &depth_draw_groups, &color_draw_groups }) {
+		for (auto& group : *groups) {
+			for (uint32_t c = 0; c < group.command_count; c++) {
+				uint32_t commandIdx = group.first_command + c;
+				commandGroups[commandIdx] = { groupCount, group.first_command, indirect_command_meshes[commandIdx] };
+			}
+
+			groupCount++;
+		}
+	}
+
+	size_t commandGroupsMemorySize = commandGroups.size() * sizeof(GpuCulling::CommandGroup);
+
+	command_groups_buffer = context->create_gpu_storage_buffer(commandGroupsMemorySize, MemoryCategory::DrawData);
+	context->upload_to_gpu_buffer(command_groups_buffer, commandGroups.data(), commandGroupsMemorySize);
+
+	vk::Extent3D fieldDims = field_composer->get_field_dims();
+
+	std::vector<GpuCulling::SkinningDispatch> skinningDispatches;
+	skinningDispatches.reserve(skeletal_meshes.size());
+
+	for (auto& skelMesh : skeletal_meshes) {
+		skinningDispatches.push_back({
+			skelMesh.out_mesh_id,
+			meshes[skelMesh.out_mesh_id].first_transform,
+			static_cast<uint32_t>(meshes[skelMesh.out_mesh_id].instance_transforms.size()),
+			fieldDims.width / 8,
+			fieldDims.height / 8,
+			fieldDims.depth / 8,
+			static_cast<uint32_t>(skelMesh.vertex_count / 256) + 1
+		});
+	}
+
+	// Buffers can't be empty, scenes without skeletal meshes still bind one element
+	size_t skinningDispatchCount = std::max<size_t>(skinningDispatches.size(), 1);
+	size_t skinningDispatchMemorySize = skinningDispatchCount * sizeof(GpuCulling::SkinningDispatch);
+
+	skinning_dispatch_buffer = context->create_gpu_storage_buffer(skinningDispatchMemorySize, MemoryCategory::DrawData);
+
+	if (!skinningDispatches.empty()) {
+		context->upload_to_gpu_buffer(skinning_dispatch_buffer, skinningDispatches.data(), skinningDispatches.size() * sizeof(GpuCulling::SkinningDispatch));
+	}
+
+	/*
+	* Per frame outputs
+	*/
+	size_t dispatchArgsMemorySize = skinningDispatchCount * GpuCulling::DISPATCHES_PER_SKELETAL_MESH * sizeof(vk::DispatchIndirectCommand);
+	std::vector<uint32_t> composedGenerations(skinningDispatchCount, AnimationScheduler::NO_GENERATION);
+
+	for (auto& frame : in_flight_frames) {
+		frame.culled_command_buffer = context->create_buffer(
+			indirect_command_count * sizeof(vk::DrawIndexedIndirectCommand),
+			vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::SharingMode::eExclusive,
+			VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY,
+			MemoryCategory::DrawData
+		);
+
+		frame.draw_count_buffer = context->create_buffer(
+			groupCount * sizeof(uint32_t),
+			vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::SharingMode::eExclusive,
+			VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY,
+			MemoryCategory::DrawData
+		);
+
+		frame.dispatch_args_buffer = context->create_buffer(
+			dispatchArgsMemorySize,
+			vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::SharingMode::eExclusive,
+			VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY,
+			MemoryCategory::DrawData
+		);
+
+		// Nothing is composed yet
+		frame.composed_generation_buffer = context->create_gpu_storage_buffer(composedGenerations.size() * sizeof(uint32_t), MemoryCategory::DrawData);
+		context->upload_to_gpu_buffer(frame.composed_generation_buffer, composedGenerations.data(), composedGenerations.size() * sizeof(uint32_t));
+	}
+
+	/*
+	* Descriptor sets
+	*/
+	std::vector<vk::DescriptorSetLayout> cullLayouts(in_flight_frames.size(), cull_pipeline.descriptor_set_layout);
+
+	vk::DescriptorSetAllocateInfo cullDescriptorSetInfo;
+	cullDescriptorSetInfo.descriptorPool = descriptor_pool;
+	cullDescriptorSetInfo.descriptorSetCount = static_cast<uint32_t>(cullLayouts.size());
+	cullDescriptorSetInfo.pSetLayouts = cullLayouts.data();
+
+	std::vector<vk::DescriptorSet> cullDescriptorSets = context->primary_logical_device.allocateDescriptorSets(cullDescriptorSetInfo);
+
+	for (size_t i = 0; i < in_flight_frames.size(); i++) {
+		InFlightFrameData& frame = in_flight_frames[i];
+		frame.cull_descriptor_set = cullDescriptorSets[i];
+
+		std::vector<vk::WriteDescriptorSet> descriptorWrites;
+		std::list<vk::DescriptorBufferInfo> bufferInfos;
+
+		auto addWrite = [&](vk::DescriptorSetLayoutBinding Binding, vk::DescriptorBufferInfo BufferInfo) {
+			bufferInfos.push_back(BufferInfo);
+
+			vk::WriteDescriptorSet descriptorWrite;
+			descriptorWrite.dstSet = frame.cull_descriptor_set;
+			descriptorWrite.dstBinding = Binding.binding;
+			descriptorWrite.dstArrayElement = 0;
+			descriptorWrite.descriptorType = Binding.descriptorType;
+			descriptorWrite.descriptorCount = Binding.descriptorCount;
+			descriptorWrite.pBufferInfo = &bufferInfos.back();
+			descriptorWrite.pImageInfo = nullptr;
+			descriptorWrite.pTexelBufferView = nullptr;
+
+			descriptorWrites.push_back(descriptorWrite);
+		};
+
+		addWrite(GpuCulling::ModelTransformBuffer::layout_binding(), frame_data_ring.get_descriptor_info(i, frame_data_allocations[ModelBuffer::name()]));
+		addWrite(GpuCulling::FrustumBuffer::layout_binding(), frame_data_ring.get_descriptor_info(i, frustum_planes));
+		addWrite(GpuCulling::MeshBoundsBuffer::layout_binding(), { mesh_bounds_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuCulling::SourceCommandBuffer::layout_binding(), { indirect_command_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuCulling::CommandGroupBuffer::layout_binding(), { command_groups_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuCulling::SkinningDispatchBuffer::layout_binding(), { skinning_dispatch_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuCulling::CulledCommandBuffer::layout_binding(), { frame.culled_command_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuCulling::DrawCountBuffer::layout_binding(), { frame.draw_count_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuCulling::DispatchArgsBuffer::layout_binding(), { frame.dispatch_args_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuCulling::PoseGenerationBuffer::layout_binding(), frame_data_ring.get_descriptor_info(i, pose_generations));
+		addWrite(GpuCulling::ComposedGenerationBuffer::layout_binding(), { frame.composed_generation_buffer.buffer, 0, VK_WHOLE_SIZE });
+
+		context->primary_logical_device.updateDescriptorSets(descriptorWrites, nullptr);
+	}
+}
+
+void RendererImpl::build_animation_data() {
+	/*
+	* Static inputs, skeletons and compressed clips
+	*/
+	auto uploadStatic = [this]<typename T>(const std::vector<T>& Data, BufferAllocation& Buffer) {
+		// Buffers can't be empty, skeletons without animations still bind one element
+		size_t memorySize = std::max<size_t>(Data.size() * sizeof(T), sizeof(uint32_t));
+
+		Buffer = context->create_gpu_storage_buffer(memorySize, MemoryCategory::AnimationData);
+
+		if (!Data.empty()) {
+			context->upload_to_gpu_buffer(Buffer, Data.data(), Data.size() * sizeof(T));
+		}
+	};
+
+	// The kernel reads key data as whole words
+	if (animation_data.key_data.size() % 2 != 0) {
+		animation_data.key_data.push_back(0);
+	}
+
+	uploadStatic(animation_data.skeletons, animation_skeleton_buffer);
+	uploadStatic(animation_data.rest_bones, animation_rest_bone_buffer);
+	uploadStatic(animation_data.hierarchy, animation_hierarchy_buffer);
+	uploadStatic(animation_data.clips, animation_clip_buffer);
+	uploadStatic(animation_data.tracks, animation_track_buffer);
+	uploadStatic(animation_data.key_data, animation_key_buffer);
+	uploadStatic(animation_data.bounds, animation_bounds_buffer);
+
+	/*
+	* Per frame outputs, every skeletal mesh starts at an offset its bone buffer descriptor may bind
+	*/
+	vk::DeviceSize offsetAlignment = context->get_physical_device_properties().limits.minStorageBufferOffsetAlignment;
+	uint32_t boneAlignment = static_cast<uint32_t>(std::lcm<vk::DeviceSize>(sizeof(Bone), std::max<vk::DeviceSize>(offsetAlignment, 1)) / sizeof(Bone));
+	uint32_t animatedBoneCount = 0;
+
+	for (auto& skelMesh : skeletal_meshes) {
+		skelMesh.first_animated_bone = animatedBoneCount;
+
+		uint32_t boneCount = std::max<uint32_t>(static_cast<uint32_t>(skelMesh.skeleton->bones.size()), 1);
+		animatedBoneCount += (boneCount + boneAlignment - 1) / boneAlignment * boneAlignment;
+	}
+
+	for (auto& frame : in_flight_frames) {
+		// Vertex cache bakes copy their poses in
+		frame.animated_bone_buffer = context->create_buffer(
+			animatedBoneCount * sizeof(Bone),
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::SharingMode::eExclusive,
+			VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_ONLY,
+			MemoryCategory::AnimationData
+		);
+	}
+
+	/*
+	* Descriptor sets
+	*/
+	std::vector<vk::DescriptorSetLayout> animationLayouts(in_flight_frames.size(), animation_pipeline.descriptor_set_layout);
+
+	vk::DescriptorSetAllocateInfo animationDescriptorSetInfo;
+	animationDescriptorSetInfo.descriptorPool = descriptor_pool;
+	animationDescriptorSetInfo.descriptorSetCount = static_cast<uint32_t>(animationLayouts.size());
+	animationDescriptorSetInfo.pSetLayouts = animationLayouts.data();
+
+	std::vector<vk::DescriptorSet> animationDescriptorSets = context->primary_logical_device.allocateDescriptorSets(animationDescriptorSetInfo);
+
+	for (size_t i = 0; i < in_flight_frames.size(); i++) {
+		InFlightFrameData& frame = in_flight_frames[i];
+		frame.animation_descriptor_set = animationDescriptorSets[i];
+
+		std::vector<vk::WriteDescriptorSet> descriptorWrites;
+		std::list<vk::DescriptorBufferInfo> bufferInfos;
+
+		auto addWrite = [&](vk::DescriptorSetLayoutBinding Binding, vk::DescriptorBufferInfo BufferInfo) {
+			bufferInfos.push_back(BufferInfo);
+
+			vk::WriteDescriptorSet descriptorWrite;
+			descriptorWrite.dstSet = frame.animation_descriptor_set;
+			descriptorWrite.dstBinding = Binding.binding;
+			descriptorWrite.dstArrayElement = 0;
+			descriptorWrite.descriptorType = Binding.descriptorType;
+			descriptorWrite.descriptorCount = Binding.descriptorCount;
+			descriptorWrite.pBufferInfo = &bufferInfos.back();
+			descriptorWrite.pImageInfo = nullptr;
+			descriptorWrite.pTexelBufferView = nullptr;
+
+			descriptorWrites.push_back(descriptorWrite);
+		};
+
+		addWrite(GpuAnimation::InstanceBuffer::layout_binding(), frame_data_ring.get_descriptor_info(i, animation_instances));
+		addWrite(GpuAnimation::SkeletonBuffer::layout_binding(), { animation_skeleton_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuAnimation::RestBoneBuffer::layout_binding(), { animation_rest_bone_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuAnimation::HierarchyBuffer::layout_binding(), { animation_hierarchy_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuAnimation::ClipBuffer::layout_binding(), { animation_clip_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuAnimation::TrackBuffer::layout_binding(), { animation_track_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuAnimation::KeyDataBuffer::layout_binding(), { animation_key_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuAnimation::BoundsBuffer::layout_binding(), { animation_bounds_buffer.buffer, 0, VK_WHOLE_SIZE });
+		addWrite(GpuAnimation::OutBoneBuffer::layout_binding(), { frame.animated_bone_buffer.buffer, 0, VK_WHOLE_SIZE });
+
+		context->primary_logical_device.updateDescriptorSets(descriptorWrites, nullptr);
+	}
+}
+
+vk::DescriptorBufferInfo RendererImpl::get_bone_buffer_info(Swapchain::FrameId FrameIdx, const InternalSkeletalMesh& SkeletalMesh) {
+	if (!use_gpu_animation) {
+		return frame_data_ring.get_descriptor_info(FrameIdx, SkeletalMesh.sampled_bones);
+	}
+
+	return {
+		in_flight_frames[FrameIdx].animated_bone_buffer.buffer,
+		SkeletalMesh.first_animated_bone * sizeof(Bone),
+		std::max<size_t>(SkeletalMesh.skeleton->bones.size(), 1) * sizeof(Bone)
+	};
+}
+
+void RendererImpl::build_animation_batch() {
+	animation_batch.clear();
+	batched_skeletons.clear();
+	batched_skeleton_indices.assign(skeletal_meshes.size(), SIZE_MAX);
+
+	// Only skeletons posed one at a time on the CPU are batched
+	if (use_gpu_animation || use_animation_scheduling) {
+		return;
+	}
+
+	struct Rig {
+		BinaryBlob key;
+		std::vector<Skeleton*> skeletons;
+	};
+
+	// Rigs by the CRC of their key, keys are compared whole so a collision never merges two rigs
+	std::unordered_map<uint64_t, std::vector<Rig>> rigs;
+	std::unordered_set<const Skeleton*> visited;
+
+	for (auto& skelMesh : skeletal_meshes) {
+		Skeleton* skeleton = skelMesh.skeleton;
+
+		if (!visited.insert(skeleton).second || (!skeleton->is_finalized() && skeleton->finalize() != Skeleton::Error::OK)) {
+			continue;
+		}
+
+		BinaryBlob key = get_rig_key(*skeleton);
+		std::vector<Rig>& bucket = rigs[CRC::crc64(std::string_view(reinterpret_cast<const char*>(key.data()), key.size()))];
+
+		auto rig = std::find_if(bucket.begin(), bucket.end(), [&key](const Rig& R) {
+			return R.key == key;
+		});
+
+		if (rig == bucket.end()) {
+			bucket.push_back({ std::move(key), {} });
+			rig = bucket.end() - 1;
+		}
+
+		rig->skeletons.push_back(skeleton);
+	}
+
+	// Instances are grouped by the first skeleton of their rig, a rig of one is left to the scalar path
+	std::unordered_map<const Skeleton*, size_t> batchedIndices;
+
+	for (auto& [crc, bucket] : rigs) {
+		for (const Rig& rig : bucket) {
+			if (rig.skeletons.size() < 2) {
+				continue;
+			}
+
+			for (Skeleton* skeleton : rig.skeletons) {
+				auto [instance, e] = animation_batch.add_instance(*rig.skeletons.front());
+
+				if (e == AnimationBatch::Error::OK) {
+					batchedIndices[skeleton] = batched_skeletons.size();
+					batched_skeletons.push_back({ skeleton, instance });
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < skeletal_meshes.size(); i++) {
+		auto it = batchedIndices.find(skeletal_meshes[i].skeleton);
+
+		if (it != batchedIndices.end()) {
+			batched_skeleton_indices[i] = it->second;
+		}
+	}
+}
+
+void RendererImpl::bake_vertex_caches() {
+	bool hasRequests = std::any_of(skeletal_meshes.begin(), skeletal_meshes.end(), [](const InternalSkeletalMesh& m) {
+		return m.vertex_cache_request.has_value();
+	});
+
+	if (!hasRequests) {
+		return;
+	}
+
+	// Fields must be resident, and nothing may still read the first frame's bones, fields or outputs
+	context->flush_uploads();
+	context->primary_logical_device.waitIdle();
+
+	vk::CommandBufferAllocateInfo commandBufferInfo;
+	commandBufferInfo.commandPool = command_pool;
+	commandBufferInfo.level = vk::CommandBufferLevel::ePrimary;
+	commandBufferInfo.commandBufferCount = 1;
+
+	vk::CommandBuffer commandBuffer = context->primary_logical_device.allocateCommandBuffers(commandBufferInfo)[0];
+
+	for (auto& skelMesh : skeletal_meshes) {
+		if (!skelMesh.vertex_cache_request.has_value()) {
+			continue;
+		}
+
+		VertexCacheRequest request = skelMesh.vertex_cache_request.value();
+		skelMesh.vertex_cache_request.reset();
+
+		context->destroy_buffer(skelMesh.vertex_cache_block_buffer);
+		context->destroy_buffer(skelMesh.vertex_cache_data_buffer);
+
+		skelMesh.vertex_cache_block_buffer = {};
+		skelMesh.vertex_cache_data_buffer = {};
+		skelMesh.vertex_cache.reset();
+
+		Skeleton& skeleton = *skelMesh.skeleton;
+
+		if (!skeleton.is_finalized() && skeleton.finalize() != Skeleton::Error::OK) {
+			LOG_ERROR("Failed to bake vertex cache, skeleton can't be posed");
+			continue;
+		}
+
+		/*
+		* Sample every frame through the composer and skinning kernels, the skeleton's own playback is left alone
+		*/
+		auto [animation, animationError] = skeleton.get_animation(request.animation);
+
+		if (animationError != Skeleton::Error::OK) {
+			LOG_ERROR("Failed to bake vertex cache, animation not found");
+			continue;
+		}
+
+		std::chrono::milliseconds duration = skeleton.animation_durations[animation - skeleton.animations.data()];
+		uint32_t frameCount = static_cast<uint32_t>(std::ceil(duration.count() * request.frame_rate / 1000.0f)) + 1;
+		size_t vertexCount = skelMesh.vertex_count;
+
+		std::vector<glm::vec3> positions(frameCount * vertexCount);
+		std::vector<glm::vec3> normals(frameCount * vertexCount);
+		std::vector<Bone> pose(skeleton.bones.size());
+		std::vector<size_t> cursors;
+
+		vk::DescriptorBufferInfo boneBuffer = get_bone_buffer_info(0, skelMesh);
+		size_t poseSize = std::max<size_t>(std::min<size_t>(pose.size() * sizeof(Bone), boneBuffer.range), sizeof(Bone));
+		size_t frameSize = skelMesh.vertex_out_buffers[0].size;
+
+		// Frames are recorded back to back and submitted once per chunk, chunks only bound the memory of long clips
+		uint32_t chunkFrames = std::clamp<uint32_t>(static_cast<uint32_t>(VERTEX_CACHE_BAKE_CHUNK_BYTES / std::max<size_t>(frameSize, 1)), 1, frameCount);
+
+		// Poses reach the bone buffer through a copy before each frame, the skinned outputs are copied out after it
+		BufferAllocation poseStaging = context->create_mapped_buffer(chunkFrames * poseSize, vk::BufferUsageFlagBits::eTransferSrc, MemoryCategory::Staging);
+		BufferAllocation readback = context->create_buffer(
+			chunkFrames * frameSize,
+			vk::BufferUsageFlagBits::eTransferDst,
+			vk::SharingMode::eExclusive,
+			VmaMemoryUsage::VMA_MEMORY_USAGE_GPU_TO_CPU,
+			MemoryCategory::Staging,
+			VMA_ALLOCATION_CREATE_MAPPED_BIT
+		);
+
+		ElasticSkinning::SkinningContext skinContext{
+			static_cast<uint32_t>(vertexCount),
+			static_cast<uint32_t>(skeleton.bones.size()),
+			skelMesh.isofield_scale,
+			skelMesh.field_dims
+		};
+
+		for (uint32_t firstFrame = 0; firstFrame < frameCount; firstFrame += chunkFrames) {
+			uint32_t chunkCount = std::min(chunkFrames, frameCount - firstFrame);
+
+			for (uint32_t c = 0; c < chunkCount; c++) {
+				std::chrono::milliseconds time = std::min(duration, std::chrono::milliseconds(std::llround((firstFrame + c) * 1000.0f / request.frame_rate)));
+
+				if (skeleton.sample_animation(animation, time, false, pose, cursors) != Skeleton::Error::OK) {
+					std::copy(skeleton.bones.begin(), skeleton.bones.end(), pose.begin());
+				}
+
+				std::memcpy(static_cast<uint8_t*>(poseStaging.mapped_data) + c * poseSize, pose.data(), std::min(poseSize, pose.size() * sizeof(Bone)));
+			}
+
+			vmaFlushAllocation(context->allocator, poseStaging.allocation, 0, chunkCount * poseSize);
+
+			vk::CommandBufferBeginInfo beginInfo;
+			beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+
+			commandBuffer.reset();
+			commandBuffer.begin(beginInfo);
+
+			for (uint32_t c = 0; c < chunkCount; c++) {
+				// The previous frame's reads of the bones, fields and outputs finish before this frame overwrites them
+				if (c > 0) {
+					vk::MemoryBarrier frameBarrier;
+					frameBarrier.srcAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite;
+					frameBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite;
+
+					commandBuffer.pipelineBarrier(
+						vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+						vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+						(vk::DependencyFlagBits)0, frameBarrier, nullptr, nullptr
+					);
+				}
+
+				commandBuffer.copyBuffer(poseStaging.buffer, boneBuffer.buffer, vk::BufferCopy{ c * poseSize, boneBuffer.offset, poseSize });
+
+				vk::MemoryBarrier poseBarrier;
+				poseBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+				poseBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+				commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, (vk::DependencyFlagBits)0, poseBarrier, nullptr, nullptr);
+
+				field_composer->record_command_buffer(0, commandBuffer, skelMesh.out_mesh_id);
+
+				vk::MemoryBarrier fieldBarrier;
+				fieldBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+				fieldBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+				commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, (vk::DependencyFlagBits)0, fieldBarrier, nullptr, nullptr);
+
+				commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, skinning_pipeline.pipeline);
+
+				commandBuffer.pushConstants<ElasticSkinning::SkinningContext>(
+					skinning_pipeline.pipeline_layout,
+					skinning_pipeline.context_push_constant.stageFlags,
+					skinning_pipeline.context_push_constant.offset,
+					skinContext
+				);
+
+				commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, skinning_pipeline.pipeline_layout, 0, skelMesh.skinning_descriptor_sets[0], nullptr);
+				commandBuffer.dispatch((vertexCount / 256) + 1, 1, 1);
+
+				vk::MemoryBarrier skinBarrier;
+				skinBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+				skinBarrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
+				commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, (vk::DependencyFlagBits)0, skinBarrier, nullptr, nullptr);
+
+				commandBuffer.copyBuffer(skelMesh.vertex_out_buffers[0].buffer, readback.buffer, vk::BufferCopy{ 0, c * frameSize, frameSize });
+			}
+
+			vk::MemoryBarrier readbackBarrier;
+			readbackBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+			readbackBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+
+			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, (vk::DependencyFlagBits)0, readbackBarrier, nullptr, nullptr);
+
+			commandBuffer.end();
+
+			vk::SubmitInfo submitInfo;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &commandBuffer;
+
+			context->primary_queue.submit(submitInfo, nullptr);
+			context->primary_queue.waitIdle();
+
+			vmaInvalidateAllocation(context->allocator, readback.allocation, 0, chunkCount * frameSize);
+
+			for (uint32_t c = 0; c < chunkCount; c++) {
+				const uint8_t* skinned = static_cast<const uint8_t*>(readback.mapped_data) + c * frameSize;
+				const VertexPosition* skinnedPositions = reinterpret_cast<const VertexPosition*>(skinned);
+				const VertexAttributes* skinnedAttributes = reinterpret_cast<const VertexAttributes*>(skinned + VertexStreams::attribute_offset(vertexCount));
+				size_t f = firstFrame + c;
+
+				for (size_t v = 0; v < vertexCount; v++) {
+					positions[f * vertexCount + v] = skinnedPositions[v].position;
+					normals[f * vertexCount + v] = skinnedAttributes[v].normal;
+				}
+			}
+		}
+
+		context->destroy_buffer(poseStaging);
+		context->destroy_buffer(readback);
+
+		/*
+		* Compress and upload
+		*/
+		auto [clip, clipError] = VertexCache::encode(positions, normals, static_cast<uint32_t>(vertexCount), request.frame_rate, duration, request.loop);
+
+		if (clipError != VertexCache::Error::OK) {
+			LOG_ERROR("Failed to encode vertex cache");
+			continue;
+		}
+
+		skelMesh.vertex_cache_block_buffer = context->create_gpu_storage_buffer(clip.blocks.size() * sizeof(VertexCache::Block), MemoryCategory::VertexCaches);
+		skelMesh.vertex_cache_data_buffer = context->create_gpu_storage_buffer(clip.data.size() * sizeof(uint32_t), MemoryCategory::VertexCaches);
+
+		context->upload_to_gpu_buffer(skelMesh.vertex_cache_block_buffer, clip.blocks.data(), clip.blocks.size() * sizeof(VertexCache::Block));
+		context->upload_to_gpu_buffer(skelMesh.vertex_cache_data_buffer, clip.data.data(), clip.data.size() * sizeof(uint32_t));
+
+		LOG("Baked %u frames of %zu vertices into a %zu byte vertex cache\n", clip.frame_count, vertexCount, clip.data.size() * sizeof(uint32_t));
+
+		clip.blocks = {};
+		clip.data = {};
+
+		skelMesh.vertex_cache = std::move(clip);
+	}
+
+	context->primary_logical_device.freeCommandBuffers(command_pool, commandBuffer);
+}
+
+void RendererImpl::build_vertex_cache_data() {
+	for (auto& skelMesh : skeletal_meshes) {
+		if (!skelMesh.vertex_cache.has_value()) {
+			continue;
+		}
+
+		std::vector<vk::DescriptorSetLayout> vertexCacheLayouts(in_flight_frames.size(), vertex_cache_pipeline.descriptor_set_layout);
+
+		vk::DescriptorSetAllocateInfo vertexCacheDescriptorSetInfo;
+		vertexCacheDescriptorSetInfo.descriptorPool = descriptor_pool;
+		vertexCacheDescriptorSetInfo.descriptorSetCount = static_cast<uint32_t>(vertexCacheLayouts.size());
+		vertexCacheDescriptorSetInfo.pSetLayouts = vertexCacheLayouts.data();
+
+		skelMesh.vertex_cache_descriptor_sets = context->primary_logical_device.allocateDescriptorSets(vertexCacheDescriptorSetInfo);
+
+		std::vector<vk::WriteDescriptorSet> descriptorWrites;
+		std::list<vk::DescriptorBufferInfo> bufferInfos;
+
+		for (size_t i = 0; i < in_flight_frames.size(); i++) {
+			auto addWrite = [&](vk::DescriptorSetLayoutBinding Binding, vk::DescriptorBufferInfo BufferInfo) {
+				bufferInfos.push_back(BufferInfo);
+
+				vk::WriteDescriptorSet descriptorWrite;
+				descriptorWrite.dstSet = skelMesh.vertex_cache_descriptor_sets[i];
+				descriptorWrite.dstBinding = Binding.binding;
+				descriptorWrite.dstArrayElement = 0;
+				descriptorWrite.descriptorType = Binding.descriptorType;
+				descriptorWrite.descriptorCount = Binding.descriptorCount;
+				descriptorWrite.pBufferInfo = &bufferInfos.back();
+				descriptorWrite.pImageInfo = nullptr;
+				descriptorWrite.pTexelBufferView = nullptr;
+
+				descriptorWrites.push_back(descriptorWrite);
+			};
+
+			vk::DescriptorBufferInfo positionInfo{
+				skelMesh.vertex_out_buffers[i].buffer,
+				0,
+				std::max<vk::DeviceSize>(skelMesh.vertex_count * sizeof(VertexPosition), sizeof(VertexPosition))
+			};
+
+			vk::DescriptorBufferInfo attributeInfo{
+				skelMesh.vertex_out_buffers[i].buffer,
+				VertexStreams::attribute_offset(skelMesh.vertex_count),
+				VK_WHOLE_SIZE
+			};
+
+			addWrite(VertexCache::BlockBuffer::layout_binding(), { skelMesh.vertex_cache_block_buffer.buffer, 0, VK_WHOLE_SIZE });
+			addWrite(ElasticVertexBuffer::layout_binding(), { skelMesh.vertex_source_buffer.buffer, 0, VK_WHOLE_SIZE });
+			addWrite(PositionStreamBuffer::layout_binding(), positionInfo);
+			addWrite(VertexCache::CacheDataBuffer::layout_binding(), { skelMesh.vertex_cache_data_buffer.buffer, 0, VK_WHOLE_SIZE });
+			addWrite(AttributeStreamBuffer::layout_binding(), attributeInfo);
+			addWrite(VertexCache::PlaybackBuffer::layout_binding(), frame_data_ring.get_descriptor_info(i, vertex_cache_playbacks));
+		}
+
+		context->primary_logical_device.updateDescriptorSets(descriptorWrites, nullptr);
+	}
+}
+
+void RendererImpl::build_bindless_data() {
+	/*
+	* Texture array, every registered texture gets a slot
+	*/
+	std::unordered_map<StringHash, uint32_t> textureIndices;
+	std::vector<vk::DescriptorImageInfo> imageInfos;
+	imageInfos.reserve(std::min<size_t>(textures.size(), bindless_texture_capacity));
+
+	for (auto& texture : textures) {
+		if (imageInfos.size() >= bindless_texture_capacity) {
+			LOG_ERROR("More textures than bindless slots, remaining textures fall back to the default texture");
+			break;
+		}
+
+		textureIndices[texture.first] = static_cast<uint32_t>(imageInfos.size());
+		imageInfos.push_back({ texture_sampler, texture.second.view, vk::ImageLayout::eShaderReadOnlyOptimal });
+	}
+
+	auto findTexture = [&](StringHash Name, uint32_t Fallback) {
+		auto it = textureIndices.find(Name);
+		return it != textureIndices.end() ? it->second : Fallback;
+	};
+
+	uint32_t defaultTexture = findTexture(DEFAULT_TEXTURE_NAME, 0);
+
+	/*
+	* Materials, and the material of every transform slot
+	*/
+	std::unordered_map<StringHash, uint32_t> materialIndices;
+	std::vector<GpuMaterial> gpuMaterials;
+	gpuMaterials.reserve(materials.size());
+
+	for (auto& material : materials) {
+		materialIndices[material.first] = static_cast<uint32_t>(gpuMaterials.size());
+
+		GpuMaterial gpuMaterial{};
+		gpuMaterial.albedo_factor = material.second.albedo_factor;
+		gpuMaterial.albedo_texture = findTexture(material.second.albedo_texture_name, defaultTexture);
+		gpuMaterial.normal_texture = findTexture(material.second.normal_texture_name, GpuMaterial::NO_TEXTURE);
+		gpuMaterial.metallic_roughness_texture = findTexture(material.second.metallic_roughness_texture_name, GpuMaterial::NO_TEXTURE);
+		gpuMaterial.metallic_factor = material.second.metallic_factor;
+		gpuMaterial.roughness_factor = material.second.roughness_factor;
+
+		gpuMaterials.push_back(gpuMaterial);
+	}
+
+	// Buffers can't be empty
+	if (gpuMaterials.empty()) {
+		gpuMaterials.push_back({});
+	}
+
+	std::vector<uint32_t> slotMaterials(std::max<uint32_t>(transform_count, 1), 0);
+
+	for (auto& mesh : meshes) {
+		auto it = materialIndices.find(mesh.material_hash);
+		uint32_t materialIdx = it != materialIndices.end() ? it->second : 0;
+
+		std::fill_n(slotMaterials.begin() + mesh.first_transform, mesh.instance_transforms.size(), materialIdx);
+	}
+
+	size_t materialMemorySize = gpuMaterials.size() * sizeof(GpuMaterial);
+	size_t materialIndexMemorySize = slotMaterials.size() * sizeof(uint32_t);
+
+	material_buffer = context->create_gpu_storage_buffer(materialMemorySize, MemoryCategory::DrawData);
+	context->upload_to_gpu_buffer(material_buffer, gpuMaterials.data(), materialMemorySize);
+
+	material_index_buffer = context->create_gpu_storage_buffer(materialIndexMemorySize, MemoryCategory::DrawData);
+	context->upload_to_gpu_buffer(material_index_buffer, slotMaterials.data(), materialIndexMemorySize);
+
+	/*
+	* Descriptor set, shared by every bindless pipeline and frame
+	*/
+	vk::DescriptorSetAllocateInfo bindlessSetInfo;
+	bindlessSetInfo.descriptorPool = descriptor_pool;
+	bindlessSetInfo.descriptorSetCount = 1;
+	bindlessSetInfo.pSetLayouts = &bindless_set_layout;
+
+	bindless_descriptor_set = context->primary_logical_device.allocateDescriptorSets(bindlessSetInfo)[0];
+
+	std::vector<vk::WriteDescriptorSet> descriptorWrites;
+
+	if (!imageInfos.empty()) {
+		vk::WriteDescriptorSet textureWrite;
+		textureWrite.dstSet = bindless_descriptor_set;
+		textureWrite.dstBinding = BindlessTextureArray::layout_binding().binding;
+		textureWrite.dstArrayElement = 0;
+		textureWrite.descriptorType = BindlessTextureArray::layout_binding().descriptorType;
+		textureWrite.descriptorCount = static_cast<uint32_t>(imageInfos.size());
+		textureWrite.pBufferInfo = nullptr;
+		textureWrite.pImageInfo = imageInfos.data();
+		textureWrite.pTexelBufferView = nullptr;
+
+		descriptorWrites.push_back(textureWrite);
+	}
+
+	std::array<vk::DescriptorBufferInfo, 2> bufferInfos = {
+		vk::DescriptorBufferInfo{ material_buffer.buffer, 0, VK_WHOLE_SIZE },
+		vk::DescriptorBufferInfo{ material_index_buffer.buffer, 0, VK_WHOLE_SIZE }
+	};
+
+	std::array<vk::DescriptorSetLayoutBinding, 2> bufferBindings = {
+		MaterialBuffer::layout_binding(),
+		MaterialIndexBuffer::layout_binding()
+	};
+
+	for (size_t i = 0; i < bufferInfos.size(); i++) {
+		vk::WriteDescriptorSet bufferWrite;
+		bufferWrite.dstSet = bindless_descriptor_set;
+		bufferWrite.dstBinding = bufferBindings[i].binding;
+		bufferWrite.dstArrayElement = 0;
+		bufferWrite.descriptorType = bufferBindings[i].descriptorType;
+		bufferWrite.descriptorCount = bufferBindings[i].descriptorCount;
+		bufferWrite.pBufferInfo = &bufferInfos[i];
+		bufferWrite.pImageInfo = nullptr;
+		bufferWrite.pTexelBufferView = nullptr;
+
+		descriptorWrites.push_back(bufferWrite);
+	}
+
+	context->primary_logical_device.updateDescriptorSets(descriptorWrites, nullptr);
+}
+
+void RendererImpl::record_secondary_command_buffer(Swapchain::FrameId FrameIdx, RecordingStage Stage, size_t First, size_t Count, vk::CommandBuffer CommandBuffer) {
+	switch (Stage) {
+	case RecordingStage::Sampling:
+		record_animation_sampling_command_buffer(FrameIdx, CommandBuffer);
+		break;
+	case RecordingStage::Culling:
+		record_frustum_culling_command_buffer(FrameIdx, CommandBuffer);
+		break;
+	case RecordingStage::Composition:
+		record_elastic_skinning_composition_command_buffer(FrameIdx, First, Count, CommandBuffer);
+		break;
+	case RecordingStage::Animate:
+		record_elastic_skinning_animate_command_buffer(FrameIdx, First, Count, CommandBuffer);
+		break;
+	case RecordingStage::Depth:
+		if (use_indirect_draws) {
+			record_indirect_draw_command_buffer(FrameIdx, true, First, Count, CommandBuffer);
+		}
+		else {
+			record_draw_command_buffer(FrameIdx, true, First, Count, CommandBuffer);
+		}
+		break;
+	case RecordingStage::Color:
+		if (use_indirect_draws) {
+			record_indirect_draw_command_buffer(FrameIdx, false, First, Count, CommandBuffer);
+		}
+		else {
+			record_draw_command_buffer(FrameIdx, false, First, Count, CommandBuffer);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void RendererImpl::record_elastic_skinning_composition_command_buffer(Swapchain::FrameId FrameIdx, size_t First, size_t Count, vk::CommandBuffer CommandBuffer) {
+	vk::CommandBuffer currentCommandBuffer = CommandBuffer;
+
+	vk::CommandBufferInheritanceInfo inheritanceInfo;
+	inheritanceInfo.renderPass = nullptr;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = nullptr;
+	inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+	inheritanceInfo.queryFlags = vk::QueryControlFlagBits(0);
+	inheritanceInfo.pipelineStatistics = vk::QueryPipelineStatisticFlagBits(0);
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = (vk::CommandBufferUsageFlagBits)(0);
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	currentCommandBuffer.begin(beginInfo);
+
+	// Culled skeletal meshes have their field dispatch sizes zeroed by the culling kernel, scheduled ones
+	// by the CPU without culling while their fields are current
+	vk::Buffer dispatchArgs = nullptr;
+	vk::DeviceSize dispatchArgsOffset = 0;
+	vk::DeviceSize dispatchArgsStride = 0;
+
+	if (use_frustum_culling) {
+		dispatchArgs = in_flight_frames[FrameIdx].dispatch_args_buffer.buffer;
+		dispatchArgsStride = GpuCulling::DISPATCHES_PER_SKELETAL_MESH * sizeof(vk::DispatchIndirectCommand);
+	}
+	else if (use_animation_scheduling) {
+		vk::DescriptorBufferInfo argsInfo = frame_data_ring.get_descriptor_info(FrameIdx, composition_dispatch_args);
+
+		dispatchArgs = argsInfo.buffer;
+		dispatchArgsOffset = argsInfo.offset;
+		dispatchArgsStride = sizeof(vk::DispatchIndirectCommand);
+	}
+
+	for (size_t i = First; i < First + Count; i++) {
+		// Cached meshes replay baked vertices and never read their fields
+		if (skeletal_meshes[i].vertex_cache.has_value()) {
+			continue;
+		}
+
+		field_composer->record_command_buffer(
+			FrameIdx,
+			currentCommandBuffer,
+			skeletal_meshes[i].out_mesh_id,
+			&profiler,
+			dispatchArgs,
+			dispatchArgsOffset + i * dispatchArgsStride
+		);
+	}
+
+	currentCommandBuffer.end();
+}
+
+void RendererImpl::record_elastic_skinning_animate_command_buffer(Swapchain::FrameId FrameIdx, size_t First, size_t Count, vk::CommandBuffer CommandBuffer) {
+	vk::CommandBuffer currentCommandBuffer = CommandBuffer;
+
+	vk::CommandBufferInheritanceInfo inheritanceInfo;
+	inheritanceInfo.renderPass = nullptr;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = nullptr;
+	inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+	inheritanceInfo.queryFlags = vk::QueryControlFlagBits(0);
+	inheritanceInfo.pipelineStatistics = vk::QueryPipelineStatisticFlagBits(0);
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = (vk::CommandBufferUsageFlagBits)(0);
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	currentCommandBuffer.begin(beginInfo);
+
+	// Skinning for skeletal meshes, or vertex cache playback for meshes with a baked clip
+	vk::Pipeline boundPipeline = nullptr;
+
+	for (size_t skelMeshIdx = First; skelMeshIdx < First + Count; skelMeshIdx++) {
+		InternalSkeletalMesh& skelMesh = skeletal_meshes[skelMeshIdx];
+		InternalMesh& targetMesh = meshes[skelMesh.out_mesh_id];
+		MeshId profiledMesh = profiler.is_per_mesh() ? skelMesh.out_mesh_id : GpuProfiler::ALL_MESHES;
+
+		vk::Pipeline meshPipeline = skelMesh.vertex_cache.has_value() ? vertex_cache_pipeline.pipeline : skinning_pipeline.pipeline;
+
+		if (meshPipeline != boundPipeline) {
+			currentCommandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, meshPipeline);
+			boundPipeline = meshPipeline;
+		}
+
+		// Execute vertex cache playback kernel
+		if (skelMesh.vertex_cache.has_value()) {
+			GpuProfiler::ScopeId scope = profiler.begin_scope(FrameIdx, currentCommandBuffer, GpuProfiler::Stage::VertexCachePlayback, profiledMesh);
+
+			VertexCache::PlaybackContext playbackContext{
+				static_cast<uint32_t>(skelMesh.vertex_count),
+				skelMesh.vertex_cache_index,
+				skelMesh.vertex_cache->bounds_min,
+				skelMesh.vertex_cache->bounds_extent
+			};
+
+			currentCommandBuffer.pushConstants<VertexCache::PlaybackContext>(
+				vertex_cache_pipeline.pipeline_layout,
+				vertex_cache_pipeline.context_push_constant.stageFlags,
+				vertex_cache_pipeline.context_push_constant.offset,
+				playbackContext
+			);
+
+			currentCommandBuffer.bindDescriptorSets(
+				vk::PipelineBindPoint::eCompute,
+				vertex_cache_pipeline.pipeline_layout,
+				0,
+				skelMesh.vertex_cache_descriptor_sets[FrameIdx],
+				nullptr
+			);
+
+			// Same workgroup size as skinning, so the culled dispatch sizes apply as they are
+			if (use_frustum_culling) {
+				vk::DeviceSize argsOffset = (skelMeshIdx * GpuCulling::DISPATCHES_PER_SKELETAL_MESH + 1) * sizeof(vk::DispatchIndirectCommand);
+
+				currentCommandBuffer.dispatchIndirect(in_flight_frames[FrameIdx].dispatch_args_buffer.buffer, argsOffset);
+			}
+			else {
+				uint32_t groupCount = (skelMesh.vertex_count / VertexCache::WORKGROUP_SIZE) + 1;
+
+				currentCommandBuffer.dispatch(groupCount, 1, 1);
+			}
+
+			profiler.end_scope(FrameIdx, currentCommandBuffer, scope);
+		}
+		// Execute skinning kernel
+		else {
+			GpuProfiler::ScopeId scope = profiler.begin_scope(FrameIdx, currentCommandBuffer, GpuProfiler::Stage::VertexProjection, profiledMesh);
+
+			ElasticSkinning::SkinningContext skinContext{
+				static_cast<uint32_t>(skelMesh.vertex_count),
+				static_cast<uint32_t>(skelMesh.skeleton->bones.size()),
+				skelMesh.isofield_scale,
+				skelMesh.field_dims
+			};
+
+			currentCommandBuffer.pushConstants<ElasticSkinning::SkinningContext>(
+				skinning_pipeline.pipeline_layout,
+				skinning_pipeline.context_push_constant.stageFlags,
+				skinning_pipeline.context_push_constant.offset,
+				skinContext
+			);
+
+			std::vector<vk::DescriptorSet> descriptorSets = { skelMesh.skinning_descriptor_sets[FrameIdx] };
+
+			currentCommandBuffer.bindDescriptorSets(
+				vk::PipelineBindPoint::eCompute,
+				skinning_pipeline.pipeline_layout,
+				0,
+				descriptorSets,
+				nullptr
+			);
+
+			if (use_frustum_culling) {
+				vk::DeviceSize argsOffset = (skelMeshIdx * GpuCulling::DISPATCHES_PER_SKELETAL_MESH + 1) * sizeof(vk::DispatchIndirectCommand);
+
+				currentCommandBuffer.dispatchIndirect(in_flight_frames[FrameIdx].dispatch_args_buffer.buffer, argsOffset);
+			}
+			else {
+				uint32_t groupCount = (skelMesh.vertex_count / 256) + 1;
+
+				currentCommandBuffer.dispatch(groupCount, 1, 1);
+			}
+
+			profiler.end_scope(FrameIdx, currentCommandBuffer, scope);
+		}
+
+		// Merged geometry is written in place within the shared vertex buffer, one region per stream
+		vk::Buffer targetBuffer = use_indirect_draws ? geometry_vertex_buffer.buffer : targetMesh.vertex_buffer.buffer;
+		size_t targetCapacity = use_indirect_draws ? geometry_vertex_count : targetMesh.vertex_count;
+
+		std::array<vk::BufferCopy, 2> copyRegions = VertexStreams::copy_regions(
+			skelMesh.vertex_count, 0,
+			targetCapacity, targetMesh.vertex_offset,
+			skelMesh.vertex_count
+		);
+
+		auto targetBarriers = [&](vk::AccessFlags SrcAccess, vk::AccessFlags DstAccess) {
+			std::vector<vk::BufferMemoryBarrier> barriers;
+
+			for (auto& region : copyRegions) {
+				vk::BufferMemoryBarrier barrier;
+				barrier.buffer = targetBuffer;
+				barrier.offset = region.dstOffset;
+				barrier.size = region.size;
+				barrier.srcAccessMask = SrcAccess;
+				barrier.dstAccessMask = DstAccess;
+				barrier.srcQueueFamilyIndex = context->primary_queue_family_index;
+				barrier.dstQueueFamilyIndex = context->primary_queue_family_index;
+
+				barriers.push_back(barrier);
+			}
+
+			return barriers;
+		};
+
+		// Barrier the output buffer, and the rendered buffer against draws of a previous frame still in flight
+		{
+			vk::BufferMemoryBarrier outBarrier;
+			outBarrier.buffer = skelMesh.vertex_out_buffers[FrameIdx].buffer;
+			outBarrier.offset = 0;
+			outBarrier.size = VK_WHOLE_SIZE;
+			outBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+			outBarrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+			outBarrier.srcQueueFamilyIndex = context->primary_queue_family_index;
+			outBarrier.dstQueueFamilyIndex = context->primary_queue_family_index;
+
+			std::vector<vk::BufferMemoryBarrier> barriers = targetBarriers(vk::AccessFlagBits::eVertexAttributeRead, vk::AccessFlagBits::eTransferWrite);
+			barriers.push_back(outBarrier);
+
+			currentCommandBuffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexInput,
+				vk::PipelineStageFlagBits::eTransfer,
+				(vk::DependencyFlagBits)0,
+				nullptr,
+				barriers,
+				nullptr
+			);
+		}
+
+		// Transfer skinned output vertices to the vertex buffers to be rendered
+		{
+			GpuProfiler::ScopeId scope = profiler.begin_scope(FrameIdx, currentCommandBuffer, GpuProfiler::Stage::VertexCopy, profiledMesh);
+
+			currentCommandBuffer.copyBuffer(skelMesh.vertex_out_buffers[FrameIdx].buffer, targetBuffer, copyRegions);
+
+			profiler.end_scope(FrameIdx, currentCommandBuffer, scope);
+		}
+
+		// Barrier the rendered buffer
+		{
+			std::vector<vk::BufferMemoryBarrier> barriers = targetBarriers(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eVertexAttributeRead);
+
+			currentCommandBuffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::PipelineStageFlagBits::eVertexInput,
+				(vk::DependencyFlagBits)0,
+				nullptr,
+				barriers,
+				nullptr
+			);
+		}
+	}
+
+	currentCommandBuffer.end();
+}
+
+void RendererImpl::record_draw_command_buffer(Swapchain::FrameId FrameIdx, bool DepthOnly, size_t First, size_t Count, vk::CommandBuffer CommandBuffer) {
+	InFlightFrameData& frame = in_flight_frames[FrameIdx];
+
+	vk::CommandBuffer currentCommandBuffer = CommandBuffer;
+
+	// Framebuffers are per swapchain image, leave it to the primary
+	vk::CommandBufferInheritanceInfo inheritanceInfo;
+	inheritanceInfo.renderPass = geometry_render_pass;
+	inheritanceInfo.subpass = DepthOnly ? depth_subpass : color_subpass;
+	inheritanceInfo.framebuffer = nullptr;
+	inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+	inheritanceInfo.queryFlags = vk::QueryControlFlagBits(0);
+	inheritanceInfo.pipelineStatistics = vk::QueryPipelineStatisticFlagBits(0);
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	currentCommandBuffer.begin(beginInfo);
+
+	set_viewport_state(currentCommandBuffer);
+
+	GpuProfiler::Stage stage = DepthOnly ? GpuProfiler::Stage::DepthSubpass : GpuProfiler::Stage::ColorSubpass;
+	GpuProfiler::ScopeId subpassScope = profiler.begin_scope(FrameIdx, currentCommandBuffer, stage);
+
+	bool hasColorSampler = std::find(sampler_type_names.begin(), sampler_type_names.end(), ColorSampler::name()) != sampler_type_names.end();
+
+	StringHash boundPipeline = 0;
+
+	// Chunks are recorded concurrently, so only look up existing entries here
+	for (MeshId meshId = static_cast<MeshId>(First); meshId < First + Count; meshId++) {
+		StringHash pipelineHash = DepthOnly ? meshes[meshId].depth_pipeline_hash : meshes[meshId].pipeline_hash;
+		GfxPipelineImpl* pipeline = &pipelines.at(pipelineHash);
+
+		GpuProfiler::ScopeId meshScope = GpuProfiler::INVALID_SCOPE;
+
+		if (profiler.is_per_mesh()) {
+			meshScope = profiler.begin_scope(FrameIdx, currentCommandBuffer, stage, meshId, true);
+		}
+
+		// Bindless sets are shared by every mesh of the pipeline, only the push constant changes
+		if (!pipeline->bindless_textures || pipelineHash != boundPipeline) {
+			currentCommandBuffer.bindPipeline(
+				vk::PipelineBindPoint::eGraphics,
+				pipeline->pipeline
+			);
+
+			std::vector<vk::DescriptorSet> descriptorSets = { frame.buffer_descriptor_sets.at(meshes[meshId].pipeline_hash) };
+
+			if (pipeline->bindless_textures) {
+				descriptorSets.push_back(bindless_descriptor_set);
+			}
+			else if (!DepthOnly && hasColorSampler) {
+				descriptorSets.push_back(find_texture_descriptor_set(meshes[meshId].pipeline_hash, meshes[meshId].material_hash));
+			}
+
+			currentCommandBuffer.bindDescriptorSets(
+				vk::PipelineBindPoint::eGraphics,
+				pipeline->pipeline_layout,
+				0,
+				descriptorSets,
+				nullptr
+			);
+
+			boundPipeline = pipelineHash;
+		}
+
+		// Instances offset from the first transform slot through gl_InstanceIndex
+		currentCommandBuffer.pushConstants<uint32_t>(
+			pipeline->pipeline_layout,
+			pipeline->mesh_id_push_constant.stageFlags,
+			pipeline->mesh_id_push_constant.offset,
+			meshes[meshId].first_transform
+		);
+
+		// The depth pipelines only consume the position stream
+		std::array<vk::Buffer, 2> vertexBuffers = { meshes[meshId].vertex_buffer.buffer, meshes[meshId].vertex_buffer.buffer };
+		std::array<vk::DeviceSize, 2> offsets = { 0, VertexStreams::attribute_offset(meshes[meshId].vertex_count) };
+		currentCommandBuffer.bindVertexBuffers(0, DepthOnly ? 1 : 2, vertexBuffers.data(), offsets.data());
+		currentCommandBuffer.bindIndexBuffer(
+			meshes[meshes[meshId].index_source.value_or(meshId)].index_buffer.buffer,
+			0,
+			vk::IndexType::eUint32
+		);
 
-		vk::CommandBufferBeginInfo beginInfo;
-		beginInfo.flags = (vk::CommandBufferUsageFlagBits)(0);
-		beginInfo.pInheritanceInfo = nullptr;
+		currentCommandBuffer.drawIndexed(
+			static_cast<uint32_t>(meshes[meshId].index_count),
+			static_cast<uint32_t>(meshes[meshId].instance_transforms.size()),
+			0,
+			0,
+			0
+		);
 
-		currentCommandBuffer.begin(beginInfo);
+		profiler.end_scope(FrameIdx, currentCommandBuffer, meshScope);
+	}
 
-		currentCommandBuffer.executeCommands(elastic_skinning_composition_command_buffers[i]);
-		currentCommandBuffer.executeCommands(elastic_skinning_animate_command_buffers[i]);
+	profiler.end_scope(FrameIdx, currentCommandBuffer, subpassScope);
 
-		vk::RenderPassBeginInfo renderPassInfo;
-		renderPassInfo.renderPass = geometry_render_pass;
-		renderPassInfo.framebuffer = frames[i].framebuffer;
-		renderPassInfo.renderArea.offset = vk::Offset2D{ 0,0 };
-		renderPassInfo.renderArea.extent = render_swapchain.extent;
+	currentCommandBuffer.end();
+}
 
-		vk::ClearValue depthClear;
-		depthClear.color.float32 = { { 0.0f, 0.0f, 0.0f, 1.0f } };
-		depthClear.depthStencil.depth = 1.0f;
-		depthClear.depthStencil.stencil = 0.0f;
+void RendererImpl::record_indirect_draw_command_buffer(Swapchain::FrameId FrameIdx, bool DepthOnly, size_t First, size_t Count, vk::CommandBuffer CommandBuffer) {
+	InFlightFrameData& frame = in_flight_frames[FrameIdx];
 
-		vk::ClearValue colorClear;
-		colorClear.color.float32 = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+	vk::CommandBuffer currentCommandBuffer = CommandBuffer;
 
-		std::vector<vk::ClearValue> clearValues{
-			depthClear,
-			colorClear
-		};
+	// Framebuffers are per swapchain image, leave it to the primary
+	vk::CommandBufferInheritanceInfo inheritanceInfo;
+	inheritanceInfo.renderPass = geometry_render_pass;
+	inheritanceInfo.subpass = DepthOnly ? depth_subpass : color_subpass;
+	inheritanceInfo.framebuffer = nullptr;
+	inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+	inheritanceInfo.queryFlags = vk::QueryControlFlagBits(0);
+	inheritanceInfo.pipelineStatistics = vk::QueryPipelineStatisticFlagBits(0);
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	currentCommandBuffer.begin(beginInfo);
+
+	set_viewport_state(currentCommandBuffer);
+
+	// Meshes are no longer recorded individually, so there are no per mesh scopes here
+	GpuProfiler::Stage stage = DepthOnly ? GpuProfiler::Stage::DepthSubpass : GpuProfiler::Stage::ColorSubpass;
+	GpuProfiler::ScopeId subpassScope = profiler.begin_scope(FrameIdx, currentCommandBuffer, stage);
+
+	bool hasColorSampler = std::find(sampler_type_names.begin(), sampler_type_names.end(), ColorSampler::name()) != sampler_type_names.end();
+	bool hasMultiDraw = context->get_enabled_features().multiDrawIndirect;
+	bool hasDrawCount = use_frustum_culling && context->get_enabled_vulkan12_features().drawIndirectCount;
+
+	const std::vector<DrawGroup>& groups = DepthOnly ? depth_draw_groups : color_draw_groups;
+	const uint32_t commandStride = sizeof(vk::DrawIndexedIndirectCommand);
+
+	// Culled commands are rewritten every frame, draw counts are indexed by group with depth groups first
+	vk::Buffer commands = use_frustum_culling ? frame.culled_command_buffer.buffer : indirect_command_buffer.buffer;
+	size_t firstCountIdx = DepthOnly ? 0 : depth_draw_groups.size();
+
+	// Geometry is shared by every group, the depth pipelines only consume the position stream
+	std::array<vk::Buffer, 2> vertexBuffers = { geometry_vertex_buffer.buffer, geometry_vertex_buffer.buffer };
+	std::array<vk::DeviceSize, 2> offsets = { 0, VertexStreams::attribute_offset(geometry_vertex_count) };
+	currentCommandBuffer.bindVertexBuffers(0, DepthOnly ? 1 : 2, vertexBuffers.data(), offsets.data());
+	currentCommandBuffer.bindIndexBuffer(
+		geometry_index_buffer.buffer,
+		0,
+		vk::IndexType::eUint32
+	);
 
-		renderPassInfo.clearValueCount = clearValues.size();
-		renderPassInfo.pClearValues = clearValues.data();
+	StringHash boundPipeline = 0;
 
-		currentCommandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+	for (size_t groupIdx = First; groupIdx < First + Count; groupIdx++) {
+		const DrawGroup& group = groups[groupIdx];
 
-		// Depth only subpass
-		for (MeshId meshId = 0; meshId < meshes.size(); meshId++) {
-			GfxPipelineImpl* pipeline = &pipelines[meshes[meshId].depth_pipeline_hash];
+		StringHash pipelineHash = DepthOnly ? hash_combine(group.pipeline_hash, RendererImpl::DEPTH_PIPELINE_NAME) : group.pipeline_hash;
+		GfxPipelineImpl* pipeline = &pipelines.at(pipelineHash);
+		bool pipelineChanged = pipelineHash != boundPipeline;
 
+		if (pipelineChanged) {
 			currentCommandBuffer.bindPipeline(
 				vk::PipelineBindPoint::eGraphics,
 				pipeline->pipeline
 			);
 
-			std::vector<vk::DescriptorSet> descriptorSets = { frames[i].buffer_descriptor_sets[meshes[meshId].pipeline_hash] };
-			
-			currentCommandBuffer.bindDescriptorSets(
-				vk::PipelineBindPoint::eGraphics,
-				pipeline->pipeline_layout,
-				0,
-				descriptorSets,
-				nullptr
-			);
-
+			// Instance index carries the transform slot
 			currentCommandBuffer.pushConstants<MeshId>(
 				pipeline->pipeline_layout,
 				pipeline->mesh_id_push_constant.stageFlags,
 				pipeline->mesh_id_push_constant.offset,
-				meshId
-			);
-
-			std::array<vk::Buffer, 1> vertexBuffers = { meshes[meshId].vertex_buffer.buffer };
-			std::array<vk::DeviceSize, 1> offsets = { 0 };
-			currentCommandBuffer.bindVertexBuffers(0, vertexBuffers, offsets);
-			currentCommandBuffer.bindIndexBuffer(
-				meshes[meshId].index_buffer.buffer,
-				0,
-				vk::IndexType::eUint32
-			);
-
-			currentCommandBuffer.drawIndexed(
-				static_cast<uint32_t>(meshes[meshId].index_count),
-				1,
-				0,
-				0,
 				0
 			);
-		}
 
-		currentCommandBuffer.nextSubpass(vk::SubpassContents::eInline);
-
-		// Color subpass
-		for (MeshId meshId = 0; meshId < meshes.size(); meshId++) {
-			GfxPipelineImpl* pipeline = &pipelines[meshes[meshId].pipeline_hash];
-
-			currentCommandBuffer.bindPipeline(
-				vk::PipelineBindPoint::eGraphics,
-				pipeline->pipeline
-			);
+			boundPipeline = pipelineHash;
+		}
 
-			std::vector<vk::DescriptorSet> descriptorSets = { frames[i].buffer_descriptor_sets[meshes[meshId].pipeline_hash] };
+		// Bindless groups of one pipeline share their sets
+		if (!pipeline->bindless_textures || pipelineChanged) {
+			std::vector<vk::DescriptorSet> descriptorSets = { frame.buffer_descriptor_sets.at(group.pipeline_hash) };
 
-			if (std::find(sampler_type_names.begin(), sampler_type_names.end(), ColorSampler::name()) != sampler_type_names.end()) {
-				InternalMaterial material = materials[meshes[meshId].material_hash];
-				StringHash compositeName = hash_combine(meshes[meshId].pipeline_hash, ColorSampler::name(), material.albedo_texture_name);
-				descriptorSets.push_back(texture_descriptor_sets[compositeName]);
+			if (pipeline->bindless_textures) {
+				descriptorSets.push_back(bindless_descriptor_set);
+			}
+			else if (!DepthOnly && hasColorSampler) {
+				descriptorSets.push_back(find_texture_descriptor_set(group.pipeline_hash, group.material_hash));
 			}
 
 			currentCommandBuffer.bindDescriptorSets(
@@ -1549,37 +3885,426 @@ void RendererImpl::record_command_buffers() {
 				descriptorSets,
 				nullptr
 			);
+		}
 
-			currentCommandBuffer.pushConstants<MeshId>(
-				pipeline->pipeline_layout,
-				pipeline->mesh_id_push_constant.stageFlags,
-				pipeline->mesh_id_push_constant.offset,
-				meshId
-				);
+		vk::DeviceSize commandOffset = group.first_command * vk::DeviceSize(commandStride);
 
-			std::array<vk::Buffer, 1> vertexBuffers = { meshes[meshId].vertex_buffer.buffer };
-			std::array<vk::DeviceSize, 1> offsets = { 0 };
-			currentCommandBuffer.bindVertexBuffers(0, vertexBuffers, offsets);
-			currentCommandBuffer.bindIndexBuffer(
-				meshes[meshId].index_buffer.buffer,
-				0,
-				vk::IndexType::eUint32
-			);
+		if (hasDrawCount) {
+			vk::DeviceSize countOffset = (firstCountIdx + groupIdx) * sizeof(uint32_t);
 
-			currentCommandBuffer.drawIndexed(
-				static_cast<uint32_t>(meshes[meshId].index_count),
-				1,
-				0,
-				0,
-				0
-			);
+			currentCommandBuffer.drawIndexedIndirectCount(commands, commandOffset, frame.draw_count_buffer.buffer, countOffset, group.command_count, commandStride);
+		}
+		else if (hasMultiDraw) {
+			currentCommandBuffer.drawIndexedIndirect(commands, commandOffset, group.command_count, commandStride);
+		}
+		else {
+			for (uint32_t c = 0; c < group.command_count; c++) {
+				currentCommandBuffer.drawIndexedIndirect(commands, commandOffset + c * commandStride, 1, commandStride);
+			}
+		}
+	}
+
+	profiler.end_scope(FrameIdx, currentCommandBuffer, subpassScope);
+
+	currentCommandBuffer.end();
+}
+
+void RendererImpl::set_viewport_state(vk::CommandBuffer CommandBuffer) {
+	vk::Viewport viewport;
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(render_swapchain.extent.width);
+	viewport.height = static_cast<float>(render_swapchain.extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	vk::Rect2D scissor;
+	scissor.offset = vk::Offset2D{ 0, 0 };
+	scissor.extent = render_swapchain.extent;
+
+	CommandBuffer.setViewport(0, viewport);
+	CommandBuffer.setScissor(0, scissor);
+}
+
+vk::DescriptorSet RendererImpl::find_texture_descriptor_set(StringHash PipelineHash, StringHash MaterialHash) {
+	const InternalMaterial& material = materials.at(MaterialHash);
+	StringHash compositeName = hash_combine(PipelineHash, ColorSampler::name(), material.albedo_texture_name);
+
+	auto textureSet = texture_descriptor_sets.find(compositeName);
+
+	if (textureSet == texture_descriptor_sets.end()) {
+		textureSet = texture_descriptor_sets.find(hash_combine(PipelineHash, ColorSampler::name(), DEFAULT_TEXTURE_NAME));
+	}
+
+	return textureSet->second;
+}
+
+void RendererImpl::record_frustum_culling_command_buffer(Swapchain::FrameId FrameIdx, vk::CommandBuffer CommandBuffer) {
+	InFlightFrameData& frame = in_flight_frames[FrameIdx];
+
+	vk::CommandBufferInheritanceInfo inheritanceInfo;
+	inheritanceInfo.renderPass = nullptr;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = nullptr;
+	inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+	inheritanceInfo.queryFlags = vk::QueryControlFlagBits(0);
+	inheritanceInfo.pipelineStatistics = vk::QueryPipelineStatisticFlagBits(0);
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = (vk::CommandBufferUsageFlagBits)(0);
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	CommandBuffer.begin(beginInfo);
+
+	GpuProfiler::ScopeId scope = profiler.begin_scope(FrameIdx, CommandBuffer, GpuProfiler::Stage::FrustumCulling);
+
+	// Visible commands are appended per group
+	CommandBuffer.fillBuffer(frame.draw_count_buffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+	{
+		vk::BufferMemoryBarrier barrier;
+		barrier.buffer = frame.draw_count_buffer.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+		barrier.srcQueueFamilyIndex = context->primary_queue_family_index;
+		barrier.dstQueueFamilyIndex = context->primary_queue_family_index;
+
+		CommandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer,
+			vk::PipelineStageFlagBits::eComputeShader,
+			(vk::DependencyFlagBits)0,
+			nullptr,
+			barrier,
+			nullptr
+		);
+	}
+
+	CommandBuffer.bindPipeline(
+		vk::PipelineBindPoint::eCompute,
+		cull_pipeline.pipeline
+	);
+
+	GpuCulling::CullContext cullContext{
+		indirect_command_count,
+		static_cast<uint32_t>(skeletal_meshes.size()),
+		context->get_enabled_vulkan12_features().drawIndirectCount,
+		use_animation_scheduling
+	};
+
+	CommandBuffer.pushConstants<GpuCulling::CullContext>(
+		cull_pipeline.pipeline_layout,
+		cull_pipeline.context_push_constant.stageFlags,
+		cull_pipeline.context_push_constant.offset,
+		cullContext
+	);
+
+	CommandBuffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eCompute,
+		cull_pipeline.pipeline_layout,
+		0,
+		frame.cull_descriptor_set,
+		nullptr
+	);
+
+	uint32_t invocationCount = std::max<uint32_t>(cullContext.command_count, cullContext.skeletal_mesh_count);
+
+	CommandBuffer.dispatch((invocationCount + GpuCulling::WORKGROUP_SIZE - 1) / GpuCulling::WORKGROUP_SIZE, 1, 1);
+
+	// Commands, counts and dispatch sizes are consumed as indirect arguments
+	{
+		vk::MemoryBarrier barrier;
+		barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+		barrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead;
+
+		CommandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader,
+			vk::PipelineStageFlagBits::eDrawIndirect,
+			(vk::DependencyFlagBits)0,
+			barrier,
+			nullptr,
+			nullptr
+		);
+	}
+
+	profiler.end_scope(FrameIdx, CommandBuffer, scope);
+
+	CommandBuffer.end();
+}
+
+void RendererImpl::record_animation_sampling_command_buffer(Swapchain::FrameId FrameIdx, vk::CommandBuffer CommandBuffer) {
+	InFlightFrameData& frame = in_flight_frames[FrameIdx];
+
+	vk::CommandBufferInheritanceInfo inheritanceInfo;
+	inheritanceInfo.renderPass = nullptr;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = nullptr;
+	inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+	inheritanceInfo.queryFlags = vk::QueryControlFlagBits(0);
+	inheritanceInfo.pipelineStatistics = vk::QueryPipelineStatisticFlagBits(0);
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = (vk::CommandBufferUsageFlagBits)(0);
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	CommandBuffer.begin(beginInfo);
+
+	GpuProfiler::ScopeId scope = profiler.begin_scope(FrameIdx, CommandBuffer, GpuProfiler::Stage::AnimationSampling);
+
+	CommandBuffer.bindPipeline(
+		vk::PipelineBindPoint::eCompute,
+		animation_pipeline.pipeline
+	);
+
+	GpuAnimation::SampleContext sampleContext{
+		static_cast<uint32_t>(skeletal_meshes.size())
+	};
+
+	CommandBuffer.pushConstants<GpuAnimation::SampleContext>(
+		animation_pipeline.pipeline_layout,
+		animation_pipeline.context_push_constant.stageFlags,
+		animation_pipeline.context_push_constant.offset,
+		sampleContext
+	);
+
+	CommandBuffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eCompute,
+		animation_pipeline.pipeline_layout,
+		0,
+		frame.animation_descriptor_set,
+		nullptr
+	);
+
+	// One workgroup poses one instance
+	CommandBuffer.dispatch(sampleContext.instance_count, 1, 1);
+
+	// Composition and skinning read the posed bones
+	{
+		vk::MemoryBarrier barrier;
+		barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+		CommandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader,
+			vk::PipelineStageFlagBits::eComputeShader,
+			(vk::DependencyFlagBits)0,
+			barrier,
+			nullptr,
+			nullptr
+		);
+	}
+
+	profiler.end_scope(FrameIdx, CommandBuffer, scope);
+
+	CommandBuffer.end();
+}
+
+void RendererImpl::record_primary_command_buffer(const Swapchain::Frame& Frame) {
+	InFlightFrameData& inFlightFrame = in_flight_frames[Frame.in_flight_id];
+
+	vk::CommandBuffer currentCommandBuffer = inFlightFrame.primary_command_buffer;
+
+	currentCommandBuffer.reset();
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	beginInfo.pInheritanceInfo = nullptr;
+
+	currentCommandBuffer.begin(beginInfo);
+
+	profiler.reset_frame(Frame.in_flight_id, currentCommandBuffer);
+
+	if (!inFlightFrame.sampling_command_buffers.empty()) {
+		currentCommandBuffer.executeCommands(inFlightFrame.sampling_command_buffers);
+	}
+
+	if (!inFlightFrame.culling_command_buffers.empty()) {
+		currentCommandBuffer.executeCommands(inFlightFrame.culling_command_buffers);
+	}
+
+	if (!inFlightFrame.composition_command_buffers.empty()) {
+		currentCommandBuffer.executeCommands(inFlightFrame.composition_command_buffers);
+	}
+
+	if (!inFlightFrame.animate_command_buffers.empty()) {
+		currentCommandBuffer.executeCommands(inFlightFrame.animate_command_buffers);
+	}
+
+	vk::RenderPassBeginInfo renderPassInfo;
+	renderPassInfo.renderPass = geometry_render_pass;
+	renderPassInfo.framebuffer = frames[Frame.id].framebuffer;
+	renderPassInfo.renderArea.offset = vk::Offset2D{ 0,0 };
+	renderPassInfo.renderArea.extent = render_swapchain.extent;
+
+	vk::ClearValue depthClear;
+	depthClear.color.float32 = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+	depthClear.depthStencil.depth = 1.0f;
+	depthClear.depthStencil.stencil = 0.0f;
+
+	vk::ClearValue colorClear;
+	colorClear.color.float32 = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+	std::vector<vk::ClearValue> clearValues{
+		depthClear,
+		colorClear
+	};
+
+	renderPassInfo.clearValueCount = clearValues.size();
+	renderPassInfo.pClearValues = clearValues.data();
+
+	currentCommandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+
+	// Depth only subpass
+	if (!inFlightFrame.depth_command_buffers.empty()) {
+		currentCommandBuffer.executeCommands(inFlightFrame.depth_command_buffers);
+	}
+
+	currentCommandBuffer.nextSubpass(vk::SubpassContents::eSecondaryCommandBuffers);
+
+	// Color subpass
+	if (!inFlightFrame.color_command_buffers.empty()) {
+		currentCommandBuffer.executeCommands(inFlightFrame.color_command_buffers);
+	}
+
+	currentCommandBuffer.endRenderPass();
+
+	currentCommandBuffer.end();
+}
+
+void RendererImpl::record_command_buffers(bool DrawStagesOnly) {
+	context->primary_logical_device.waitIdle();
+
+	// Scopes of a frame are cleared together, so profiled frames are always recorded whole
+	if (profiler.is_initialized()) {
+		DrawStagesOnly = false;
+	}
+
+	/*
+	* Split every stage of every frame into chunks of meshes, one secondary each
+	*/
+
+	struct RecordingJob {
+		Swapchain::FrameId frame;
+		RecordingStage stage;
+		size_t first;
+		size_t count;
+
+		vk::CommandBuffer* target;
+	};
+
+	std::vector<RecordingJob> jobs;
+
+	size_t chunkSize = settings.meshes_per_command_buffer;
+
+	// Indirect draw stages are split by draw group rather than by mesh
+	size_t depthDrawCount = use_indirect_draws ? depth_draw_groups.size() : meshes.size();
+	size_t colorDrawCount = use_indirect_draws ? color_draw_groups.size() : meshes.size();
+
+	auto chunkCount = [chunkSize](size_t Count) {
+		return (Count + chunkSize - 1) / chunkSize;
+	};
+
+	// Size every target vector first, jobs hold pointers into them
+	for (auto& frame : in_flight_frames) {
+		if (!DrawStagesOnly) {
+			frame.sampling_command_buffers.resize(use_gpu_animation ? 1 : 0);
+			frame.culling_command_buffers.resize(use_frustum_culling ? 1 : 0);
+			frame.composition_command_buffers.resize(chunkCount(skeletal_meshes.size()));
+			frame.animate_command_buffers.resize(chunkCount(skeletal_meshes.size()));
+		}
+
+		frame.depth_command_buffers.resize(chunkCount(depthDrawCount));
+		frame.color_command_buffers.resize(chunkCount(colorDrawCount));
+	}
+
+	for (Swapchain::FrameId i = 0; i < in_flight_frames.size(); i++) {
+		InFlightFrameData& frame = in_flight_frames[i];
+
+		// Scopes are allocated while recording the secondaries, which are reused every frame
+		if (!DrawStagesOnly) {
+			profiler.clear_frame(i);
+		}
+
+		auto addStage = [&](RecordingStage Stage, size_t MeshCount, std::vector<vk::CommandBuffer>& Targets) {
+			for (size_t c = 0; c < Targets.size(); c++) {
+				size_t first = c * chunkSize;
+				jobs.push_back({ i, Stage, first, std::min(chunkSize, MeshCount - first), &Targets[c] });
+			}
+		};
+
+		if (!DrawStagesOnly) {
+			addStage(RecordingStage::Sampling, frame.sampling_command_buffers.size(), frame.sampling_command_buffers);
+			addStage(RecordingStage::Culling, frame.culling_command_buffers.size(), frame.culling_command_buffers);
+			addStage(RecordingStage::Composition, skeletal_meshes.size(), frame.composition_command_buffers);
+			addStage(RecordingStage::Animate, skeletal_meshes.size(), frame.animate_command_buffers);
+		}
+
+		addStage(RecordingStage::Depth, depthDrawCount, frame.depth_command_buffers);
+		addStage(RecordingStage::Color, colorDrawCount, frame.color_command_buffers);
+	}
+
+	/*
+	* Record the chunks on the job system, each task allocating from and recording into its own pool. Pools
+	* belong to tasks rather than workers, a task runs on one worker start to end so its pool is never shared
+	*/
+
+	size_t threadCount = std::min(recording_threads.size(), std::max<size_t>(jobs.size(), 1));
+	std::atomic<size_t> nextJob{ 0 };
+
+	auto recordJobs = [&](size_t ThreadIdx) {
+		RecordingThreadData& thread = recording_threads[ThreadIdx];
+
+		if (!DrawStagesOnly) {
+			context->primary_logical_device.resetCommandPool(thread.command_pool, vk::CommandPoolResetFlags(0));
 		}
 
-		currentCommandBuffer.endRenderPass();
+		context->primary_logical_device.resetCommandPool(thread.draw_command_pool, vk::CommandPoolResetFlags(0));
 
-		currentCommandBuffer.end();
+		size_t usedCommandBuffers = 0;
+		size_t usedDrawCommandBuffers = 0;
+
+		auto nextCommandBuffer = [&](vk::CommandPool Pool, std::vector<vk::CommandBuffer>& CommandBuffers, size_t& Used) {
+			if (Used == CommandBuffers.size()) {
+				vk::CommandBufferAllocateInfo commandBufferInfo;
+				commandBufferInfo.commandPool = Pool;
+				commandBufferInfo.level = vk::CommandBufferLevel::eSecondary;
+				commandBufferInfo.commandBufferCount = static_cast<uint32_t>(std::max<size_t>(CommandBuffers.size(), 4));
+
+				auto allocated = context->primary_logical_device.allocateCommandBuffers(commandBufferInfo);
+				CommandBuffers.insert(CommandBuffers.end(), allocated.begin(), allocated.end());
+			}
+
+			return CommandBuffers[Used++];
+		};
+
+		for (size_t j = nextJob++; j < jobs.size(); j = nextJob++) {
+			const RecordingJob& job = jobs[j];
+
+			bool isDrawStage = job.stage == RecordingStage::Depth || job.stage == RecordingStage::Color;
+
+			vk::CommandBuffer commandBuffer = isDrawStage ?
+				nextCommandBuffer(thread.draw_command_pool, thread.draw_command_buffers, usedDrawCommandBuffers) :
+				nextCommandBuffer(thread.command_pool, thread.secondary_command_buffers, usedCommandBuffers);
+
+			record_secondary_command_buffer(job.frame, job.stage, job.first, job.count, commandBuffer);
+
+			*job.target = commandBuffer;
+		}
+	};
+
+	JobSystem::TaskGroup group;
+
+	for (size_t t = 1; t < threadCount; t++) {
+		job_system.run(group, [&recordJobs, t]() {
+			recordJobs(t);
+		});
 	}
 
+	recordJobs(0);
+
+	job_system.wait(group);
+
 	are_command_buffers_recorded = true;
 }
 
@@ -1587,8 +4312,20 @@ void RendererImpl::reset_command_buffers() {
 	context->primary_logical_device.waitIdle();
 	are_command_buffers_recorded = false;
 
-	for (auto& commandBuffer : primary_render_command_buffers) {
-		commandBuffer.reset();
+	for (auto& frame : in_flight_frames) {
+		frame.primary_command_buffer.reset();
+
+		frame.sampling_command_buffers.clear();
+		frame.culling_command_buffers.clear();
+		frame.composition_command_buffers.clear();
+		frame.animate_command_buffers.clear();
+		frame.depth_command_buffers.clear();
+		frame.color_command_buffers.clear();
+	}
+
+	for (auto& thread : recording_threads) {
+		context->primary_logical_device.resetCommandPool(thread.command_pool, vk::CommandPoolResetFlags(0));
+		context->primary_logical_device.resetCommandPool(thread.draw_command_pool, vk::CommandPoolResetFlags(0));
 	}
 }
 
@@ -1607,13 +4344,27 @@ void RendererImpl::window_maximized_callback() {
 void RendererImpl::window_restored_callback() {
 	context->primary_logical_device.waitIdle();
 
+	vk::Format previousFormat = render_pass_color_format;
+
 	destroy_render_state();
 	create_render_state();
 
-	for (auto& pipeline : pipelines) {
-		pipeline.second.reinit();
+	if (!are_command_buffers_recorded) {
+		return;
 	}
 
-	reset_command_buffers();
-	record_command_buffers();
+	// A new render pass invalidates the pipelines and every secondary recorded against it
+	if (render_pass_color_format != previousFormat) {
+		for (auto& pipeline : pipelines) {
+			pipeline.second.reinit();
+		}
+
+		reset_command_buffers();
+		record_command_buffers();
+
+		return;
+	}
+
+	// Pipelines and the skinning secondaries don't depend on the extent
+	record_command_buffers(true);
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "skeleton.h"
 
+#include <algorithm>
+#include <numeric>
+
 void Skeleton::add_bone(const Bone& bone, const std::string& name) {
 	add_bone(bone, CRC::crc64(name));
 }
@@ -7,6 +10,7 @@ void Skeleton::add_bone(const Bone& bone, const std::string& name) {
 void Skeleton::add_bone(const Bone& bone, StringHash name) {
 	bones.push_back(bone);
 	bone_names.push_back(name);
+	finalized = false;
 }
 
 Retval<Bone*, Skeleton::Error> Skeleton::get_bone(const std::string& name) {
@@ -44,6 +48,7 @@ void Skeleton::add_bone_relationship(const std::string& parent, const std::strin
 
 void Skeleton::add_bone_relationship(StringHash parent, StringHash child) {
 	bone_relationships.push_back({ parent, child });
+	finalized = false;
 }
 
 Retval<std::vector<StringHash>, Skeleton::Error> Skeleton::get_bone_children(const std::string& parent) {
@@ -163,6 +168,8 @@ void Skeleton::add_animation(const Animation& animation, const std::string& name
 void Skeleton::add_animation(const Animation& animation, StringHash name) {
 	animations.push_back(animation);
 	animation_names.push_back(name);
+	compressed_animations.emplace_back();
+	finalized = false;
 }
 
 Retval<Animation*, Skeleton::Error> Skeleton::get_animation(const std::string& name) {
@@ -190,9 +197,19 @@ Skeleton::Error Skeleton::play_animation(StringHash name, bool loop) {
 		return e;
 	}
 
-	active_animation = anim;
 	is_looped = loop;
 
+	// Playing the active animation again keeps its playback going
+	if (anim == active_animation) {
+		return e;
+	}
+
+	active_animation = anim;
+	animation_start_time = std::chrono::steady_clock::now();
+
+	bool isCompressed = !compressed_animations[anim - animations.data()].empty();
+	channel_cursors.assign(anim->channels.size() * (isCompressed ? CompressedAnimation::TRACKS_PER_CHANNEL : 1), 0);
+
 	return e;
 }
 
@@ -200,81 +217,219 @@ void Skeleton::clear_animation() {
 	active_animation = nullptr;
 }
 
-std::vector<Bone> Skeleton::sample_animation_frame() {
-	std::vector<Bone> outBones{ bones.begin(), bones.end() };
+Skeleton::Error Skeleton::compress_animations(const AnimationCompressionSettings& settings) {
+	for (size_t a = 0; a < animations.size(); a++) {
+		if (!compressed_animations[a].empty()) {
+			continue;
+		}
 
-	// Sample active bones
-	if (active_animation != nullptr) {
-		auto now = std::chrono::steady_clock::now();
-		auto timeDiff = std::chrono::duration_cast<std::chrono::milliseconds>(now - animation_start_time);
-
-		for (StringHash name : active_animation->channel_names) {
-			Bone* outBone = nullptr;
-			size_t boneIdx = 0;
-
-			for (size_t i = 0; i < bone_names.size(); i++) {
-				if (bone_names[i] == name) {
-					outBone = &outBones[i];
-					boneIdx = i;
-					break;
-				}
-			}
+		auto [compressed, e] = CompressedAnimation::compress(animations[a], settings);
+
+		if (e != CompressedAnimation::Error::OK) {
+			return Error::INVALID_ANIMATION;
+		}
+
+		compressed_animations[a] = std::move(compressed);
+
+		// Channels stay for their count and interpolation, only the keys go
+		for (auto& channel : animations[a].channels) {
+			channel.time_points = {};
+			channel.keyframes = {};
+		}
+	}
+
+	finalized = false;
+
+	return Error::OK;
+}
 
-			auto [channel, error] = active_animation->get_channel(name);
+Skeleton::Error Skeleton::finalize() {
+	parent_indices.assign(bones.size(), NO_BONE);
 
-			auto [frame, status] = channel->sample(timeDiff);
+	for (auto& relationship : bone_relationships) {
+		auto [parentIdx, pe] = get_bone_index(relationship.parent);
+		auto [childIdx, ce] = get_bone_index(relationship.child);
+
+		// Relationships may name nodes that are not part of the skin
+		if (pe != Error::OK || ce != Error::OK) {
+			continue;
+		}
+
+		parent_indices[childIdx] = static_cast<uint32_t>(parentIdx);
+	}
+
+	/*
+	* Sorting by depth puts every parent before its children
+	*/
+	std::vector<uint32_t> depths(bones.size(), NO_BONE);
+	std::vector<uint32_t> chain;
 
-			if (status == Channel::Status::PAST_END) {
-				animation_start_time = now;
+	for (uint32_t i = 0; i < bones.size(); i++) {
+		chain.clear();
+
+		// Walk up until a bone with a known depth or a root
+		uint32_t current = i;
+
+		while (depths[current] == NO_BONE) {
+			chain.push_back(current);
+
+			if (chain.size() > bones.size()) {
+				topological_order.clear();
+				return Error::CYCLIC_HIERARCHY;
 			}
 
-			if (outBone != nullptr) {
-				outBone->rotation = frame.rotation;
-				outBone->position = frame.position;
-				outBone->rotation = frame.rotation;
+			if (parent_indices[current] == NO_BONE) {
+				break;
 			}
+
+			current = parent_indices[current];
+		}
+
+		uint32_t depth = depths[current] == NO_BONE ? 0 : depths[current] + 1;
+
+		for (auto it = chain.rbegin(); it != chain.rend(); it++) {
+			depths[*it] = depth++;
 		}
 	}
 
-	auto getBoneIdx = [this](StringHash name) -> size_t {
-		for (size_t i = 0; i < bone_names.size(); i++) {
-			if (bone_names[i] == name) {
-				return i;
+	topological_order.resize(bones.size());
+	std::iota(topological_order.begin(), topological_order.end(), 0);
+
+	std::stable_sort(topological_order.begin(), topological_order.end(), [&depths](uint32_t A, uint32_t B) {
+		return depths[A] < depths[B];
+	});
+
+	/*
+	* Channels are matched to bones once instead of on every sample
+	*/
+	animation_channel_bones.resize(animations.size());
+	animation_durations.assign(animations.size(), std::chrono::milliseconds(0));
+
+	for (size_t a = 0; a < animations.size(); a++) {
+		const Animation& animation = animations[a];
+		const CompressedAnimation& compressed = compressed_animations[a];
+		std::vector<uint32_t>& channelBones = animation_channel_bones[a];
+
+		channelBones.assign(animation.channels.size(), NO_BONE);
+
+		for (size_t c = 0; c < animation.channels.size(); c++) {
+			auto [boneIdx, e] = get_bone_index(animation.channel_names[c]);
+			bool hasKeys = compressed.empty() ? !animation.channels[c].time_points.empty() : compressed.has_keys(c);
+
+			if (e == Error::OK && hasKeys) {
+				channelBones[c] = static_cast<uint32_t>(boneIdx);
+
+				auto duration = compressed.empty() ? animation.channels[c].time_points.back() : compressed.get_channel_duration(c);
+				animation_durations[a] = std::max(animation_durations[a], duration);
 			}
 		}
+	}
 
-		return 0;
-	};
+	finalized = true;
 
-	// Propagate transformations
-	auto [root, e] = get_root_bone();
+	return Error::OK;
+}
+
+std::chrono::milliseconds Skeleton::get_animation_time(std::chrono::steady_clock::time_point now) {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(now - animation_start_time);
+}
+
+Skeleton::Error Skeleton::sample_animation_frame(std::chrono::milliseconds time, std::span<Bone> out) {
+	return sample_animation(active_animation, time, is_looped, out, channel_cursors);
+}
+
+std::vector<Bone> Skeleton::sample_animation_frame() {
+	std::vector<Bone> outBones(bones.size());
+
+	if (sample_animation_frame(get_animation_time(), outBones) != Error::OK) {
+		return bones;
+	}
+
+	return outBones;
+}
+
+Skeleton::Error Skeleton::sample_animation(const std::string& name, std::chrono::milliseconds time, bool loop, std::span<Bone> out, std::vector<size_t>& cursors) {
+	return sample_animation(CRC::crc64(name), time, loop, out, cursors);
+}
+
+Skeleton::Error Skeleton::sample_animation(StringHash name, std::chrono::milliseconds time, bool loop, std::span<Bone> out, std::vector<size_t>& cursors) {
+	auto [anim, e] = get_animation(name);
+
+	if (e != Error::OK) {
+		return e;
+	}
+
+	return sample_animation(anim, time, loop, out, cursors);
+}
+
+Skeleton::Error Skeleton::sample_animation(const Animation* animation, std::chrono::milliseconds time, bool loop, std::span<Bone> out, std::vector<size_t>& cursors) {
+	if (out.size() < bones.size()) {
+		return Error::OUTPUT_TOO_SMALL;
+	}
 
-	std::vector<Retval<std::vector<StringHash>, Error>> currGen;
-	currGen.push_back(get_bone_children(root));
+	if (!finalized) {
+		Error e = finalize();
 
-	do {
-		std::vector<Retval<std::vector<StringHash>, Error>> newGen;
+		if (e != Error::OK) {
+			return e;
+		}
+	}
 
-		for (auto& children : currGen) {
-			for (auto child : children.value) {
-				auto [parentName, pe] = get_bone_parent(child);
-				size_t parentIdx = getBoneIdx(parentName);
-				size_t childIdx = getBoneIdx(child);
+	std::copy(bones.begin(), bones.end(), out.begin());
 
-				Bone* parentBone = &outBones[parentIdx];
-				Bone* childBone = &outBones[childIdx];
+	// Sample active bones
+	if (animation != nullptr) {
+		size_t animationIdx = animation - animations.data();
+		const std::vector<uint32_t>& channelBones = animation_channel_bones[animationIdx];
+		std::chrono::milliseconds duration = animation_durations[animationIdx];
+		const CompressedAnimation& compressed = compressed_animations[animationIdx];
+		size_t cursorCount = compressed.empty() ? channelBones.size() : channelBones.size() * CompressedAnimation::TRACKS_PER_CHANNEL;
+
+		if (cursors.size() != cursorCount) {
+			cursors.assign(cursorCount, 0);
+		}
+
+		if (loop && duration.count() > 0 && time > duration) {
+			time %= duration;
+		}
+
+		for (size_t c = 0; c < channelBones.size(); c++) {
+			if (channelBones[c] == NO_BONE) {
+				continue;
+			}
 
-				glm::vec3 rotatedOffset = parentBone->rotation * childBone->position;
-				childBone->position = parentBone->position + rotatedOffset;
+			Keyframe frame;
 
-				childBone->rotation = parentBone->rotation * childBone->rotation;
-				
-				newGen.push_back(get_bone_children(child));
+			if (compressed.empty()) {
+				frame = animation->channels[c].sample(time, cursors[c]).value;
 			}
+			else {
+				std::span<size_t, CompressedAnimation::TRACKS_PER_CHANNEL> trackCursors(&cursors[c * CompressedAnimation::TRACKS_PER_CHANNEL], CompressedAnimation::TRACKS_PER_CHANNEL);
+				frame = compressed.sample(c, time, trackCursors);
+			}
+
+			Bone& outBone = out[channelBones[c]];
+			outBone.rotation = frame.rotation;
+			outBone.position = frame.position;
 		}
+	}
 
-		currGen = newGen;
-	} while (!currGen.empty());
+	// Propagate transformations, parents are always final before their children
+	for (uint32_t boneIdx : topological_order) {
+		uint32_t parentIdx = parent_indices[boneIdx];
 
-	return outBones;
+		if (parentIdx == NO_BONE) {
+			continue;
+		}
+
+		const Bone& parentBone = out[parentIdx];
+		Bone& childBone = out[boneIdx];
+
+		glm::vec3 rotatedOffset = parentBone.rotation * childBone.position;
+		childBone.position = parentBone.position + rotatedOffset;
+
+		childBone.rotation = parentBone.rotation * childBone.rotation;
+	}
+
+	return Error::OK;
 }
\ No newline at end of file
@@ -7,7 +7,7 @@ Swapchain::~Swapchain() {
 	deinit();
 }
 
-Swapchain::Error Swapchain::init(GfxContext* Context) {
+Swapchain::Error Swapchain::init(GfxContext* Context, size_t FramesInFlight) {
 	if (!Context) {
 		return Error::INVALID_CONTEXT;
 	}
@@ -17,6 +17,8 @@ Swapchain::Error Swapchain::init(GfxContext* Context) {
 	}
 
 	context = Context;
+	offscreen = false;
+	max_frames_in_flight = std::max<size_t>(FramesInFlight, 1);
 	
 	auto surfaceCapabilities = context->primary_physical_device.getSurfaceCapabilitiesKHR(context->render_surface);
 	auto surfaceFormats = context->primary_physical_device.getSurfaceFormatsKHR(context->render_surface);
@@ -125,6 +127,87 @@ Swapchain::Error Swapchain::init(GfxContext* Context) {
 
 	images = context->primary_logical_device.getSwapchainImagesKHR(swapchain);
 
+	Error viewError = create_image_views();
+
+	if (viewError != Error::OK) {
+		return viewError;
+	}
+
+	Error syncError = create_sync_objects();
+
+	if (syncError != Error::OK) {
+		return syncError;
+	}
+
+	/*
+	* Finish initialization
+	*/
+	
+	current_frame = 0;
+	is_init = true;
+
+	return Error::OK;
+}
+
+Swapchain::Error Swapchain::init_offscreen(GfxContext* Context, vk::Extent2D Extent, size_t ImageCount, size_t FramesInFlight) {
+	if (!Context) {
+		return Error::INVALID_CONTEXT;
+	}
+
+	if (!Context->is_initialized()) {
+		return Error::UNINITIALIZED_CONTEXT;
+	}
+
+	context = Context;
+	offscreen = true;
+	max_frames_in_flight = std::max<size_t>(FramesInFlight, 1);
+
+	format = vk::Format::eR8G8B8A8Srgb;
+	extent = Extent;
+
+	offscreen_images.resize(std::max<size_t>(ImageCount, 1));
+	images.resize(offscreen_images.size());
+
+	for (size_t i = 0; i < offscreen_images.size(); i++) {
+		offscreen_images[i] = context->create_texture(
+			vk::ImageType::e2D,
+			format,
+			vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+			vk::Extent3D{ extent, 1 },
+			MemoryCategory::RenderTargets
+		);
+
+		if (!offscreen_images[i].image) {
+			return Error::FAIL_CREATE_OFFSCREEN_IMAGE;
+		}
+
+		images[i] = offscreen_images[i].image;
+	}
+
+	Error viewError = create_image_views();
+
+	if (viewError != Error::OK) {
+		return viewError;
+	}
+
+	Error syncError = create_sync_objects();
+
+	if (syncError != Error::OK) {
+		return syncError;
+	}
+
+	/*
+	* Finish initialization
+	*/
+
+	current_frame = 0;
+	current_offscreen_image = 0;
+	is_init = true;
+
+	return Error::OK;
+}
+
+Swapchain::Error Swapchain::create_image_views() {
 	image_views.resize(images.size());
 
 	for (size_t i = 0; i < images.size(); i++) {
@@ -152,9 +235,10 @@ Swapchain::Error Swapchain::init(GfxContext* Context) {
 		image_views[i] = imageView;
 	}
 
+	return Error::OK;
+}
 
-	max_frames_in_flight = image_views.size();
-
+Swapchain::Error Swapchain::create_sync_objects() {
 	/*
 	* Create synchronization primitives
 	*/
@@ -180,19 +264,21 @@ Swapchain::Error Swapchain::init(GfxContext* Context) {
 		}
 	}
 
-	/*
-	* Finish initialization
-	*/
-	
-	current_frame = 0;
-	is_init = true;
-
 	return Error::OK;
 }
 
 Swapchain::Error Swapchain::reinit() {
+	size_t framesInFlight = max_frames_in_flight;
+
+	if (offscreen) {
+		size_t imageCount = offscreen_images.size();
+
+		deinit();
+		return init_offscreen(context, extent, imageCount, framesInFlight);
+	}
+
 	deinit();
-	return init(context);
+	return init(context, framesInFlight);
 }
 
 void Swapchain::deinit() {
@@ -230,8 +316,16 @@ void Swapchain::deinit() {
 			image_views.clear();
 		}
 
+		for (auto& image : offscreen_images) {
+			context->destroy_texture(image);
+		}
+
+		offscreen_images.clear();
+		images.clear();
+
 		if (swapchain) {
 			context->primary_logical_device.destroy(swapchain);
+			swapchain = nullptr;
 		}
 	}
 }
@@ -240,36 +334,56 @@ Retval <Swapchain::Frame, Swapchain::Error> Swapchain::prepare_frame() {
 	std::array<vk::Fence, 1> currentFences = { in_flight_fences[current_frame] };
 	context->primary_logical_device.waitForFences(currentFences, VK_TRUE, UINT64_MAX);
 
-	auto imageIndex = context->primary_logical_device.acquireNextImageKHR(swapchain, UINT64_MAX, image_available_semaphores[current_frame], nullptr);
+	FrameId imageIdx;
 
-	if (imageIndex.result != vk::Result::eSuccess) {
-		return { {}, Error::FAIL_ACQUIRE_IMAGE };
+	// Offscreen images are cycled in order, nothing to acquire
+	if (offscreen) {
+		imageIdx = static_cast<FrameId>(current_offscreen_image);
 	}
+	else {
+		auto imageIndex = context->primary_logical_device.acquireNextImageKHR(swapchain, UINT64_MAX, image_available_semaphores[current_frame], nullptr);
+
+		if (imageIndex.result == vk::Result::eErrorOutOfDateKHR) {
+			return { {}, Error::OUT_OF_DATE };
+		}
 
-	if (imageIndex.result == vk::Result::eErrorOutOfDateKHR) {
-		return { {}, Error::OUT_OF_DATE };
+		if (imageIndex.result != vk::Result::eSuccess && imageIndex.result != vk::Result::eSuboptimalKHR) {
+			return { {}, Error::FAIL_ACQUIRE_IMAGE };
+		}
+
+		imageIdx = imageIndex.value;
 	}
 
-	if (images_in_flight[current_frame]) {
-		std::array<vk::Fence, 1> ImageInFlightFences = { images_in_flight[current_frame] };
+	// The image may still be in use by a different frame in flight
+	if (images_in_flight[imageIdx] && images_in_flight[imageIdx] != in_flight_fences[current_frame]) {
+		std::array<vk::Fence, 1> ImageInFlightFences = { images_in_flight[imageIdx] };
 		context->primary_logical_device.waitForFences(ImageInFlightFences, VK_TRUE, UINT64_MAX);
-		images_in_flight[current_frame] = nullptr;
 	}
 
+	images_in_flight[imageIdx] = in_flight_fences[current_frame];
+
 	context->primary_logical_device.resetFences(currentFences);
 
 	return {
-		image_available_semaphores[current_frame],
-		render_finished_semaphores[current_frame],
-		in_flight_fences[current_frame],
-		imageIndex.value
+		{
+			offscreen ? nullptr : image_available_semaphores[current_frame],
+			offscreen ? nullptr : render_finished_semaphores[current_frame],
+			in_flight_fences[current_frame],
+			imageIdx,
+			static_cast<FrameId>(current_frame)
+		},
+		Error::OK
 	};
 }
 
 Swapchain::Error Swapchain::present_frame(Frame Frame) {
 	Error retval = Error::OK;
 
-	images_in_flight[Frame.id] = in_flight_fences[current_frame];
+	if (offscreen) {
+		current_offscreen_image = (current_offscreen_image + 1) % images.size();
+		current_frame = (current_frame + 1) % max_frames_in_flight;
+		return retval;
+	}
 
 	vk::PresentInfoKHR presentInfo;
 	presentInfo.waitSemaphoreCount = 1;
@@ -0,0 +1,348 @@
+#include "uploadmanager.h"
+
+#include <algorithm>
+#include <cstring>
+
+UploadManager::~UploadManager() {
+	deinit();
+}
+
+UploadManager::Error UploadManager::init(GfxContext* Context, vk::Queue Queue, uint32_t QueueFamilyIndex, vk::DeviceSize StagingSize, size_t BatchCount) {
+	if (is_init) {
+		deinit();
+	}
+
+	if (Context == nullptr) {
+		LOG_ERROR("Invalid context");
+		return Error::INVALID_CONTEXT;
+	}
+
+	if (Context->primary_logical_device == VK_NULL_HANDLE || Context->allocator == VK_NULL_HANDLE) {
+		LOG_ERROR("Uninitialized context");
+		return Error::UNINITIALIZED_CONTEXT;
+	}
+
+	context = Context;
+	queue = Queue;
+	queue_family_index = QueueFamilyIndex;
+
+	// Copy offsets into images must be a multiple of the texel size, 16 covers every format in use
+	vk::PhysicalDeviceLimits limits = context->get_physical_device_properties().limits;
+
+	alignment = std::max({
+		limits.optimalBufferCopyOffsetAlignment,
+		limits.nonCoherentAtomSize,
+		vk::DeviceSize(16)
+	});
+
+	/*
+	* Command buffers are reset and reused once their batch retires
+	*/
+	vk::CommandPoolCreateInfo poolInfo;
+	poolInfo.queueFamilyIndex = queue_family_index;
+	poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient;
+
+	command_pool = context->primary_logical_device.createCommandPool(poolInfo);
+
+	if (!command_pool) {
+		LOG_ERROR("Failed to create upload command pool");
+		return Error::FAIL_CREATE_COMMAND_POOL;
+	}
+
+	batches.clear();
+	batches.resize(std::max<size_t>(BatchCount, 1));
+
+	vk::CommandBufferAllocateInfo commandAllocInfo;
+	commandAllocInfo.level = vk::CommandBufferLevel::ePrimary;
+	commandAllocInfo.commandPool = command_pool;
+	commandAllocInfo.commandBufferCount = static_cast<uint32_t>(batches.size());
+
+	std::vector<vk::CommandBuffer> commandBuffers = context->primary_logical_device.allocateCommandBuffers(commandAllocInfo);
+
+	for (size_t i = 0; i < batches.size(); i++) {
+		batches[i].command_buffer = commandBuffers[i];
+		batches[i].fence = context->primary_logical_device.createFence({});
+	}
+
+	current_batch = 0;
+	oldest_batch = 0;
+	submitted_serial = 0;
+	completed_serial = 0;
+
+	/*
+	* Staging ring
+	*/
+	staging = context->create_mapped_buffer(std::max(align_up(StagingSize, alignment), alignment), vk::BufferUsageFlagBits::eTransferSrc, MemoryCategory::Staging);
+
+	if (!staging.buffer || staging.mapped_data == nullptr) {
+		LOG_ERROR("Failed to create persistently mapped staging buffer");
+
+		if (staging.buffer) {
+			context->destroy_buffer(staging);
+		}
+
+		staging = {};
+
+		for (auto& b : batches) {
+			context->primary_logical_device.destroy(b.fence);
+		}
+
+		batches.clear();
+
+		context->primary_logical_device.destroy(command_pool);
+		command_pool = nullptr;
+
+		return Error::FAIL_CREATE_BUFFER;
+	}
+
+	ring_head = 0;
+	ring_used = 0;
+
+	is_init = true;
+
+	return Error::OK;
+}
+
+void UploadManager::deinit() {
+	if (!is_init) {
+		return;
+	}
+
+	wait();
+
+	// An open batch was never submitted, its commands are simply dropped
+	for (auto& b : batches) {
+		retire(b);
+		context->primary_logical_device.destroy(b.fence);
+	}
+
+	batches.clear();
+
+	context->primary_logical_device.destroy(command_pool);
+	command_pool = nullptr;
+
+	context->destroy_buffer(staging);
+	staging = {};
+
+	ring_head = 0;
+	ring_used = 0;
+
+	is_init = false;
+}
+
+void UploadManager::upload_buffer(BufferAllocation Dest, const void* Source, size_t Size, vk::DeviceSize DestOffset) {
+	if (!is_init || Size == 0) {
+		return;
+	}
+
+	StagingRegion region = write_staging(Source, Size);
+
+	vk::BufferCopy copyRegion;
+	copyRegion.srcOffset = region.offset;
+	copyRegion.dstOffset = DestOffset;
+	copyRegion.size = Size;
+
+	get_command_buffer().copyBuffer(region.buffer, Dest.buffer, copyRegion);
+}
+
+void UploadManager::upload_texture(TextureAllocation Dest, const void* Source, size_t Size) {
+	if (!is_init || Size == 0) {
+		return;
+	}
+
+	StagingRegion region = write_staging(Source, Size);
+
+	vk::BufferImageCopy copyRegion;
+	copyRegion.bufferOffset = region.offset;
+	copyRegion.bufferRowLength = 0;
+	copyRegion.bufferImageHeight = 0;
+
+	copyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+	copyRegion.imageSubresource.mipLevel = 0;
+	copyRegion.imageSubresource.baseArrayLayer = 0;
+	copyRegion.imageSubresource.layerCount = 1;
+
+	copyRegion.imageOffset = vk::Offset3D{ 0, 0, 0 };
+	copyRegion.imageExtent = Dest.dimensions;
+
+	get_command_buffer().copyBufferToImage(region.buffer, Dest.image, vk::ImageLayout::eTransferDstOptimal, copyRegion);
+}
+
+vk::CommandBuffer UploadManager::get_command_buffer() {
+	if (!has_open_batch()) {
+		begin_batch();
+	}
+
+	return batches[current_batch].command_buffer;
+}
+
+uint64_t UploadManager::flush() {
+	if (!has_open_batch()) {
+		return submitted_serial;
+	}
+
+	Batch& batch = batches[current_batch];
+
+	// Makes every write of the batch visible to whatever is submitted after it on the queue
+	vk::MemoryBarrier barrier;
+	barrier.srcAccessMask = vk::AccessFlagBits::eMemoryWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite;
+
+	batch.command_buffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eAllCommands,
+		vk::PipelineStageFlagBits::eAllCommands,
+		vk::DependencyFlagBits(0),
+		barrier,
+		nullptr,
+		nullptr
+	);
+
+	batch.command_buffer.end();
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.command_buffer;
+
+	queue.submit(submitInfo, batch.fence);
+
+	batch.state = BatchState::InFlight;
+	batch.serial = ++submitted_serial;
+	current_batch = (current_batch + 1) % batches.size();
+
+	// Reclaim whatever already finished, never blocks
+	while (retire_oldest(false));
+
+	return batch.serial;
+}
+
+bool UploadManager::is_complete(uint64_t Serial) {
+	if (!is_init) {
+		return false;
+	}
+
+	while (retire_oldest(false));
+
+	return completed_serial >= Serial;
+}
+
+void UploadManager::wait() {
+	if (!is_init) {
+		return;
+	}
+
+	while (retire_oldest(true));
+}
+
+UploadManager::StagingRegion UploadManager::write_staging(const void* Source, size_t Size) {
+	if (Size > staging.size) {
+		BufferAllocation transferBuffer = context->create_transfer_buffer(Size);
+
+		void* data;
+		vmaMapMemory(context->allocator, transferBuffer.allocation, &data);
+		std::memcpy(data, Source, Size);
+		vmaUnmapMemory(context->allocator, transferBuffer.allocation);
+
+		vmaFlushAllocation(context->allocator, transferBuffer.allocation, 0, Size);
+
+		get_command_buffer();
+		batches[current_batch].dedicated_buffers.push_back(transferBuffer);
+
+		return { transferBuffer.buffer, 0 };
+	}
+
+	// The open batch must own the space it writes to
+	get_command_buffer();
+
+	for (;;) {
+		if (ring_used == 0) {
+			ring_head = 0;
+		}
+
+		vk::DeviceSize offset = align_up(ring_head, alignment);
+		vk::DeviceSize padding = offset - ring_head;
+
+		// Wrap around, the skipped tail is released with this batch
+		if (offset + Size > staging.size) {
+			offset = 0;
+			padding = staging.size - ring_head;
+		}
+
+		vk::DeviceSize needed = padding + Size;
+
+		if (ring_used + needed <= staging.size) {
+			ring_head = offset + Size;
+			ring_used += needed;
+			batches[current_batch].ring_bytes += needed;
+
+			std::memcpy(static_cast<uint8_t*>(staging.mapped_data) + offset, Source, Size);
+			vmaFlushAllocation(context->allocator, staging.allocation, offset, Size);
+
+			return { staging.buffer, offset };
+		}
+
+		// Only the open batch holds the space, submit it so it can retire
+		if (!retire_oldest(true)) {
+			flush();
+			get_command_buffer();
+		}
+	}
+}
+
+void UploadManager::begin_batch() {
+	Batch& batch = batches[current_batch];
+
+	// Every batch is in flight, the one to reuse is the oldest
+	while (batch.state == BatchState::InFlight) {
+		retire_oldest(true);
+	}
+
+	context->primary_logical_device.resetFences(batch.fence);
+	batch.command_buffer.reset();
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+
+	batch.command_buffer.begin(beginInfo);
+
+	batch.state = BatchState::Recording;
+	batch.ring_bytes = 0;
+}
+
+bool UploadManager::retire_oldest(bool Wait) {
+	Batch& batch = batches[oldest_batch];
+
+	if (batch.state != BatchState::InFlight) {
+		return false;
+	}
+
+	if (Wait) {
+		vk::Result result = context->primary_logical_device.waitForFences(batch.fence, VK_TRUE, UINT64_MAX);
+
+		if (result != vk::Result::eSuccess) {
+			LOG_ERROR("Failed to wait for upload batch");
+			return false;
+		}
+	}
+	else if (context->primary_logical_device.getFenceStatus(batch.fence) != vk::Result::eSuccess) {
+		return false;
+	}
+
+	completed_serial = batch.serial;
+
+	retire(batch);
+	oldest_batch = (oldest_batch + 1) % batches.size();
+
+	return true;
+}
+
+void UploadManager::retire(Batch& Retired) {
+	ring_used -= std::min(ring_used, Retired.ring_bytes);
+
+	for (auto& buf : Retired.dedicated_buffers) {
+		context->destroy_buffer(buf);
+	}
+
+	Retired.dedicated_buffers.clear();
+	Retired.ring_bytes = 0;
+	Retired.state = BatchState::Free;
+}
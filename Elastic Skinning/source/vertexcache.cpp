@@ -0,0 +1,229 @@
+#include "vertexcache.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace VertexCache {
+
+	static constexpr float QUANTIZATION_STEPS = 65535.0f;
+	// Largest delta magnitude a shift is chosen for, one short of the int8 range so the error carried over from
+	// the frame before still fits
+	static constexpr int32_t DELTA_RANGE = 126;
+
+	static int32_t quantize(float Value) {
+		return static_cast<int32_t>(std::clamp(std::round(Value * QUANTIZATION_STEPS), 0.0f, QUANTIZATION_STEPS));
+	}
+
+	static glm::vec2 octahedral_encode(glm::vec3 Normal) {
+		float sum = std::abs(Normal.x) + std::abs(Normal.y) + std::abs(Normal.z);
+
+		if (sum <= 0.0f) {
+			return { 0.0f, 0.0f };
+		}
+
+		Normal /= sum;
+
+		if (Normal.z >= 0.0f) {
+			return { Normal.x, Normal.y };
+		}
+
+		// The lower hemisphere is folded over the diagonals
+		return {
+			(1.0f - std::abs(Normal.y)) * (Normal.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::abs(Normal.x)) * (Normal.y >= 0.0f ? 1.0f : -1.0f)
+		};
+	}
+
+	static glm::vec3 octahedral_decode(glm::vec2 Encoded) {
+		glm::vec3 normal(Encoded.x, Encoded.y, 1.0f - std::abs(Encoded.x) - std::abs(Encoded.y));
+		float fold = std::max(-normal.z, 0.0f);
+
+		normal.x += normal.x >= 0.0f ? -fold : fold;
+		normal.y += normal.y >= 0.0f ? -fold : fold;
+
+		return glm::normalize(normal);
+	}
+
+	static uint32_t key_word_count(uint32_t VertexCount) {
+		return (VertexCount * CHANNELS + 1) / 2;
+	}
+
+	Retval<Clip, Error> encode(std::span<const glm::vec3> Positions, std::span<const glm::vec3> Normals, uint32_t VertexCount, float FrameRate, std::chrono::milliseconds Duration, bool Looped) {
+		if (VertexCount == 0 || Positions.empty() || Positions.size() % VertexCount != 0 || Normals.size() != Positions.size() || FrameRate <= 0.0f) {
+			return { {}, Error::INVALID_FRAMES };
+		}
+
+		Clip ret;
+		ret.vertex_count = VertexCount;
+		ret.frame_count = static_cast<uint32_t>(Positions.size() / VertexCount);
+		ret.frame_rate = FrameRate;
+		ret.duration = Duration;
+		ret.looped = Looped;
+
+		/*
+		* Quantized channels of every frame
+		*/
+		glm::vec3 boundsMax = Positions[0];
+		ret.bounds_min = Positions[0];
+
+		for (const glm::vec3& p : Positions) {
+			ret.bounds_min = glm::min(ret.bounds_min, p);
+			boundsMax = glm::max(boundsMax, p);
+		}
+
+		ret.bounds_extent = boundsMax - ret.bounds_min;
+
+		std::vector<int32_t> quantized(Positions.size() * CHANNELS);
+
+		for (size_t i = 0; i < Positions.size(); i++) {
+			int32_t* channels = &quantized[i * CHANNELS];
+
+			for (glm::length_t c = 0; c < 3; c++) {
+				float extent = ret.bounds_extent[c];
+				channels[c] = quantize(extent > 0.0f ? (Positions[i][c] - ret.bounds_min[c]) / extent : 0.0f);
+			}
+
+			glm::vec2 normal = octahedral_encode(Normals[i]) * 0.5f + 0.5f;
+			channels[3] = quantize(normal.x);
+			channels[4] = quantize(normal.y);
+		}
+
+		/*
+		* Blocks of a key frame followed by deltas
+		*/
+		size_t channelsPerFrame = static_cast<size_t>(VertexCount) * CHANNELS;
+		uint32_t keyWords = key_word_count(VertexCount);
+
+		std::vector<int32_t> reconstructed(channelsPerFrame);
+
+		for (uint32_t firstFrame = 0; firstFrame < ret.frame_count; firstFrame += FRAMES_PER_BLOCK) {
+			Block block;
+			block.first_word = static_cast<uint32_t>(ret.data.size());
+			block.frame_count = std::min(FRAMES_PER_BLOCK, ret.frame_count - firstFrame);
+
+			const int32_t* blockChannels = &quantized[firstFrame * channelsPerFrame];
+
+			// Smallest shift that fits the largest change between two frames of the block
+			auto getShift = [&](uint32_t FirstChannel, uint32_t ChannelCount) {
+				int32_t largest = 0;
+
+				for (uint32_t f = 1; f < block.frame_count; f++) {
+					for (size_t v = 0; v < VertexCount; v++) {
+						for (uint32_t c = FirstChannel; c < FirstChannel + ChannelCount; c++) {
+							size_t i = v * CHANNELS + c;
+							largest = std::max(largest, std::abs(blockChannels[f * channelsPerFrame + i] - blockChannels[(f - 1) * channelsPerFrame + i]));
+						}
+					}
+				}
+
+				uint32_t shift = 0;
+
+				while ((DELTA_RANGE << shift) < largest) {
+					shift++;
+				}
+
+				return shift;
+			};
+
+			block.position_shift = getShift(0, 3);
+			block.normal_shift = getShift(3, 2);
+
+			ret.data.resize(ret.data.size() + keyWords, 0);
+
+			for (size_t i = 0; i < channelsPerFrame; i++) {
+				reconstructed[i] = blockChannels[i];
+				ret.data[block.first_word + i / 2] |= static_cast<uint32_t>(reconstructed[i]) << ((i % 2) * 16);
+			}
+
+			// Deltas are taken from the decoded frame before, so quantization errors don't add up over the block
+			size_t firstDeltaWord = ret.data.size();
+			ret.data.resize(firstDeltaWord + ((block.frame_count - 1) * channelsPerFrame + 3) / 4, 0);
+
+			for (uint32_t f = 1; f < block.frame_count; f++) {
+				for (size_t i = 0; i < channelsPerFrame; i++) {
+					uint32_t shift = (i % CHANNELS) < 3 ? block.position_shift : block.normal_shift;
+					int32_t scale = 1 << shift;
+					int32_t delta = blockChannels[f * channelsPerFrame + i] - reconstructed[i];
+
+					// Rounded half away from zero
+					int32_t stored = (std::abs(delta) + scale / 2) / scale;
+					stored = std::clamp(delta < 0 ? -stored : stored, -127, 127);
+
+					reconstructed[i] += stored * scale;
+
+					size_t byte = (f - 1) * channelsPerFrame + i;
+					ret.data[firstDeltaWord + byte / 4] |= (static_cast<uint32_t>(stored) & 0xFF) << ((byte % 4) * 8);
+				}
+			}
+
+			ret.blocks.push_back(block);
+		}
+
+		return { ret, Error::OK };
+	}
+
+	Error decode_frame(const Clip& Clip, uint32_t Frame, std::span<glm::vec3> Positions, std::span<glm::vec3> Normals) {
+		if (Frame >= Clip.frame_count || Positions.size() < Clip.vertex_count || Normals.size() < Clip.vertex_count) {
+			return Error::INVALID_FRAMES;
+		}
+
+		const Block& block = Clip.blocks[Frame / FRAMES_PER_BLOCK];
+		size_t channelsPerFrame = static_cast<size_t>(Clip.vertex_count) * CHANNELS;
+		size_t firstDeltaByte = static_cast<size_t>(block.first_word + key_word_count(Clip.vertex_count)) * 4;
+
+		for (size_t v = 0; v < Clip.vertex_count; v++) {
+			int32_t channels[CHANNELS];
+
+			for (uint32_t c = 0; c < CHANNELS; c++) {
+				size_t half = static_cast<size_t>(block.first_word) * 2 + v * CHANNELS + c;
+				channels[c] = (Clip.data[half / 2] >> ((half % 2) * 16)) & 0xFFFF;
+
+				for (uint32_t f = 1; f <= Frame % FRAMES_PER_BLOCK; f++) {
+					size_t byte = firstDeltaByte + (f - 1) * channelsPerFrame + v * CHANNELS + c;
+					int8_t delta = static_cast<int8_t>((Clip.data[byte / 4] >> ((byte % 4) * 8)) & 0xFF);
+
+					channels[c] += delta * (1 << (c < 3 ? block.position_shift : block.normal_shift));
+				}
+			}
+
+			Positions[v] = Clip.bounds_min + glm::vec3(channels[0], channels[1], channels[2]) / QUANTIZATION_STEPS * Clip.bounds_extent;
+			Normals[v] = octahedral_decode(glm::clamp(glm::vec2(channels[3], channels[4]) / QUANTIZATION_STEPS * 2.0f - 1.0f, -1.0f, 1.0f));
+		}
+
+		return Error::OK;
+	}
+
+	Playback get_playback(const Clip& Clip, std::chrono::milliseconds Time) {
+		Playback ret{ 0, 0, 0.0f, 0 };
+
+		if (Clip.frame_count < 2) {
+			return ret;
+		}
+
+		float duration = static_cast<float>(Clip.duration.count());
+		float time = static_cast<float>(Time.count());
+
+		if (Clip.looped && duration > 0.0f) {
+			time = std::fmod(time, duration);
+			time = time < 0.0f ? time + duration : time;
+		}
+		else {
+			time = std::clamp(time, 0.0f, duration);
+		}
+
+		float frameTime = 1000.0f / Clip.frame_rate;
+		uint32_t lastFrame = Clip.frame_count - 1;
+
+		ret.frame_a = std::min(static_cast<uint32_t>(time / frameTime), lastFrame);
+		ret.frame_b = std::min(ret.frame_a + 1, lastFrame);
+
+		// The last interval ends with the clip
+		float timeA = ret.frame_a * frameTime;
+		float timeB = std::min(ret.frame_b * frameTime, duration);
+
+		ret.weight = timeB > timeA ? std::clamp((time - timeA) / (timeB - timeA), 0.0f, 1.0f) : 0.0f;
+
+		return ret;
+	}
+
+}